@@ -13,6 +13,8 @@
 #include "pc/configfile.h"
 #include "seq_ids.h"
 #include "dialog_ids.h"
+#include "pc/audio/mod_seq.h"
+#include "pc/audio/audio_thread.h"
 
 #if defined(VERSION_EU) || defined(VERSION_SH)
 #define EU_FLOAT(x) x##f
@@ -319,6 +321,15 @@ STATIC_ASSERT(ARRAY_COUNT(sBackgroundMusicDefaultVolume) == SEQ_COUNT,
               "change this array if you are adding sequences");
 
 u8 sCurrentBackgroundMusicSeqId = SEQUENCE_NONE;
+
+// mod sequences may use ids past SEQ_COUNT and override the vanilla volume
+static f32 background_music_default_volume(u8 seqId) {
+    s32 volume = mod_seq_default_volume(seqId);
+    if (volume < 0) {
+        volume = seqId < SEQ_COUNT ? sBackgroundMusicDefaultVolume[seqId] : 127;
+    }
+    return volume / 127.0f;
+}
 u8 sMusicDynamicDelay = 0;
 u8 sSoundBankUsedListBack[SOUND_BANK_COUNT] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 u8 sSoundBankFreeListFront[SOUND_BANK_COUNT] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
@@ -815,6 +826,7 @@ struct SPTask *create_next_audio_frame_task(void) {
     return NULL;
 }
 void create_next_audio_buffer(s16 *samples, u32 num_samples) {
+    mod_seq_update();
     gAudioFrameCount++;
     if (sGameLoopTicked != 0) {
         update_game_sound();
@@ -832,6 +844,7 @@ void create_next_audio_buffer(s16 *samples, u32 num_samples) {
  * Called from threads: thread5_game_loop
  */
 void play_sound(s32 soundBits, f32 *pos) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_PLAY_SOUND, .args = { soundBits }, .pos = pos);
     sSoundRequests[sSoundRequestCount].soundBits = soundBits;
     sSoundRequests[sSoundRequestCount].position = pos;
     sSoundRequestCount++;
@@ -1350,6 +1363,7 @@ static void noop_8031EEC8(void) {
  * Called from threads: thread5_game_loop
  */
 void audio_signal_game_loop_tick(void) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_GAME_LOOP_TICK);
     sGameLoopTicked = 1;
 #if defined(VERSION_EU) || defined(VERSION_SH)
     maybe_tick_game_sound();
@@ -1790,6 +1804,7 @@ static void seq_player_play_sequence(u8 player, u8 seqId, u16 arg2) {
  * Called from threads: thread5_game_loop
  */
 void seq_player_fade_out(u8 player, u16 fadeDuration) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_SEQ_PLAYER_FADE_OUT, .args = { player, fadeDuration });
 #if defined(VERSION_EU) || defined(VERSION_SH)
 #ifdef VERSION_EU
     u32 fd = fadeDuration;
@@ -1813,6 +1828,9 @@ void seq_player_fade_out(u8 player, u16 fadeDuration) {
  */
 void fade_volume_scale(u8 player, u8 targetScale, u16 fadeDuration) {
     u8 i;
+
+    AUDIO_THREAD_DEFER(AUDIO_CALL_FADE_VOLUME_SCALE, .args = { player, targetScale, fadeDuration });
+
     for (i = 0; i < CHANNELS_MAX; i++) {
         fade_channel_volume_scale(player, i, targetScale, fadeDuration);
     }
@@ -2040,6 +2058,7 @@ void unused_8031FED0(u8 player, u32 bits, s8 arg2) {
  * Called from threads: thread5_game_loop
  */
 void seq_player_lower_volume(u8 player, u16 fadeDuration, u8 percentage) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_SEQ_PLAYER_LOWER_VOLUME, .args = { player, fadeDuration, percentage });
     if (player == SEQ_PLAYER_LEVEL) {
         sLowerBackgroundMusicVolume = TRUE;
         begin_background_music_fade(fadeDuration);
@@ -2057,6 +2076,7 @@ void seq_player_lower_volume(u8 player, u16 fadeDuration, u8 percentage) {
  * Called from threads: thread5_game_loop
  */
 void seq_player_unlower_volume(u8 player, u16 fadeDuration) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_SEQ_PLAYER_UNLOWER_VOLUME, .args = { player, fadeDuration });
     sLowerBackgroundMusicVolume = FALSE;
     if (player == SEQ_PLAYER_LEVEL) {
         if (gSequencePlayers[player].state != SEQUENCE_PLAYER_STATE_FADE_OUT) {
@@ -2115,7 +2135,7 @@ static u8 begin_background_music_fade(u16 fadeDuration) {
         } else {
 #if defined(VERSION_JP) || defined(VERSION_US)
             gSequencePlayers[SEQ_PLAYER_LEVEL].volume =
-                sBackgroundMusicDefaultVolume[sCurrentBackgroundMusicSeqId] / 127.0f;
+                background_music_default_volume(sCurrentBackgroundMusicSeqId);
 #endif
             seq_player_fade_to_normal_volume(SEQ_PLAYER_LEVEL, fadeDuration);
         }
@@ -2130,6 +2150,8 @@ static u8 begin_background_music_fade(u16 fadeDuration) {
 void set_audio_muted(u8 muted) {
     u8 i;
 
+    AUDIO_THREAD_DEFER(AUDIO_CALL_SET_AUDIO_MUTED, .args = { muted });
+
     for (i = 0; i < SEQUENCE_PLAYERS; i++) {
 #if defined(VERSION_EU) || defined(VERSION_SH)
         if (muted)
@@ -2231,9 +2253,13 @@ void get_currently_playing_sound(u8 bank, u8 *numPlayingSounds, u8 *numSoundsInB
  * Called from threads: thread5_game_loop
  */
 void stop_sound(u32 soundBits, f32 *pos) {
-    u8 bank = (soundBits & SOUNDARGS_MASK_BANK) >> SOUNDARGS_SHIFT_BANK;
-    u8 soundIndex = sSoundBanks[bank][0].next;
+    u8 bank;
+    u8 soundIndex;
+
+    AUDIO_THREAD_DEFER(AUDIO_CALL_STOP_SOUND, .args = { (s32)soundBits }, .pos = pos);
 
+    bank = (soundBits & SOUNDARGS_MASK_BANK) >> SOUNDARGS_SHIFT_BANK;
+    soundIndex = sSoundBanks[bank][0].next;
     while (soundIndex != 0xff) {
         // If sound has same id and source position pointer
         if ((u16)(soundBits >> SOUNDARGS_SHIFT_SOUNDID)
@@ -2257,6 +2283,8 @@ void stop_sounds_from_source(f32 *pos) {
     u8 bank;
     u8 soundIndex;
 
+    AUDIO_THREAD_DEFER(AUDIO_CALL_STOP_SOUNDS_FROM_SOURCE, .pos = pos);
+
     for (bank = 0; bank < SOUND_BANK_COUNT; bank++) {
         soundIndex = sSoundBanks[bank][0].next;
         while (soundIndex != 0xff) {
@@ -2290,6 +2318,7 @@ static void stop_sounds_in_bank(u8 bank) {
  * Called from threads: thread3_main, thread5_game_loop
  */
 void stop_sounds_in_continuous_banks(void) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_STOP_SOUNDS_IN_CONTINUOUS_BANKS);
     stop_sounds_in_bank(SOUND_BANK_MOVING);
     stop_sounds_in_bank(SOUND_BANK_ENV);
     stop_sounds_in_bank(SOUND_BANK_AIR);
@@ -2301,6 +2330,8 @@ void stop_sounds_in_continuous_banks(void) {
 void sound_banks_disable(UNUSED u8 player, u16 bankMask) {
     u8 i;
 
+    AUDIO_THREAD_DEFER(AUDIO_CALL_SOUND_BANKS_DISABLE, .args = { player, bankMask });
+
     for (i = 0; i < SOUND_BANK_COUNT; i++) {
         if (bankMask & 1) {
             sSoundBankDisabled[i] = TRUE;
@@ -2326,6 +2357,8 @@ static void disable_all_sequence_players(void) {
 void sound_banks_enable(UNUSED u8 player, u16 bankMask) {
     u8 i;
 
+    AUDIO_THREAD_DEFER(AUDIO_CALL_SOUND_BANKS_ENABLE, .args = { player, bankMask });
+
     for (i = 0; i < SOUND_BANK_COUNT; i++) {
         if (bankMask & 1) {
             sSoundBankDisabled[i] = FALSE;
@@ -2350,6 +2383,7 @@ u8 unused_803209D8(u8 player, u8 channelIndex, u8 arg2) {
  * Called from threads: thread5_game_loop
  */
 void set_sound_moving_speed(u8 bank, u8 speed) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_SET_SOUND_MOVING_SPEED, .args = { bank, speed });
     sSoundMovingSpeed[bank] = speed;
 }
 
@@ -2359,6 +2393,8 @@ void set_sound_moving_speed(u8 bank, u8 speed) {
 void play_dialog_sound(u8 dialogID) {
     u8 speaker;
 
+    AUDIO_THREAD_DEFER(AUDIO_CALL_PLAY_DIALOG_SOUND, .args = { dialogID });
+
     if (dialogID >= DIALOG_COUNT) {
         dialogID = 0;
     }
@@ -2385,6 +2421,8 @@ void play_dialog_sound(u8 dialogID) {
 void set_sequence_player_volume(s32 player, f32 volume) {
     u8 i;
 
+    AUDIO_THREAD_DEFER(AUDIO_CALL_SET_SEQUENCE_PLAYER_VOLUME, .args = { player }, .value = volume);
+
     if (player < SEQ_PLAYER_LEVEL || player > SEQ_PLAYER_SFX) {
         return;
     }
@@ -2405,7 +2443,7 @@ void set_sequence_player_volume(s32 player, f32 volume) {
     // Keep vanilla/romhack BGM behavior consistent when custom scaling is applied.
     if (player == SEQ_PLAYER_LEVEL && sCurrentBackgroundMusicSeqId != SEQUENCE_NONE) {
         struct SequencePlayer *seqPlayer = &gSequencePlayers[player];
-        f32 maxVolume = sBackgroundMusicDefaultVolume[sCurrentBackgroundMusicSeqId] / 127.0f;
+        f32 maxVolume = background_music_default_volume(sCurrentBackgroundMusicSeqId);
         if (seqPlayer->volume > maxVolume) {
             seqPlayer->volume = maxVolume;
         }
@@ -2428,6 +2466,8 @@ void play_music(u8 player, u16 seqArgs, u16 fadeTimer) {
     u8 i;
     u8 foundIndex = 0;
 
+    AUDIO_THREAD_DEFER(AUDIO_CALL_PLAY_MUSIC, .args = { player, seqArgs, fadeTimer });
+
     // Except for the background music player, we don't support queued
     // sequences. Just play them immediately, stopping any old sequence.
     if (player != SEQ_PLAYER_LEVEL) {
@@ -2488,6 +2528,8 @@ void stop_background_music(u16 seqId) {
     u8 foundIndex;
     u8 i;
 
+    AUDIO_THREAD_DEFER(AUDIO_CALL_STOP_BACKGROUND_MUSIC, .args = { seqId });
+
     if (sBackgroundMusicQueueSize == 0) {
         return;
     }
@@ -2529,6 +2571,7 @@ void stop_background_music(u16 seqId) {
  * Called from threads: thread5_game_loop
  */
 void fadeout_background_music(u16 seqId, u16 fadeOut) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_FADEOUT_BACKGROUND_MUSIC, .args = { seqId, fadeOut });
     if (sBackgroundMusicQueueSize != 0 && sBackgroundMusicQueue[0].seqId == (u8)(seqId & 0xff)) {
         seq_player_fade_out(SEQ_PLAYER_LEVEL, fadeOut);
     }
@@ -2538,6 +2581,7 @@ void fadeout_background_music(u16 seqId, u16 fadeOut) {
  * Called from threads: thread5_game_loop
  */
 void drop_queued_background_music(void) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_DROP_QUEUED_BACKGROUND_MUSIC);
     if (sBackgroundMusicQueueSize != 0) {
         sBackgroundMusicQueueSize = 1;
     }
@@ -2589,6 +2633,8 @@ void func_80320ED8(void) {
 void play_secondary_music(u8 seqId, u8 bgMusicVolume, u8 volume, u16 fadeTimer) {
     UNUSED u32 dummy;
 
+    AUDIO_THREAD_DEFER(AUDIO_CALL_PLAY_SECONDARY_MUSIC, .args = { seqId, bgMusicVolume, volume, fadeTimer });
+
     sUnused80332118 = 0;
     if (sCurrentBackgroundMusicSeqId == 0xff || sCurrentBackgroundMusicSeqId == SEQ_MENU_TITLE_SCREEN) {
         return;
@@ -2615,6 +2661,7 @@ void play_secondary_music(u8 seqId, u8 bgMusicVolume, u8 volume, u16 fadeTimer)
  * Called from threads: thread5_game_loop
  */
 void func_80321080(u16 fadeTimer) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_FUNC_80321080, .args = { fadeTimer });
     if (sBackgroundMusicTargetVolume != TARGET_VOLUME_UNSET) {
         sBackgroundMusicTargetVolume = TARGET_VOLUME_UNSET;
         D_80332120 = 0;
@@ -2630,6 +2677,8 @@ void func_80321080(u16 fadeTimer) {
 void func_803210D4(u16 fadeDuration) {
     u8 i;
 
+    AUDIO_THREAD_DEFER(AUDIO_CALL_FUNC_803210D4, .args = { fadeDuration });
+
     if (sHasStartedFadeOut) {
         return;
     }
@@ -2663,6 +2712,7 @@ void func_803210D4(u16 fadeDuration) {
  * Called from threads: thread5_game_loop
  */
 void play_course_clear(void) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_PLAY_COURSE_CLEAR);
     seq_player_play_sequence(SEQ_PLAYER_ENV, SEQ_EVENT_CUTSCENE_COLLECT_STAR, 0);
     sBackgroundMusicMaxTargetVolume = TARGET_VOLUME_IS_PRESENT_FLAG | 0;
 #if defined(VERSION_EU) || defined(VERSION_SH)
@@ -2675,6 +2725,7 @@ void play_course_clear(void) {
  * Called from threads: thread5_game_loop
  */
 void play_peachs_jingle(void) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_PLAY_PEACHS_JINGLE);
     seq_player_play_sequence(SEQ_PLAYER_ENV, SEQ_EVENT_PEACH_MESSAGE, 0);
     sBackgroundMusicMaxTargetVolume = TARGET_VOLUME_IS_PRESENT_FLAG | 0;
 #if defined(VERSION_EU) || defined(VERSION_SH)
@@ -2691,6 +2742,7 @@ void play_peachs_jingle(void) {
  * Called from threads: thread5_game_loop
  */
 void play_puzzle_jingle(void) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_PLAY_PUZZLE_JINGLE);
     seq_player_play_sequence(SEQ_PLAYER_ENV, SEQ_EVENT_SOLVE_PUZZLE, 0);
     sBackgroundMusicMaxTargetVolume = TARGET_VOLUME_IS_PRESENT_FLAG | 20;
 #if defined(VERSION_EU) || defined(VERSION_SH)
@@ -2703,6 +2755,7 @@ void play_puzzle_jingle(void) {
  * Called from threads: thread5_game_loop
  */
 void play_star_fanfare(void) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_PLAY_STAR_FANFARE);
     seq_player_play_sequence(SEQ_PLAYER_ENV, SEQ_EVENT_HIGH_SCORE, 0);
     sBackgroundMusicMaxTargetVolume = TARGET_VOLUME_IS_PRESENT_FLAG | 20;
 #if defined(VERSION_EU) || defined(VERSION_SH)
@@ -2715,6 +2768,7 @@ void play_star_fanfare(void) {
  * Called from threads: thread5_game_loop
  */
 void play_power_star_jingle(u8 arg0) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_PLAY_POWER_STAR_JINGLE, .args = { arg0 });
     if (!arg0) {
         sBackgroundMusicTargetVolume = 0;
     }
@@ -2730,6 +2784,7 @@ void play_power_star_jingle(u8 arg0) {
  * Called from threads: thread5_game_loop
  */
 void play_race_fanfare(void) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_PLAY_RACE_FANFARE);
     seq_player_play_sequence(SEQ_PLAYER_ENV, SEQ_EVENT_RACE, 0);
     sBackgroundMusicMaxTargetVolume = TARGET_VOLUME_IS_PRESENT_FLAG | 20;
 #if defined(VERSION_EU) || defined(VERSION_SH)
@@ -2742,6 +2797,7 @@ void play_race_fanfare(void) {
  * Called from threads: thread5_game_loop
  */
 void play_toads_jingle(void) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_PLAY_TOADS_JINGLE);
     seq_player_play_sequence(SEQ_PLAYER_ENV, SEQ_EVENT_TOAD_MESSAGE, 0);
     sBackgroundMusicMaxTargetVolume = TARGET_VOLUME_IS_PRESENT_FLAG | 20;
 #if defined(VERSION_EU) || defined(VERSION_SH)
@@ -2754,6 +2810,7 @@ void play_toads_jingle(void) {
  * Called from threads: thread5_game_loop
  */
 void sound_reset(u8 presetId) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_SOUND_RESET, .args = { presetId });
 #ifndef VERSION_JP
     if (presetId >= 8) {
         presetId = 0;
@@ -2787,6 +2844,7 @@ void sound_reset(u8 presetId) {
  * Called from threads: thread5_game_loop
  */
 void audio_set_sound_mode(u8 soundMode) {
+    AUDIO_THREAD_DEFER(AUDIO_CALL_SET_SOUND_MODE, .args = { soundMode });
     D_80332108 = (D_80332108 & 0xf) + (soundMode << 4);
     gSoundMode = soundMode;
 }
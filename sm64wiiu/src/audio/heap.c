@@ -7,6 +7,10 @@
 #include "seqplayer.h"
 #include "effects.h"
 
+#ifndef TARGET_N64
+#include "pc/audio/mod_seq.h"
+#endif
+
 #define ALIGN16(val) (((val) + 0xF) & ~0xF)
 
 struct PoolSplit {
@@ -227,6 +231,9 @@ void discard_bank(s32 bankId) {
             audio_list_push_back(&gNoteFreeLists.disabled, &note->listItem);
         }
     }
+#ifndef TARGET_N64
+    mod_seq_bank_discarded(bankId);
+#endif
 }
 
 void discard_sequence(s32 seqId) {
@@ -1290,6 +1297,9 @@ void audio_reset_session(void) {
     sPersistentCommonPoolSplit.wantUnused = preset->unk18;
 #else
     sPersistentCommonPoolSplit.wantUnused = 0;
+#endif
+#ifndef TARGET_N64
+    mod_seq_pools_reset();
 #endif
     persistent_pools_init(&sPersistentCommonPoolSplit);
     sTemporaryCommonPoolSplit.wantSeq = DOUBLE_SIZE_ON_64_BIT(preset->temporarySeqMem);
@@ -132,6 +132,7 @@ void audio_reset_session(void);
 void audio_reset_session(struct AudioSessionSettings *preset);
 #endif
 void discard_bank(s32 bankId);
+void discard_sequence(s32 seqId);
 
 #ifdef VERSION_SH
 void fill_filter(s16 filter[8], s32 arg1, s32 arg2);
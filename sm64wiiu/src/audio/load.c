@@ -7,6 +7,11 @@
 #include "load.h"
 #include "seqplayer.h"
 
+#ifndef TARGET_N64
+#include "pc/configfile.h"
+#include "pc/audio/mod_seq.h"
+#endif
+
 #define ALIGN16(val) (((val) + 0xF) & ~0xF)
 
 struct SharedDma {
@@ -57,6 +62,11 @@ u8 sSampleDmaReuseQueueTail2;
 u8 sSampleDmaReuseQueueHead1; // sh: 0x803505E2
 u8 sSampleDmaReuseQueueHead2; // sh: 0x803505E3
 
+#ifndef TARGET_N64
+u64 gSampleDmaBytesCopied;
+u64 gSampleDmaFrames;
+#endif
+
 // bss correct up to here
 
 ALSeqFile *gSeqFileHeader;
@@ -164,6 +174,13 @@ void audio_dma_partial_copy_async(uintptr_t *devAddr, u8 **vAddr, ssize_t *remai
 void decrease_sample_dma_ttls() {
     u32 i;
 
+#ifndef TARGET_N64
+    gSampleDmaFrames++;
+    if (!configAudioSampleDmaCache) {
+        return;
+    }
+#endif
+
     for (i = 0; i < sSampleDmaListSize1; i++) {
 #if defined(VERSION_EU)
         struct SharedDma *temp = &sSampleDmas[i];
@@ -207,6 +224,15 @@ void *dma_sample_data(uintptr_t devAddr, u32 size, s32 arg2, u8 *dmaIndexRef) {
     ssize_t bufferPos;
     UNUSED u32 pad;
 
+#ifndef TARGET_N64
+    // Bank samples already sit in addressable memory on PC, so unless the N64
+    // DMA cache is asked for, notes read them in place. The cache would only
+    // hand back a copy of the same bytes.
+    if (!configAudioSampleDmaCache) {
+        return (void *) devAddr;
+    }
+#endif
+
     if (arg2 != 0 || *dmaIndexRef >= sSampleDmaListSize1) {
         for (i = sSampleDmaListSize1; i < gSampleDmaNumListItems; i++) {
 #if defined(VERSION_EU)
@@ -296,6 +322,9 @@ void *dma_sample_data(uintptr_t devAddr, u32 size, s32 arg2, u8 *dmaIndexRef) {
 #ifdef VERSION_US
     osInvalDCache(dma->buffer, transfer);
 #endif
+#ifndef TARGET_N64
+    gSampleDmaBytesCopied += transfer;
+#endif
 #if defined(VERSION_EU)
     osPiStartDma(&gCurrAudioFrameDmaIoMesgBufs[gCurrAudioFrameDmaCount++], OS_MESG_PRI_NORMAL,
                      OS_READ, dmaDevAddr, dma->buffer, transfer, &gCurrAudioFrameDmaQueue);
@@ -588,6 +617,13 @@ struct AudioBank *bank_load_immediate(s32 bankId, s32 arg1) {
 
     // (This is broken if the length is 1 (mod 16), but that never happens --
     // it's always divisible by 4.)
+#ifndef TARGET_N64
+    // mod banks are already parsed; their instrument table is copied in place
+    if (mod_seq_owns_bank(bankId)) {
+        return mod_seq_bank_load(bankId, arg1);
+    }
+#endif
+
     alloc = gAlCtlHeader->seqArray[bankId].len + 0xf;
     alloc = ALIGN16(alloc);
     alloc -= 0x10;
@@ -623,6 +659,13 @@ struct AudioBank *bank_load_async(s32 bankId, s32 arg1, struct SequencePlayer *s
     UNUSED u32 pad3;
 #endif
 
+#ifndef TARGET_N64
+    // mod banks are already parsed; their instrument table is copied in place
+    if (mod_seq_owns_bank(bankId)) {
+        return mod_seq_bank_load(bankId, arg1);
+    }
+#endif
+
     alloc = gAlCtlHeader->seqArray[bankId].len + 0xf;
     alloc = ALIGN16(alloc);
     alloc -= 0x10;
@@ -768,6 +811,12 @@ struct AudioBank *load_banks_immediate(s32 seqId, u8 *outDefaultBank) {
     u16 offset;
     u8 i;
 
+#ifdef AVOID_UB
+    //! @bug a sequence with no banks returns and reports garbage
+    ret = NULL;
+    bankId = 0;
+#endif
+
     offset = ((u16 *) gAlBankSets)[seqId];
 #ifdef VERSION_EU
     for (i = gAlBankSets[offset++]; i != 0; i--) {
@@ -804,6 +853,12 @@ void preload_sequence(u32 seqId, u8 preloadMask) {
     if (seqId >= gSequenceCount) {
         return;
     }
+#ifndef TARGET_N64
+    // ids between the vanilla count and the highest mod id may be unset
+    if (gSeqFileHeader->seqArray[seqId].len == 0) {
+        return;
+    }
+#endif
 
     gAudioLoadLock = AUDIO_LOCK_LOADING;
     if (preloadMask & PRELOAD_BANKS) {
@@ -847,7 +902,16 @@ void load_sequence_internal(u32 player, u32 seqId, s32 loadAsync) {
     if (seqId >= gSequenceCount) {
         return;
     }
+#ifndef TARGET_N64
+    // ids between the vanilla count and the highest mod id may be unset
+    if (gSeqFileHeader->seqArray[seqId].len == 0) {
+        return;
+    }
+#endif
 
+#ifndef TARGET_N64
+    mod_seq_sequence_load_started(player, seqId);
+#endif
     sequence_player_disable(seqPlayer);
     if (loadAsync) {
         s32 numMissingBanks = 0;
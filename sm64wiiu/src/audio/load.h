@@ -30,10 +30,17 @@ extern struct NotePool gNoteFreeLists;
 
 extern OSMesgQueue gCurrAudioFrameDmaQueue;
 extern u32 gSampleDmaNumListItems;
+#ifndef TARGET_N64
+// bytes dma_sample_data copied into the sample DMA cache, and audio frames
+// rendered; reading samples in place copies nothing
+extern u64 gSampleDmaBytesCopied;
+extern u64 gSampleDmaFrames;
+#endif
 extern ALSeqFile *gAlCtlHeader;
 extern ALSeqFile *gAlTbl;
 extern ALSeqFile *gSeqFileHeader;
 extern u8 *gAlBankSets;
+extern u16 gSequenceCount;
 
 extern struct CtlEntry *gCtlEntries;
 #if defined(VERSION_EU) || defined(VERSION_SH)
@@ -9,6 +9,10 @@
 #include "effects.h"
 #include "external.h"
 
+#ifndef TARGET_N64
+#include "pc/audio/mod_seq.h"
+#endif
+
 void note_set_resampling_rate(struct Note *note, f32 resamplingRateInput);
 
 #if defined(VERSION_EU) || defined(VERSION_SH)
@@ -1166,6 +1170,9 @@ void note_init_for_layer(struct Note *note, struct SequenceChannelLayer *seqLaye
 #endif
     sub->stereoHeadsetEffects = seqLayer->seqChannel->stereoHeadsetEffects;
     sub->reverbIndex = seqLayer->seqChannel->reverbIndex & 3;
+#ifndef TARGET_N64
+    mod_seq_note_started(seqLayer->seqChannel->seqPlayer - gSequencePlayers);
+#endif
 }
 #else
 s32 note_init_for_layer(struct Note *note, struct SequenceChannelLayer *seqLayer) {
@@ -1187,6 +1194,9 @@ s32 note_init_for_layer(struct Note *note, struct SequenceChannelLayer *seqLayer
         build_synthetic_wave(note, seqLayer);
     }
     note_init(note);
+#ifndef TARGET_N64
+    mod_seq_note_started(seqLayer->seqChannel->seqPlayer - gSequencePlayers);
+#endif
     return FALSE;
 }
 #endif
@@ -329,6 +329,9 @@ u64 *synthesis_execute(u64 *cmdBuf, s32 *writtenCmds, s16 *aiBuf, s32 bufLen) {
     u32 *aiBufPtr = (u32 *) aiBuf;
     u64 *cmd = cmdBuf + 1;
     s32 v0;
+#ifndef TARGET_N64
+    s32 useFloat = synthesis_float_enabled();
+#endif
 
     aSegment(cmdBuf, 0, 0);
 
@@ -349,6 +352,11 @@ u64 *synthesis_execute(u64 *cmdBuf, s32 *writtenCmds, s16 *aiBuf, s32 bufLen) {
         if (gSynthesisReverb.useReverb != 0) {
             prepare_reverb_ring_buffer(chunkLen, gAudioUpdatesPerFrame - i);
         }
+#ifndef TARGET_N64
+        if (useFloat) {
+            synthesis_float_do_one_audio_update((s16 *) aiBufPtr, chunkLen, gAudioUpdatesPerFrame - i);
+        } else
+#endif
         cmd = synthesis_do_one_audio_update((s16 *) aiBufPtr, chunkLen, cmd, gAudioUpdatesPerFrame - i);
         bufLen -= chunkLen;
         aiBufPtr += chunkLen;
@@ -668,6 +676,12 @@ u64 *synthesis_process_notes(s16 *aiBuf, s32 bufLen, u64 *cmd) {
     s32 resampledTempLen;                    // spD8, spAC
     u16 noteSamplesDmemAddrBeforeResampling; // spD6, spAA
 
+#ifdef AVOID_UB
+    //! @bug both are only set inside the sample loading loop, which a note
+    //  with nothing left to load skips
+    sp130 = 0;
+    noteSamplesDmemAddrBeforeResampling = DMEM_ADDR_UNCOMPRESSED_NOTE;
+#endif
 
 #ifndef VERSION_EU
     for (noteIndex = 0; noteIndex < gMaxSimultaneousNotes; noteIndex++) {
@@ -94,6 +94,11 @@ void note_set_vel_pan_reverb(struct Note *note, f32 velocity, f32 pan, u8 reverb
 void note_set_frequency(struct Note *note, f32 frequency);
 void note_enable(struct Note *note);
 void note_disable(struct Note *note);
+s32 get_volume_ramping(u16 sourceVol, u16 targetVol, s32 arg2);
+#ifndef TARGET_N64
+s32 synthesis_float_enabled(void);
+void synthesis_float_do_one_audio_update(s16 *aiBuf, s32 bufLen, s32 updateIndex);
+#endif
 #endif
 
 #endif // AUDIO_SYNTHESIS_H
@@ -0,0 +1,399 @@
+#if defined(VERSION_JP) || defined(VERSION_US)
+#ifndef TARGET_N64
+#include <ultra64.h>
+#include <math.h>
+#include <string.h>
+
+#include "synthesis.h"
+#include "heap.h"
+#include "load.h"
+#include "internal.h"
+#include "external.h"
+#include "pc/configfile.h"
+#include "pc/mixer.h"
+
+// Native float synthesis. Instead of emitting an audio command list for the
+// software RSP (src/pc/mixer.c), every note is rendered in a single pass:
+// ADPCM decode, pitch resample, volume envelope and reverb send straight into
+// float dry/wet buses, which are clamped to s16 once per update.
+//
+// Notes keep using NoteSynthesisBuffers (adpcmdecState holds the decoded frame
+// around samplePosInt, finalResampleState the resampler taps) so the game can
+// switch between this and synthesis_process_notes() at any frame boundary.
+
+#define FLOAT_BUF_LEN (DEFAULT_LEN_1CH / (s32) sizeof(s16))
+#define FLOAT_MAX_SOURCE (FLOAT_BUF_LEN * 4 + 1) // at the highest pitch, just under 4x
+#define FLOAT_HISTORY 6 // resampler taps, plus two for the delay of the 2x path
+
+#define FLOAT_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+static f32 sDryLeft[FLOAT_BUF_LEN];
+static f32 sDryRight[FLOAT_BUF_LEN];
+static f32 sWetLeft[FLOAT_BUF_LEN];
+static f32 sWetRight[FLOAT_BUF_LEN];
+
+static f32 sResampleTable[64][4];
+static s32 sResampleTableReady;
+
+s32 synthesis_float_enabled(void) {
+    if (!configAudioFloatSynthesis) {
+        return FALSE;
+    }
+    // headset panning (Haas delay) and the downsampled reverb ring have no
+    // float version yet; neither is used by the US/JP presets or the default
+    // stereo sound mode
+    if (gSoundMode == SOUND_MODE_HEADSET) {
+        return FALSE;
+    }
+    if (gSynthesisReverb.useReverb != 0 && gReverbDownsampleRate != 1) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void float_init_resample_table(void) {
+    s32 i, j;
+    for (i = 0; i < 64; i++) {
+        for (j = 0; j < 4; j++) {
+            sResampleTable[i][j] = resample_table[i][j] * (1.0f / 32768.0f);
+        }
+    }
+    sResampleTableReady = TRUE;
+}
+
+static inline s16 float_to_s16(f32 x) {
+    if (x > 32767.0f) {
+        return 32767;
+    }
+    if (x < -32768.0f) {
+        return -32768;
+    }
+    return (s16) x;
+}
+
+// Same arithmetic as aADPCMdec, for one 9-byte frame. 'frame' holds the
+// previous frame on entry and the decoded one on return.
+static void float_decode_adpcm_frame(const u8 *in, s16 *frame, const s16 *book) {
+    s32 shift = in[0] >> 4;
+    const s16 *tbl = book + (in[0] & 0xf) * 16;
+    s16 ins[8];
+    s16 out[16];
+    s32 prev1 = frame[15];
+    s32 prev2 = frame[14];
+    s32 half, j, k;
+
+    in++;
+    for (half = 0; half < 2; half++) {
+        for (j = 0; j < 4; j++) {
+            ins[j * 2] = (s16)(((((*in >> 4) << 28) >> 28)) << shift);
+            ins[j * 2 + 1] = (s16)((((*in++ & 0xf) << 28) >> 28) << shift);
+        }
+        for (j = 0; j < 8; j++) {
+            s32 acc = tbl[j] * prev2 + tbl[8 + j] * prev1 + (ins[j] << 11);
+            for (k = 0; k < j; k++) {
+                acc += tbl[8 + (j - k) - 1] * ins[k];
+            }
+            acc >>= 11;
+            out[half * 8 + j] = (s16)(acc > 0x7fff ? 0x7fff : (acc < -0x8000 ? -0x8000 : acc));
+        }
+        prev1 = out[half * 8 + 7];
+        prev2 = out[half * 8 + 6];
+    }
+    memcpy(frame, out, sizeof(out));
+}
+
+// Produces 'count' consecutive samples of an ADPCM note starting at
+// samplePosInt, following the sample's loop, and advances the note. Loop and
+// end handling follow synthesis_process_notes(): the decoded frame around the
+// position lives in adpcmdecState, and a pending note->restart means it has
+// to be reloaded from the loop state.
+static void float_load_adpcm_samples(struct Note *note, s16 *out, s32 count, s32 flags) {
+    struct AudioBankSample *sample = note->sound->sample;
+    struct AdpcmLoop *loop = sample->loop;
+    s16 *frame = note->synthesisBuffers->adpcmdecState;
+    s32 endPos = loop->end;
+    s32 pos = note->samplePosInt;
+    s32 framePos;
+    const u8 *data = NULL;
+    s32 dataFrames = 0;
+
+    if (flags & A_INIT) {
+        memset(frame, 0, 16 * sizeof(s16));
+        framePos = -16;
+    } else if (note->restart) {
+        memcpy(frame, loop->state, 16 * sizeof(s16));
+        framePos = pos & ~0xf;
+        note->restart = FALSE;
+    } else {
+        // the last frame decoded is the one holding the previous sample
+        framePos = (pos - 1) & ~0xf;
+    }
+
+    while (count > 0) {
+        s32 n;
+
+        if (pos >= endPos) {
+            if (loop->count == 0 || loop->start >= (u32) endPos) {
+                memset(out, 0, count * sizeof(s16));
+                note->samplePosInt = 0;
+                note->finished = TRUE;
+                note->enabled = FALSE;
+                return;
+            }
+            pos = loop->start;
+            memcpy(frame, loop->state, 16 * sizeof(s16));
+            framePos = pos & ~0xf;
+            dataFrames = 0;
+            continue;
+        }
+
+        if (pos >= framePos + 16) {
+            if (dataFrames == 0) {
+                // fetch every frame this run still needs in one go
+                dataFrames = (FLOAT_MIN(count, endPos - pos) + 15) / 16;
+                data = dma_sample_data((uintptr_t)(sample->sampleAddr + (framePos + 16) / 16 * 9),
+                                       dataFrames * 9, flags, &note->sampleDmaIndex);
+                flags = 0;
+            }
+            float_decode_adpcm_frame(data, frame, sample->book->book);
+            framePos += 16;
+            data += 9;
+            dataFrames--;
+        }
+
+        n = FLOAT_MIN(count, FLOAT_MIN(endPos, framePos + 16) - pos);
+        memcpy(out, frame + (pos - framePos), n * sizeof(s16));
+        out += n;
+        count -= n;
+        pos += n;
+    }
+    note->samplePosInt = pos;
+}
+
+// Renders one note into the float buses. Mirrors one iteration of
+// synthesis_process_notes() followed by final_resample() and
+// process_envelope(), without going through DMEM.
+static void float_process_note(struct Note *note, s32 bufLen) {
+    s16 window[FLOAT_HISTORY + 16 + FLOAT_MAX_SOURCE];
+    s16 *src = window + FLOAT_HISTORY;
+    s32 taps = FLOAT_HISTORY - 4;
+    f32 resampled[FLOAT_BUF_LEN];
+    s16 *resampleState = note->synthesisBuffers->finalResampleState;
+    s32 flags = 0;
+    u32 pitch;
+    u32 phase;
+    u32 samplesLenFixedPoint;
+    s32 nSamples;
+    s32 pos;
+    s32 i;
+
+    if (note->needsInit == TRUE) {
+        flags = A_INIT;
+        note->samplePosInt = 0;
+        note->samplePosFrac = 0;
+    }
+
+    // same clamping and fixed-point rate as the command list path; above 2x
+    // that path halves the samples first, here they are resampled in one step
+    if (note->frequency < 2.0f) {
+        if (note->frequency > 1.99996f) {
+            note->frequency = 1.99996f;
+        }
+        pitch = (u32)(u16)(s32)(note->frequency * 32768.0f) << 1;
+    } else {
+        if (note->frequency >= 3.99993f) {
+            note->frequency = 3.99993f;
+        }
+        pitch = (u32)(u16)(s32)(note->frequency * 0.5f * 32768.0f) << 1;
+        // wave notes skip the halving there and so play at half the rate
+        if (note->sound != NULL) {
+            pitch <<= 1;
+            // halving first delays that path by two source samples
+            taps -= 2;
+        }
+    }
+
+    // the resampler phase is samplePosFrac, so it consumes exactly the
+    // samples that are loaded here
+    phase = note->samplePosFrac;
+    samplesLenFixedPoint = phase + pitch * bufLen;
+    nSamples = samplesLenFixedPoint >> 16;
+    note->samplePosFrac = samplesLenFixedPoint & 0xffff;
+
+    // finalResampleState[0..3] are the taps the command list path keeps too;
+    // the two samples before them go in the slots its resampler leaves unused
+    if (flags & A_INIT) {
+        memset(window, 0, FLOAT_HISTORY * sizeof(s16));
+    } else {
+        window[0] = resampleState[6];
+        window[1] = resampleState[7];
+        memcpy(window + 2, resampleState, 4 * sizeof(s16));
+    }
+
+    if (note->sound == NULL) {
+        // a wave synthesis note: the 64-sample waveform repeats
+        s16 *samples = note->synthesisBuffers->samples;
+        note->samplePosInt &= (note->sampleCount - 1);
+        for (i = 0; i < nSamples; i++) {
+            src[i] = samples[(note->samplePosInt + i) & 0x3f];
+        }
+        note->samplePosInt += nSamples;
+    } else if (flags & A_INIT) {
+        // on A_INIT the command list resamples from the decoder's zeroed
+        // history, so a new note starts with 16 samples of silence and skips
+        // the last 16 it decoded. When it halves the samples first, that is
+        // the end of the first half; the second half is decoded without it.
+        memset(src, 0, 16 * sizeof(s16));
+        if (taps == FLOAT_HISTORY - 4) {
+            float_load_adpcm_samples(note, src + 16, nSamples, flags);
+        } else {
+            s32 firstPart = ((pitch >> 1) * bufLen >> 16) & ~1;
+            float_load_adpcm_samples(note, src + 16, firstPart, flags);
+            float_load_adpcm_samples(note, src + firstPart, nSamples - firstPart, 0);
+        }
+    } else {
+        float_load_adpcm_samples(note, src, nSamples, flags);
+    }
+
+    for (i = 0, pos = taps; i < bufLen; i++) {
+        const f32 *tbl = sResampleTable[phase >> 10];
+        const s16 *in = window + pos;
+        resampled[i] = in[0] * tbl[0] + in[1] * tbl[1] + in[2] * tbl[2] + in[3] * tbl[3];
+        phase += pitch;
+        pos += phase >> 16;
+        phase &= 0xffff;
+    }
+    resampleState[6] = window[nSamples];
+    resampleState[7] = window[nSamples + 1];
+    memcpy(resampleState, window + nSamples + 2, 4 * sizeof(s16));
+    resampleState[4] = (s16) phase;
+
+    if (note->needsInit == TRUE) {
+        note->needsInit = FALSE;
+    }
+
+    {
+        u16 sourceLeft = note->curVolLeft;
+        u16 sourceRight = note->curVolRight;
+        u16 targetLeft = note->targetVolLeft;
+        u16 targetRight = note->targetVolRight;
+        s32 useWet = gSynthesisReverb.useReverb && note->reverbVol != 0;
+        // volumes are Q1.15 and the dry/wet gains scale them once more
+        f32 dryScale = gVolume * (1.0f / (32768.0f * 32768.0f));
+        f32 wetScale = note->reverbVolShifted * (1.0f / (32768.0f * 32768.0f));
+        f32 signLeft = note->stereoStrongRight ? -1.0f : 1.0f;
+        f32 signRight = note->stereoStrongLeft ? -1.0f : 1.0f;
+        f32 tgtLeft = targetLeft;
+        f32 tgtRight = targetRight;
+        f32 rateLeft = 1.0f;
+        f32 rateRight = 1.0f;
+        f32 lanesLeft[8];
+        f32 lanesRight[8];
+
+        note->curVolLeft = targetLeft;
+        note->curVolRight = targetRight;
+
+        // aEnvMixer keeps eight volume lanes per channel: the first block
+        // steps linearly from the source volume, then every block of eight
+        // multiplies them all by the ramping rate. Both channels' steps are
+        // scaled by the left source volume, as the microcode does.
+        if (sourceLeft != targetLeft || sourceRight != targetRight || note->envMixerNeedsInit) {
+            f32 diffLeft, diffRight;
+            rateLeft = get_volume_ramping(sourceLeft, targetLeft, bufLen) * (1.0f / 65536.0f);
+            rateRight = get_volume_ramping(sourceRight, targetRight, bufLen) * (1.0f / 65536.0f);
+            diffLeft = sourceLeft * (rateLeft - 1.0f) * (1.0f / 8.0f);
+            diffRight = sourceLeft * (rateRight - 1.0f) * (1.0f / 8.0f);
+            for (i = 0; i < 8; i++) {
+                lanesLeft[i] = sourceLeft + diffLeft * (i + 1);
+                lanesRight[i] = sourceRight + diffRight * (i + 1);
+            }
+        } else {
+            for (i = 0; i < 8; i++) {
+                lanesLeft[i] = tgtLeft;
+                lanesRight[i] = tgtRight;
+            }
+        }
+
+        for (i = 0; i < bufLen; i++) {
+            f32 s = resampled[i];
+            f32 l, r;
+            s32 lane = i & 7;
+            f32 volLeft = lanesLeft[lane];
+            f32 volRight = lanesRight[lane];
+            if (rateLeft >= 1.0f ? volLeft > tgtLeft : volLeft < tgtLeft) {
+                volLeft = tgtLeft;
+            }
+            if (rateRight >= 1.0f ? volRight > tgtRight : volRight < tgtRight) {
+                volRight = tgtRight;
+            }
+            lanesLeft[lane] = volLeft * rateLeft;
+            lanesRight[lane] = volRight * rateRight;
+            l = s * volLeft * signLeft;
+            r = s * volRight * signRight;
+            sDryLeft[i] += l * dryScale;
+            sDryRight[i] += r * dryScale;
+            if (useWet) {
+                sWetLeft[i] += l * wetScale;
+                sWetRight[i] += r * wetScale;
+            }
+        }
+    }
+}
+
+void synthesis_float_do_one_audio_update(s16 *aiBuf, s32 bufLen, s32 updateIndex) {
+    struct ReverbRingBufferItem *item = &gSynthesisReverb.items[gSynthesisReverb.curFrame][updateIndex];
+    s16 *ringLeft = gSynthesisReverb.ringBuffer.left;
+    s16 *ringRight = gSynthesisReverb.ringBuffer.right;
+    s32 lengthA = item->lengthA / 2;
+    s32 lengthB = item->lengthB / 2;
+    s32 noteIndex;
+    s32 i;
+
+    if (!sResampleTableReady) {
+        float_init_resample_table();
+    }
+
+    if (gSynthesisReverb.useReverb == 0) {
+        memset(sDryLeft, 0, bufLen * sizeof(f32));
+        memset(sDryRight, 0, bufLen * sizeof(f32));
+    } else {
+        // the oldest ring buffer samples are both this update's reverb output
+        // and, scaled by the reverb gain, the start of its wet buses
+        f32 gain = 1.0f + (s16)(0x8000 + gSynthesisReverb.reverbGain) * (1.0f / 32768.0f);
+        for (i = 0; i < bufLen; i++) {
+            s32 ringPos = i < lengthA ? item->startPos + i : i - lengthA;
+            sDryLeft[i] = ringLeft[ringPos];
+            sDryRight[i] = ringRight[ringPos];
+            sWetLeft[i] = sDryLeft[i] * gain;
+            sWetRight[i] = sDryRight[i] * gain;
+        }
+    }
+
+    for (noteIndex = 0; noteIndex < gMaxSimultaneousNotes; noteIndex++) {
+        struct Note *note = &gNotes[noteIndex];
+        if (note->enabled && IS_BANK_LOAD_COMPLETE(note->bankId) == FALSE) {
+            gAudioErrorFlags = (note->bankId << 8) + noteIndex + 0x1000000;
+        } else if (note->enabled) {
+            float_process_note(note, bufLen);
+        }
+    }
+
+    if (gSynthesisReverb.useReverb != 0) {
+        for (i = 0; i < lengthA; i++) {
+            ringLeft[item->startPos + i] = float_to_s16(sWetLeft[i]);
+            ringRight[item->startPos + i] = float_to_s16(sWetRight[i]);
+        }
+        for (i = 0; i < lengthB; i++) {
+            ringLeft[i] = float_to_s16(sWetLeft[lengthA + i]);
+            ringRight[i] = float_to_s16(sWetRight[lengthA + i]);
+        }
+    }
+
+    for (i = 0; i < bufLen; i++) {
+        aiBuf[i * 2] = float_to_s16(sDryLeft[i]);
+        aiBuf[i * 2 + 1] = float_to_s16(sDryRight[i]);
+    }
+}
+
+#endif
+#endif
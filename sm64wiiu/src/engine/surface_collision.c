@@ -196,6 +196,7 @@ s32 find_wall_collisions(struct WallCollisionData *colData) {
     if (z <= -LEVEL_BOUNDARY_MAX || z >= LEVEL_BOUNDARY_MAX) {
         return numCollisions;
     }
+    COLLISION_ZONE_BEGIN();
 
     // World (level) consists of a 16x16 grid. Find where the collision is on
     // the grid (round toward -inf)
@@ -212,6 +213,7 @@ s32 find_wall_collisions(struct WallCollisionData *colData) {
 
     // Increment the debug tracker.
     gNumCalls.wall += 1;
+    COLLISION_ZONE_END();
 
     return numCollisions;
 }
@@ -325,6 +327,7 @@ f32 find_ceil(f32 posX, f32 posY, f32 posZ, struct Surface **pceil) {
     if (z <= -LEVEL_BOUNDARY_MAX || z >= LEVEL_BOUNDARY_MAX) {
         return height;
     }
+    COLLISION_ZONE_BEGIN();
 
     // Each level is split into cells to limit load, find the appropriate cell.
     cellX = ((x + LEVEL_BOUNDARY_MAX) / CELL_SIZE) & NUM_CELLS_INDEX;
@@ -347,6 +350,7 @@ f32 find_ceil(f32 posX, f32 posY, f32 posZ, struct Surface **pceil) {
 
     // Increment the debug tracker.
     gNumCalls.ceil += 1;
+    COLLISION_ZONE_END();
 
     return height;
 }
@@ -532,6 +536,7 @@ f32 find_floor(f32 xPos, f32 yPos, f32 zPos, struct Surface **pfloor) {
     if (z <= -LEVEL_BOUNDARY_MAX || z >= LEVEL_BOUNDARY_MAX) {
         return height;
     }
+    COLLISION_ZONE_BEGIN();
 
     // Each level is split into cells to limit load, find the appropriate cell.
     cellX = ((x + LEVEL_BOUNDARY_MAX) / CELL_SIZE) & NUM_CELLS_INDEX;
@@ -575,6 +580,7 @@ f32 find_floor(f32 xPos, f32 yPos, f32 zPos, struct Surface **pfloor) {
 
     // Increment the debug tracker.
     gNumCalls.floor += 1;
+    COLLISION_ZONE_END();
 
     return height;
 }
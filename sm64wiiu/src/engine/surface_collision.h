@@ -5,6 +5,17 @@
 
 #include "types.h"
 
+// Collision is only timed in benchmark builds; the queries run too often to
+// carry a profiler zone in a regular build.
+#ifdef BENCHMARK
+#include "pc/debug_context.h"
+#define COLLISION_ZONE_BEGIN() CTX_BEGIN(CTX_COLLISION)
+#define COLLISION_ZONE_END() CTX_END(CTX_COLLISION)
+#else
+#define COLLISION_ZONE_BEGIN()
+#define COLLISION_ZONE_END()
+#endif
+
 // Range level area is 16384x16384 (-8192 to +8192 in x and z)
 #define LEVEL_BOUNDARY_MAX  0x2000 // 8192
 
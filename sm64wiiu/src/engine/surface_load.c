@@ -833,6 +833,7 @@ void load_object_collision_model(void) {
     // Update if no Time Stop, in range, and in the current room.
     if (!(gTimeStopState & TIME_STOP_ACTIVE) && marioDist < tangibleDist
         && !(gCurrentObject->activeFlags & ACTIVE_FLAG_IN_DIFFERENT_ROOM)) {
+        COLLISION_ZONE_BEGIN();
         collisionData++;
         transform_object_vertices(&collisionData, vertexData);
 
@@ -840,6 +841,7 @@ void load_object_collision_model(void) {
         while (*collisionData != TERRAIN_LOAD_CONTINUE) {
             load_object_surfaces(&collisionData, vertexData);
         }
+        COLLISION_ZONE_END();
     }
 
 #ifndef NODRAWINGDISTANCE
@@ -20,6 +20,7 @@
 #include "segment_symbols.h"
 #include "rumble_init.h"
 #include "pc/djui/djui.h"
+#include "pc/debug_context.h"
 #include <prevent_bss_reordering.h>
 
 // First 3 controller slots
@@ -737,7 +738,9 @@ void game_loop_one_iteration(void) {
         audio_game_loop_tick();
         select_gfx_pool();
         read_controller_inputs();
+        CTX_BEGIN(CTX_LEVEL_SCRIPT);
         levelCommandAddr = level_script_execute(levelCommandAddr);
+        CTX_END(CTX_LEVEL_SCRIPT);
 
         display_and_vsync();
 
@@ -15,6 +15,7 @@
 #include "print.h"
 #ifndef TARGET_N64
 #include "pc/djui/djui.h"
+#include "pc/djui/djui_hud_utils.h"
 #include "pc/lua/smlua.h"
 #include "pc/lua/smlua_hooks.h"
 #endif
@@ -461,6 +462,7 @@ void render_hud(void) {
         // Draw behind-HUD Lua layers after HUD projection setup and before vanilla HUD.
         djui_hud_begin_frame();
         smlua_call_event_hooks(HOOK_ON_HUD_RENDER_BEHIND);
+        djui_hud_end_cached_blocks();
 #endif
 
         if (gCurrentArea != NULL && gCurrentArea->camera->mode == CAMERA_MODE_INSIDE_CANNON) {
@@ -496,6 +498,7 @@ void render_hud(void) {
         // Draw front-HUD Lua layers after vanilla HUD so overlays appear above counters.
         smlua_call_event_hooks(HOOK_ON_HUD_RENDER);
         smlua_render_mod_overlay();
+        djui_hud_end_cached_blocks();
 #endif
     }
 }
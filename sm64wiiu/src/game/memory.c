@@ -522,6 +522,20 @@ void alloc_only_pool_clear(struct AllocOnlyPool *pool) {
     pool->lastBlockNextPos = 0;
 }
 
+// A pool outside the main pool's stack, with a lifetime of its own.
+struct AllocOnlyPool *alloc_only_pool_create(void) {
+    struct AllocOnlyPool *pool = (struct AllocOnlyPool *) calloc(1, sizeof(struct AllocOnlyPool));
+    if (pool == NULL) {
+        abort();
+    }
+    return pool;
+}
+
+void alloc_only_pool_destroy(struct AllocOnlyPool *pool) {
+    alloc_only_pool_release_handler(pool);
+    free(pool);
+}
+
 void *alloc_only_pool_alloc(struct AllocOnlyPool *pool, s32 size) {
     const size_t ptr_size = sizeof(u8 *);
     u32 s = size + ptr_size;
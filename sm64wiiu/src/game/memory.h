@@ -87,6 +87,8 @@ void load_engine_code_segment(void);
 struct AllocOnlyPool *alloc_only_pool_init(void);
 void alloc_only_pool_clear(struct AllocOnlyPool *pool);
 void *alloc_only_pool_alloc(struct AllocOnlyPool *pool, s32 size);
+struct AllocOnlyPool *alloc_only_pool_create(void);
+void alloc_only_pool_destroy(struct AllocOnlyPool *pool);
 #else
 struct AllocOnlyPool *alloc_only_pool_init(u32 size, u32 side);
 void *alloc_only_pool_alloc(struct AllocOnlyPool *pool, s32 size);
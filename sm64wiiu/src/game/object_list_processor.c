@@ -20,6 +20,7 @@
 #include "profiler.h"
 #include "spawn_object.h"
 #include "pc/lua/smlua_hooks.h"
+#include "pc/debug_context.h"
 
 
 /**
@@ -636,6 +637,7 @@ UNUSED static u16 unused_get_elapsed_time(u64 *cycleCounts, s32 index) {
 void update_objects(UNUSED s32 unused) {
     s64 cycleCounts[30];
 
+    CTX_BEGIN(CTX_OBJECTS);
     cycleCounts[0] = get_current_clock();
 
     gTimeStopState &= ~TIME_STOP_MARIO_OPENED_DOOR;
@@ -693,4 +695,5 @@ void update_objects(UNUSED s32 unused) {
     }
 
     gPrevFrameObjectCount = gObjectCounter;
+    CTX_END(CTX_OBJECTS);
 }
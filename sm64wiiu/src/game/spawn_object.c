@@ -20,6 +20,7 @@
 #include "object_list_processor.h"
 #include "spawn_object.h"
 #include "types.h"
+#include "pc/lua/smlua.h"
 
 /**
  * An unused linked list struct that seems to have been replaced by ObjectNode.
@@ -224,6 +225,7 @@ UNUSED static void unused_delete_leaf_nodes(struct Object *obj) {
  * Free the given object.
  */
 void unload_object(struct Object *obj) {
+    smlua_on_object_unload(obj);
     obj->activeFlags = ACTIVE_FLAG_DEACTIVATED;
     obj->prevObj = NULL;
 
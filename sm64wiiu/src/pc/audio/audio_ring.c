@@ -0,0 +1,76 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_ring.h"
+
+bool audio_ring_init(struct AudioRing *ring, uint32_t capacity_frames) {
+    uint32_t capacity = 1;
+    while (capacity < capacity_frames) {
+        capacity <<= 1;
+    }
+    ring->samples = calloc(capacity * 2, sizeof(int16_t));
+    if (ring->samples == NULL) {
+        return false;
+    }
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->tail = 0;
+    return true;
+}
+
+void audio_ring_free(struct AudioRing *ring) {
+    free(ring->samples);
+    ring->samples = NULL;
+    ring->capacity = 0;
+}
+
+uint32_t audio_ring_buffered(struct AudioRing *ring) {
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    return head - tail;
+}
+
+// Copies `count` frames between the ring at `index` and `frames`, splitting
+// the copy where the ring wraps.
+static void audio_ring_copy(struct AudioRing *ring, uint32_t index, int16_t *frames, uint32_t count, bool to_ring) {
+    uint32_t start = index & (ring->capacity - 1);
+    uint32_t first = ring->capacity - start;
+    if (first > count) {
+        first = count;
+    }
+    if (to_ring) {
+        memcpy(ring->samples + start * 2, frames, first * 2 * sizeof(int16_t));
+        memcpy(ring->samples, frames + first * 2, (count - first) * 2 * sizeof(int16_t));
+    } else {
+        memcpy(frames, ring->samples + start * 2, first * 2 * sizeof(int16_t));
+        memcpy(frames + first * 2, ring->samples, (count - first) * 2 * sizeof(int16_t));
+    }
+}
+
+uint32_t audio_ring_write(struct AudioRing *ring, const int16_t *frames, uint32_t count) {
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    uint32_t space = ring->capacity - (head - tail);
+    if (count > space) {
+        count = space;
+    }
+    if (count > 0) {
+        audio_ring_copy(ring, head, (int16_t *)frames, count, true);
+        __atomic_store_n(&ring->head, head + count, __ATOMIC_RELEASE);
+    }
+    return count;
+}
+
+uint32_t audio_ring_read(struct AudioRing *ring, int16_t *frames, uint32_t count) {
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t avail = head - tail;
+    if (count > avail) {
+        count = avail;
+    }
+    if (count > 0) {
+        audio_ring_copy(ring, tail, frames, count, false);
+        __atomic_store_n(&ring->tail, tail + count, __ATOMIC_RELEASE);
+    }
+    return count;
+}
@@ -0,0 +1,25 @@
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Lock-free single-producer/single-consumer ring of interleaved stereo s16
+// frames. One thread may write and one other thread may read concurrently;
+// the indices only ever grow and wrap at 2^32.
+struct AudioRing {
+    int16_t *samples;
+    uint32_t capacity; // in frames, power of two
+    uint32_t head;     // frames written; only the producer stores it
+    uint32_t tail;     // frames read; only the consumer stores it
+};
+
+bool audio_ring_init(struct AudioRing *ring, uint32_t capacity_frames);
+void audio_ring_free(struct AudioRing *ring);
+// returns the number of frames actually written
+uint32_t audio_ring_write(struct AudioRing *ring, const int16_t *frames, uint32_t count);
+// returns the number of frames actually read
+uint32_t audio_ring_read(struct AudioRing *ring, int16_t *frames, uint32_t count);
+uint32_t audio_ring_buffered(struct AudioRing *ring);
+
+#endif
@@ -6,25 +6,47 @@
 #include "SDL2/SDL.h"
 #endif
 
+#include <string.h>
+
+#include "macros.h"
 #include "audio_api.h"
+#include "audio_ring.h"
+
+#define AUDIO_SDL_RING_FRAMES 8192
+#define AUDIO_SDL_MAX_BUFFERED 6000
 
 static SDL_AudioDeviceID dev;
+static struct AudioRing ring;
+
+// Runs on SDL's audio thread; the ring is drained lock-free and any shortfall
+// is played as silence.
+static void audio_sdl_callback(UNUSED void *userdata, Uint8 *stream, int len) {
+    uint32_t frames = (uint32_t)len / 4;
+    uint32_t got = audio_ring_read(&ring, (int16_t *)stream, frames);
+    if (got < frames) {
+        memset(stream + got * 4, 0, (frames - got) * 4);
+    }
+}
 
 static bool audio_sdl_init(void) {
     if (SDL_Init(SDL_INIT_AUDIO) != 0) {
         fprintf(stderr, "SDL init error: %s\n", SDL_GetError());
         return false;
     }
+    if (!audio_ring_init(&ring, AUDIO_SDL_RING_FRAMES)) {
+        return false;
+    }
     SDL_AudioSpec want, have;
     SDL_zero(want);
     want.freq = 32000;
-    want.format = AUDIO_S16;
+    want.format = AUDIO_S16SYS; // mixer output is native-endian
     want.channels = 2;
     want.samples = 512;
-    want.callback = NULL;
+    want.callback = audio_sdl_callback;
     dev = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
     if (dev == 0) {
         fprintf(stderr, "SDL_OpenAudio error: %s\n", SDL_GetError());
+        audio_ring_free(&ring);
         return false;
     }
     SDL_PauseAudioDevice(dev, 0);
@@ -32,7 +54,7 @@ static bool audio_sdl_init(void) {
 }
 
 static int audio_sdl_buffered(void) {
-    return SDL_GetQueuedAudioSize(dev) / 4;
+    return (int)audio_ring_buffered(&ring);
 }
 
 static int audio_sdl_get_desired_buffered(void) {
@@ -40,15 +62,9 @@ static int audio_sdl_get_desired_buffered(void) {
 }
 
 static void audio_sdl_play(const uint8_t *buf, size_t len) {
-    if (audio_sdl_buffered() < 6000) {
+    if (audio_sdl_buffered() < AUDIO_SDL_MAX_BUFFERED) {
         // Don't fill the audio buffer too much in case this happens
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-        uint16_t *buf_16 = (uint16_t *)buf;
-        for (uint32_t i = 0; i < (len / 2); i++) { // handle AUDIO_S16 format on big endian devices
-            buf_16[i] = buf[i*2] | ((uint16_t)(buf[i*2+1]) << 8);
-        }
-#endif // SDL_BYTEORDER
-        SDL_QueueAudio(dev, buf, len);
+        audio_ring_write(&ring, (const int16_t *)buf, (uint32_t)(len / 4));
     }
 }
 
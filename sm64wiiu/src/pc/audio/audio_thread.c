@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "sm64.h"
+#include "audio/external.h"
+#include "audio/internal.h"
+#include "audio/load.h"
+#include "pc/configfile.h"
+#include "pc/debug_context.h"
+#include "pc/thread.h"
+#include "pc/utils/misc.h"
+
+#include "audio_thread.h"
+#include "mod_sample.h"
+#include "mod_stream.h"
+
+// a busy tick queues a few dozen sounds; this covers many ticks of backlog
+#define AUDIO_COMMAND_QUEUE_SIZE 1024 // power of two
+#define AUDIO_IDLE_SLEEP_US 1000
+
+extern void create_next_audio_buffer(s16 *samples, u32 num_samples);
+
+// single producer (game thread), single consumer (audio thread)
+static struct AudioCommand sCommands[AUDIO_COMMAND_QUEUE_SIZE];
+static u32 sCommandHead = 0;
+static u32 sCommandTail = 0;
+
+static struct AudioAPI *sApi = NULL;
+static struct ThreadHandle sThread;
+static uintptr_t sThreadId = 0;
+static struct ThreadMutex sStatsLock;
+static bool sRunning = false;
+static bool sQuit = false;
+
+// game-side copies so an unchanged master volume is not re-sent every frame
+static f32 sSentMasterVolume = -1.0f;
+static bool sSentMute = false;
+
+// owned by the audio thread
+static f32 sMasterVolume = 1.0f;
+static bool sMute = false;
+
+static audio_thread_stats_t sStats;
+
+static void audio_thread_push(const struct AudioCommand *cmd) {
+    u32 head = sCommandHead;
+    // dropping a call could lose a music change; wait for the audio thread
+    // to drain instead, it never blocks on us
+    if (head - __atomic_load_n(&sCommandTail, __ATOMIC_ACQUIRE) >= AUDIO_COMMAND_QUEUE_SIZE) {
+        lock_mutex(&sStatsLock);
+        sStats.stalls++;
+        unlock_mutex(&sStatsLock);
+        while (head - __atomic_load_n(&sCommandTail, __ATOMIC_ACQUIRE) >= AUDIO_COMMAND_QUEUE_SIZE) {
+            sleep_thread_us(AUDIO_IDLE_SLEEP_US);
+        }
+    }
+    sCommands[head & (AUDIO_COMMAND_QUEUE_SIZE - 1)] = *cmd;
+    __atomic_store_n(&sCommandHead, head + 1, __ATOMIC_RELEASE);
+}
+
+bool audio_thread_defer(const struct AudioCommand *cmd) {
+    if (!sRunning || current_thread_id() == __atomic_load_n(&sThreadId, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    audio_thread_push(cmd);
+    return true;
+}
+
+static void audio_thread_replay(const struct AudioCommand *cmd) {
+    const s32 *a = cmd->args;
+    switch (cmd->type) {
+        case AUDIO_CALL_PLAY_SOUND:                      play_sound(a[0], cmd->pos); break;
+        case AUDIO_CALL_STOP_SOUND:                      stop_sound((u32)a[0], cmd->pos); break;
+        case AUDIO_CALL_STOP_SOUNDS_FROM_SOURCE:         stop_sounds_from_source(cmd->pos); break;
+        case AUDIO_CALL_STOP_SOUNDS_IN_CONTINUOUS_BANKS: stop_sounds_in_continuous_banks(); break;
+        case AUDIO_CALL_GAME_LOOP_TICK:                  audio_signal_game_loop_tick(); break;
+        case AUDIO_CALL_SEQ_PLAYER_FADE_OUT:             seq_player_fade_out(a[0], a[1]); break;
+        case AUDIO_CALL_FADE_VOLUME_SCALE:               fade_volume_scale(a[0], a[1], a[2]); break;
+        case AUDIO_CALL_SEQ_PLAYER_LOWER_VOLUME:         seq_player_lower_volume(a[0], a[1], a[2]); break;
+        case AUDIO_CALL_SEQ_PLAYER_UNLOWER_VOLUME:       seq_player_unlower_volume(a[0], a[1]); break;
+        case AUDIO_CALL_SET_AUDIO_MUTED:                 set_audio_muted(a[0]); break;
+        case AUDIO_CALL_SOUND_BANKS_DISABLE:             sound_banks_disable(a[0], a[1]); break;
+        case AUDIO_CALL_SOUND_BANKS_ENABLE:              sound_banks_enable(a[0], a[1]); break;
+        case AUDIO_CALL_SET_SOUND_MOVING_SPEED:          set_sound_moving_speed(a[0], a[1]); break;
+        case AUDIO_CALL_PLAY_DIALOG_SOUND:               play_dialog_sound(a[0]); break;
+        case AUDIO_CALL_SET_SEQUENCE_PLAYER_VOLUME:      set_sequence_player_volume(a[0], cmd->value); break;
+        case AUDIO_CALL_PLAY_MUSIC:                      play_music(a[0], a[1], a[2]); break;
+        case AUDIO_CALL_STOP_BACKGROUND_MUSIC:           stop_background_music(a[0]); break;
+        case AUDIO_CALL_FADEOUT_BACKGROUND_MUSIC:        fadeout_background_music(a[0], a[1]); break;
+        case AUDIO_CALL_DROP_QUEUED_BACKGROUND_MUSIC:    drop_queued_background_music(); break;
+        case AUDIO_CALL_PLAY_SECONDARY_MUSIC:            play_secondary_music(a[0], a[1], a[2], a[3]); break;
+        case AUDIO_CALL_FUNC_80321080:                   func_80321080(a[0]); break;
+        case AUDIO_CALL_FUNC_803210D4:                   func_803210D4(a[0]); break;
+        case AUDIO_CALL_PLAY_COURSE_CLEAR:               play_course_clear(); break;
+        case AUDIO_CALL_PLAY_PEACHS_JINGLE:              play_peachs_jingle(); break;
+        case AUDIO_CALL_PLAY_PUZZLE_JINGLE:              play_puzzle_jingle(); break;
+        case AUDIO_CALL_PLAY_STAR_FANFARE:               play_star_fanfare(); break;
+        case AUDIO_CALL_PLAY_POWER_STAR_JINGLE:          play_power_star_jingle(a[0]); break;
+        case AUDIO_CALL_PLAY_RACE_FANFARE:               play_race_fanfare(); break;
+        case AUDIO_CALL_PLAY_TOADS_JINGLE:               play_toads_jingle(); break;
+        case AUDIO_CALL_SOUND_RESET:                     sound_reset(a[0]); break;
+        case AUDIO_CALL_SET_SOUND_MODE:                  audio_set_sound_mode(a[0]); break;
+        case AUDIO_CALL_MASTER_VOLUME:
+            sMasterVolume = cmd->value;
+            sMute = a[0] != 0;
+            break;
+    }
+}
+
+// replays queued calls up to the next end of frame; true when one was reached
+static bool audio_thread_replay_frame(void) {
+    u32 tail = sCommandTail;
+    u32 head = __atomic_load_n(&sCommandHead, __ATOMIC_ACQUIRE);
+    bool frame = false;
+    while (tail != head && !frame) {
+        struct AudioCommand *cmd = &sCommands[tail & (AUDIO_COMMAND_QUEUE_SIZE - 1)];
+        frame = cmd->type == AUDIO_CALL_END_FRAME;
+        if (!frame) {
+            audio_thread_replay(cmd);
+        }
+        tail++;
+    }
+    __atomic_store_n(&sCommandTail, tail, __ATOMIC_RELEASE);
+    return frame;
+}
+
+// one game tick of audio: the same two chunks produce_one_frame() makes inline
+static void audio_thread_synthesize(s16 *buffer) {
+    f64 start = clock_elapsed_f64();
+    CTX_BEGIN(CTX_AUDIO);
+
+    int buffered = sApi->buffered();
+    u32 samples = buffered < sApi->get_desired_buffered() ? AUDIO_SAMPLES_HIGH : AUDIO_SAMPLES_LOW;
+    for (int i = 0; i < 2; i++) {
+        create_next_audio_buffer(buffer + i * (samples * 2), samples);
+    }
+    mod_stream_mix(buffer, 2 * samples);
+    mod_sample_mix(buffer, 2 * samples);
+
+    // a muted backend still gets silence so its fill keeps steering HIGH/LOW
+    u32 count = 2 * samples * 2;
+    if (sMute) {
+        memset(buffer, 0, count * sizeof(s16));
+    } else if (sMasterVolume < 1.0f) {
+        for (u32 i = 0; i < count; i++) {
+            buffer[i] = (s16)((f32)buffer[i] * sMasterVolume);
+        }
+    }
+    sApi->play((u8 *)buffer, count * sizeof(s16));
+    CTX_END(CTX_AUDIO);
+
+    f64 elapsed = clock_elapsed_f64() - start;
+    f64 latency = (f64)(buffered + 2 * samples) / AUDIO_OUTPUT_RATE;
+    lock_mutex(&sStatsLock);
+    if (buffered == 0 && sStats.chunks > 0) {
+        sStats.underruns++;
+    }
+    sStats.chunks += 2;
+    sStats.synth_time += elapsed;
+    if (elapsed > sStats.synth_max) { sStats.synth_max = elapsed; }
+    sStats.latency = latency;
+    if (latency > sStats.latency_max) { sStats.latency_max = latency; }
+    unlock_mutex(&sStatsLock);
+}
+
+static void *audio_thread_main(UNUSED void *arg) {
+    static s16 buffer[AUDIO_SAMPLES_HIGH * 2 * 2];
+    debug_context_set_thread_name("audio");
+    __atomic_store_n(&sThreadId, current_thread_id(), __ATOMIC_RELEASE);
+    while (!__atomic_load_n(&sQuit, __ATOMIC_ACQUIRE)) {
+        if (!audio_thread_replay_frame()) {
+            sleep_thread_us(AUDIO_IDLE_SLEEP_US);
+            continue;
+        }
+        audio_thread_synthesize(buffer);
+    }
+    return NULL;
+}
+
+bool audio_thread_init(struct AudioAPI *api) {
+#ifdef HAVE_THREADS
+    if (sRunning || api == NULL || api->get_desired_buffered() <= 0) {
+        return false;
+    }
+    memset(&sStats, 0, sizeof(sStats));
+    sApi = api;
+    sQuit = false;
+    if (init_mutex(&sStatsLock) != 0) {
+        return false;
+    }
+    if (init_thread_handle(&sThread, audio_thread_main, NULL, NULL, 0) != 0) {
+        printf("audio: could not start the audio thread, mixing on the game thread\n");
+        return false;
+    }
+    sRunning = true;
+    return true;
+#else
+    (void)api;
+    return false;
+#endif
+}
+
+void audio_thread_shutdown(void) {
+    if (!sRunning) {
+        return;
+    }
+    __atomic_store_n(&sQuit, true, __ATOMIC_RELEASE);
+    cleanup_thread_handle(&sThread);
+    sRunning = false;
+
+    if (sStats.chunks > 0) {
+        printf("audio: %u chunks, synth avg %.3fms (max %.3fms), latency %.1fms (max %.1fms), %u underruns, %u queue stalls\n",
+               (unsigned)sStats.chunks, sStats.synth_time * 1000.0 / (sStats.chunks / 2),
+               sStats.synth_max * 1000.0, sStats.latency * 1000.0, sStats.latency_max * 1000.0,
+               (unsigned)sStats.underruns, (unsigned)sStats.stalls);
+    }
+    if (gSampleDmaFrames > 0) {
+        printf("audio: sample dma copied %.1f bytes per frame (%s)\n",
+               (double)gSampleDmaBytesCopied / (double)gSampleDmaFrames,
+               configAudioSampleDmaCache ? "n64 cache" : "in place");
+    }
+    destroy_mutex(&sStatsLock);
+}
+
+bool audio_thread_running(void) {
+    return sRunning;
+}
+
+void audio_thread_end_frame(void) {
+    if (sRunning) {
+        struct AudioCommand cmd = { .type = AUDIO_CALL_END_FRAME };
+        audio_thread_push(&cmd);
+    }
+}
+
+void audio_thread_set_sequence_volume(int32_t player, float volume) {
+    // not deduplicated: new channels start at volumeScale 1.0 and the level
+    // BGM clamp is only reapplied here, so this has to run every tick
+    if (player < 0 || player >= SEQUENCE_PLAYERS) {
+        return;
+    }
+    set_sequence_player_volume(player, volume);
+}
+
+void audio_thread_set_master_volume(float volume, bool mute) {
+    if (!sRunning || (sSentMasterVolume == volume && sSentMute == mute)) {
+        return;
+    }
+    struct AudioCommand cmd = { .type = AUDIO_CALL_MASTER_VOLUME, .args = { mute }, .value = volume };
+    audio_thread_push(&cmd);
+    sSentMasterVolume = volume;
+    sSentMute = mute;
+}
+
+void audio_thread_get_stats(audio_thread_stats_t *out) {
+    if (!sRunning) {
+        *out = sStats;
+        return;
+    }
+    lock_mutex(&sStatsLock);
+    *out = sStats;
+    unlock_mutex(&sStatsLock);
+}
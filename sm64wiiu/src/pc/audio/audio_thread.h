@@ -0,0 +1,113 @@
+#ifndef AUDIO_THREAD_H
+#define AUDIO_THREAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "audio_api.h"
+
+// Frames synthesized per create_next_audio_buffer() call; two chunks make
+// one 30 Hz game frame's worth of audio.
+#ifdef VERSION_EU
+#define AUDIO_SAMPLES_HIGH 656
+#define AUDIO_SAMPLES_LOW 640
+#else
+#define AUDIO_SAMPLES_HIGH 544
+#define AUDIO_SAMPLES_LOW 528
+#endif
+
+#define AUDIO_OUTPUT_RATE 32000
+
+// Runs synthesis on its own thread, one game tick behind the game. While it
+// runs the game never touches the audio engine: the game-facing entry points
+// in audio/external.c hand their calls to a single-producer command queue and
+// return, and audio_thread_end_frame() closes each tick. The audio thread
+// replays a tick's calls in order, then synthesizes that tick's two chunks,
+// HIGH or LOW from the backend fill exactly like the inline path, so
+// sequences still tick 60 times a second in step with the game. Game-side
+// reads of audio state (get_current_background_music) may be a tick stale.
+// Backends that report no buffering (audio_null) keep the inline per-frame
+// path so headless runs stay deterministic.
+
+enum AudioCall {
+    AUDIO_CALL_PLAY_SOUND,
+    AUDIO_CALL_STOP_SOUND,
+    AUDIO_CALL_STOP_SOUNDS_FROM_SOURCE,
+    AUDIO_CALL_STOP_SOUNDS_IN_CONTINUOUS_BANKS,
+    AUDIO_CALL_GAME_LOOP_TICK,
+    AUDIO_CALL_SEQ_PLAYER_FADE_OUT,
+    AUDIO_CALL_FADE_VOLUME_SCALE,
+    AUDIO_CALL_SEQ_PLAYER_LOWER_VOLUME,
+    AUDIO_CALL_SEQ_PLAYER_UNLOWER_VOLUME,
+    AUDIO_CALL_SET_AUDIO_MUTED,
+    AUDIO_CALL_SOUND_BANKS_DISABLE,
+    AUDIO_CALL_SOUND_BANKS_ENABLE,
+    AUDIO_CALL_SET_SOUND_MOVING_SPEED,
+    AUDIO_CALL_PLAY_DIALOG_SOUND,
+    AUDIO_CALL_SET_SEQUENCE_PLAYER_VOLUME,
+    AUDIO_CALL_PLAY_MUSIC,
+    AUDIO_CALL_STOP_BACKGROUND_MUSIC,
+    AUDIO_CALL_FADEOUT_BACKGROUND_MUSIC,
+    AUDIO_CALL_DROP_QUEUED_BACKGROUND_MUSIC,
+    AUDIO_CALL_PLAY_SECONDARY_MUSIC,
+    AUDIO_CALL_FUNC_80321080,
+    AUDIO_CALL_FUNC_803210D4,
+    AUDIO_CALL_PLAY_COURSE_CLEAR,
+    AUDIO_CALL_PLAY_PEACHS_JINGLE,
+    AUDIO_CALL_PLAY_PUZZLE_JINGLE,
+    AUDIO_CALL_PLAY_STAR_FANFARE,
+    AUDIO_CALL_PLAY_POWER_STAR_JINGLE,
+    AUDIO_CALL_PLAY_RACE_FANFARE,
+    AUDIO_CALL_PLAY_TOADS_JINGLE,
+    AUDIO_CALL_SOUND_RESET,
+    AUDIO_CALL_SET_SOUND_MODE,
+    // internal to audio_thread.c
+    AUDIO_CALL_MASTER_VOLUME,
+    AUDIO_CALL_END_FRAME,
+};
+
+struct AudioCommand {
+    uint8_t type;
+    int32_t args[4];
+    float *pos;
+    float value;
+};
+
+// queues the call when the audio thread runs and we are not on it
+bool audio_thread_defer(const struct AudioCommand *cmd);
+
+// first statement of a deferred entry point, e.g.
+//   AUDIO_THREAD_DEFER(AUDIO_CALL_PLAY_MUSIC, .args = { player, seqArgs, fadeTimer });
+#define AUDIO_THREAD_DEFER(...) \
+    do { \
+        if (audio_thread_defer(&(struct AudioCommand){ .type = __VA_ARGS__ })) { return; } \
+    } while (0)
+
+typedef struct {
+    uint32_t chunks;       // create_next_audio_buffer() calls
+    uint32_t underruns;    // refills that found the backend empty
+    uint32_t stalls;       // game-thread waits on a full command queue
+    double synth_time;     // seconds spent synthesizing
+    double synth_max;      // longest single refill
+    double latency;        // backend fill after the last refill, in seconds
+    double latency_max;
+} audio_thread_stats_t;
+
+// returns false (and leaves audio on the game thread) when threads are
+// unavailable or the backend cannot pace a producer
+bool audio_thread_init(struct AudioAPI *api);
+void audio_thread_shutdown(void);
+bool audio_thread_running(void);
+
+// after the game tick and smlua_update(): the audio thread synthesizes the
+// tick once it has replayed everything queued before this
+void audio_thread_end_frame(void);
+
+// replayed with the current tick's calls; call the sequence volume every
+// tick, the master volume is only re-sent when it changes
+void audio_thread_set_sequence_volume(int32_t player, float volume);
+void audio_thread_set_master_volume(float volume, bool mute);
+
+void audio_thread_get_stats(audio_thread_stats_t *out);
+
+#endif
@@ -0,0 +1,505 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sm64.h"
+#include "pc/fs/fs_async.h"
+#include "pc/thread.h"
+
+#include "audio_thread.h"
+#include "mod_sample.h"
+
+// a voice whose sample is still loading gives up after a quarter second
+#define MOD_SAMPLE_MAX_WAIT (AUDIO_OUTPUT_RATE / 4)
+
+enum ModSampleState {
+    MOD_SAMPLE_EMPTY,   // registered, not decoded
+    MOD_SAMPLE_LOADING,
+    MOD_SAMPLE_READY,
+    MOD_SAMPLE_FAILED,
+};
+
+struct ModSample {
+    char *path;
+    u8 state;
+    u16 voices;    // voices referencing it; never evicted while nonzero
+    s16 *pcm;      // mono
+    u32 frames;
+    u32 rate;
+    u32 last_used; // play counter at the last play, for LRU eviction
+};
+
+struct ModVoice {
+    s16 sample;    // -1 when free
+    u32 serial;    // start order; the lowest is stolen first
+    u64 pos;       // 48.16 frames into the sample
+    u32 step;      // 16.16 frames per output frame, 0 until the sample is ready
+    f32 pitch;
+    f32 gain[2];
+    u32 waited;    // output frames spent waiting for the sample to load
+};
+
+// sSamples[].path and sSampleCount are only touched on the game thread;
+// everything else is guarded by sLock, which the mixer holds while it runs
+static struct ModSample sSamples[MOD_SAMPLE_MAX];
+static u32 sSampleCount = 0;
+static struct ModVoice sVoices[MOD_SAMPLE_VOICES];
+static struct ThreadMutex sLock;
+static bool sInitialized = false;
+static u32 sPlayCounter = 0;
+static f32 sSfxVolume = 1.0f;
+static mod_sample_stats_t sStats;
+
+/* decoding */
+
+static u32 read_be32(const u8 *p) {
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
+static u32 read_le32(const u8 *p) {
+    return p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+// the integer part of an 80-bit IEEE extended float (AIFF sample rates)
+static u32 read_ext80(const u8 *p) {
+    s32 exponent = (((p[0] & 0x7f) << 8) | p[1]) - 16383;
+    if (exponent < 0 || exponent > 31) {
+        return 0;
+    }
+    return read_be32(p + 2) >> (31 - exponent);
+}
+
+// the top 16 bits of one `bits`-wide PCM sample
+static s32 read_pcm(const u8 *p, u32 bits, bool big_endian) {
+    u32 bytes = bits / 8;
+    if (bits == 8) {
+        // AIFF stores 8-bit samples signed, WAV unsigned
+        return big_endian ? (s8)p[0] * 256 : (p[0] - 128) * 256;
+    }
+    return big_endian ? (s16)((p[0] << 8) | p[1]) : (s16)((p[bytes - 2]) | (p[bytes - 1] << 8));
+}
+
+// converts interleaved PCM to mono s16, averaging the channels
+static s16 *decode_pcm(const u8 *data, u32 frames, u32 channels, u32 bits, bool big_endian) {
+    u32 stride = channels * (bits / 8);
+    s16 *pcm = malloc(frames * sizeof(s16));
+    if (pcm == NULL) {
+        return NULL;
+    }
+    for (u32 i = 0; i < frames; i++) {
+        s32 sum = 0;
+        for (u32 c = 0; c < channels; c++) {
+            sum += read_pcm(data + i * stride + c * (bits / 8), bits, big_endian);
+        }
+        pcm[i] = (s16)(sum / (s32)channels);
+    }
+    return pcm;
+}
+
+static bool decode_aiff(const u8 *data, u32 size, struct ModSample *out) {
+    bool aifc = memcmp(data + 8, "AIFC", 4) == 0;
+    bool big_endian = true;
+    u32 channels = 0, frames = 0, bits = 0, rate = 0;
+    const u8 *sound = NULL;
+    u32 sound_size = 0;
+
+    for (u32 off = 12; off + 8 <= size;) {
+        const u8 *chunk = data + off;
+        u32 length = read_be32(chunk + 4);
+        if (length > size - off - 8) {
+            length = size - off - 8;
+        }
+        if (!memcmp(chunk, "COMM", 4) && length >= 18) {
+            channels = (chunk[8] << 8) | chunk[9];
+            frames = read_be32(chunk + 10);
+            bits = (chunk[14] << 8) | chunk[15];
+            rate = read_ext80(chunk + 16);
+            if (aifc && length >= 22) {
+                if (!memcmp(chunk + 26, "sowt", 4)) {
+                    big_endian = false;
+                } else if (memcmp(chunk + 26, "NONE", 4) != 0) {
+                    return false; // compressed AIFF-C
+                }
+            }
+        } else if (!memcmp(chunk, "SSND", 4) && length >= 8) {
+            u32 skip = read_be32(chunk + 8);
+            if (skip <= length - 8) {
+                sound = chunk + 16 + skip;
+                sound_size = length - 8 - skip;
+            }
+        }
+        off += 8 + length + (length & 1);
+    }
+
+    bits = (bits + 7) & ~7u;
+    if (sound == NULL || channels == 0 || rate == 0 || bits == 0 || bits > 32) {
+        return false;
+    }
+    if (frames > sound_size / (channels * (bits / 8))) {
+        frames = sound_size / (channels * (bits / 8));
+    }
+    out->pcm = decode_pcm(sound, frames, channels, bits, big_endian);
+    out->frames = frames;
+    out->rate = rate;
+    return out->pcm != NULL;
+}
+
+static bool decode_wav(const u8 *data, u32 size, struct ModSample *out) {
+    u32 channels = 0, bits = 0, rate = 0, format = 0;
+    const u8 *sound = NULL;
+    u32 sound_size = 0;
+
+    for (u32 off = 12; off + 8 <= size;) {
+        const u8 *chunk = data + off;
+        u32 length = read_le32(chunk + 4);
+        if (length > size - off - 8) {
+            length = size - off - 8;
+        }
+        if (!memcmp(chunk, "fmt ", 4) && length >= 16) {
+            format = chunk[8] | (chunk[9] << 8);
+            channels = chunk[10] | (chunk[11] << 8);
+            rate = read_le32(chunk + 12);
+            bits = chunk[22] | (chunk[23] << 8);
+        } else if (!memcmp(chunk, "data", 4)) {
+            sound = chunk + 8;
+            sound_size = length;
+        }
+        off += 8 + length + (length & 1);
+    }
+
+    // plain PCM, or WAVE_FORMAT_EXTENSIBLE wrapping it
+    bits = (bits + 7) & ~7u;
+    if (sound == NULL || (format != 1 && format != 0xfffe) || channels == 0 || rate == 0 || bits == 0 || bits > 32) {
+        return false;
+    }
+    u32 frames = sound_size / (channels * (bits / 8));
+    out->pcm = decode_pcm(sound, frames, channels, bits, false);
+    out->frames = frames;
+    out->rate = rate;
+    return out->pcm != NULL;
+}
+
+static bool mod_sample_decode(const u8 *data, u32 size, struct ModSample *out) {
+    if (size < 12) {
+        return false;
+    }
+    if (!memcmp(data, "FORM", 4) && (!memcmp(data + 8, "AIFF", 4) || !memcmp(data + 8, "AIFC", 4))) {
+        return decode_aiff(data, size, out);
+    }
+    if (!memcmp(data, "RIFF", 4) && !memcmp(data + 8, "WAVE", 4)) {
+        return decode_wav(data, size, out);
+    }
+    return false;
+}
+
+/* cache */
+
+// frees least recently played samples until the cache fits its budget;
+// `keep` is the sample that was just added
+static void mod_sample_evict_locked(u32 keep) {
+    while (sStats.bytes > MOD_SAMPLE_CACHE_BUDGET) {
+        struct ModSample *victim = NULL;
+        for (u32 i = 0; i < sSampleCount; i++) {
+            struct ModSample *s = &sSamples[i];
+            if (i == keep || s->state != MOD_SAMPLE_READY || s->voices > 0) {
+                continue;
+            }
+            if (victim == NULL || (s32)(s->last_used - victim->last_used) < 0) {
+                victim = s;
+            }
+        }
+        if (victim == NULL) {
+            return;
+        }
+        free(victim->pcm);
+        victim->pcm = NULL;
+        victim->state = MOD_SAMPLE_EMPTY;
+        sStats.bytes -= victim->frames * sizeof(s16);
+        sStats.resident--;
+        sStats.evictions++;
+    }
+}
+
+// runs on an fs_async worker; swaps the file for a decoded struct ModSample
+static void *mod_sample_decode_async(void *data, u64 *size, UNUSED void *user) {
+    struct ModSample *decoded = calloc(1, sizeof(*decoded));
+    bool ok = decoded != NULL && *size <= UINT32_MAX && mod_sample_decode(data, (u32)*size, decoded);
+    free(data);
+    if (!ok) {
+        free(decoded);
+        return NULL;
+    }
+    *size = sizeof(*decoded);
+    return decoded;
+}
+
+// runs on the game thread from fs_async_update(); only publishes the PCM
+static void mod_sample_loaded(fs_async_req_t *req, void *user) {
+    u32 index = (u32)(uintptr_t)user;
+    struct ModSample *result = fs_async_take(req, NULL);
+    fs_async_release(req);
+
+    if (!sInitialized || index >= sSampleCount) {
+        if (result != NULL) {
+            free(result->pcm);
+            free(result);
+        }
+        return;
+    }
+    struct ModSample decoded = { 0 };
+    bool ok = result != NULL;
+    if (ok) {
+        decoded = *result;
+        free(result);
+    } else {
+        printf("mod_sample: could not load or decode '%s'\n", sSamples[index].path);
+    }
+
+    lock_mutex(&sLock);
+    struct ModSample *s = &sSamples[index];
+    if (ok && s->last_used == 0 && sStats.bytes + decoded.frames * sizeof(s16) > MOD_SAMPLE_CACHE_BUDGET) {
+        // a prefetch never evicts a sample that has been played
+        free(decoded.pcm);
+        s->state = MOD_SAMPLE_EMPTY;
+    } else if (ok) {
+        s->pcm = decoded.pcm;
+        s->frames = decoded.frames;
+        s->rate = decoded.rate;
+        s->state = MOD_SAMPLE_READY;
+        sStats.bytes += s->frames * sizeof(s16);
+        sStats.resident++;
+        mod_sample_evict_locked(index);
+    } else {
+        s->state = MOD_SAMPLE_FAILED;
+    }
+    unlock_mutex(&sLock);
+}
+
+// queues the load of an EMPTY sample; called with sLock held
+static void mod_sample_request_locked(u32 index, fs_async_priority_t prio) {
+    struct ModSample *s = &sSamples[index];
+    s->state = MOD_SAMPLE_LOADING;
+    if (fs_async_load_transform(s->path, prio, mod_sample_decode_async, mod_sample_loaded, (void *)(uintptr_t)index) == NULL) {
+        s->state = MOD_SAMPLE_EMPTY;
+    }
+}
+
+/* api */
+
+void mod_sample_init(void) {
+    if (sInitialized) {
+        return;
+    }
+    memset(sSamples, 0, sizeof(sSamples));
+    memset(&sStats, 0, sizeof(sStats));
+    for (u32 i = 0; i < MOD_SAMPLE_VOICES; i++) {
+        sVoices[i].sample = -1;
+    }
+    sSampleCount = 0;
+    init_mutex(&sLock);
+    sInitialized = true;
+}
+
+void mod_sample_shutdown(void) {
+    if (!sInitialized) {
+        return;
+    }
+    lock_mutex(&sLock);
+    u64 plays = sStats.hits + sStats.misses;
+    if (plays > 0) {
+        printf("mod_sample: %llu plays, %.1f%% cache hits, %u of %u samples resident (%u KB), %llu evictions, %llu steals, %llu expired\n",
+               (unsigned long long)plays, sStats.hits * 100.0 / plays, (unsigned)sStats.resident,
+               (unsigned)sStats.samples, (unsigned)(sStats.bytes / 1024), (unsigned long long)sStats.evictions,
+               (unsigned long long)sStats.steals, (unsigned long long)sStats.expired);
+    }
+    for (u32 i = 0; i < sSampleCount; i++) {
+        free(sSamples[i].pcm);
+        free(sSamples[i].path);
+    }
+    sSampleCount = 0;
+    sInitialized = false;
+    unlock_mutex(&sLock);
+    destroy_mutex(&sLock);
+}
+
+int32_t mod_sample_load(const char *vpath) {
+    if (!sInitialized || vpath == NULL) {
+        return -1;
+    }
+    for (u32 i = 0; i < sSampleCount; i++) {
+        if (!strcmp(sSamples[i].path, vpath)) {
+            return (int32_t)i;
+        }
+    }
+    if (sSampleCount >= MOD_SAMPLE_MAX) {
+        printf("mod_sample: too many samples, '%s' will not play\n", vpath);
+        return -1;
+    }
+    char *path = strdup(vpath);
+    if (path == NULL) {
+        return -1;
+    }
+
+    lock_mutex(&sLock);
+    u32 index = sSampleCount;
+    memset(&sSamples[index], 0, sizeof(sSamples[index]));
+    sSamples[index].path = path;
+    sSampleCount++;
+    sStats.samples = sSampleCount;
+    // warm the cache while there is room; later samples load on first play
+    if (sStats.bytes < MOD_SAMPLE_CACHE_BUDGET) {
+        mod_sample_request_locked(index, FS_ASYNC_PRIORITY_PREFETCH);
+    }
+    unlock_mutex(&sLock);
+    return (int32_t)index;
+}
+
+void mod_sample_play(int32_t sample, float volume, float pan, float pitch) {
+    if (!sInitialized || sample < 0 || (u32)sample >= sSampleCount) {
+        return;
+    }
+
+    lock_mutex(&sLock);
+    struct ModSample *s = &sSamples[sample];
+    if (s->state == MOD_SAMPLE_FAILED) {
+        unlock_mutex(&sLock);
+        return;
+    }
+    if (s->state == MOD_SAMPLE_READY) {
+        sStats.hits++;
+    } else {
+        sStats.misses++;
+        if (s->state == MOD_SAMPLE_EMPTY) {
+            mod_sample_request_locked((u32)sample, FS_ASYNC_PRIORITY_HIGH);
+        }
+    }
+    s->last_used = ++sPlayCounter;
+
+    // a free voice, or else the oldest
+    struct ModVoice *voice = NULL;
+    for (u32 i = 0; i < MOD_SAMPLE_VOICES; i++) {
+        struct ModVoice *v = &sVoices[i];
+        if (v->sample < 0) {
+            voice = v;
+            break;
+        }
+        if (voice == NULL || (s32)(v->serial - voice->serial) < 0) {
+            voice = v;
+        }
+    }
+    if (voice->sample >= 0) {
+        sSamples[voice->sample].voices--;
+        sStats.steals++;
+    }
+
+    if (pan < -1.0f) { pan = -1.0f; }
+    if (pan > 1.0f) { pan = 1.0f; }
+    if (volume < 0.0f) { volume = 0.0f; }
+    voice->sample = (s16)sample;
+    voice->serial = sPlayCounter;
+    voice->pos = 0;
+    voice->step = 0;
+    voice->pitch = pitch > 0.0f ? pitch : 1.0f;
+    voice->gain[0] = volume * (pan > 0.0f ? 1.0f - pan : 1.0f);
+    voice->gain[1] = volume * (pan < 0.0f ? 1.0f + pan : 1.0f);
+    voice->waited = 0;
+    s->voices++;
+    unlock_mutex(&sLock);
+}
+
+void mod_sample_stop(int32_t sample) {
+    if (!sInitialized) {
+        return;
+    }
+    lock_mutex(&sLock);
+    for (u32 i = 0; i < MOD_SAMPLE_VOICES; i++) {
+        struct ModVoice *v = &sVoices[i];
+        if (v->sample >= 0 && (sample < 0 || v->sample == sample)) {
+            sSamples[v->sample].voices--;
+            v->sample = -1;
+        }
+    }
+    unlock_mutex(&sLock);
+}
+
+void mod_sample_stop_all(void) {
+    mod_sample_stop(-1);
+}
+
+void mod_sample_set_sfx_volume(float volume) {
+    if (!sInitialized) {
+        return;
+    }
+    lock_mutex(&sLock);
+    sSfxVolume = volume;
+    unlock_mutex(&sLock);
+}
+
+static void mod_sample_release_voice(struct ModVoice *v) {
+    sSamples[v->sample].voices--;
+    v->sample = -1;
+}
+
+void mod_sample_mix(int16_t *buffer, uint32_t frames) {
+    if (!sInitialized) {
+        return;
+    }
+
+    lock_mutex(&sLock);
+    for (u32 i = 0; i < MOD_SAMPLE_VOICES; i++) {
+        struct ModVoice *v = &sVoices[i];
+        if (v->sample < 0) {
+            continue;
+        }
+        const struct ModSample *s = &sSamples[v->sample];
+        if (s->state != MOD_SAMPLE_READY) {
+            v->waited += frames;
+            if (s->state == MOD_SAMPLE_FAILED || v->waited > MOD_SAMPLE_MAX_WAIT) {
+                sStats.expired++;
+                mod_sample_release_voice(v);
+            }
+            continue;
+        }
+        if (v->step == 0) {
+            v->step = (u32)((f32)s->rate * v->pitch * 65536.0f / AUDIO_OUTPUT_RATE);
+            if (v->step == 0) {
+                v->step = 1;
+            }
+        }
+
+        // 16.16 linear interpolation; the last frame pairs with itself
+        f32 gain_l = v->gain[0] * sSfxVolume;
+        f32 gain_r = v->gain[1] * sSfxVolume;
+        u32 last = s->frames - 1;
+        u64 pos = v->pos;
+        for (u32 j = 0; j < frames; j++) {
+            if ((pos >> 16) >= s->frames) {
+                break;
+            }
+            u32 index = (u32)(pos >> 16);
+            s32 a = s->pcm[index];
+            s32 b = s->pcm[index < last ? index + 1 : last];
+            f32 sample = (f32)(a + (((b - a) * (s32)(pos & 0xffff)) >> 16));
+            s32 l = buffer[j * 2] + (s32)(sample * gain_l);
+            s32 r = buffer[j * 2 + 1] + (s32)(sample * gain_r);
+            buffer[j * 2] = (s16)(l > 32767 ? 32767 : l < -32768 ? -32768 : l);
+            buffer[j * 2 + 1] = (s16)(r > 32767 ? 32767 : r < -32768 ? -32768 : r);
+            pos += v->step;
+        }
+        v->pos = pos;
+        if ((pos >> 16) >= s->frames) {
+            mod_sample_release_voice(v);
+        }
+    }
+    unlock_mutex(&sLock);
+}
+
+void mod_sample_get_stats(mod_sample_stats_t *out) {
+    if (!sInitialized) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    lock_mutex(&sLock);
+    *out = sStats;
+    unlock_mutex(&sLock);
+}
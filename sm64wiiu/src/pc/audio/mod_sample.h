@@ -0,0 +1,49 @@
+#ifndef MOD_SAMPLE_H
+#define MOD_SAMPLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// One-shot mod sounds (audio_sample_* in Lua). Each AIFF/WAV file is loaded
+// through fs_async and decoded once, on the game thread when the load
+// completes, into mono s16 kept in an LRU cache of MOD_SAMPLE_CACHE_BUDGET
+// bytes. Plays go to a fixed pool of voices; when every voice is busy the
+// oldest one is stolen. A play that misses the cache waits for its load
+// instead of reading the file on the frame that triggered it.
+
+#define MOD_SAMPLE_MAX 256
+#define MOD_SAMPLE_VOICES 16
+#define MOD_SAMPLE_CACHE_BUDGET (4 * 1024 * 1024)
+
+typedef struct {
+    uint32_t samples;      // distinct files registered
+    uint32_t resident;     // decoded and cached right now
+    uint32_t bytes;        // PCM bytes cached
+    uint64_t hits;         // plays whose sample was already decoded
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t steals;       // plays that took over a busy voice
+    uint64_t expired;      // plays dropped because their load took too long
+} mod_sample_stats_t;
+
+void mod_sample_init(void);
+void mod_sample_shutdown(void);
+
+// returns a sample id for `vpath` (the same id for the same path), or -1;
+// starts loading it in the background while the cache has room
+int32_t mod_sample_load(const char *vpath);
+// `pan` is -1 (left) to 1 (right); `pitch` multiplies the playback rate
+void mod_sample_play(int32_t sample, float volume, float pan, float pitch);
+// stops every voice playing `sample`
+void mod_sample_stop(int32_t sample);
+void mod_sample_stop_all(void);
+// gain shared by every sample (the sfx volume setting)
+void mod_sample_set_sfx_volume(float volume);
+
+// adds the active voices into `frames` interleaved stereo frames at
+// AUDIO_OUTPUT_RATE; called by whichever thread produces audio
+void mod_sample_mix(int16_t *buffer, uint32_t frames);
+
+void mod_sample_get_stats(mod_sample_stats_t *out);
+
+#endif
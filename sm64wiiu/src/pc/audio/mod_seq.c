@@ -0,0 +1,585 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sm64.h"
+#include "audio/external.h"
+#include "audio/heap.h"
+#include "audio/internal.h"
+#include "audio/load.h"
+#include "pc/thread.h"
+#include "pc/utils/misc.h"
+
+#include "mod_seq.h"
+
+#define ALIGN16(val) (((val) + 0xF) & ~0xF)
+#define BANK_HEADER_SIZE 0x10 // numInstruments, numDrums, shared, date
+#define BANK_SET_MAX 0x0F     // banks per sequence kept from a vanilla set
+#define BANK_SETS_SIZE (MOD_SEQ_MAX_SEQUENCES * sizeof(u16) + MOD_SEQ_MAX_SEQUENCES * (1 + BANK_SET_MAX))
+
+struct ModSequence {
+    // game side: what the next mod_seq_update() installs
+    bool changed;
+    u8 *pending;
+    s32 pending_len;
+    s16 pending_bank;
+    u8 pending_fallback;
+
+    // engine side
+    u8 *data; // NULL when the id is vanilla or unused
+    s32 len;
+    s16 bank; // -1: the fallback sequence's banks
+    u8 fallback;
+};
+
+struct ModBank {
+    char *key;       // NULL when the slot is free
+    bool registered;
+    u8 sample_bank;
+    u8 *file;        // the ctl entry as registered, until parsed
+    s32 file_len;
+    struct AudioBank *bank; // parsed and patched
+    u32 num_instruments;
+    u32 num_drums;
+    s32 refs;        // audio pool entries holding the bank's instrument table
+};
+
+// Everything below is guarded by sLock except the engine-side timing state,
+// which only the engine touches. sVolumes is written by the game thread and
+// read by it.
+static struct ModSequence sSequences[MOD_SEQ_MAX_SEQUENCES];
+static struct ModBank sBanks[MOD_SEQ_MAX_BANKS];
+static u8 sVolumes[MOD_SEQ_MAX_SEQUENCES];
+static struct ThreadMutex sLock;
+static bool sInitialized = false;
+static bool sDirty = false;
+static mod_seq_stats_t sStats;
+
+// the engine's tables as audio_init() loaded them, and the larger copies
+// installed in their place on the first update
+static u32 sVanillaSeqCount;
+static u32 sVanillaBankCount;
+static ALSeqFile *sVanillaSeqHeader;
+static u8 *sVanillaBankSets;
+static ALSeqFile *sSeqHeader;
+static u8 *sBankSets;
+static struct CtlEntry *sCtlEntries;
+
+// level sequence player timing; engine side only
+static bool sWaitingForNote = false;
+static bool sWaitingMod = false;
+static f64 sLoadStart;
+
+/* bank files */
+
+static bool bank_range_ok(u32 len, uintptr_t offset, size_t size, size_t align) {
+    return offset != 0 && offset % align == 0 && offset <= len && size <= len - offset;
+}
+
+static bool bank_sound_ok(const u8 *body, u32 len, const struct AudioBankSound *sound, u32 tbl_len) {
+    uintptr_t offset = (uintptr_t) sound->sample;
+    if (offset == 0) {
+        return true;
+    }
+    if (!bank_range_ok(len, offset, sizeof(struct AudioBankSample), sizeof(void *))) {
+        return false;
+    }
+    const struct AudioBankSample *sample = (const struct AudioBankSample *) (body + offset);
+    uintptr_t data = (uintptr_t) sample->sampleAddr;
+    if (sample->loaded != 0 || data > tbl_len || sample->sampleSize > tbl_len - data) {
+        return false;
+    }
+
+    uintptr_t loop = (uintptr_t) sample->loop;
+    if (!bank_range_ok(len, loop, offsetof(struct AdpcmLoop, state), 4)) {
+        return false;
+    }
+    if (((const struct AdpcmLoop *) (body + loop))->count != 0 && !bank_range_ok(len, loop, sizeof(struct AdpcmLoop), 4)) {
+        return false;
+    }
+
+    uintptr_t book = (uintptr_t) sample->book;
+    if (!bank_range_ok(len, book, offsetof(struct AdpcmBook, book), 4)) {
+        return false;
+    }
+    const struct AdpcmBook *header = (const struct AdpcmBook *) (body + book);
+    // the mixers decode order 2 books only
+    if (header->order != 2 || header->npredictors < 1 || header->npredictors > 16) {
+        return false;
+    }
+    return bank_range_ok(len, book, offsetof(struct AdpcmBook, book) + 8 * 2 * header->npredictors * sizeof(s16), 4);
+}
+
+// Walks every offset patch_audio_bank() will follow, so a bad file is turned
+// away at registration rather than crashing the audio thread later.
+static bool bank_file_ok(const u8 *file, s32 file_len, u32 tbl_len) {
+    if (file_len <= BANK_HEADER_SIZE) {
+        return false;
+    }
+    const u32 *header = (const u32 *) file;
+    u32 num_instruments = header[0];
+    u32 num_drums = header[1];
+    const u8 *body = file + BANK_HEADER_SIZE;
+    u32 len = (u32) file_len - BANK_HEADER_SIZE;
+
+    if (num_instruments > 0xFF || num_drums > 0xFF ||
+        len < offsetof(struct AudioBank, instruments) + num_instruments * sizeof(struct Instrument *)) {
+        return false;
+    }
+    const struct AudioBank *bank = (const struct AudioBank *) body;
+
+    for (u32 i = 0; i < num_instruments; i++) {
+        uintptr_t offset = (uintptr_t) bank->instruments[i];
+        if (offset == 0) {
+            continue;
+        }
+        if (!bank_range_ok(len, offset, sizeof(struct Instrument), sizeof(void *))) {
+            return false;
+        }
+        const struct Instrument *inst = (const struct Instrument *) (body + offset);
+        if (inst->loaded != 0 || !bank_range_ok(len, (uintptr_t) inst->envelope, sizeof(struct AdsrEnvelope), 2) ||
+            !bank_sound_ok(body, len, &inst->lowNotesSound, tbl_len) ||
+            !bank_sound_ok(body, len, &inst->normalNotesSound, tbl_len) ||
+            !bank_sound_ok(body, len, &inst->highNotesSound, tbl_len)) {
+            return false;
+        }
+    }
+
+    uintptr_t drums = (uintptr_t) bank->drums;
+    if (drums == 0 || num_drums == 0) {
+        return true;
+    }
+    if (!bank_range_ok(len, drums, num_drums * sizeof(struct Drum *), sizeof(void *))) {
+        return false;
+    }
+    for (u32 i = 0; i < num_drums; i++) {
+        uintptr_t offset = (uintptr_t) ((struct Drum *const *) (body + drums))[i];
+        if (offset == 0) {
+            continue;
+        }
+        if (!bank_range_ok(len, offset, sizeof(struct Drum), sizeof(void *))) {
+            return false;
+        }
+        const struct Drum *drum = (const struct Drum *) (body + offset);
+        if (drum->loaded != 0 || !bank_range_ok(len, (uintptr_t) drum->envelope, sizeof(struct AdsrEnvelope), 2) ||
+            !bank_sound_ok(body, len, &drum->sound, tbl_len)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool bank_parse(struct ModBank *b) {
+    const u32 *header = (const u32 *) b->file;
+    u32 len = (u32) b->file_len - BANK_HEADER_SIZE;
+    struct AudioBank *bank = malloc(len);
+    if (bank == NULL) {
+        return false;
+    }
+    memcpy(bank, b->file + BANK_HEADER_SIZE, len);
+    b->num_instruments = header[0];
+    b->num_drums = header[1];
+#ifndef VERSION_SH
+    patch_audio_bank(bank, gAlTbl->seqArray[b->sample_bank].offset, b->num_instruments, b->num_drums);
+#endif
+    free(b->file);
+    b->file = NULL;
+    b->bank = bank;
+    sStats.banks_parsed++;
+    return true;
+}
+
+static void bank_free(struct ModBank *b) {
+    free(b->key);
+    free(b->file);
+    free(b->bank);
+    memset(b, 0, sizeof(*b));
+}
+
+/* engine tables */
+
+// Swaps in tables with room for every sequence and bank id the load status
+// arrays can track. They are never swapped back: a note or sequence player
+// may still refer to a mod id after its mod is gone.
+static bool extend_tables(void) {
+    if (sSeqHeader != NULL) {
+        return true;
+    }
+    if (gSeqFileHeader == NULL || gAlCtlHeader == NULL || gAlBankSets == NULL) {
+        return false;
+    }
+
+    sSeqHeader = calloc(1, sizeof(ALSeqFile) + (MOD_SEQ_MAX_SEQUENCES - 1) * sizeof(ALSeqData));
+    sBankSets = calloc(1, BANK_SETS_SIZE);
+    sCtlEntries = calloc(MOD_SEQ_MAX_BANKS, sizeof(struct CtlEntry));
+    if (sSeqHeader == NULL || sBankSets == NULL || sCtlEntries == NULL) {
+        free(sSeqHeader);
+        free(sBankSets);
+        free(sCtlEntries);
+        sSeqHeader = NULL;
+        return false;
+    }
+
+    sVanillaSeqHeader = gSeqFileHeader;
+    sVanillaBankSets = gAlBankSets;
+    memcpy(sSeqHeader, gSeqFileHeader, offsetof(ALSeqFile, seqArray) + sVanillaSeqCount * sizeof(ALSeqData));
+    memcpy(sCtlEntries, gCtlEntries, sVanillaBankCount * sizeof(struct CtlEntry));
+    gCtlEntries = sCtlEntries;
+    return true;
+}
+
+// Stops players on `seqId` and forgets any copy the sequence pools hold, so
+// the next load reads the new data.
+static void drop_loaded_sequence(s32 seqId) {
+    struct SoundMultiPool *pool = &gSeqLoadedPool;
+
+    discard_sequence(seqId);
+    for (u32 i = 0; i < pool->persistent.numEntries; i++) {
+        if (pool->persistent.entries[i].id == seqId) {
+            pool->persistent.entries[i].id = -1;
+        }
+    }
+    for (u32 i = 0; i < 2; i++) {
+        if (pool->temporary.entries[i].id == seqId) {
+            pool->temporary.entries[i].id = -1;
+        }
+    }
+    gSeqLoadStatus[seqId] = SOUND_LOAD_STATUS_NOT_LOADED;
+}
+
+static void build_bank_sets(u32 count) {
+    u16 *offsets = (u16 *) sBankSets;
+    u32 pos = MOD_SEQ_MAX_SEQUENCES * sizeof(u16);
+
+    for (u32 i = 0; i < count; i++) {
+        struct ModSequence *seq = &sSequences[i];
+        offsets[i] = (u16) pos;
+        if (seq->data != NULL && seq->bank >= 0) {
+            sBankSets[pos++] = 1;
+            sBankSets[pos++] = (u8) seq->bank;
+            continue;
+        }
+        u32 source = seq->data != NULL ? seq->fallback : i;
+        if (source >= sVanillaSeqCount) {
+            sBankSets[pos++] = 0;
+            continue;
+        }
+        const u8 *set = sVanillaBankSets + ((u16 *) sVanillaBankSets)[source];
+        u32 banks = set[0] < BANK_SET_MAX ? set[0] : BANK_SET_MAX;
+        sBankSets[pos++] = (u8) banks;
+        memcpy(sBankSets + pos, set + 1, banks);
+        pos += banks;
+    }
+}
+
+/* game side */
+
+void mod_seq_init(void) {
+    if (sInitialized) {
+        return;
+    }
+    init_mutex(&sLock);
+    sVanillaSeqCount = gSeqFileHeader != NULL ? gSequenceCount : 0;
+    sVanillaBankCount = gAlCtlHeader != NULL ? (u32) gAlCtlHeader->seqCount : 0;
+    if (sVanillaBankCount > MOD_SEQ_MAX_BANKS) {
+        sVanillaBankCount = MOD_SEQ_MAX_BANKS;
+    }
+    sInitialized = true;
+}
+
+void mod_seq_shutdown(void) {
+    if (!sInitialized) {
+        return;
+    }
+    if (sStats.level_loads > 0) {
+        u32 vanilla = sStats.level_loads - sStats.mod_level_loads;
+        printf("audio: level music first note avg %.2fms (max %.2fms) over %u loads",
+               sStats.first_note_time * 1000.0 / sStats.level_loads, sStats.first_note_max * 1000.0,
+               (unsigned) sStats.level_loads);
+        if (sStats.mod_level_loads > 0) {
+            printf(", mod sequences avg %.2fms, vanilla avg %.2fms",
+                   sStats.mod_first_note_time * 1000.0 / sStats.mod_level_loads,
+                   vanilla > 0 ? (sStats.first_note_time - sStats.mod_first_note_time) * 1000.0 / vanilla : 0.0);
+        }
+        printf("\n");
+    }
+    if (sStats.banks_parsed > 0) {
+        printf("audio: mod banks parsed %u times, reused %u times\n",
+               (unsigned) sStats.banks_parsed, (unsigned) sStats.bank_hits);
+    }
+    destroy_mutex(&sLock);
+    sInitialized = false;
+}
+
+static bool bank_id_valid(s32 bank) {
+    if (bank >= 0 && (u32) bank < sVanillaBankCount) {
+        return true;
+    }
+    return bank >= 0 && bank < MOD_SEQ_MAX_BANKS && sBanks[bank].key != NULL && sBanks[bank].registered;
+}
+
+bool mod_seq_set_sequence(int32_t seq_id, uint8_t *data, int32_t len, int32_t bank, int32_t fallback, int32_t volume) {
+#ifdef VERSION_SH
+    return false;
+#endif
+    if (!sInitialized || seq_id < 0 || seq_id >= MOD_SEQ_MAX_SEQUENCES || data == NULL || len <= 0 ||
+        fallback < 0 || (u32) fallback >= sVanillaSeqCount) {
+        return false;
+    }
+    // the sequence loaders copy the length rounded up past the next 16 bytes
+    u8 *padded = realloc(data, len + 0x20);
+    if (padded == NULL) {
+        return false;
+    }
+    data = padded;
+    memset(data + len, 0, 0x20);
+
+    lock_mutex(&sLock);
+    struct ModSequence *seq = &sSequences[seq_id];
+    free(seq->pending);
+    seq->pending = data;
+    seq->pending_len = len;
+    seq->pending_bank = (s16) (bank_id_valid(bank) ? bank : -1);
+    seq->pending_fallback = (u8) fallback;
+    seq->changed = true;
+    sVolumes[seq_id] = (u8) (volume < 0 ? 0 : (volume > 127 ? 127 : volume));
+    __atomic_store_n(&sDirty, true, __ATOMIC_RELEASE);
+    unlock_mutex(&sLock);
+    return true;
+}
+
+int32_t mod_seq_load_bank(const char *key, uint8_t *data, int32_t len, int32_t sample_bank) {
+#ifdef VERSION_SH
+    return -1;
+#endif
+    if (!sInitialized || key == NULL || data == NULL || sample_bank < 0 || (u32) sample_bank >= sVanillaBankCount) {
+        return -1;
+    }
+
+    lock_mutex(&sLock);
+    s32 id = -1;
+    for (u32 i = sVanillaBankCount; i < MOD_SEQ_MAX_BANKS; i++) {
+        struct ModBank *b = &sBanks[i];
+        if (b->key != NULL && b->sample_bank == sample_bank && !strcmp(b->key, key)) {
+            // already loaded, maybe still cached from before a reset
+            b->registered = true;
+            free(data);
+            unlock_mutex(&sLock);
+            return (int32_t) i;
+        }
+        if (b->key == NULL && id < 0) {
+            id = (s32) i;
+        }
+    }
+
+    if (id < 0 || !bank_file_ok(data, len, (u32) gAlTbl->seqArray[sample_bank].len)) {
+        unlock_mutex(&sLock);
+        return -1;
+    }
+    struct ModBank *b = &sBanks[id];
+    b->key = strdup(key);
+    if (b->key == NULL) {
+        unlock_mutex(&sLock);
+        return -1;
+    }
+    b->registered = true;
+    b->sample_bank = (u8) sample_bank;
+    b->file = data;
+    b->file_len = len;
+    unlock_mutex(&sLock);
+    return id;
+}
+
+void mod_seq_reset(void) {
+    if (!sInitialized) {
+        return;
+    }
+    lock_mutex(&sLock);
+    for (u32 i = 0; i < MOD_SEQ_MAX_SEQUENCES; i++) {
+        struct ModSequence *seq = &sSequences[i];
+        free(seq->pending);
+        seq->pending = NULL;
+        seq->pending_len = 0;
+        seq->changed = seq->data != NULL;
+    }
+    for (u32 i = 0; i < MOD_SEQ_MAX_BANKS; i++) {
+        sBanks[i].registered = false;
+    }
+    memset(sVolumes, 0, sizeof(sVolumes));
+    __atomic_store_n(&sDirty, true, __ATOMIC_RELEASE);
+    unlock_mutex(&sLock);
+}
+
+int32_t mod_seq_default_volume(uint8_t seq_id) {
+    if (sVolumes[seq_id] != 0) {
+        return sVolumes[seq_id];
+    }
+    return seq_id < sVanillaSeqCount ? -1 : 127;
+}
+
+/* engine side */
+
+void mod_seq_update(void) {
+    if (!sInitialized || !__atomic_load_n(&sDirty, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    lock_mutex(&sLock);
+    if (!extend_tables()) {
+        unlock_mutex(&sLock);
+        return;
+    }
+    sDirty = false;
+
+    u32 count = sVanillaSeqCount;
+    for (u32 i = 0; i < MOD_SEQ_MAX_SEQUENCES; i++) {
+        struct ModSequence *seq = &sSequences[i];
+        if (seq->changed) {
+            drop_loaded_sequence((s32) i);
+            free(seq->data);
+            seq->data = seq->pending;
+            seq->len = seq->pending_len;
+            seq->bank = seq->pending_bank;
+            seq->fallback = seq->pending_fallback;
+            seq->pending = NULL;
+            seq->changed = false;
+        }
+        if (seq->data != NULL) {
+            sSeqHeader->seqArray[i].offset = seq->data;
+            sSeqHeader->seqArray[i].len = seq->len;
+            if (i + 1 > count) {
+                count = i + 1;
+            }
+        } else if (i < sVanillaSeqCount) {
+            sSeqHeader->seqArray[i] = sVanillaSeqHeader->seqArray[i];
+        } else {
+            // load_sequence_internal() skips ids with no data
+            sSeqHeader->seqArray[i].offset = NULL;
+            sSeqHeader->seqArray[i].len = 0;
+        }
+    }
+    sSeqHeader->seqCount = (s16) count;
+    build_bank_sets(count);
+    gSeqFileHeader = sSeqHeader;
+    gAlBankSets = sBankSets;
+    gSequenceCount = (u16) count;
+
+    for (u32 i = sVanillaBankCount; i < MOD_SEQ_MAX_BANKS; i++) {
+        struct ModBank *b = &sBanks[i];
+        if (b->key != NULL && !b->registered && b->refs == 0) {
+            bank_free(b);
+        }
+    }
+    unlock_mutex(&sLock);
+}
+
+bool mod_seq_owns_bank(int32_t bank_id) {
+    return sInitialized && (u32) bank_id >= sVanillaBankCount && bank_id < MOD_SEQ_MAX_BANKS;
+}
+
+struct AudioBank *mod_seq_bank_load(int32_t bank_id, int32_t arg) {
+    struct ModBank *b = &sBanks[bank_id];
+
+    lock_mutex(&sLock);
+    bool ready = extend_tables() && b->key != NULL && b->registered;
+    if (ready && b->bank == NULL) {
+        ready = bank_parse(b);
+    } else if (ready) {
+        sStats.bank_hits++;
+    }
+    unlock_mutex(&sLock);
+    if (!ready) {
+        return NULL;
+    }
+
+    // The slot cannot be freed from here on: only the engine frees banks.
+    // Allocating may evict another bank and call mod_seq_bank_discarded(),
+    // so sLock is not held across it.
+    u32 size = offsetof(struct AudioBank, instruments) + b->num_instruments * sizeof(struct Instrument *);
+    if (size < sizeof(struct AudioBank)) {
+        size = sizeof(struct AudioBank);
+    }
+    size = ALIGN16(size);
+    struct AudioBank *ret = alloc_bank_or_seq(&gBankLoadedPool, 1, size, arg, bank_id);
+    if (ret == NULL) {
+        return NULL;
+    }
+    memcpy(ret, b->bank, size);
+
+    lock_mutex(&sLock);
+    b->refs++;
+    unlock_mutex(&sLock);
+    gCtlEntries[bank_id].numInstruments = (u8) b->num_instruments;
+    gCtlEntries[bank_id].numDrums = (u8) b->num_drums;
+    gCtlEntries[bank_id].instruments = ret->instruments;
+    gCtlEntries[bank_id].drums = ret->drums;
+    gBankLoadStatus[bank_id] = SOUND_LOAD_STATUS_COMPLETE;
+    return ret;
+}
+
+static void bank_release(struct ModBank *b) {
+    if (b->refs > 0) {
+        b->refs--;
+    }
+    if (b->refs == 0 && b->key != NULL && !b->registered) {
+        bank_free(b);
+    }
+}
+
+void mod_seq_bank_discarded(int32_t bank_id) {
+    if (!mod_seq_owns_bank(bank_id)) {
+        return;
+    }
+    lock_mutex(&sLock);
+    bank_release(&sBanks[bank_id]);
+    unlock_mutex(&sLock);
+}
+
+// the audio pools are about to be rebuilt; no pool holds a mod bank after this
+void mod_seq_pools_reset(void) {
+    if (!sInitialized) {
+        return;
+    }
+    lock_mutex(&sLock);
+    for (u32 i = sVanillaBankCount; i < MOD_SEQ_MAX_BANKS; i++) {
+        struct ModBank *b = &sBanks[i];
+        b->refs = 0;
+        if (b->key != NULL && !b->registered) {
+            bank_free(b);
+        }
+    }
+    unlock_mutex(&sLock);
+}
+
+void mod_seq_sequence_load_started(int32_t player, int32_t seq_id) {
+    if (player != SEQ_PLAYER_LEVEL) {
+        return;
+    }
+    sWaitingForNote = true;
+    sWaitingMod = seq_id >= 0 && seq_id < MOD_SEQ_MAX_SEQUENCES && sSequences[seq_id].data != NULL;
+    sLoadStart = clock_elapsed_f64();
+}
+
+void mod_seq_note_started(int32_t player) {
+    if (player != SEQ_PLAYER_LEVEL || !sWaitingForNote) {
+        return;
+    }
+    f64 elapsed = clock_elapsed_f64() - sLoadStart;
+    sWaitingForNote = false;
+    sStats.level_loads++;
+    sStats.first_note_time += elapsed;
+    if (elapsed > sStats.first_note_max) {
+        sStats.first_note_max = elapsed;
+    }
+    if (sWaitingMod) {
+        sStats.mod_level_loads++;
+        sStats.mod_first_note_time += elapsed;
+    }
+}
+
+void mod_seq_get_stats(mod_seq_stats_t *out) {
+    lock_mutex(&sLock);
+    *out = sStats;
+    unlock_mutex(&sLock);
+}
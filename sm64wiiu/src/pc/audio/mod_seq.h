@@ -0,0 +1,62 @@
+#ifndef MOD_SEQ_H
+#define MOD_SEQ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Mod sequences (.m64) and instrument banks (.bin) registered into the audio
+// engine's tables at runtime. Registrations come from the game thread and are
+// applied at the top of the next audio frame by whichever thread runs the
+// engine, so the tables never change under a sequence load.
+//
+// A mod bank is one ctl entry as tools/assemble_sound.py --dump-individual-bins
+// writes it for this target (native endianness and pointer width); its
+// samples are read from a vanilla bank's tbl entry. A bank is parsed and
+// patched once, the first time a sequence loads it, and that copy is what the
+// engine plays from. The audio pools only take its instrument table, so a
+// session reset or a level change that evicts it costs a small copy next
+// time instead of a re-read and re-patch. The copy is freed once the bank is
+// unregistered and no pool refers to it.
+
+#define MOD_SEQ_MAX_SEQUENCES 0x100 // gSeqLoadStatus entries
+#define MOD_SEQ_MAX_BANKS 0x40      // gBankLoadStatus entries
+
+typedef struct {
+    uint32_t banks_parsed;      // parse and patch passes over mod bank files
+    uint32_t bank_hits;         // mod bank loads served from the patched copy
+    uint32_t level_loads;       // level sequence loads that reached a first note
+    uint32_t mod_level_loads;   // ... of which were mod sequences
+    double first_note_time;     // summed seconds from load to first note
+    double mod_first_note_time;
+    double first_note_max;
+} mod_seq_stats_t;
+
+void mod_seq_init(void);
+void mod_seq_shutdown(void);
+
+// Game thread. `data` is malloc'd and owned by mod_seq on success. The
+// sequence plays with `bank` when that is a vanilla or registered mod bank,
+// otherwise with the banks of vanilla sequence `fallback`. A `volume` of 0
+// keeps the vanilla default volume (127 for new ids).
+bool mod_seq_set_sequence(int32_t seq_id, uint8_t *data, int32_t len, int32_t bank, int32_t fallback, int32_t volume);
+// returns a bank id, or -1 when the file is malformed or every id is taken;
+// registering the same `key` again returns the same id. `data` is owned by
+// mod_seq on success
+int32_t mod_seq_load_bank(const char *key, uint8_t *data, int32_t len, int32_t sample_bank);
+// unregisters everything; vanilla sequences come back on the next audio frame
+void mod_seq_reset(void);
+// default volume for background music `seq_id`, or -1 when vanilla's applies
+int32_t mod_seq_default_volume(uint8_t seq_id);
+
+// Audio engine side, serialized with the rest of the engine.
+void mod_seq_update(void);
+bool mod_seq_owns_bank(int32_t bank_id);
+struct AudioBank *mod_seq_bank_load(int32_t bank_id, int32_t arg);
+void mod_seq_bank_discarded(int32_t bank_id);
+void mod_seq_pools_reset(void);
+void mod_seq_sequence_load_started(int32_t player, int32_t seq_id);
+void mod_seq_note_started(int32_t player);
+
+void mod_seq_get_stats(mod_seq_stats_t *out);
+
+#endif
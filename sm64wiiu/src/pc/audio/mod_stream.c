@@ -0,0 +1,532 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sm64.h"
+#include "pc/fs/fs.h"
+#include "pc/platform.h"
+#include "pc/thread.h"
+#include "pc/utils/misc.h"
+
+#include "audio_ring.h"
+#include "audio_thread.h"
+#include "mod_stream.h"
+#include "vorbis.h"
+
+#define MOD_STREAM_CHUNK 1024        // frames decoded per worker step
+#define MOD_STREAM_INPUT_FRAMES 256  // mixer-side window the resampler reads from
+#define MOD_STREAM_MAX_FREQUENCY 4.0f
+
+enum ModStreamState {
+    MOD_STREAM_FREE,
+    MOD_STREAM_LOADING, // opened; the worker has not loaded the file yet
+    MOD_STREAM_READY,
+    MOD_STREAM_FAILED,
+    MOD_STREAM_CLOSING, // the worker frees it
+};
+
+// Everything but the ring contents and the `worker`/`mixer` parts is guarded
+// by sLock. A restart bumps `request`; the worker seeks and acknowledges it,
+// stops writing, and waits until the mixer has dropped the old frames
+// (`flushed`) before it decodes from the new position.
+struct ModStream {
+    u8 state;
+    bool playing;
+    bool looping;
+    u32 request;
+    u32 ack;
+    u32 flushed;
+    u32 finished;       // `ack` at which the decoder ran out, or ~0
+    u64 loop_start;
+    u64 loop_end;
+    f32 volume;
+    f32 frequency;
+    char path[SYS_MAX_PATH];
+    mod_stream_stats_t stats;
+
+    struct AudioRing ring;
+
+    // worker
+    u8 *file;
+    vorbis_t *decoder;
+    u64 length;
+
+    // mixer
+    s16 input[MOD_STREAM_INPUT_FRAMES * 2];
+    u32 input_count;
+    f64 input_pos;
+    bool primed; // has played since the last flush, so an empty ring is an underrun
+};
+
+static struct ModStream sStreams[MOD_STREAM_MAX];
+static struct ThreadMutex sLock;
+static struct ThreadCond sWorkCond;
+static struct ThreadHandle sWorker;
+static bool sInitialized = false;
+static bool sThreaded = false;
+static bool sQuit = false;
+static u32 sWakeups = 0;
+static f32 sMusicVolume = 1.0f;
+
+// worker scratch: one chunk at the file's channel count, then as stereo
+static s16 sDecodeBuffer[MOD_STREAM_CHUNK * 8];
+static s16 sStereoBuffer[MOD_STREAM_CHUNK * 2];
+
+static void mod_stream_print_stats(const struct ModStream *s) {
+    const mod_stream_stats_t *st = &s->stats;
+    if (st->frames == 0 || st->rate == 0) {
+        return;
+    }
+    f64 seconds = (f64)st->frames / st->rate;
+    printf("mod_stream: '%s': decoded %.1fs in %.1fms (%.2f%% of a core), %u KB held, %u underruns\n",
+           s->path, seconds, st->decode_time * 1000.0, st->decode_time * 100.0 / seconds,
+           (unsigned)(st->memory / 1024), (unsigned)st->underruns);
+}
+
+// frees what the worker opened; called by the worker with sLock held, when
+// the mixer cannot be inside the stream
+static void mod_stream_release(struct ModStream *s) {
+    mod_stream_print_stats(s);
+    vorbis_close(s->decoder);
+    free(s->file);
+    audio_ring_free(&s->ring);
+    s->decoder = NULL;
+    s->file = NULL;
+    s->state = MOD_STREAM_FREE;
+}
+
+// loads and opens a stream without holding sLock
+static bool mod_stream_load(struct ModStream *s, const char *path) {
+    u64 size = 0;
+    s->file = fs_load_file_direct(path, &size);
+    if (s->file == NULL || size > UINT32_MAX) {
+        printf("mod_stream: could not load '%s'\n", path);
+        return false;
+    }
+    s->decoder = vorbis_open(s->file, (u32)size);
+    if (s->decoder == NULL) {
+        printf("mod_stream: '%s' is not an Ogg Vorbis stream the decoder supports\n", path);
+        return false;
+    }
+    if (!audio_ring_init(&s->ring, MOD_STREAM_RING_FRAMES)) {
+        return false;
+    }
+    s->length = vorbis_length(s->decoder);
+    s->stats.rate = vorbis_rate(s->decoder);
+    s->stats.memory = (u32)(size + vorbis_memory(s->decoder) + s->ring.capacity * 2 * sizeof(s16) + sizeof(*s));
+    return true;
+}
+
+// Decodes one chunk into the ring. Returns false once the stream has no
+// more frames to give.
+static bool mod_stream_decode(struct ModStream *s, u32 space, bool looping, u64 loop_start, u64 loop_end) {
+    u32 channels = vorbis_channels(s->decoder);
+    u64 end = s->length != 0 ? s->length : UINT64_MAX;
+    if (looping && loop_end > loop_start) {
+        end = loop_end;
+    }
+
+    // one retry after wrapping around to the loop start
+    for (u32 attempt = 0; attempt < 2; attempt++) {
+        u64 pos = vorbis_tell(s->decoder);
+        u32 want = space < MOD_STREAM_CHUNK ? space : MOD_STREAM_CHUNK;
+        if (pos < end && end - pos < want) {
+            want = (u32)(end - pos);
+        }
+
+        f64 start = clock_elapsed_f64();
+        s32 frames = pos < end ? vorbis_read(s->decoder, sDecodeBuffer, want) : 0;
+        f64 elapsed = clock_elapsed_f64() - start;
+
+        if (frames > 0) {
+            for (s32 i = 0; i < frames; i++) {
+                const s16 *src = sDecodeBuffer + i * channels;
+                sStereoBuffer[i * 2] = src[0];
+                sStereoBuffer[i * 2 + 1] = src[channels > 1 ? 1 : 0];
+            }
+            audio_ring_write(&s->ring, sStereoBuffer, (u32)frames);
+            lock_mutex(&sLock);
+            s->stats.frames += (u64)frames;
+            s->stats.decode_time += elapsed;
+            unlock_mutex(&sLock);
+            return true;
+        }
+        if (!looping) {
+            break;
+        }
+        vorbis_seek(s->decoder, loop_start < end ? loop_start : 0);
+    }
+    return false;
+}
+
+// One pass over the streams. Returns true if it did any work; false means
+// the worker can sleep until the mixer or the game wakes it.
+static bool mod_stream_service(void) {
+    bool worked = false;
+
+    for (s32 i = 0; i < MOD_STREAM_MAX; i++) {
+        struct ModStream *s = &sStreams[i];
+
+        lock_mutex(&sLock);
+        if (s->state == MOD_STREAM_CLOSING) {
+            mod_stream_release(s);
+            unlock_mutex(&sLock);
+            continue;
+        }
+        if (s->state == MOD_STREAM_LOADING) {
+            char path[SYS_MAX_PATH];
+            snprintf(path, sizeof(path), "%s", s->path);
+            unlock_mutex(&sLock);
+            bool ok = mod_stream_load(s, path);
+            lock_mutex(&sLock);
+            if (s->state == MOD_STREAM_CLOSING) {
+                mod_stream_release(s);
+            } else {
+                s->state = ok ? MOD_STREAM_READY : MOD_STREAM_FAILED;
+            }
+            unlock_mutex(&sLock);
+            worked = true;
+            continue;
+        }
+        if (s->state != MOD_STREAM_READY) {
+            unlock_mutex(&sLock);
+            continue;
+        }
+        if (s->request != s->ack) {
+            // nothing written from here on belongs to the old position
+            s->ack = s->request;
+            s->finished = ~0u;
+            vorbis_seek(s->decoder, 0);
+            worked = true;
+        }
+        bool waiting = s->flushed != s->ack || s->finished == s->ack;
+        bool looping = s->looping;
+        u64 loop_start = s->loop_start;
+        u64 loop_end = s->loop_end;
+        unlock_mutex(&sLock);
+
+        u32 space = s->ring.capacity - audio_ring_buffered(&s->ring);
+        if (waiting || space < MOD_STREAM_CHUNK) {
+            continue;
+        }
+        if (!mod_stream_decode(s, space, looping, loop_start, loop_end)) {
+            lock_mutex(&sLock);
+            s->finished = s->ack;
+            unlock_mutex(&sLock);
+        }
+        worked = true;
+    }
+    return worked;
+}
+
+static void *mod_stream_worker(UNUSED void *arg) {
+    while (true) {
+        lock_mutex(&sLock);
+        u32 seen = sWakeups;
+        unlock_mutex(&sLock);
+
+        if (mod_stream_service()) {
+            continue;
+        }
+
+        // sleep until a request or a mix that arrived after `seen`
+        lock_mutex(&sLock);
+        while (!sQuit && sWakeups == seen) {
+            wait_cond(&sWorkCond, &sLock);
+        }
+        bool quit = sQuit;
+        unlock_mutex(&sLock);
+        if (quit) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void mod_stream_wake(void) {
+    if (sThreaded) {
+        lock_mutex(&sLock);
+        sWakeups++;
+        broadcast_cond(&sWorkCond);
+        unlock_mutex(&sLock);
+    }
+}
+
+void mod_stream_init(void) {
+    if (sInitialized) {
+        return;
+    }
+    memset(sStreams, 0, sizeof(sStreams));
+    init_mutex(&sLock);
+    init_cond(&sWorkCond);
+    sQuit = false;
+    sInitialized = true;
+
+    // without threads mod_stream_mix() decodes before it mixes
+#ifdef HAVE_THREADS
+    sThreaded = init_thread_handle(&sWorker, mod_stream_worker, NULL, NULL, 0) == 0;
+    if (!sThreaded) {
+        printf("mod_stream: could not start the decode thread, decoding while mixing\n");
+    }
+#endif
+}
+
+void mod_stream_shutdown(void) {
+    if (!sInitialized) {
+        return;
+    }
+    mod_stream_close_all();
+    if (sThreaded) {
+        lock_mutex(&sLock);
+        sQuit = true;
+        broadcast_cond(&sWorkCond);
+        unlock_mutex(&sLock);
+        cleanup_thread_handle(&sWorker);
+        sThreaded = false;
+    }
+
+    // the worker is gone; release whatever it did not get to
+    lock_mutex(&sLock);
+    for (s32 i = 0; i < MOD_STREAM_MAX; i++) {
+        if (sStreams[i].state != MOD_STREAM_FREE) {
+            mod_stream_release(&sStreams[i]);
+        }
+    }
+    sInitialized = false;
+    unlock_mutex(&sLock);
+    destroy_cond(&sWorkCond);
+    destroy_mutex(&sLock);
+}
+
+int32_t mod_stream_open(const char *vpath) {
+    if (!sInitialized || vpath == NULL) {
+        return -1;
+    }
+    lock_mutex(&sLock);
+    for (s32 i = 0; i < MOD_STREAM_MAX; i++) {
+        struct ModStream *s = &sStreams[i];
+        if (s->state != MOD_STREAM_FREE) {
+            continue;
+        }
+        memset(s, 0, sizeof(*s));
+        snprintf(s->path, sizeof(s->path), "%s", vpath);
+        s->state = MOD_STREAM_LOADING;
+        s->finished = ~0u;
+        s->volume = 1.0f;
+        s->frequency = 1.0f;
+        unlock_mutex(&sLock);
+        mod_stream_wake();
+        return i;
+    }
+    unlock_mutex(&sLock);
+    printf("mod_stream: no free stream for '%s'\n", vpath);
+    return -1;
+}
+
+void mod_stream_close(int32_t stream) {
+    if (!sInitialized || stream < 0 || stream >= MOD_STREAM_MAX) {
+        return;
+    }
+    lock_mutex(&sLock);
+    if (sStreams[stream].state != MOD_STREAM_FREE) {
+        sStreams[stream].state = MOD_STREAM_CLOSING;
+    }
+    unlock_mutex(&sLock);
+    mod_stream_wake();
+}
+
+void mod_stream_close_all(void) {
+    for (s32 i = 0; i < MOD_STREAM_MAX; i++) {
+        mod_stream_close(i);
+    }
+}
+
+// looks up a stream for the game-side setters; returns with sLock held
+static struct ModStream *mod_stream_lock(int32_t stream) {
+    if (!sInitialized || stream < 0 || stream >= MOD_STREAM_MAX) {
+        return NULL;
+    }
+    lock_mutex(&sLock);
+    struct ModStream *s = &sStreams[stream];
+    if (s->state == MOD_STREAM_FREE || s->state == MOD_STREAM_CLOSING) {
+        unlock_mutex(&sLock);
+        return NULL;
+    }
+    return s;
+}
+
+void mod_stream_play(int32_t stream, bool restart) {
+    struct ModStream *s = mod_stream_lock(stream);
+    if (s == NULL) {
+        return;
+    }
+    // a finished stream starts over rather than staying silent
+    if (restart || s->finished == s->request) {
+        s->request++;
+    }
+    s->playing = true;
+    unlock_mutex(&sLock);
+    mod_stream_wake();
+}
+
+void mod_stream_stop(int32_t stream) {
+    struct ModStream *s = mod_stream_lock(stream);
+    if (s == NULL) {
+        return;
+    }
+    s->playing = false;
+    s->request++;
+    unlock_mutex(&sLock);
+    mod_stream_wake();
+}
+
+void mod_stream_set_looping(int32_t stream, bool looping) {
+    struct ModStream *s = mod_stream_lock(stream);
+    if (s == NULL) {
+        return;
+    }
+    s->looping = looping;
+    unlock_mutex(&sLock);
+    mod_stream_wake();
+}
+
+void mod_stream_set_loop_points(int32_t stream, uint64_t start, uint64_t end) {
+    struct ModStream *s = mod_stream_lock(stream);
+    if (s == NULL) {
+        return;
+    }
+    s->loop_start = start;
+    s->loop_end = end;
+    unlock_mutex(&sLock);
+}
+
+void mod_stream_set_volume(int32_t stream, float volume) {
+    struct ModStream *s = mod_stream_lock(stream);
+    if (s == NULL) {
+        return;
+    }
+    s->volume = volume < 0.0f ? 0.0f : volume;
+    unlock_mutex(&sLock);
+}
+
+void mod_stream_set_frequency(int32_t stream, float frequency) {
+    struct ModStream *s = mod_stream_lock(stream);
+    if (s == NULL) {
+        return;
+    }
+    if (frequency > MOD_STREAM_MAX_FREQUENCY) {
+        frequency = MOD_STREAM_MAX_FREQUENCY;
+    }
+    s->frequency = frequency > 0.0f ? frequency : 1.0f;
+    unlock_mutex(&sLock);
+}
+
+void mod_stream_set_music_volume(float volume) {
+    if (!sInitialized) {
+        return;
+    }
+    lock_mutex(&sLock);
+    sMusicVolume = volume;
+    unlock_mutex(&sLock);
+}
+
+// Linearly resamples a stream's ring into `buffer`, adding to what is there.
+// Returns false if the ring ran dry first.
+static bool mod_stream_resample(struct ModStream *s, s16 *buffer, u32 frames, f32 step, f32 gain) {
+    u32 done = 0;
+
+    while (done < frames) {
+        if (s->input_count < MOD_STREAM_INPUT_FRAMES) {
+            s->input_count += audio_ring_read(&s->ring, s->input + s->input_count * 2,
+                                              MOD_STREAM_INPUT_FRAMES - s->input_count);
+        }
+        u32 start = done;
+        f64 pos = s->input_pos;
+        for (; done < frames; done++) {
+            u32 i = (u32)pos;
+            if (i + 1 >= s->input_count) {
+                break;
+            }
+            f32 frac = (f32)(pos - i);
+            const s16 *a = s->input + i * 2;
+            for (u32 c = 0; c < 2; c++) {
+                f32 sample = ((f32)a[c] + (f32)(a[c + 2] - a[c]) * frac) * gain;
+                s32 mixed = buffer[done * 2 + c] + (s32)sample;
+                buffer[done * 2 + c] = (s16)(mixed > 32767 ? 32767 : mixed < -32768 ? -32768 : mixed);
+            }
+            pos += step;
+        }
+
+        // drop the frames the resampler has moved past
+        u32 used = (u32)pos < s->input_count ? (u32)pos : s->input_count;
+        memmove(s->input, s->input + used * 2, (s->input_count - used) * 2 * sizeof(s16));
+        s->input_count -= used;
+        s->input_pos = pos - used;
+
+        if (done == start && audio_ring_buffered(&s->ring) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void mod_stream_mix(int16_t *buffer, uint32_t frames) {
+    bool consumed = false;
+
+    if (!sInitialized) {
+        return;
+    }
+    if (!sThreaded) {
+        while (mod_stream_service()) {
+        }
+    }
+
+    lock_mutex(&sLock);
+    for (s32 i = 0; i < MOD_STREAM_MAX; i++) {
+        struct ModStream *s = &sStreams[i];
+        if (s->state != MOD_STREAM_READY) {
+            continue;
+        }
+        if (s->flushed != s->ack) {
+            // the worker moved on; drop what it wrote for the old position
+            u32 stale = audio_ring_buffered(&s->ring);
+            while (stale > 0) {
+                u32 n = stale < MOD_STREAM_INPUT_FRAMES ? stale : MOD_STREAM_INPUT_FRAMES;
+                audio_ring_read(&s->ring, s->input, n);
+                stale -= n;
+            }
+            s->input_count = 0;
+            s->input_pos = 0.0;
+            s->primed = false;
+            s->flushed = s->ack;
+            consumed = true;
+        }
+        if (!s->playing || s->request != s->ack) {
+            continue;
+        }
+        f32 step = (f32)s->stats.rate * s->frequency / AUDIO_OUTPUT_RATE;
+        if (mod_stream_resample(s, buffer, frames, step, s->volume * sMusicVolume)) {
+            s->primed = true;
+        } else if (s->finished == s->ack) {
+            s->playing = false;
+        } else if (s->primed) {
+            s->stats.underruns++;
+        }
+        consumed = true;
+    }
+    unlock_mutex(&sLock);
+
+    if (consumed) {
+        mod_stream_wake();
+    }
+}
+
+bool mod_stream_get_stats(int32_t stream, mod_stream_stats_t *out) {
+    struct ModStream *s = mod_stream_lock(stream);
+    if (s == NULL) {
+        return false;
+    }
+    *out = s->stats;
+    unlock_mutex(&sLock);
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef MOD_STREAM_H
+#define MOD_STREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Ogg Vorbis streams for mod audio (audio_stream_* in Lua). A worker thread
+// keeps a small ring of decoded frames per stream topped up; the mixer
+// resamples them to the output rate and adds them to the synthesized buffer
+// before master gain. Each stream holds its compressed file, one decoder and
+// MOD_STREAM_RING_FRAMES of PCM, never a whole decoded file.
+
+#define MOD_STREAM_MAX 8
+#define MOD_STREAM_RING_FRAMES 8192 // stereo frames at the file's rate
+
+typedef struct {
+    uint64_t frames;       // frames decoded
+    double decode_time;    // seconds the worker spent decoding them
+    uint32_t rate;
+    uint32_t memory;       // bytes held: file, decoder tables and buffers
+    uint32_t underruns;    // mixes that found the ring empty mid-playback
+} mod_stream_stats_t;
+
+void mod_stream_init(void);
+void mod_stream_shutdown(void);
+
+// returns a stream id, or -1 when every slot is taken; the file is loaded
+// and opened by the worker
+int32_t mod_stream_open(const char *vpath);
+void mod_stream_close(int32_t stream);
+void mod_stream_close_all(void);
+
+// `restart` rewinds to the first frame; stop pauses and rewinds
+void mod_stream_play(int32_t stream, bool restart);
+void mod_stream_stop(int32_t stream);
+void mod_stream_set_looping(int32_t stream, bool looping);
+// in frames at the file's rate; an end of 0 loops at the end of the file
+void mod_stream_set_loop_points(int32_t stream, uint64_t start, uint64_t end);
+void mod_stream_set_volume(int32_t stream, float volume);
+// playback speed and pitch multiplier
+void mod_stream_set_frequency(int32_t stream, float frequency);
+// gain shared by every stream (the music volume setting)
+void mod_stream_set_music_volume(float volume);
+
+// adds every playing stream into `frames` interleaved stereo frames at
+// AUDIO_OUTPUT_RATE; called by whichever thread produces audio
+void mod_stream_mix(int16_t *buffer, uint32_t frames);
+
+bool mod_stream_get_stats(int32_t stream, mod_stream_stats_t *out);
+
+#endif
@@ -0,0 +1,1566 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vorbis.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define VORBIS_MAX_CHANNELS 8
+#define VORBIS_MAX_BLOCKSIZE 8192
+#define VORBIS_FAST_BITS 9 // codewords this short resolve with one table lookup
+#define VORBIS_NO_CODE 0xffffffffu
+#define FLOOR1_MAX_VALUES 256
+
+// Ogg page and packet reader over the in-memory file. It is a plain struct so
+// seeking can snapshot and restore it.
+struct OggReader {
+    uint32_t page_offset;   // offset of the current page header
+    uint32_t page_next;     // offset of the next page header
+    uint32_t body_pos;      // offset of the next segment's data
+    const uint8_t *lacing;
+    uint8_t segments;
+    uint8_t segment;        // next segment to read on this page
+    uint8_t flags;
+    int64_t granule;
+};
+
+struct VorbisBits {
+    const uint8_t *data;
+    uint32_t size;          // in bytes
+    uint32_t pos;           // in bits
+    bool eop;               // a read ran past the end of the packet
+};
+
+struct VorbisCodebook {
+    uint32_t dimensions;
+    uint32_t entries;
+    uint32_t *fast;         // indexed by the next VORBIS_FAST_BITS bits: entry << 6 | length
+    uint32_t *long_codes;   // LSB-first codewords longer than VORBIS_FAST_BITS
+    uint32_t *long_entries; // entry << 6 | length, parallel to long_codes
+    uint32_t long_count;
+    float *values;          // entries * dimensions, NULL without a VQ lookup
+};
+
+struct VorbisFloor {
+    uint8_t partitions;
+    uint8_t partition_class[32];
+    uint8_t class_dimensions[16];
+    uint8_t class_subclasses[16];
+    uint8_t class_masterbook[16];
+    int16_t subclass_books[16][8];
+    uint8_t multiplier;
+    uint16_t values;
+    uint16_t x[FLOOR1_MAX_VALUES];
+    uint8_t sorted[FLOOR1_MAX_VALUES];
+    uint8_t low_neighbor[FLOOR1_MAX_VALUES];
+    uint8_t high_neighbor[FLOOR1_MAX_VALUES];
+};
+
+struct VorbisResidue {
+    uint16_t type;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t partition_size;
+    uint8_t classifications;
+    uint8_t classbook;
+    int16_t books[64][8];
+};
+
+struct VorbisMapping {
+    uint8_t submaps;
+    uint16_t coupling_steps;
+    uint8_t magnitude[256];
+    uint8_t angle[256];
+    uint8_t mux[VORBIS_MAX_CHANNELS];
+    uint8_t submap_floor[16];
+    uint8_t submap_residue[16];
+};
+
+struct VorbisMode {
+    uint8_t blockflag;
+    uint8_t mapping;
+};
+
+// per blocksize IMDCT tables
+struct VorbisTransform {
+    uint32_t n;
+    float *twiddle;         // n/4 complex pre/post rotations
+    float *fft_twiddle;     // n/8 complex FFT roots
+    uint16_t *bitrev;       // n/4 FFT input permutation
+    float *slope;           // n/2 window slope
+};
+
+struct vorbis_s {
+    const uint8_t *data;
+    uint32_t size;
+    uint32_t serial;
+    struct OggReader reader;
+    struct OggReader audio_start;
+    uint8_t *packet;
+    uint32_t packet_cap;
+
+    uint32_t channels;
+    uint32_t rate;
+    uint32_t blocksize[2];
+    uint64_t length;
+
+    uint32_t codebook_count;
+    struct VorbisCodebook *codebooks;
+    uint32_t floor_count;
+    struct VorbisFloor *floors;
+    uint32_t residue_count;
+    struct VorbisResidue *residues;
+    uint32_t mapping_count;
+    struct VorbisMapping *mappings;
+    uint32_t mode_count;
+    struct VorbisMode modes[64];
+    struct VorbisTransform transform[2];
+
+    // decode buffers
+    float *spectrum[VORBIS_MAX_CHANNELS];  // blocksize[1]/2
+    float *time[VORBIS_MAX_CHANNELS];      // blocksize[1]
+    float *overlap[VORBIS_MAX_CHANNELS];   // right half of the previous block
+    float *pcm[VORBIS_MAX_CHANNELS];       // finished samples of the last packet
+    int16_t *floor_y[VORBIS_MAX_CHANNELS];
+    float *interleaved;                    // residue type 2 scratch
+    float *fft;                            // blocksize[1]/4 complex scratch
+    uint8_t *classifications;
+    uint32_t classifications_stride;
+    uint32_t prev_n;                       // 0 until a block has been decoded
+
+    uint32_t pcm_pos;
+    uint32_t pcm_count;
+    uint64_t decode_pos;                   // stream frame of the next packet's first sample
+    uint64_t position;                     // stream frame of pcm[pcm_pos]
+    uint64_t seek_target;                  // frames before this are decoded and dropped
+    bool synced;                           // decode_pos is known
+    size_t memory;
+};
+
+static const float sFloor1InverseDb[256] = {
+    1.0649863e-07f, 1.1341951e-07f, 1.2079015e-07f, 1.2863978e-07f,
+    1.3699951e-07f, 1.4590251e-07f, 1.5538408e-07f, 1.6548181e-07f,
+    1.7623575e-07f, 1.8768855e-07f, 1.9988561e-07f, 2.1287530e-07f,
+    2.2670913e-07f, 2.4144197e-07f, 2.5713223e-07f, 2.7384213e-07f,
+    2.9163793e-07f, 3.1059021e-07f, 3.3077411e-07f, 3.5226968e-07f,
+    3.7516214e-07f, 3.9954229e-07f, 4.2550680e-07f, 4.5315863e-07f,
+    4.8260743e-07f, 5.1396998e-07f, 5.4737065e-07f, 5.8294187e-07f,
+    6.2082472e-07f, 6.6116941e-07f, 7.0413592e-07f, 7.4989464e-07f,
+    7.9862701e-07f, 8.5052630e-07f, 9.0579828e-07f, 9.6466216e-07f,
+    1.0273513e-06f, 1.0941144e-06f, 1.1652161e-06f, 1.2409384e-06f,
+    1.3215816e-06f, 1.4074654e-06f, 1.4989305e-06f, 1.5963394e-06f,
+    1.7000785e-06f, 1.8105592e-06f, 1.9282195e-06f, 2.0535261e-06f,
+    2.1869758e-06f, 2.3290978e-06f, 2.4804557e-06f, 2.6416497e-06f,
+    2.8133190e-06f, 2.9961443e-06f, 3.1908506e-06f, 3.3982101e-06f,
+    3.6190449e-06f, 3.8542308e-06f, 4.1047004e-06f, 4.3714470e-06f,
+    4.6555282e-06f, 4.9580707e-06f, 5.2802740e-06f, 5.6234160e-06f,
+    5.9888572e-06f, 6.3780469e-06f, 6.7925283e-06f, 7.2339451e-06f,
+    7.7040476e-06f, 8.2047000e-06f, 8.7378876e-06f, 9.3057248e-06f,
+    9.9104632e-06f, 1.0554501e-05f, 1.1240392e-05f, 1.1970856e-05f,
+    1.2748789e-05f, 1.3577278e-05f, 1.4459606e-05f, 1.5399272e-05f,
+    1.6400004e-05f, 1.7465768e-05f, 1.8600792e-05f, 1.9809576e-05f,
+    2.1096914e-05f, 2.2467911e-05f, 2.3928002e-05f, 2.5482978e-05f,
+    2.7139006e-05f, 2.8902651e-05f, 3.0780908e-05f, 3.2781225e-05f,
+    3.4911534e-05f, 3.7180282e-05f, 3.9596466e-05f, 4.2169667e-05f,
+    4.4910090e-05f, 4.7828601e-05f, 5.0936773e-05f, 5.4246931e-05f,
+    5.7772202e-05f, 6.1526565e-05f, 6.5524908e-05f, 6.9783085e-05f,
+    7.4317983e-05f, 7.9147585e-05f, 8.4291040e-05f, 8.9768747e-05f,
+    9.5602426e-05f, 0.00010181521f, 0.00010843174f, 0.00011547824f,
+    0.00012298267f, 0.00013097477f, 0.00013948625f, 0.00014855085f,
+    0.00015820453f, 0.00016848555f, 0.00017943469f, 0.00019109536f,
+    0.00020351382f, 0.00021673929f, 0.00023082423f, 0.00024582449f,
+    0.00026179955f, 0.00027881276f, 0.00029693158f, 0.00031622787f,
+    0.00033677814f, 0.00035866388f, 0.00038197188f, 0.00040679456f,
+    0.00043323036f, 0.00046138411f, 0.00049136745f, 0.00052329927f,
+    0.00055730621f, 0.00059352311f, 0.00063209358f, 0.00067317058f,
+    0.00071691700f, 0.00076350630f, 0.00081312324f, 0.00086596457f,
+    0.00092223983f, 0.00098217216f, 0.0010459992f, 0.0011139742f,
+    0.0011863665f, 0.0012634633f, 0.0013455702f, 0.0014330129f,
+    0.0015261382f, 0.0016253153f, 0.0017309374f, 0.0018434235f,
+    0.0019632195f, 0.0020908006f, 0.0022266726f, 0.0023713743f,
+    0.0025254795f, 0.0026895994f, 0.0028643847f, 0.0030505286f,
+    0.0032487691f, 0.0034598925f, 0.0036847358f, 0.0039241906f,
+    0.0041792066f, 0.0044507950f, 0.0047400328f, 0.0050480668f,
+    0.0053761186f, 0.0057254891f, 0.0060975636f, 0.0064938176f,
+    0.0069158225f, 0.0073652516f, 0.0078438871f, 0.0083536271f,
+    0.0088964928f, 0.009474637f, 0.010090352f, 0.010746080f,
+    0.011444421f, 0.012188144f, 0.012980198f, 0.013823725f,
+    0.014722068f, 0.015678791f, 0.016697687f, 0.017782797f,
+    0.018938423f, 0.020169149f, 0.021479854f, 0.022875735f,
+    0.024362330f, 0.025945531f, 0.027631618f, 0.029427276f,
+    0.031339626f, 0.033376252f, 0.035545228f, 0.037855157f,
+    0.040315199f, 0.042935108f, 0.045725273f, 0.048696758f,
+    0.051861348f, 0.055231591f, 0.058820850f, 0.062643361f,
+    0.066714279f, 0.071049749f, 0.075666962f, 0.080584227f,
+    0.085821044f, 0.091398179f, 0.097337747f, 0.10366330f,
+    0.11039993f, 0.11757434f, 0.12521498f, 0.13335215f,
+    0.14201813f, 0.15124727f, 0.16107617f, 0.17154380f,
+    0.18269168f, 0.19456402f, 0.20720788f, 0.22067342f,
+    0.23501402f, 0.25028656f, 0.26655159f, 0.28387361f,
+    0.30232132f, 0.32196786f, 0.34289114f, 0.36517414f,
+    0.38890521f, 0.41417847f, 0.44109412f, 0.46975890f,
+    0.50028648f, 0.53279791f, 0.56742212f, 0.60429640f,
+    0.64356699f, 0.68538959f, 0.72993007f, 0.77736504f,
+    0.82788260f, 0.88168307f, 0.9389798f, 1.0f,
+};
+
+/* bit reader */
+
+static uint32_t bits_peek(const struct VorbisBits *b) {
+    uint32_t byte = b->pos >> 3;
+    uint64_t acc = 0;
+    if (byte + 5 <= b->size) {
+        const uint8_t *p = b->data + byte;
+        acc = (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) | ((uint64_t)p[4] << 32);
+    } else {
+        for (uint32_t i = 0; byte + i < b->size; i++) {
+            acc |= (uint64_t)b->data[byte + i] << (8 * i);
+        }
+    }
+    return (uint32_t)(acc >> (b->pos & 7));
+}
+
+static uint32_t bits_read(struct VorbisBits *b, const uint32_t count) {
+    if (count == 0) {
+        return 0;
+    }
+    if (b->pos + count > b->size * 8) {
+        b->pos = b->size * 8;
+        b->eop = true;
+        return 0;
+    }
+    uint32_t value = bits_peek(b);
+    b->pos += count;
+    return count == 32 ? value : value & ((1u << count) - 1);
+}
+
+static uint32_t ilog(uint32_t x) {
+    uint32_t bits = 0;
+    while (x > 0) {
+        bits++;
+        x >>= 1;
+    }
+    return bits;
+}
+
+static float float32_unpack(const uint32_t x) {
+    double mantissa = (double)(x & 0x1fffff);
+    int32_t exponent = (int32_t)((x & 0x7fe00000) >> 21);
+    if (x & 0x80000000) {
+        mantissa = -mantissa;
+    }
+    return (float)ldexp(mantissa, exponent - 788);
+}
+
+static uint32_t bit_reverse(uint32_t x) {
+    x = ((x & 0xaaaaaaaa) >> 1) | ((x & 0x55555555) << 1);
+    x = ((x & 0xcccccccc) >> 2) | ((x & 0x33333333) << 2);
+    x = ((x & 0xf0f0f0f0) >> 4) | ((x & 0x0f0f0f0f) << 4);
+    x = ((x & 0xff00ff00) >> 8) | ((x & 0x00ff00ff) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+static void *vorbis_alloc(vorbis_t *v, const size_t size) {
+    void *ptr = calloc(1, size);
+    if (ptr != NULL) {
+        v->memory += size;
+    }
+    return ptr;
+}
+
+/* codebooks */
+
+static int32_t codebook_decode(const struct VorbisCodebook *c, struct VorbisBits *b) {
+    uint32_t bits = bits_peek(b);
+    uint32_t slot = c->fast[bits & ((1u << VORBIS_FAST_BITS) - 1)];
+    if (slot == VORBIS_NO_CODE) {
+        slot = VORBIS_NO_CODE;
+        for (uint32_t i = 0; i < c->long_count; i++) {
+            uint32_t len = c->long_entries[i] & 63;
+            uint32_t mask = len == 32 ? 0xffffffffu : (1u << len) - 1;
+            if ((bits & mask) == c->long_codes[i]) {
+                slot = c->long_entries[i];
+                break;
+            }
+        }
+        if (slot == VORBIS_NO_CODE) {
+            b->eop = true;
+            return -1;
+        }
+    }
+    uint32_t len = slot & 63;
+    if (b->pos + len > b->size * 8) {
+        b->pos = b->size * 8;
+        b->eop = true;
+        return -1;
+    }
+    b->pos += len;
+    return (int32_t)(slot >> 6);
+}
+
+static uint32_t lookup1_values(const uint32_t entries, const uint32_t dims) {
+    uint32_t r = (uint32_t)floor(exp(log((double)entries) / dims));
+    while (pow(r + 1, dims) <= entries) {
+        r++;
+    }
+    while (r > 0 && pow(r, dims) > entries) {
+        r--;
+    }
+    return r;
+}
+
+// Assigns the canonical codewords in entry order, the way the spec builds
+// its tree: each entry takes the lowest free node at its depth.
+static bool codebook_build(vorbis_t *v, struct VorbisCodebook *c, const uint8_t *lengths) {
+    uint32_t available[33] = { 0 };
+    uint32_t *codes = calloc(c->entries, sizeof(uint32_t));
+    uint32_t first = 0;
+    bool ok = true;
+
+    if (codes == NULL) {
+        return false;
+    }
+    while (first < c->entries && lengths[first] == 0) {
+        first++;
+    }
+    if (first < c->entries) {
+        for (uint32_t i = 1; i <= lengths[first]; i++) {
+            available[i] = 1u << (32 - i);
+        }
+        for (uint32_t i = first + 1; i < c->entries && ok; i++) {
+            uint32_t z = lengths[i];
+            if (z == 0) {
+                continue;
+            }
+            while (z > 0 && available[z] == 0) {
+                z--;
+            }
+            if (z == 0) {
+                ok = false; // overspecified tree
+                break;
+            }
+            uint32_t res = available[z];
+            available[z] = 0;
+            codes[i] = bit_reverse(res);
+            for (uint32_t y = lengths[i]; y > z; y--) {
+                available[y] = res + (1u << (32 - y));
+            }
+        }
+    }
+
+    c->fast = vorbis_alloc(v, sizeof(uint32_t) << VORBIS_FAST_BITS);
+    if (!ok || c->fast == NULL) {
+        free(codes);
+        return false;
+    }
+    memset(c->fast, 0xff, sizeof(uint32_t) << VORBIS_FAST_BITS);
+    for (uint32_t i = 0; i < c->entries; i++) {
+        if (lengths[i] > VORBIS_FAST_BITS) {
+            c->long_count++;
+        }
+    }
+    if (c->long_count > 0) {
+        c->long_codes = vorbis_alloc(v, c->long_count * sizeof(uint32_t));
+        c->long_entries = vorbis_alloc(v, c->long_count * sizeof(uint32_t));
+        if (c->long_codes == NULL || c->long_entries == NULL) {
+            free(codes);
+            return false;
+        }
+    }
+    for (uint32_t i = 0, n = 0; i < c->entries; i++) {
+        uint32_t len = lengths[i];
+        if (len == 0) {
+            continue;
+        }
+        if (len <= VORBIS_FAST_BITS) {
+            for (uint32_t fill = codes[i]; fill < (1u << VORBIS_FAST_BITS); fill += 1u << len) {
+                c->fast[fill] = (i << 6) | len;
+            }
+        } else {
+            c->long_codes[n] = codes[i];
+            c->long_entries[n++] = (i << 6) | len;
+        }
+    }
+    free(codes);
+    return true;
+}
+
+static bool parse_codebook(vorbis_t *v, struct VorbisBits *b, struct VorbisCodebook *c) {
+    if (bits_read(b, 24) != 0x564342) {
+        return false;
+    }
+    c->dimensions = bits_read(b, 16);
+    c->entries = bits_read(b, 24);
+    if (b->eop || c->entries == 0 || c->entries >= (1u << 24)) {
+        return false;
+    }
+
+    uint8_t *lengths = calloc(c->entries, 1);
+    if (lengths == NULL) {
+        return false;
+    }
+    if (!bits_read(b, 1)) {
+        bool sparse = bits_read(b, 1);
+        for (uint32_t i = 0; i < c->entries; i++) {
+            if (!sparse || bits_read(b, 1)) {
+                lengths[i] = (uint8_t)(bits_read(b, 5) + 1);
+            }
+        }
+    } else {
+        // ordered: runs of entries with increasing lengths
+        uint32_t length = bits_read(b, 5) + 1;
+        uint32_t entry = 0;
+        while (entry < c->entries && !b->eop) {
+            uint32_t count = bits_read(b, ilog(c->entries - entry));
+            if (length > 32 || entry + count > c->entries) {
+                free(lengths);
+                return false;
+            }
+            memset(lengths + entry, (int)length, count);
+            entry += count;
+            length++;
+        }
+    }
+    if (b->eop || !codebook_build(v, c, lengths)) {
+        free(lengths);
+        return false;
+    }
+    free(lengths);
+
+    uint32_t lookup = bits_read(b, 4);
+    if (lookup == 0) {
+        return !b->eop;
+    }
+    if (lookup > 2 || c->dimensions == 0) {
+        return false;
+    }
+
+    float minimum = float32_unpack(bits_read(b, 32));
+    float delta = float32_unpack(bits_read(b, 32));
+    uint32_t value_bits = bits_read(b, 4) + 1;
+    bool sequence = bits_read(b, 1);
+    uint32_t count = lookup == 1 ? lookup1_values(c->entries, c->dimensions) : c->entries * c->dimensions;
+    uint16_t *multiplicands = malloc(count * sizeof(uint16_t));
+    if (multiplicands == NULL || b->eop) {
+        free(multiplicands);
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        multiplicands[i] = (uint16_t)bits_read(b, value_bits);
+    }
+
+    // expand every entry's vector now so residue decode is a plain add
+    c->values = vorbis_alloc(v, (size_t)c->entries * c->dimensions * sizeof(float));
+    if (c->values == NULL || b->eop) {
+        free(multiplicands);
+        return false;
+    }
+    for (uint32_t e = 0; e < c->entries; e++) {
+        float last = 0.0f;
+        uint32_t divisor = 1;
+        for (uint32_t d = 0; d < c->dimensions; d++) {
+            uint32_t offset = lookup == 1 ? (e / divisor) % count : e * c->dimensions + d;
+            float value = multiplicands[offset] * delta + minimum + last;
+            if (sequence) {
+                last = value;
+            }
+            c->values[e * c->dimensions + d] = value;
+            divisor *= count;
+        }
+    }
+    free(multiplicands);
+    return true;
+}
+
+/* floors */
+
+static bool parse_floor(vorbis_t *v, struct VorbisBits *b, struct VorbisFloor *f) {
+    int32_t max_class = -1;
+
+    if (bits_read(b, 16) != 1) {
+        return false; // floor 0
+    }
+    f->partitions = (uint8_t)bits_read(b, 5);
+    for (uint32_t i = 0; i < f->partitions; i++) {
+        f->partition_class[i] = (uint8_t)bits_read(b, 4);
+        if (f->partition_class[i] > max_class) {
+            max_class = f->partition_class[i];
+        }
+    }
+    for (int32_t i = 0; i <= max_class; i++) {
+        f->class_dimensions[i] = (uint8_t)(bits_read(b, 3) + 1);
+        f->class_subclasses[i] = (uint8_t)bits_read(b, 2);
+        if (f->class_subclasses[i] != 0) {
+            f->class_masterbook[i] = (uint8_t)bits_read(b, 8);
+            if (f->class_masterbook[i] >= v->codebook_count) {
+                return false;
+            }
+        }
+        for (uint32_t j = 0; j < (1u << f->class_subclasses[i]); j++) {
+            f->subclass_books[i][j] = (int16_t)((int32_t)bits_read(b, 8) - 1);
+            if (f->subclass_books[i][j] >= (int32_t)v->codebook_count) {
+                return false;
+            }
+        }
+    }
+    f->multiplier = (uint8_t)(bits_read(b, 2) + 1);
+    uint32_t range_bits = bits_read(b, 4);
+    f->x[0] = 0;
+    f->x[1] = (uint16_t)(1u << range_bits);
+    f->values = 2;
+    for (uint32_t i = 0; i < f->partitions; i++) {
+        uint8_t cls = f->partition_class[i];
+        for (uint32_t j = 0; j < f->class_dimensions[cls]; j++) {
+            if (f->values >= FLOOR1_MAX_VALUES) {
+                return false;
+            }
+            f->x[f->values++] = (uint16_t)bits_read(b, range_bits);
+        }
+    }
+
+    // render order, and each point's closest already-placed neighbours
+    for (uint32_t i = 0; i < f->values; i++) {
+        f->sorted[i] = (uint8_t)i;
+    }
+    for (uint32_t i = 1; i < f->values; i++) {
+        uint8_t cur = f->sorted[i];
+        uint32_t j = i;
+        while (j > 0 && f->x[f->sorted[j - 1]] > f->x[cur]) {
+            f->sorted[j] = f->sorted[j - 1];
+            j--;
+        }
+        f->sorted[j] = cur;
+    }
+    for (uint32_t i = 2; i < f->values; i++) {
+        uint32_t low = 0, high = 1;
+        for (uint32_t j = 0; j < i; j++) {
+            if (f->x[j] < f->x[i] && f->x[j] > f->x[low]) {
+                low = j;
+            }
+            if (f->x[j] > f->x[i] && f->x[j] < f->x[high]) {
+                high = j;
+            }
+        }
+        f->low_neighbor[i] = (uint8_t)low;
+        f->high_neighbor[i] = (uint8_t)high;
+    }
+    return !b->eop;
+}
+
+static const uint16_t sFloor1Range[4] = { 256, 128, 86, 64 };
+
+// returns false when the channel's floor is unused in this packet
+static bool floor1_decode(vorbis_t *v, struct VorbisBits *b, const struct VorbisFloor *f, int16_t *y) {
+    if (!bits_read(b, 1)) {
+        return false;
+    }
+    uint32_t range_bits = ilog(sFloor1Range[f->multiplier - 1] - 1);
+    uint32_t offset = 2;
+    y[0] = (int16_t)bits_read(b, range_bits);
+    y[1] = (int16_t)bits_read(b, range_bits);
+    for (uint32_t i = 0; i < f->partitions; i++) {
+        uint8_t cls = f->partition_class[i];
+        uint32_t cbits = f->class_subclasses[cls];
+        uint32_t csub = (1u << cbits) - 1;
+        uint32_t cval = 0;
+        if (cbits > 0) {
+            int32_t entry = codebook_decode(&v->codebooks[f->class_masterbook[cls]], b);
+            cval = entry < 0 ? 0 : (uint32_t)entry;
+        }
+        for (uint32_t j = 0; j < f->class_dimensions[cls]; j++) {
+            int32_t book = f->subclass_books[cls][cval & csub];
+            cval >>= cbits;
+            y[offset] = 0;
+            if (book >= 0) {
+                int32_t entry = codebook_decode(&v->codebooks[book], b);
+                y[offset] = (int16_t)(entry < 0 ? 0 : entry);
+            }
+            offset++;
+        }
+    }
+    // a packet that ends inside the floor leaves the channel silent
+    return !b->eop;
+}
+
+static int32_t render_point(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x) {
+    int32_t dy = y1 - y0;
+    int32_t adx = x1 - x0;
+    int32_t off = abs(dy) * (x - x0) / adx;
+    return dy < 0 ? y0 - off : y0 + off;
+}
+
+static inline float floor1_amplitude(int32_t y) {
+    return sFloor1InverseDb[y < 0 ? 0 : (y > 255 ? 255 : y)];
+}
+
+// multiplies out[x0, x1) by the floor line between the two points
+static void render_line(int32_t x0, int32_t y0, int32_t x1, int32_t y1, float *out, int32_t n) {
+    int32_t dy = y1 - y0;
+    int32_t adx = x1 - x0;
+    if (adx <= 0) {
+        return;
+    }
+    int32_t base = dy / adx;
+    int32_t sy = dy < 0 ? base - 1 : base + 1;
+    int32_t ady = abs(dy) - abs(base) * adx;
+    int32_t y = y0;
+    int32_t err = 0;
+    if (x1 > n) {
+        x1 = n;
+    }
+    if (x0 < x1) {
+        out[x0] *= floor1_amplitude(y);
+    }
+    for (int32_t x = x0 + 1; x < x1; x++) {
+        err += ady;
+        if (err >= adx) {
+            err -= adx;
+            y += sy;
+        } else {
+            y += base;
+        }
+        out[x] *= floor1_amplitude(y);
+    }
+}
+
+// Turns the decoded floor points into the spectral envelope and applies it
+// to the residue in `out`.
+static void floor1_apply(const struct VorbisFloor *f, const int16_t *y, float *out, int32_t n) {
+    int32_t final[FLOOR1_MAX_VALUES];
+    bool step2[FLOOR1_MAX_VALUES];
+    int32_t range = sFloor1Range[f->multiplier - 1];
+
+    final[0] = y[0];
+    final[1] = y[1];
+    step2[0] = step2[1] = true;
+    for (uint32_t i = 2; i < f->values; i++) {
+        uint32_t low = f->low_neighbor[i];
+        uint32_t high = f->high_neighbor[i];
+        int32_t predicted = render_point(f->x[low], final[low], f->x[high], final[high], f->x[i]);
+        int32_t val = y[i];
+        int32_t highroom = range - predicted;
+        int32_t lowroom = predicted;
+        int32_t room = (highroom < lowroom ? highroom : lowroom) * 2;
+        if (val != 0) {
+            step2[low] = step2[high] = step2[i] = true;
+            if (val >= room) {
+                final[i] = highroom > lowroom ? val - lowroom + predicted : predicted - val + highroom - 1;
+            } else {
+                final[i] = (val & 1) ? predicted - (val + 1) / 2 : predicted + val / 2;
+            }
+        } else {
+            step2[i] = false;
+            final[i] = predicted;
+        }
+    }
+
+    int32_t lx = 0;
+    int32_t ly = final[f->sorted[0]] * f->multiplier;
+    for (uint32_t j = 1; j < f->values; j++) {
+        uint32_t i = f->sorted[j];
+        if (step2[i]) {
+            int32_t hy = final[i] * f->multiplier;
+            render_line(lx, ly, f->x[i], hy, out, n);
+            lx = f->x[i];
+            ly = hy;
+        }
+    }
+    if (lx < n) {
+        render_line(lx, ly, n, ly, out, n);
+    }
+}
+
+/* residues */
+
+static bool parse_residue(vorbis_t *v, struct VorbisBits *b, struct VorbisResidue *r) {
+    uint8_t cascade[64];
+
+    r->type = (uint16_t)bits_read(b, 16);
+    r->begin = bits_read(b, 24);
+    r->end = bits_read(b, 24);
+    r->partition_size = bits_read(b, 24) + 1;
+    r->classifications = (uint8_t)(bits_read(b, 6) + 1);
+    r->classbook = (uint8_t)bits_read(b, 8);
+    if (r->type > 2 || r->classbook >= v->codebook_count || v->codebooks[r->classbook].dimensions == 0) {
+        return false;
+    }
+    for (uint32_t i = 0; i < r->classifications; i++) {
+        cascade[i] = (uint8_t)bits_read(b, 3);
+        if (bits_read(b, 1)) {
+            cascade[i] |= (uint8_t)(bits_read(b, 5) << 3);
+        }
+    }
+    for (uint32_t i = 0; i < r->classifications; i++) {
+        for (uint32_t j = 0; j < 8; j++) {
+            r->books[i][j] = -1;
+            if (cascade[i] & (1 << j)) {
+                uint32_t book = bits_read(b, 8);
+                if (book >= v->codebook_count || v->codebooks[book].values == NULL) {
+                    return false;
+                }
+                r->books[i][j] = (int16_t)book;
+            }
+        }
+    }
+    return !b->eop;
+}
+
+static bool decode_partition(const struct VorbisCodebook *book, struct VorbisBits *b, float *out, uint32_t size, bool interleaved) {
+    uint32_t dims = book->dimensions;
+    if (!interleaved) {
+        // format 0: the vector's values are spread `step` apart
+        uint32_t step = size / dims;
+        for (uint32_t j = 0; j < step; j++) {
+            int32_t entry = codebook_decode(book, b);
+            if (entry < 0) {
+                return false;
+            }
+            const float *val = book->values + entry * dims;
+            for (uint32_t k = 0; k < dims; k++) {
+                out[j + k * step] += val[k];
+            }
+        }
+        return true;
+    }
+    for (uint32_t i = 0; i < size;) {
+        int32_t entry = codebook_decode(book, b);
+        if (entry < 0) {
+            return false;
+        }
+        const float *val = book->values + entry * dims;
+        for (uint32_t k = 0; k < dims && i < size; k++) {
+            out[i++] += val[k];
+        }
+    }
+    return true;
+}
+
+static void residue_decode_vectors(vorbis_t *v, struct VorbisBits *b, const struct VorbisResidue *r,
+                                   float **vectors, const bool *skip, uint32_t count, uint32_t size, bool interleaved) {
+    const struct VorbisCodebook *classbook = &v->codebooks[r->classbook];
+    uint32_t classwords = classbook->dimensions;
+    uint32_t begin = r->begin < size ? r->begin : size;
+    uint32_t end = r->end < size ? r->end : size;
+    uint32_t partitions = (end - begin) / r->partition_size;
+
+    if (end <= begin || partitions == 0) {
+        return;
+    }
+    for (uint32_t pass = 0; pass < 8; pass++) {
+        uint32_t partition = 0;
+        while (partition < partitions) {
+            if (pass == 0) {
+                for (uint32_t j = 0; j < count; j++) {
+                    if (skip[j]) {
+                        continue;
+                    }
+                    int32_t temp = codebook_decode(classbook, b);
+                    if (temp < 0) {
+                        return;
+                    }
+                    uint8_t *cls = v->classifications + j * v->classifications_stride + partition;
+                    for (int32_t i = (int32_t)classwords - 1; i >= 0; i--) {
+                        cls[i] = (uint8_t)(temp % r->classifications);
+                        temp /= r->classifications;
+                    }
+                }
+            }
+            for (uint32_t i = 0; i < classwords && partition < partitions; i++, partition++) {
+                for (uint32_t j = 0; j < count; j++) {
+                    if (skip[j]) {
+                        continue;
+                    }
+                    uint8_t cls = v->classifications[j * v->classifications_stride + partition];
+                    int32_t book = r->books[cls][pass];
+                    if (book < 0) {
+                        continue;
+                    }
+                    float *out = vectors[j] + begin + partition * r->partition_size;
+                    if (!decode_partition(&v->codebooks[book], b, out, r->partition_size, interleaved)) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void residue_decode(vorbis_t *v, struct VorbisBits *b, const struct VorbisResidue *r,
+                           float **vectors, const bool *skip, uint32_t count, uint32_t n) {
+    if (r->type != 2) {
+        residue_decode_vectors(v, b, r, vectors, skip, count, n, r->type == 1);
+        return;
+    }
+
+    // type 2 codes all channels as one interleaved vector
+    bool any = false;
+    for (uint32_t j = 0; j < count; j++) {
+        any |= !skip[j];
+    }
+    if (!any) {
+        return;
+    }
+    bool no_skip = false;
+    float *flat = v->interleaved;
+    memset(flat, 0, n * count * sizeof(float));
+    residue_decode_vectors(v, b, r, &flat, &no_skip, 1, n * count, true);
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t j = 0; j < count; j++) {
+            vectors[j][i] = flat[i * count + j];
+        }
+    }
+}
+
+/* transform */
+
+static bool transform_init(vorbis_t *v, struct VorbisTransform *t, const uint32_t n) {
+    uint32_t quarter = n / 4;
+    uint32_t bits = ilog(quarter) - 1;
+
+    t->n = n;
+    t->twiddle = vorbis_alloc(v, quarter * 2 * sizeof(float));
+    t->fft_twiddle = vorbis_alloc(v, quarter * sizeof(float));
+    t->bitrev = vorbis_alloc(v, quarter * sizeof(uint16_t));
+    t->slope = vorbis_alloc(v, n / 2 * sizeof(float));
+    if (t->twiddle == NULL || t->fft_twiddle == NULL || t->bitrev == NULL || t->slope == NULL) {
+        return false;
+    }
+    // the IMDCT is a DCT-IV of size n/2, computed as an n/4-point complex
+    // FFT between two rotations by e^(-i*pi*(k + 1/8) / (n/2))
+    for (uint32_t k = 0; k < quarter; k++) {
+        double a = -M_PI * (k + 0.125) / (n / 2);
+        uint32_t r = 0;
+        t->twiddle[2 * k] = (float)cos(a);
+        t->twiddle[2 * k + 1] = (float)sin(a);
+        for (uint32_t j = 0; j < bits; j++) {
+            r |= ((k >> j) & 1) << (bits - 1 - j);
+        }
+        t->bitrev[k] = (uint16_t)r;
+    }
+    for (uint32_t k = 0; k < quarter / 2; k++) {
+        double a = -2.0 * M_PI * k / quarter;
+        t->fft_twiddle[2 * k] = (float)cos(a);
+        t->fft_twiddle[2 * k + 1] = (float)sin(a);
+    }
+    for (uint32_t i = 0; i < n / 2; i++) {
+        double s = sin((i + 0.5) / (n / 2) * M_PI / 2.0);
+        t->slope[i] = (float)sin(M_PI / 2.0 * s * s);
+    }
+    return true;
+}
+
+// in-place radix-2 FFT of `count` complex values given in bit-reversed order
+static void fft(const struct VorbisTransform *t, float *z, const uint32_t count) {
+    for (uint32_t len = 2; len <= count; len <<= 1) {
+        uint32_t half = len >> 1;
+        uint32_t stride = count / len;
+        for (uint32_t i = 0; i < count; i += len) {
+            for (uint32_t j = 0; j < half; j++) {
+                float wr = t->fft_twiddle[2 * j * stride];
+                float wi = t->fft_twiddle[2 * j * stride + 1];
+                float *a = z + 2 * (i + j);
+                float *b = z + 2 * (i + j + half);
+                float br = b[0] * wr - b[1] * wi;
+                float bi = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - br;
+                b[1] = a[1] - bi;
+                a[0] += br;
+                a[1] += bi;
+            }
+        }
+    }
+}
+
+// out[i] = sum_k in[k] cos(2pi/n (i + 1/2 + n/4)(k + 1/2)) for i < n. With
+// m = n/2 this is u[i + m/2] of the DCT-IV u of `in`, unfolded through
+// u[-1-j] = u[j] and u[2m-1-j] = -u[j].
+static void imdct(vorbis_t *v, const struct VorbisTransform *t, const float *in, float *out) {
+    uint32_t m = t->n / 2;
+    uint32_t h = m / 2;
+    float *z = v->fft;
+
+    for (uint32_t p = 0; p < h; p++) {
+        float re = in[2 * p];
+        float im = in[m - 1 - 2 * p];
+        float wr = t->twiddle[2 * p];
+        float wi = t->twiddle[2 * p + 1];
+        uint32_t r = t->bitrev[p];
+        z[2 * r] = re * wr - im * wi;
+        z[2 * r + 1] = re * wi + im * wr;
+    }
+    fft(t, z, h);
+    for (uint32_t q = 0; q < h; q++) {
+        float re = z[2 * q];
+        float im = z[2 * q + 1];
+        float wr = t->twiddle[2 * q];
+        float wi = t->twiddle[2 * q + 1];
+        uint32_t j[2] = { 2 * q, m - 1 - 2 * q };
+        float u[2] = { re * wr - im * wi, -(re * wi + im * wr) };
+        for (uint32_t k = 0; k < 2; k++) {
+            out[3 * h - 1 - j[k]] = -u[k];
+            if (j[k] >= h) {
+                out[j[k] - h] = u[k];
+            } else {
+                out[j[k] + 3 * h] = -u[k];
+            }
+        }
+    }
+}
+
+/* setup */
+
+static bool parse_mapping(vorbis_t *v, struct VorbisBits *b, struct VorbisMapping *m) {
+    uint32_t channel_bits = ilog(v->channels - 1);
+
+    if (bits_read(b, 16) != 0) {
+        return false;
+    }
+    m->submaps = (uint8_t)(bits_read(b, 1) ? bits_read(b, 4) + 1 : 1);
+    m->coupling_steps = (uint16_t)(bits_read(b, 1) ? bits_read(b, 8) + 1 : 0);
+    for (uint32_t i = 0; i < m->coupling_steps; i++) {
+        m->magnitude[i] = (uint8_t)bits_read(b, channel_bits);
+        m->angle[i] = (uint8_t)bits_read(b, channel_bits);
+        if (m->magnitude[i] == m->angle[i] || m->magnitude[i] >= v->channels || m->angle[i] >= v->channels) {
+            return false;
+        }
+    }
+    if (bits_read(b, 2) != 0) {
+        return false;
+    }
+    if (m->submaps > 1) {
+        for (uint32_t c = 0; c < v->channels; c++) {
+            m->mux[c] = (uint8_t)bits_read(b, 4);
+            if (m->mux[c] >= m->submaps) {
+                return false;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < m->submaps; i++) {
+        bits_read(b, 8); // unused time configuration
+        m->submap_floor[i] = (uint8_t)bits_read(b, 8);
+        m->submap_residue[i] = (uint8_t)bits_read(b, 8);
+        if (m->submap_floor[i] >= v->floor_count || m->submap_residue[i] >= v->residue_count) {
+            return false;
+        }
+    }
+    return !b->eop;
+}
+
+static bool parse_identification(vorbis_t *v, struct VorbisBits *b) {
+    uint32_t version = bits_read(b, 32);
+    v->channels = bits_read(b, 8);
+    v->rate = bits_read(b, 32);
+    bits_read(b, 32); // bitrate maximum, nominal and minimum
+    bits_read(b, 32);
+    bits_read(b, 32);
+    uint32_t sizes = bits_read(b, 8);
+    v->blocksize[0] = 1u << (sizes & 15);
+    v->blocksize[1] = 1u << (sizes >> 4);
+    return version == 0 && v->channels > 0 && v->channels <= VORBIS_MAX_CHANNELS && v->rate > 0
+        && v->blocksize[0] >= 64 && v->blocksize[0] <= v->blocksize[1] && v->blocksize[1] <= VORBIS_MAX_BLOCKSIZE
+        && bits_read(b, 1) == 1 && !b->eop;
+}
+
+static bool parse_setup(vorbis_t *v, struct VorbisBits *b) {
+    v->codebook_count = bits_read(b, 8) + 1;
+    v->codebooks = vorbis_alloc(v, v->codebook_count * sizeof(struct VorbisCodebook));
+    if (v->codebooks == NULL) {
+        return false;
+    }
+    for (uint32_t i = 0; i < v->codebook_count; i++) {
+        if (!parse_codebook(v, b, &v->codebooks[i])) {
+            return false;
+        }
+    }
+
+    uint32_t time_count = bits_read(b, 6) + 1;
+    for (uint32_t i = 0; i < time_count; i++) {
+        if (bits_read(b, 16) != 0) {
+            return false;
+        }
+    }
+
+    v->floor_count = bits_read(b, 6) + 1;
+    v->floors = vorbis_alloc(v, v->floor_count * sizeof(struct VorbisFloor));
+    if (v->floors == NULL) {
+        return false;
+    }
+    for (uint32_t i = 0; i < v->floor_count; i++) {
+        if (!parse_floor(v, b, &v->floors[i])) {
+            return false;
+        }
+    }
+
+    v->residue_count = bits_read(b, 6) + 1;
+    v->residues = vorbis_alloc(v, v->residue_count * sizeof(struct VorbisResidue));
+    if (v->residues == NULL) {
+        return false;
+    }
+    for (uint32_t i = 0; i < v->residue_count; i++) {
+        if (!parse_residue(v, b, &v->residues[i])) {
+            return false;
+        }
+    }
+
+    v->mapping_count = bits_read(b, 6) + 1;
+    v->mappings = vorbis_alloc(v, v->mapping_count * sizeof(struct VorbisMapping));
+    if (v->mappings == NULL) {
+        return false;
+    }
+    for (uint32_t i = 0; i < v->mapping_count; i++) {
+        if (!parse_mapping(v, b, &v->mappings[i])) {
+            return false;
+        }
+    }
+
+    v->mode_count = bits_read(b, 6) + 1;
+    for (uint32_t i = 0; i < v->mode_count; i++) {
+        struct VorbisMode *mode = &v->modes[i];
+        mode->blockflag = (uint8_t)bits_read(b, 1);
+        uint32_t window = bits_read(b, 16);
+        uint32_t transform = bits_read(b, 16);
+        mode->mapping = (uint8_t)bits_read(b, 8);
+        if (window != 0 || transform != 0 || mode->mapping >= v->mapping_count) {
+            return false;
+        }
+    }
+    return bits_read(b, 1) == 1 && !b->eop;
+}
+
+static bool alloc_buffers(vorbis_t *v) {
+    uint32_t n = v->blocksize[1];
+
+    for (uint32_t c = 0; c < v->channels; c++) {
+        v->spectrum[c] = vorbis_alloc(v, n / 2 * sizeof(float));
+        v->time[c] = vorbis_alloc(v, n * sizeof(float));
+        v->overlap[c] = vorbis_alloc(v, n / 2 * sizeof(float));
+        v->pcm[c] = vorbis_alloc(v, n / 2 * sizeof(float));
+        v->floor_y[c] = vorbis_alloc(v, FLOOR1_MAX_VALUES * sizeof(int16_t));
+        if (v->spectrum[c] == NULL || v->time[c] == NULL || v->overlap[c] == NULL || v->pcm[c] == NULL || v->floor_y[c] == NULL) {
+            return false;
+        }
+    }
+    v->interleaved = vorbis_alloc(v, n / 2 * v->channels * sizeof(float));
+    v->fft = vorbis_alloc(v, n / 4 * 2 * sizeof(float));
+    if (v->interleaved == NULL || v->fft == NULL) {
+        return false;
+    }
+    for (uint32_t i = 0; i < 2; i++) {
+        if (!transform_init(v, &v->transform[i], v->blocksize[i])) {
+            return false;
+        }
+    }
+
+    // room for every partition's class of the largest residue vector
+    for (uint32_t i = 0; i < v->residue_count; i++) {
+        const struct VorbisResidue *r = &v->residues[i];
+        uint32_t size = r->type == 2 ? n / 2 * v->channels : n / 2;
+        uint32_t stride = size / r->partition_size + v->codebooks[r->classbook].dimensions;
+        if (stride > v->classifications_stride) {
+            v->classifications_stride = stride;
+        }
+    }
+    v->classifications = vorbis_alloc(v, v->classifications_stride * v->channels);
+    return v->classifications != NULL;
+}
+
+/* ogg */
+
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// loads the page at r->page_next, skipping other logical streams; false at
+// the end of the data
+static bool ogg_load_page(const vorbis_t *v, struct OggReader *r) {
+    for (;;) {
+        uint32_t off = r->page_next;
+        if (off + 27 > v->size) {
+            return false;
+        }
+        const uint8_t *p = v->data + off;
+        if (memcmp(p, "OggS", 4) != 0 || p[4] != 0) {
+            // lost sync; look for the next capture pattern
+            r->page_next = off + 1;
+            while (r->page_next + 4 <= v->size && memcmp(v->data + r->page_next, "OggS", 4) != 0) {
+                r->page_next++;
+            }
+            continue;
+        }
+        uint32_t body = off + 27 + p[26];
+        uint32_t body_size = 0;
+        if (body > v->size) {
+            return false;
+        }
+        for (uint32_t i = 0; i < p[26]; i++) {
+            body_size += p[27 + i];
+        }
+        if (body + body_size > v->size) {
+            return false;
+        }
+        r->page_next = body + body_size;
+        if (read_le32(p + 14) != v->serial) {
+            continue;
+        }
+        r->page_offset = off;
+        r->lacing = p + 27;
+        r->segments = p[26];
+        r->segment = 0;
+        r->body_pos = body;
+        r->flags = p[5];
+        r->granule = (int64_t)((uint64_t)read_le32(p + 6) | ((uint64_t)read_le32(p + 10) << 32));
+        return true;
+    }
+}
+
+// Returns the next complete packet. `granule` is the page's granule position
+// if this is the last packet that finishes on its page, else -1; `eos` marks
+// the last packet of the stream.
+static bool ogg_next_packet(vorbis_t *v, const uint8_t **out, uint32_t *size, int64_t *granule, bool *eos) {
+    struct OggReader *r = &v->reader;
+    uint32_t length = 0;
+    bool spanning = false;
+
+    for (;;) {
+        if (r->segment >= r->segments) {
+            if (!ogg_load_page(v, r)) {
+                return false;
+            }
+            bool continued = (r->flags & 1) != 0;
+            if (continued && !spanning) {
+                // the start of this packet is on a page we never read
+                while (r->segment < r->segments) {
+                    uint8_t len = r->lacing[r->segment++];
+                    r->body_pos += len;
+                    if (len < 255) {
+                        break;
+                    }
+                }
+            } else if (!continued && spanning) {
+                spanning = false;
+                length = 0;
+            }
+            continue;
+        }
+
+        uint32_t start = r->body_pos;
+        uint32_t bytes = 0;
+        bool done = false;
+        while (r->segment < r->segments) {
+            uint8_t len = r->lacing[r->segment++];
+            bytes += len;
+            if (len < 255) {
+                done = true;
+                break;
+            }
+        }
+        r->body_pos += bytes;
+
+        if (!done || spanning) {
+            // packets that cross a page boundary are gathered in v->packet
+            if (length + bytes > v->packet_cap) {
+                uint32_t cap = (length + bytes) * 2;
+                uint8_t *grown = realloc(v->packet, cap);
+                if (grown == NULL) {
+                    return false;
+                }
+                v->memory += cap - v->packet_cap;
+                v->packet = grown;
+                v->packet_cap = cap;
+            }
+            memcpy(v->packet + length, v->data + start, bytes);
+            length += bytes;
+            if (!done) {
+                spanning = true;
+                continue;
+            }
+            *out = v->packet;
+            *size = length;
+        } else {
+            *out = v->data + start;
+            *size = bytes;
+        }
+
+        bool last = true;
+        for (uint32_t i = r->segment; i < r->segments; i++) {
+            if (r->lacing[i] < 255) {
+                last = false;
+                break;
+            }
+        }
+        *granule = last ? r->granule : -1;
+        *eos = last && ((r->flags & 4) != 0 || r->page_next >= v->size);
+        return true;
+    }
+}
+
+// granule position of the stream's last page
+static uint64_t ogg_find_length(const vorbis_t *v) {
+    uint32_t stop = v->size > 0x10000 ? v->size - 0x10000 : 0;
+    for (uint32_t off = v->size >= 27 ? v->size - 27 : 0; off > stop; off--) {
+        const uint8_t *p = v->data + off;
+        if (memcmp(p, "OggS", 4) == 0 && read_le32(p + 14) == v->serial) {
+            int64_t granule = (int64_t)((uint64_t)read_le32(p + 6) | ((uint64_t)read_le32(p + 10) << 32));
+            return granule > 0 ? (uint64_t)granule : 0;
+        }
+    }
+    return 0;
+}
+
+/* audio packets */
+
+// Decodes one audio packet into v->pcm; returns the number of finished
+// samples per channel (0 for the first block after a reset), -1 if the
+// packet is corrupt.
+static int32_t decode_packet(vorbis_t *v, const uint8_t *data, uint32_t size) {
+    struct VorbisBits b = { data, size, 0, false };
+    float *vectors[VORBIS_MAX_CHANNELS];
+    bool bundle_skip[VORBIS_MAX_CHANNELS];
+    bool skip[VORBIS_MAX_CHANNELS];
+    bool unused[VORBIS_MAX_CHANNELS];
+
+    if (size == 0 || bits_read(&b, 1) != 0) {
+        return -1;
+    }
+    uint32_t mode_index = bits_read(&b, ilog(v->mode_count - 1));
+    if (mode_index >= v->mode_count) {
+        return -1;
+    }
+    const struct VorbisMode *mode = &v->modes[mode_index];
+    const struct VorbisMapping *map = &v->mappings[mode->mapping];
+    uint32_t n = v->blocksize[mode->blockflag];
+    uint32_t half = n / 2;
+    bool prev_long = true;
+    bool next_long = true;
+    if (mode->blockflag) {
+        prev_long = bits_read(&b, 1);
+        next_long = bits_read(&b, 1);
+    }
+    if (b.eop) {
+        return -1;
+    }
+
+    for (uint32_t c = 0; c < v->channels; c++) {
+        const struct VorbisFloor *floor = &v->floors[map->submap_floor[map->mux[c]]];
+        unused[c] = !floor1_decode(v, &b, floor, v->floor_y[c]);
+        skip[c] = unused[c];
+    }
+    // a coupled pair is decoded if either side carries a signal
+    for (uint32_t i = 0; i < map->coupling_steps; i++) {
+        if (!skip[map->magnitude[i]] || !skip[map->angle[i]]) {
+            skip[map->magnitude[i]] = skip[map->angle[i]] = false;
+        }
+    }
+
+    for (uint32_t c = 0; c < v->channels; c++) {
+        memset(v->spectrum[c], 0, half * sizeof(float));
+    }
+    for (uint32_t s = 0; s < map->submaps; s++) {
+        uint32_t count = 0;
+        for (uint32_t c = 0; c < v->channels; c++) {
+            if (map->mux[c] == s) {
+                vectors[count] = v->spectrum[c];
+                bundle_skip[count++] = skip[c];
+            }
+        }
+        residue_decode(v, &b, &v->residues[map->submap_residue[s]], vectors, bundle_skip, count, half);
+    }
+
+    for (int32_t i = (int32_t)map->coupling_steps - 1; i >= 0; i--) {
+        float *magnitude = v->spectrum[map->magnitude[i]];
+        float *angle = v->spectrum[map->angle[i]];
+        for (uint32_t j = 0; j < half; j++) {
+            float m = magnitude[j];
+            float a = angle[j];
+            if (m > 0.0f) {
+                if (a > 0.0f) {
+                    angle[j] = m - a;
+                } else {
+                    angle[j] = m;
+                    magnitude[j] = m + a;
+                }
+            } else {
+                if (a > 0.0f) {
+                    angle[j] = m + a;
+                } else {
+                    angle[j] = m;
+                    magnitude[j] = m - a;
+                }
+            }
+        }
+    }
+
+    // window slopes: a long block next to a short one overlaps it with the
+    // short slope, centred on its quarter point
+    uint32_t short_half = v->blocksize[0] / 2;
+    uint32_t left_start = 0, left_end = half, right_start = half, right_end = n;
+    const float *left_slope = v->transform[mode->blockflag].slope;
+    const float *right_slope = left_slope;
+    uint32_t right_n = half;
+    if (mode->blockflag && !prev_long) {
+        left_start = n / 4 - short_half / 2;
+        left_end = n / 4 + short_half / 2;
+        left_slope = v->transform[0].slope;
+    }
+    if (mode->blockflag && !next_long) {
+        right_start = n * 3 / 4 - short_half / 2;
+        right_end = n * 3 / 4 + short_half / 2;
+        right_slope = v->transform[0].slope;
+        right_n = short_half;
+    }
+
+    for (uint32_t c = 0; c < v->channels; c++) {
+        float *time = v->time[c];
+        if (unused[c]) {
+            memset(time, 0, n * sizeof(float));
+            continue;
+        }
+        floor1_apply(&v->floors[map->submap_floor[map->mux[c]]], v->floor_y[c], v->spectrum[c], (int32_t)half);
+        imdct(v, &v->transform[mode->blockflag], v->spectrum[c], time);
+        memset(time, 0, left_start * sizeof(float));
+        for (uint32_t i = left_start; i < left_end; i++) {
+            time[i] *= left_slope[i - left_start];
+        }
+        for (uint32_t i = right_start; i < right_end; i++) {
+            time[i] *= right_slope[right_n - 1 - (i - right_start)];
+        }
+        memset(time + right_end, 0, (n - right_end) * sizeof(float));
+    }
+
+    // the finished samples run from the previous block's centre to this one's
+    uint32_t count = v->prev_n == 0 ? 0 : v->prev_n / 4 + n / 4;
+    int32_t offset = (int32_t)(n / 4) - (int32_t)(v->prev_n / 4);
+    for (uint32_t c = 0; c < v->channels; c++) {
+        const float *time = v->time[c];
+        const float *overlap = v->overlap[c];
+        float *pcm = v->pcm[c];
+        for (uint32_t i = 0; i < count; i++) {
+            int32_t j = (int32_t)i + offset;
+            float sample = i < v->prev_n / 2 ? overlap[i] : 0.0f;
+            if (j >= 0) {
+                sample += time[j];
+            }
+            pcm[i] = sample;
+        }
+        memcpy(v->overlap[c], time + half, half * sizeof(float));
+    }
+    v->prev_n = n;
+    return (int32_t)count;
+}
+
+// decodes packets until one yields frames at or after the seek target
+static bool next_block(vorbis_t *v) {
+    const uint8_t *packet;
+    uint32_t size;
+    int64_t granule;
+    bool eos;
+
+    while (ogg_next_packet(v, &packet, &size, &granule, &eos)) {
+        int32_t count = decode_packet(v, packet, size);
+        if (count < 0) {
+            // drop the overlap and find our place again at the next granule
+            v->prev_n = 0;
+            v->synced = false;
+            continue;
+        }
+        if (granule >= 0) {
+            if (!v->synced) {
+                v->decode_pos = (uint64_t)granule;
+                v->synced = true;
+                continue;
+            }
+            // the last page's granule trims the final block
+            if (eos && (uint64_t)granule < v->decode_pos + (uint64_t)count) {
+                count = (uint64_t)granule > v->decode_pos ? (int32_t)((uint64_t)granule - v->decode_pos) : 0;
+            }
+        }
+        if (!v->synced) {
+            continue;
+        }
+
+        uint64_t first = v->decode_pos;
+        v->decode_pos += (uint64_t)count;
+        if (v->decode_pos <= v->seek_target) {
+            continue;
+        }
+        v->pcm_pos = first < v->seek_target ? (uint32_t)(v->seek_target - first) : 0;
+        v->pcm_count = (uint32_t)count;
+        v->position = first + v->pcm_pos;
+        return true;
+    }
+    return false;
+}
+
+/* api */
+
+vorbis_t *vorbis_open(const uint8_t *data, const uint32_t size) {
+    vorbis_t *v;
+
+    if (data == NULL || size < 27 || memcmp(data, "OggS", 4) != 0) {
+        return NULL;
+    }
+    v = calloc(1, sizeof(*v));
+    if (v == NULL) {
+        return NULL;
+    }
+    v->memory = sizeof(*v);
+    v->data = data;
+    v->size = size;
+    v->serial = read_le32(data + 14);
+
+    // identification, comment and setup headers
+    for (uint32_t i = 0; i < 3; i++) {
+        const uint8_t *packet;
+        uint32_t length;
+        int64_t granule;
+        bool eos;
+        if (!ogg_next_packet(v, &packet, &length, &granule, &eos) || length < 7
+            || packet[0] != 2 * i + 1 || memcmp(packet + 1, "vorbis", 6) != 0) {
+            vorbis_close(v);
+            return NULL;
+        }
+        struct VorbisBits b = { packet + 7, length - 7, 0, false };
+        if ((i == 0 && !parse_identification(v, &b)) || (i == 2 && !parse_setup(v, &b))) {
+            vorbis_close(v);
+            return NULL;
+        }
+    }
+    if (!alloc_buffers(v)) {
+        vorbis_close(v);
+        return NULL;
+    }
+    v->audio_start = v->reader;
+    v->length = ogg_find_length(v);
+    v->synced = true;
+    return v;
+}
+
+void vorbis_close(vorbis_t *v) {
+    if (v == NULL) {
+        return;
+    }
+    if (v->codebooks != NULL) {
+        for (uint32_t i = 0; i < v->codebook_count; i++) {
+            free(v->codebooks[i].fast);
+            free(v->codebooks[i].long_codes);
+            free(v->codebooks[i].long_entries);
+            free(v->codebooks[i].values);
+        }
+    }
+    free(v->codebooks);
+    free(v->floors);
+    free(v->residues);
+    free(v->mappings);
+    for (uint32_t i = 0; i < 2; i++) {
+        free(v->transform[i].twiddle);
+        free(v->transform[i].fft_twiddle);
+        free(v->transform[i].bitrev);
+        free(v->transform[i].slope);
+    }
+    for (uint32_t c = 0; c < VORBIS_MAX_CHANNELS; c++) {
+        free(v->spectrum[c]);
+        free(v->time[c]);
+        free(v->overlap[c]);
+        free(v->pcm[c]);
+        free(v->floor_y[c]);
+    }
+    free(v->interleaved);
+    free(v->fft);
+    free(v->classifications);
+    free(v->packet);
+    free(v);
+}
+
+uint32_t vorbis_channels(const vorbis_t *v) {
+    return v->channels;
+}
+
+uint32_t vorbis_rate(const vorbis_t *v) {
+    return v->rate;
+}
+
+uint64_t vorbis_length(const vorbis_t *v) {
+    return v->length;
+}
+
+size_t vorbis_memory(const vorbis_t *v) {
+    return v->memory;
+}
+
+int32_t vorbis_read(vorbis_t *v, int16_t *out, const uint32_t frames) {
+    uint32_t written = 0;
+
+    while (written < frames) {
+        if (v->pcm_pos >= v->pcm_count) {
+            if (!next_block(v)) {
+                break;
+            }
+            continue;
+        }
+        uint32_t count = v->pcm_count - v->pcm_pos;
+        if (count > frames - written) {
+            count = frames - written;
+        }
+        for (uint32_t c = 0; c < v->channels; c++) {
+            const float *src = v->pcm[c] + v->pcm_pos;
+            int16_t *dst = out + written * v->channels + c;
+            for (uint32_t i = 0; i < count; i++) {
+                float sample = src[i] * 32768.0f;
+                int32_t value;
+                if (sample >= 32767.0f) {
+                    value = 32767;
+                } else if (sample <= -32768.0f) {
+                    value = -32768;
+                } else {
+                    value = (int32_t)(sample + 32768.5f) - 32768;
+                }
+                dst[i * v->channels] = (int16_t)value;
+            }
+        }
+        v->pcm_pos += count;
+        v->position += count;
+        written += count;
+    }
+    return (int32_t)written;
+}
+
+uint64_t vorbis_tell(const vorbis_t *v) {
+    return v->position;
+}
+
+bool vorbis_seek(vorbis_t *v, const uint64_t frame) {
+    struct OggReader r = v->audio_start;
+    uint32_t prev = r.page_next;
+    int64_t start = -1;
+
+    // the last page that finishes at or before the target; decoding starts
+    // one page earlier so the packet that finishes it is complete
+    while (ogg_load_page(v, &r)) {
+        if (r.granule >= 0) {
+            if ((uint64_t)r.granule > frame) {
+                break;
+            }
+            start = prev;
+        }
+        prev = r.page_offset;
+    }
+
+    v->prev_n = 0;
+    v->pcm_pos = 0;
+    v->pcm_count = 0;
+    v->seek_target = frame;
+    v->position = frame;
+    if (start < 0) {
+        v->reader = v->audio_start;
+        v->decode_pos = 0;
+        v->synced = true;
+    } else {
+        memset(&v->reader, 0, sizeof(v->reader));
+        v->reader.page_next = (uint32_t)start;
+        v->synced = false;
+    }
+    return true;
+}
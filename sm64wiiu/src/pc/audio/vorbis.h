@@ -0,0 +1,36 @@
+#ifndef VORBIS_H
+#define VORBIS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming Ogg Vorbis decoder for mod audio. It decodes one packet at a time
+// from an Ogg file held in memory (the caller keeps `data` alive until
+// vorbis_close()), so the decoded PCM it holds never exceeds one block per
+// channel. Floor type 0 is not supported; no known encoder has produced it
+// since 2000.
+
+typedef struct vorbis_s vorbis_t;
+
+// returns NULL if `data` is not an Ogg Vorbis stream this decoder handles
+vorbis_t *vorbis_open(const uint8_t *data, const uint32_t size);
+void vorbis_close(vorbis_t *v);
+
+uint32_t vorbis_channels(const vorbis_t *v);
+uint32_t vorbis_rate(const vorbis_t *v);
+// length in frames from the last page's granule position, 0 if unknown
+uint64_t vorbis_length(const vorbis_t *v);
+// heap bytes owned by the decoder (setup tables and block buffers)
+size_t vorbis_memory(const vorbis_t *v);
+
+// decodes up to `frames` interleaved frames of vorbis_channels() samples;
+// returns the number written, 0 at the end of the stream; corrupt packets
+// are skipped
+int32_t vorbis_read(vorbis_t *v, int16_t *out, const uint32_t frames);
+// frame index of the next frame vorbis_read() returns
+uint64_t vorbis_tell(const vorbis_t *v);
+// sample-accurate; decodes from the page before the target and discards
+bool vorbis_seek(vorbis_t *v, const uint64_t frame);
+
+#endif
@@ -2,12 +2,14 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
 
 #include "configfile.h"
 #include "fs/fs.h"
+#include "fs/fs_persist.h"
 #include "mods/mods.h"
 
 #define ARRAY_LEN(arr) (sizeof(arr) / sizeof(arr[0]))
@@ -31,10 +33,18 @@ struct ConfigOption {
     int maxStringLength;
 };
 
+// growable text buffer the config is serialized into before it's handed to fs_persist
+struct ConfigBuffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+    bool failed; // a line was dropped; the buffer must not replace the file
+};
+
 struct FunctionConfigOption {
     const char *name;
     void (*read)(const char *value);
-    void (*write)(FILE *file);
+    void (*write)(struct ConfigBuffer *buffer);
 };
 
 /*
@@ -96,6 +106,7 @@ static const struct ConfigOption options[] = {
     {.name = "framerate_mode",     .type = CONFIG_TYPE_UINT, .uintValue = (unsigned int *)&configFramerateMode},
     {.name = "frame_limit",        .type = CONFIG_TYPE_UINT, .uintValue = &configFrameLimit},
     {.name = "interpolation_mode", .type = CONFIG_TYPE_UINT, .uintValue = &configInterpolationMode},
+    {.name = "frame_pacer_csv",    .type = CONFIG_TYPE_BOOL, .boolValue = &configFramePacerCsv},
     {.name = "coop_draw_distance", .type = CONFIG_TYPE_UINT, .uintValue = &configDrawDistance},
     {.name = "force_4by3",         .type = CONFIG_TYPE_BOOL, .boolValue = &configForce4By3},
 
@@ -106,6 +117,8 @@ static const struct ConfigOption options[] = {
     {.name = "env_volume",          .type = CONFIG_TYPE_UINT, .uintValue = &configEnvVolume},
     {.name = "fade_distant_sounds", .type = CONFIG_TYPE_BOOL, .boolValue = &configFadeoutDistantSounds},
     {.name = "mute_focus_loss",     .type = CONFIG_TYPE_BOOL, .boolValue = &configMuteFocusLoss},
+    {.name = "audio_float_synthesis", .type = CONFIG_TYPE_BOOL, .boolValue = &configAudioFloatSynthesis},
+    {.name = "audio_sample_dma_cache", .type = CONFIG_TYPE_BOOL, .boolValue = &configAudioSampleDmaCache},
 
     // Controls / camera
     {.name = "stick_deadzone",                 .type = CONFIG_TYPE_UINT, .uintValue = &configStickDeadzone},
@@ -176,8 +189,20 @@ static const struct ConfigOption options[] = {
     {.name = "djui_theme_gradients", .type = CONFIG_TYPE_BOOL, .boolValue = &configDjuiThemeGradients},
     {.name = "djui_theme_font",      .type = CONFIG_TYPE_UINT, .uintValue = &configDjuiThemeFont},
     {.name = "djui_scale",           .type = CONFIG_TYPE_UINT, .uintValue = &configDjuiScale},
+    {.name = "djui_batch_text",      .type = CONFIG_TYPE_BOOL, .boolValue = &configDjuiBatchText},
+    {.name = "djui_cache",           .type = CONFIG_TYPE_BOOL, .boolValue = &configDjuiCache},
     {.name = "ex_coop_theme",        .type = CONFIG_TYPE_BOOL, .boolValue = &configExCoopTheme},
 
+    // Lua
+    {.name = "lua_gc_step_kb",               .type = CONFIG_TYPE_UINT, .uintValue = &configLuaGcStepKb},
+    {.name = "lua_gc_budget_us",             .type = CONFIG_TYPE_UINT, .uintValue = &configLuaGcBudgetUs},
+    {.name = "lua_profiler",                 .type = CONFIG_TYPE_BOOL, .boolValue = &configLuaProfiler},
+    {.name = "lua_profiler_sample_interval", .type = CONFIG_TYPE_UINT, .uintValue = &configLuaProfilerSampleInterval},
+
+    // Debug
+    {.name = "ctx_trace",            .type = CONFIG_TYPE_BOOL, .boolValue = &configCtxTrace},
+    {.name = "diag_dump",            .type = CONFIG_TYPE_BOOL, .boolValue = &configDiagDump},
+
 #ifdef TARGET_WII_U
     {.name = "n64_face_buttons",     .type = CONFIG_TYPE_BOOL, .boolValue = &configN64FaceButtons},
 #endif
@@ -295,13 +320,43 @@ static void enable_mod_read(const char *value) {
     queue_enabled_mod_path(value);
 }
 
-static void enable_mod_write(FILE *file) {
+static void configfile_appendf(struct ConfigBuffer *buffer, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (needed < 0) {
+        buffer->failed = true;
+        return;
+    }
+
+    if (buffer->length + (size_t)needed + 1 > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (buffer->length + (size_t)needed + 1 > capacity) {
+            capacity *= 2;
+        }
+        char *data = realloc(buffer->data, capacity);
+        if (data == NULL) {
+            buffer->failed = true;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+
+    va_start(args, format);
+    vsnprintf(buffer->data + buffer->length, buffer->capacity - buffer->length, format, args);
+    va_end(args);
+    buffer->length += (size_t)needed;
+}
+
+static void enable_mod_write(struct ConfigBuffer *buffer) {
     for (size_t i = 0; i < gLocalMods.entryCount; i++) {
         struct Mod *mod = gLocalMods.entries[i];
         if (mod == NULL || !mod->enabled) {
             continue;
         }
-        fprintf(file, "enable-mod: %s\n", mod->relativePath);
+        configfile_appendf(buffer, "enable-mod: %s\n", mod->relativePath);
     }
 }
 
@@ -331,6 +386,7 @@ void configfile_load(void) {
     char line[1024];
 
     printf("Loading configuration from '%s'\n", filename);
+    fs_persist_recover(filename);
     file = fs_open(filename);
     if (file == NULL) {
         // Create a new config file and save defaults
@@ -426,33 +482,26 @@ void configfile_load(void) {
 
 // Writes the config file to the writable virtual filesystem location.
 void configfile_save(void) {
-    FILE *file;
     const char *filename = configfile_name();
-    const char *write_path = fs_get_write_path(filename);
+    struct ConfigBuffer buffer = { 0 };
 
     printf("Saving configuration to '%s'\n", filename);
 
-    file = fopen(write_path, "w");
-    if (file == NULL) {
-        // error
-        return;
-    }
-
     for (unsigned int i = 0; i < ARRAY_LEN(options); i++) {
         const struct ConfigOption *option = &options[i];
 
         switch (option->type) {
             case CONFIG_TYPE_BOOL:
-                fprintf(file, "%s %s\n", option->name, *option->boolValue ? "true" : "false");
+                configfile_appendf(&buffer, "%s %s\n", option->name, *option->boolValue ? "true" : "false");
                 break;
             case CONFIG_TYPE_UINT:
-                fprintf(file, "%s %u\n", option->name, *option->uintValue);
+                configfile_appendf(&buffer, "%s %u\n", option->name, *option->uintValue);
                 break;
             case CONFIG_TYPE_FLOAT:
-                fprintf(file, "%s %f\n", option->name, *option->floatValue);
+                configfile_appendf(&buffer, "%s %f\n", option->name, *option->floatValue);
                 break;
             case CONFIG_TYPE_STRING:
-                fprintf(file, "%s %s\n", option->name, option->stringValue);
+                configfile_appendf(&buffer, "%s %s\n", option->name, option->stringValue);
                 break;
             default:
                 assert(0); // unknown type
@@ -460,8 +509,17 @@ void configfile_save(void) {
     }
 
     for (unsigned int i = 0; i < ARRAY_LEN(function_options); i++) {
-        function_options[i].write(file);
+        function_options[i].write(&buffer);
+    }
+
+    // a partial buffer would atomically replace a good config with a broken one
+    if (buffer.failed) {
+        printf("Failed to build configuration for '%s', keeping the saved file\n", filename);
+        free(buffer.data);
+        return;
     }
 
-    fclose(file);
+    // written behind by fs_persist; the writer swaps it in atomically
+    fs_persist_write(filename, buffer.data, buffer.length);
+    free(buffer.data);
 }
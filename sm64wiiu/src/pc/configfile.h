@@ -75,6 +75,7 @@ extern bool configShowPing;
 extern enum RefreshRateMode configFramerateMode;
 extern unsigned int configFrameLimit;
 extern unsigned int configInterpolationMode;
+extern bool configFramePacerCsv;
 extern unsigned int configDrawDistance;
 
 extern unsigned int configMasterVolume;
@@ -83,6 +84,8 @@ extern unsigned int configSfxVolume;
 extern unsigned int configEnvVolume;
 extern bool configFadeoutDistantSounds;
 extern bool configMuteFocusLoss;
+extern bool configAudioFloatSynthesis;
+extern bool configAudioSampleDmaCache;
 
 extern unsigned int configStickDeadzone;
 extern unsigned int configRumbleStrength;
@@ -114,10 +117,15 @@ extern bool configCameraInvertY;
 extern bool configCameraToxicGas;
 
 extern bool configLuaProfiler;
+extern unsigned int configLuaProfilerSampleInterval;
+extern unsigned int configLuaGcStepKb;
+extern unsigned int configLuaGcBudgetUs;
 extern bool configDebugPrint;
 extern bool configDebugInfo;
 extern bool configDebugError;
 extern bool configCtxProfiler;
+extern bool configCtxTrace;
+extern bool configDiagDump;
 
 extern char configSaveNames[4][MAX_SAVE_NAME_STRING];
 extern char configPlayerName[MAX_CONFIG_STRING];
@@ -157,6 +165,8 @@ extern bool configDjuiThemeCenter;
 extern bool configDjuiThemeGradients;
 extern unsigned int configDjuiThemeFont;
 extern unsigned int configDjuiScale;
+extern bool configDjuiBatchText;
+extern bool configDjuiCache;
 extern bool configExCoopTheme;
 
 #ifdef TARGET_WII_U
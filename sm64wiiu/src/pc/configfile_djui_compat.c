@@ -7,6 +7,7 @@ bool configShowPing = false;
 enum RefreshRateMode configFramerateMode = RRM_AUTO;
 unsigned int configFrameLimit = 60;
 unsigned int configInterpolationMode = 1;
+bool configFramePacerCsv = false;
 unsigned int configDrawDistance = 1;
 
 unsigned int configMasterVolume = 80;
@@ -15,6 +16,8 @@ unsigned int configSfxVolume = 127;
 unsigned int configEnvVolume = 127;
 bool configFadeoutDistantSounds = false;
 bool configMuteFocusLoss = false;
+bool configAudioFloatSynthesis = false;
+bool configAudioSampleDmaCache = false;
 
 unsigned int configStickDeadzone = 16;
 unsigned int configRumbleStrength = 50;
@@ -46,10 +49,15 @@ bool configCameraInvertY = true;
 bool configCameraToxicGas = true;
 
 bool configLuaProfiler = false;
+unsigned int configLuaProfilerSampleInterval = 0;
+unsigned int configLuaGcStepKb = 16;
+unsigned int configLuaGcBudgetUs = 1000;
 bool configDebugPrint = false;
 bool configDebugInfo = false;
 bool configDebugError = false;
 bool configCtxProfiler = false;
+bool configCtxTrace = false;
+bool configDiagDump = false;
 
 char configSaveNames[4][MAX_SAVE_NAME_STRING] = {
     "Mario A",
@@ -106,4 +114,6 @@ bool configDjuiThemeCenter = true;
 bool configDjuiThemeGradients = true;
 unsigned int configDjuiThemeFont = 0;
 unsigned int configDjuiScale = 0;
+bool configDjuiBatchText = true;
+bool configDjuiCache = true;
 bool configExCoopTheme = false;
@@ -5,6 +5,7 @@
 
 #include "controller_recorded_tas.h"
 #include "controller_keyboard.h"
+#include "pc/pc_bench.h"
 
 #if defined(_WIN32) || defined(_WIN64)
 #include "controller_xinput.h"
@@ -53,11 +54,17 @@ void osContGetReadData(OSContPad *pad) {
     pad->stick_y = 0;
     pad->errnum = 0;
 
+    // nothing live may leak into a benchmark run
+    if (pc_bench_read_input(pad)) {
+        return;
+    }
+
     for (size_t i = 0; i < sizeof(controller_implementations) / sizeof(struct ControllerAPI *); i++) {
         if (controller_implementations[i]->read) {
             controller_implementations[i]->read(pad);
         }
     }
+    controller_recorded_tas_capture(pad);
 }
 
 u32 controller_get_raw_key(void) {
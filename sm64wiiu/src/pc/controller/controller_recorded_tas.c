@@ -1,26 +1,330 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <ultra64.h>
 
-#include "controller_api.h"
+#include "controller_recorded_tas.h"
+#include "pc/fs/fs_persist.h"
 
-static FILE *fp;
+// .m64 layout: a 0x400-byte little-endian header, then per frame one 4-byte
+// sample per present controller (buttons big-endian, then stick x and y)
+#define M64_HEADER_SIZE      0x400
+#define M64_SAMPLE_SIZE      4
+#define M64_MAX_CONTROLLERS  4
+#define M64_VERSION          3
+#define M64_START_POWER_ON   2
+
+#define M64_OFS_VERSION      0x004
+#define M64_OFS_VI_COUNT     0x00C
+#define M64_OFS_FPS          0x014
+#define M64_OFS_CONTROLLERS  0x015
+#define M64_OFS_SAMPLES      0x018
+#define M64_OFS_START_TYPE   0x01C
+#define M64_OFS_CONT_FLAGS   0x020
+#define M64_OFS_ROM_NAME     0x0C4
+#define M64_OFS_AUTHOR       0x222
+
+static const u8 sM64Magic[4] = { 'M', '6', '4', 0x1A };
+
+// a recording goes to disk this often, in frames
+#define TAS_RECORD_FLUSH_FRAMES 60
+
+struct TasPlayback {
+    u8 *file;  // the whole movie, header included
+    u32 frames;
+    u8 controllers;
+    u32 frame; // next to play
+    bool loop;
+    u32 loopStart;
+};
+
+struct TasRecording {
+    char *vpath;
+    u8 *file;  // header space, then the samples so far
+    u32 frames;
+    u32 capacity;
+    u32 flushed;
+};
+
+static struct TasPlayback sPlayback = { 0 };
+static struct TasRecording sRecording = { 0 };
+
+static const char *sPlayPath = "cont.m64";
+static const char *sRecordPath = NULL;
+static u32 sStartFrame = 0;
+static bool sLoop = false;
+static u32 sLoopStart = 0;
+
+static u32 read_u32_le(const u8 *p) {
+    return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static void write_u32_le(u8 *p, u32 v) {
+    p[0] = (u8)v;
+    p[1] = (u8)(v >> 8);
+    p[2] = (u8)(v >> 16);
+    p[3] = (u8)(v >> 24);
+}
+
+static void decode_sample(const u8 *sample, OSContPad *pad) {
+    pad->button = (u16)((sample[0] << 8) | sample[1]);
+    pad->stick_x = (s8)sample[2];
+    pad->stick_y = (s8)sample[3];
+}
+
+  //////////////
+ // playback //
+//////////////
+
+void controller_recorded_tas_close(void) {
+    free(sPlayback.file);
+    memset(&sPlayback, 0, sizeof(sPlayback));
+}
+
+// checks the header against the data behind it; frames and controllers out
+static bool validate_movie(const char *path, const u8 *file, size_t size, u32 *frames, u8 *controllers) {
+    if (size < M64_HEADER_SIZE || memcmp(file, sM64Magic, sizeof(sM64Magic)) != 0) {
+        printf("tas: '%s' isn't an .m64 movie\n", path);
+        return false;
+    }
+    u32 version = read_u32_le(file + M64_OFS_VERSION);
+    if (version != M64_VERSION) {
+        printf("tas: '%s' is version %u, expected %d\n", path, version, M64_VERSION);
+        return false;
+    }
+
+    u8 count = file[M64_OFS_CONTROLLERS];
+    u32 flags = read_u32_le(file + M64_OFS_CONT_FLAGS) & 0xF;
+    if (count == 0 || count > M64_MAX_CONTROLLERS) {
+        printf("tas: '%s' claims %u controllers\n", path, count);
+        return false;
+    }
+    if ((u32)__builtin_popcount(flags) != count) {
+        printf("tas: '%s' has %u controllers but flags 0x%x; trusting the count\n", path, count, flags);
+    }
+
+    size_t frameSize = (size_t)count * M64_SAMPLE_SIZE;
+    size_t dataSize = size - M64_HEADER_SIZE;
+    u32 held = (u32)(dataSize / frameSize);
+    u32 claimed = read_u32_le(file + M64_OFS_SAMPLES);
+    if (dataSize % frameSize != 0) {
+        printf("tas: '%s' ends in a partial frame\n", path);
+    }
+    if (claimed != held) {
+        printf("tas: '%s' header says %u frames, file holds %u\n", path, claimed, held);
+    }
+
+    *frames = (claimed < held) ? claimed : held;
+    *controllers = count;
+    return true;
+}
+
+bool controller_recorded_tas_open(const char *path) {
+    controller_recorded_tas_close();
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    u8 *file = (size > 0) ? malloc((size_t)size) : NULL;
+    bool ok = file != NULL && fread(file, 1, (size_t)size, fp) == (size_t)size;
+    fclose(fp);
+
+    u32 frames = 0;
+    u8 controllers = 0;
+    if (!ok || !validate_movie(path, file, (size_t)size, &frames, &controllers)) {
+        free(file);
+        return false;
+    }
+
+    sPlayback.file = file;
+    sPlayback.frames = frames;
+    sPlayback.controllers = controllers;
+    printf("tas: playing '%s', %u frames for %u controllers\n", path, frames, controllers);
+    return true;
+}
+
+u32 controller_recorded_tas_frame_count(void) {
+    return sPlayback.frames;
+}
+
+u8 controller_recorded_tas_controller_count(void) {
+    return sPlayback.controllers;
+}
+
+u32 controller_recorded_tas_tell(void) {
+    return sPlayback.frame;
+}
+
+bool controller_recorded_tas_seek(u32 frame) {
+    if (sPlayback.file == NULL || frame > sPlayback.frames) {
+        return false;
+    }
+    sPlayback.frame = frame;
+    return true;
+}
+
+void controller_recorded_tas_set_loop(bool loop, u32 start) {
+    sPlayback.loop = loop;
+    sPlayback.loopStart = start;
+}
+
+bool controller_recorded_tas_peek(u8 port, OSContPad *pad) {
+    if (sPlayback.file == NULL || port >= sPlayback.controllers || sPlayback.frame >= sPlayback.frames) {
+        return false;
+    }
+    size_t index = (size_t)sPlayback.frame * sPlayback.controllers + port;
+    decode_sample(sPlayback.file + M64_HEADER_SIZE + index * M64_SAMPLE_SIZE, pad);
+    return true;
+}
+
+  ///////////////
+ // recording //
+///////////////
+
+static void recording_write(void) {
+    u8 *header = sRecording.file;
+    memset(header, 0, M64_HEADER_SIZE);
+    memcpy(header, sM64Magic, sizeof(sM64Magic));
+    write_u32_le(header + M64_OFS_VERSION, M64_VERSION);
+    // two VIs per game tick
+    write_u32_le(header + M64_OFS_VI_COUNT, sRecording.frames * 2);
+    header[M64_OFS_FPS] = 60;
+    header[M64_OFS_CONTROLLERS] = 1;
+    write_u32_le(header + M64_OFS_SAMPLES, sRecording.frames);
+    header[M64_OFS_START_TYPE] = M64_START_POWER_ON;
+    write_u32_le(header + M64_OFS_CONT_FLAGS, 1);
+    memcpy(header + M64_OFS_ROM_NAME, "SUPER MARIO 64", 14);
+    memcpy(header + M64_OFS_AUTHOR, "sm64wiiu", 8);
+
+    fs_persist_write(sRecording.vpath, sRecording.file, M64_HEADER_SIZE + (size_t)sRecording.frames * M64_SAMPLE_SIZE);
+    sRecording.flushed = sRecording.frames;
+}
+
+void controller_recorded_tas_stop_recording(void) {
+    if (sRecording.file == NULL) {
+        return;
+    }
+    recording_write();
+    printf("tas: recorded %u frames to '%s'\n", sRecording.frames, sRecording.vpath);
+    free(sRecording.file);
+    free(sRecording.vpath);
+    memset(&sRecording, 0, sizeof(sRecording));
+}
+
+bool controller_recorded_tas_record(const char *vpath) {
+    static bool sRegistered = false;
+    controller_recorded_tas_stop_recording();
+    controller_recorded_tas_close();
+
+    sRecording.capacity = M64_HEADER_SIZE + TAS_RECORD_FLUSH_FRAMES * 30 * M64_SAMPLE_SIZE;
+    sRecording.file = malloc(sRecording.capacity);
+    sRecording.vpath = strdup(vpath);
+    if (sRecording.file == NULL || sRecording.vpath == NULL) {
+        free(sRecording.file);
+        free(sRecording.vpath);
+        memset(&sRecording, 0, sizeof(sRecording));
+        return false;
+    }
+    if (!sRegistered) {
+        // runs before fs_persist_shutdown, which was registered earlier
+        atexit(controller_recorded_tas_stop_recording);
+        sRegistered = true;
+    }
+    printf("tas: recording to '%s'\n", vpath);
+    return true;
+}
+
+bool controller_recorded_tas_recording(void) {
+    return sRecording.file != NULL;
+}
+
+void controller_recorded_tas_capture(const OSContPad *pad) {
+    if (sRecording.file == NULL) {
+        return;
+    }
+    size_t used = M64_HEADER_SIZE + (size_t)sRecording.frames * M64_SAMPLE_SIZE;
+    if (used + M64_SAMPLE_SIZE > sRecording.capacity) {
+        u8 *grown = realloc(sRecording.file, sRecording.capacity * 2);
+        if (grown == NULL) {
+            return;
+        }
+        sRecording.file = grown;
+        sRecording.capacity *= 2;
+    }
+
+    u8 *sample = sRecording.file + used;
+    sample[0] = (u8)(pad->button >> 8);
+    sample[1] = (u8)pad->button;
+    sample[2] = (u8)pad->stick_x;
+    sample[3] = (u8)pad->stick_y;
+    sRecording.frames++;
+
+    // the writer thread does the disk work; this only copies the buffer
+    if (sRecording.frames - sRecording.flushed >= TAS_RECORD_FLUSH_FRAMES) {
+        recording_write();
+    }
+}
+
+  /////////
+ // api //
+/////////
+
+bool controller_recorded_tas_parse_args(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--tas-", 6) != 0) {
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "usage: %s [--tas-play <file.m64>] [--tas-start <frame>] [--tas-loop <frame>]\n"
+                            "       [--tas-record <file.m64>]\n", argv[0]);
+            return false;
+        }
+        const char *value = argv[++i];
+        if (!strcmp(arg, "--tas-play")) {
+            sPlayPath = value;
+        } else if (!strcmp(arg, "--tas-start")) {
+            sStartFrame = (u32)strtoul(value, NULL, 10);
+        } else if (!strcmp(arg, "--tas-loop")) {
+            sLoop = true;
+            sLoopStart = (u32)strtoul(value, NULL, 10);
+        } else if (!strcmp(arg, "--tas-record")) {
+            sRecordPath = value;
+        } else {
+            fprintf(stderr, "%s: unknown option '%s'\n", argv[0], arg);
+            return false;
+        }
+    }
+    return true;
+}
 
 static void tas_init(void) {
-    fp = fopen("cont.m64", "rb");
-    if (fp != NULL) {
-        uint8_t buf[0x400];
-        fread(buf, 1, sizeof(buf), fp);
+    if (sRecordPath != NULL) {
+        controller_recorded_tas_record(sRecordPath);
+        return;
+    }
+    if (controller_recorded_tas_open(sPlayPath)) {
+        controller_recorded_tas_set_loop(sLoop, sLoopStart);
+        controller_recorded_tas_seek(sStartFrame);
     }
 }
 
 static void tas_read(OSContPad *pad) {
-    if (fp != NULL) {
-        uint8_t bytes[4] = {0};
-        fread(bytes, 1, 4, fp);
-        pad->button = (bytes[0] << 8) | bytes[1];
-        pad->stick_x = bytes[2];
-        pad->stick_y = bytes[3];
+    if (sPlayback.file == NULL) {
+        return;
     }
+    if (sPlayback.frame >= sPlayback.frames) {
+        if (!sPlayback.loop || sPlayback.loopStart >= sPlayback.frames) {
+            return;
+        }
+        sPlayback.frame = sPlayback.loopStart;
+    }
+    controller_recorded_tas_peek(0, pad);
+    sPlayback.frame++;
 }
 
 static u32 tas_rawkey(void) {
@@ -28,10 +332,8 @@ static u32 tas_rawkey(void) {
 }
 
 static void tas_shutdown(void) {
-    if (fp != NULL) {
-        fclose(fp);
-        fp = NULL;
-    }
+    controller_recorded_tas_stop_recording();
+    controller_recorded_tas_close();
 }
 
 struct ControllerAPI controller_recorded_tas = {
@@ -1,8 +1,42 @@
 #ifndef CONTROLLER_RECORDED_TAS_H
 #define CONTROLLER_RECORDED_TAS_H
 
+#include <stdbool.h>
+
 #include "controller_api.h"
 
+// Plays and records Mupen64-style .m64 movies. A movie is loaded whole and
+// checked against its header, so reads never touch the disk; recordings go
+// out through fs_persist's writer thread.
+//
+//   --tas-play <file>      movie to play (default cont.m64, if present)
+//   --tas-start <frame>    first frame to play
+//   --tas-loop <frame>     after the last frame, continue from this one
+//   --tas-record <file>    record port 0 to a movie under the write path
+
 extern struct ControllerAPI controller_recorded_tas;
 
+// false on a malformed command line, after printing the usage
+bool controller_recorded_tas_parse_args(int argc, char *argv[]);
+
+// replaces the movie being played, from its first frame
+bool controller_recorded_tas_open(const char *path);
+void controller_recorded_tas_close(void);
+
+u32 controller_recorded_tas_frame_count(void);
+u8 controller_recorded_tas_controller_count(void);
+u32 controller_recorded_tas_tell(void);
+bool controller_recorded_tas_seek(u32 frame);
+void controller_recorded_tas_set_loop(bool loop, u32 start);
+
+// the current frame for any controller in the movie; the game reads port 0
+bool controller_recorded_tas_peek(u8 port, OSContPad *pad);
+
+// recording replaces playback; the movie is flushed every second and on stop
+bool controller_recorded_tas_record(const char *vpath);
+void controller_recorded_tas_stop_recording(void);
+bool controller_recorded_tas_recording(void);
+// once per tick with the merged pad the game is about to see
+void controller_recorded_tas_capture(const OSContPad *pad);
+
 #endif
@@ -1,37 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+
 #include "debug_context.h"
+#include "configfile.h"
+#include "thread.h"
+#include "fs/fs.h"
+#include "utils/misc.h"
+
+// threads beyond this many go untimed
+#define DEBUG_CONTEXT_MAX_THREADS 4
+// per thread, a power of two; 16 bytes each
+#define DEBUG_CONTEXT_TRACE_EVENTS (1 << 16)
+// deepest nesting the trace export balances
+#define DEBUG_CONTEXT_MAX_DEPTH 64
+
+static const char* sDebugContextNames[CTX_MAX] = {
+    "NONE",
+    "TOTAL",
+    "NET",
+    "INTERP",
+    "GAME",
+    "SMLUA",
+    "AUDIO",
+    "RENDER",
+    "LEVEL",
+    "HOOK",
+    "LIGHTING",
+    "OBJECTS",
+    "COLLISION",
+};
+
+struct DebugContextEvent {
+    f64 time;
+    u8 ctx;
+    bool end;
+};
+
+struct DebugContextThread {
+    uintptr_t id; // 0 while the slot is free
+    const char* name;
+    u32 depth[CTX_MAX];
+    f64 start[CTX_MAX];
+    f64 time[CTX_MAX];
+    struct DebugContextEvent* events; // allocated the first time ctx_trace sees the thread
+    u32 eventCount; // ever written; the ring holds the last DEBUG_CONTEXT_TRACE_EVENTS
+};
+
+static struct DebugContextThread sThreads[DEBUG_CONTEXT_MAX_THREADS] = { 0 };
 
-static u32 sCtxDepth[CTX_MAX] = { 0 };
-static f64 sCtxTime[CTX_MAX] = { 0 };
+static struct DebugContextThread* debug_context_thread(void) {
+    uintptr_t id = current_thread_id();
+    for (u32 i = 0; i < DEBUG_CONTEXT_MAX_THREADS; i++) {
+        if (__atomic_load_n(&sThreads[i].id, __ATOMIC_ACQUIRE) == id) {
+            return &sThreads[i];
+        }
+    }
+    for (u32 i = 0; i < DEBUG_CONTEXT_MAX_THREADS; i++) {
+        uintptr_t expected = 0;
+        if (__atomic_compare_exchange_n(&sThreads[i].id, &expected, id, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return &sThreads[i];
+        }
+    }
+    return NULL;
+}
+
+static bool debug_context_enabled(enum DebugContext ctx) {
+    return ctx > CTX_NONE && ctx < CTX_MAX && (configCtxProfiler || configCtxTrace);
+}
+
+static void debug_context_log(struct DebugContextThread* thread, enum DebugContext ctx, bool end, f64 time) {
+    if (!configCtxTrace) { return; }
+    if (thread->events == NULL) {
+        thread->events = malloc(DEBUG_CONTEXT_TRACE_EVENTS * sizeof(struct DebugContextEvent));
+        if (thread->events == NULL) { return; }
+    }
+    u32 count = thread->eventCount;
+    struct DebugContextEvent* event = &thread->events[count & (DEBUG_CONTEXT_TRACE_EVENTS - 1)];
+    event->time = time;
+    event->ctx = (u8)ctx;
+    event->end = end;
+    __atomic_store_n(&thread->eventCount, count + 1, __ATOMIC_RELEASE);
+}
 
 void debug_context_begin(enum DebugContext ctx) {
-    if (ctx > CTX_NONE && ctx < CTX_MAX) {
-        sCtxDepth[ctx]++;
+    if (!debug_context_enabled(ctx)) { return; }
+    struct DebugContextThread* thread = debug_context_thread();
+    if (thread == NULL) { return; }
+
+    f64 now = clock_elapsed_f64();
+    if (thread->depth[ctx]++ == 0) {
+        thread->start[ctx] = now;
     }
+    debug_context_log(thread, ctx, false, now);
 }
 
 void debug_context_end(enum DebugContext ctx) {
-    if (ctx > CTX_NONE && ctx < CTX_MAX && sCtxDepth[ctx] > 0) {
-        sCtxDepth[ctx]--;
+    if (!debug_context_enabled(ctx)) { return; }
+    struct DebugContextThread* thread = debug_context_thread();
+    if (thread == NULL || thread->depth[ctx] == 0) { return; }
+
+    f64 now = clock_elapsed_f64();
+    if (--thread->depth[ctx] == 0) {
+        thread->time[ctx] += now - thread->start[ctx];
     }
+    debug_context_log(thread, ctx, true, now);
 }
 
 void debug_context_reset(void) {
+    struct DebugContextThread* thread = debug_context_thread();
+    if (thread == NULL) { return; }
     for (u32 i = 0; i < CTX_MAX; i++) {
-        sCtxDepth[i] = 0;
-        sCtxTime[i] = 0.0;
+        thread->depth[i] = 0;
+        thread->time[i] = 0.0;
     }
 }
 
 bool debug_context_within(enum DebugContext ctx) {
-    if (ctx <= CTX_NONE || ctx >= CTX_MAX) {
-        return false;
-    }
-    return sCtxDepth[ctx] > 0;
+    if (!debug_context_enabled(ctx)) { return false; }
+    struct DebugContextThread* thread = debug_context_thread();
+    return thread != NULL && thread->depth[ctx] > 0;
 }
 
 void debug_context_set_time(enum DebugContext ctx, f64 time) {
-    if (ctx > CTX_NONE && ctx < CTX_MAX) {
-        sCtxTime[ctx] = time;
+    if (ctx <= CTX_NONE || ctx >= CTX_MAX) { return; }
+    struct DebugContextThread* thread = debug_context_thread();
+    if (thread != NULL) {
+        thread->time[ctx] = time;
     }
 }
 
@@ -39,5 +133,98 @@ f64 debug_context_get_time(enum DebugContext ctx) {
     if (ctx <= CTX_NONE || ctx >= CTX_MAX) {
         return 0.0;
     }
-    return sCtxTime[ctx];
+    struct DebugContextThread* thread = debug_context_thread();
+    return (thread != NULL) ? thread->time[ctx] : 0.0;
+}
+
+const char* debug_context_get_name(enum DebugContext ctx) {
+    if (ctx < CTX_NONE || ctx >= CTX_MAX) {
+        return "OTHER";
+    }
+    return sDebugContextNames[ctx];
+}
+
+void debug_context_set_thread_name(const char* name) {
+    struct DebugContextThread* thread = debug_context_thread();
+    if (thread != NULL) {
+        thread->name = name;
+    }
+}
+
+  ///////////
+ // trace //
+///////////
+
+static void debug_context_write_event(FILE* file, bool* first, const char* name, char phase, f64 time, u32 tid) {
+    fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}", *first ? "" : ",\n",
+            name, phase, time * 1000000.0, tid);
+    *first = false;
+}
+
+static u32 debug_context_write_thread(FILE* file, bool* first, struct DebugContextThread* thread, u32 tid) {
+    fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+            *first ? "" : ",\n", tid, (thread->name != NULL) ? thread->name : "thread");
+    *first = false;
+    if (thread->events == NULL) { return 0; }
+
+    u32 count = __atomic_load_n(&thread->eventCount, __ATOMIC_ACQUIRE);
+    u32 available = (count < DEBUG_CONTEXT_TRACE_EVENTS) ? count : DEBUG_CONTEXT_TRACE_EVENTS;
+
+    // the ring may start inside zones whose begins were overwritten: drop
+    // ends that don't match an open zone, and close what's left open
+    u8 stack[DEBUG_CONTEXT_MAX_DEPTH];
+    u32 depth = 0;
+    u32 written = 0;
+    f64 last = 0.0;
+    for (u32 i = count - available; i != count; i++) {
+        struct DebugContextEvent* event = &thread->events[i & (DEBUG_CONTEXT_TRACE_EVENTS - 1)];
+        if (event->end) {
+            if (depth == 0 || stack[depth - 1] != event->ctx) { continue; }
+            depth--;
+        } else {
+            if (depth == DEBUG_CONTEXT_MAX_DEPTH) { continue; }
+            stack[depth++] = event->ctx;
+        }
+        debug_context_write_event(file, first, sDebugContextNames[event->ctx], event->end ? 'E' : 'B', event->time, tid);
+        last = event->time;
+        written++;
+    }
+    while (depth > 0) {
+        debug_context_write_event(file, first, sDebugContextNames[stack[--depth]], 'E', last, tid);
+        written++;
+    }
+    return written;
+}
+
+bool debug_context_write_trace(void) {
+    const char* path = fs_get_write_path("ctx_trace.json");
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        printf("ctx: failed to open '%s'\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    u32 written = 0;
+    for (u32 i = 0; i < DEBUG_CONTEXT_MAX_THREADS; i++) {
+        if (__atomic_load_n(&sThreads[i].id, __ATOMIC_ACQUIRE) != 0) {
+            written += debug_context_write_thread(file, &first, &sThreads[i], i);
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(file);
+
+    printf("ctx: wrote %u trace events to '%s'\n", written, path);
+    return true;
+}
+
+void debug_context_shutdown(void) {
+    if (configCtxTrace) {
+        debug_context_write_trace();
+    }
+    for (u32 i = 0; i < DEBUG_CONTEXT_MAX_THREADS; i++) {
+        free(sThreads[i].events);
+        sThreads[i].events = NULL;
+    }
 }
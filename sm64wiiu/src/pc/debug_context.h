@@ -4,6 +4,16 @@
 #include <PR/ultratypes.h>
 #include <stdbool.h>
 
+// Timing zones. A context begun and ended on the same thread is a zone; zones
+// nest freely, and a context re-entered inside itself only counts the
+// outermost span. Nothing is measured unless the context profiler display or
+// ctx_trace is on; with both off a zone is a call and a branch.
+//
+// The main thread's per-frame totals feed the context profiler display. With
+// ctx_trace on, every thread also logs its zone begins and ends into a ring
+// buffer of its own, and debug_context_write_trace() turns the most recent
+// events into a Chrome trace (chrome://tracing, Perfetto) under the write path.
+
 #define CTX_BEGIN(_ctx) debug_context_begin(_ctx)
 #define CTX_END(_ctx) debug_context_end(_ctx)
 #define CTX_WITHIN(_ctx) debug_context_within(_ctx)
@@ -22,14 +32,24 @@ enum DebugContext {
     CTX_LEVEL_SCRIPT,
     CTX_HOOK,
     CTX_LIGHTING,
+    CTX_OBJECTS,
+    CTX_COLLISION, // timed in BENCHMARK builds only
     CTX_MAX,
 };
 
 void debug_context_begin(enum DebugContext ctx);
 void debug_context_end(enum DebugContext ctx);
+// starts the calling thread's next frame of totals
 void debug_context_reset(void);
 bool debug_context_within(enum DebugContext ctx);
 void debug_context_set_time(enum DebugContext ctx, f64 time);
 f64 debug_context_get_time(enum DebugContext ctx);
+const char* debug_context_get_name(enum DebugContext ctx);
+
+// names the calling thread in traces
+void debug_context_set_thread_name(const char* name);
+// ctx_trace.json; call with the other traced threads stopped or idle
+bool debug_context_write_trace(void);
+void debug_context_shutdown(void);
 
 #endif
@@ -1,4 +1,5 @@
 #include "djui.h"
+#include "djui_cache.h"
 #include "djui_donor.h"
 #include "djui_hud_utils.h"
 
@@ -1025,6 +1026,7 @@ void djui_reset_hud_params(void) {
 
 void djui_hud_begin_frame(void) {
     gDjuiHudUtilsZ = 0.0f;
+    djui_cache_update();
 }
 
 void djui_init(void) {
@@ -1,5 +1,6 @@
 #include <string.h>
 #include "djui.h"
+#include "djui_cache.h"
 #include "djui_interactable.h"
 
   ////////////////
@@ -287,15 +288,7 @@ static void djui_base_render_border(struct DjuiBase* base) {
  // events //
 ////////////
 
-bool djui_base_render(struct DjuiBase* base) {
-    if (!base->visible) { return false; }
-
-    if (base->on_render_pre != NULL) {
-        bool skipRender = false;
-        base->on_render_pre(base, &skipRender);
-        if (skipRender) { return false; }
-    }
-
+static bool djui_base_render_live(struct DjuiBase* base) {
     struct DjuiBaseRect* comp = &base->comp;
     struct DjuiBaseRect* clip = &base->clip;
 
@@ -337,6 +330,29 @@ bool djui_base_render(struct DjuiBase* base) {
     return true;
 }
 
+bool djui_base_render(struct DjuiBase* base) {
+    if (!base->visible) { return false; }
+
+    if (base->on_render_pre != NULL) {
+        bool skipRender = false;
+        base->on_render_pre(base, &skipRender);
+        if (skipRender) { return false; }
+    }
+
+    // a replay leaves elem/comp/clip as the recording computed them, which
+    // the signature guarantees are still right for hover checks
+    switch (djui_cache_begin_base(base)) {
+        case DJUI_CACHE_REPLAYED:
+            return base->cacheRendered;
+        case DJUI_CACHE_RECORDING:
+            base->cacheRendered = djui_base_render_live(base);
+            djui_cache_end(base->cache, true);
+            return base->cacheRendered;
+        default:
+            return djui_base_render_live(base);
+    }
+}
+
 void djui_base_destroy(struct DjuiBase* base) {
     // remove hovered status
     if (gDjuiHovered == base) {
@@ -403,6 +419,10 @@ void djui_base_destroy(struct DjuiBase* base) {
     if (base == gInteractableBinding)   { gInteractableBinding = NULL; }
     if (base == gInteractableMouseDown) { gInteractableMouseDown = NULL; }
 
+    // the frame being built may still replay its recording
+    djui_cache_entry_release(base->cache);
+    base->cache = NULL;
+
     // destroy this
     base->destroy(base);
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include "djui.h"
 
+struct DjuiCacheEntry;
+
 struct DjuiBaseRect {
     f32 x;
     f32 y;
@@ -44,11 +46,18 @@ struct DjuiBase {
     bool gradient;
     s64 tag;
     bool bTag;
+    struct DjuiCacheEntry* cache;
+    u64 cacheHash;
+    bool cacheable;
+    bool cacheRendered;
     void (*get_cursor_hover_location)(struct DjuiBase*, f32* x, f32* y);
     void (*on_child_render)(struct DjuiBase*, struct DjuiBase*);
     void (*on_render_pre)(struct DjuiBase*, bool*);
     bool (*render)(struct DjuiBase*);
     void (*destroy)(struct DjuiBase*);
+    // mixes in whatever render/on_child_render draw from beyond DjuiBase;
+    // elements without one are never cached
+    void (*cache_hash)(struct DjuiBase*, u64* hash);
 };
 
 void djui_base_set_visible(struct DjuiBase* base, bool visible);
@@ -0,0 +1,327 @@
+#include <string.h>
+#include "djui.h"
+#include "djui_cache.h"
+#include "game/game_init.h"
+#include "game/memory.h"
+#include "pc/configfile.h"
+
+// entries not drawn for this many frames give their memory back
+#define DJUI_CACHE_EVICT_FRAMES 120
+// commands in a recording's first chunk; alloc_next_dl() chains more
+#define DJUI_CACHE_FIRST_CHUNK 64
+
+static struct DjuiCacheEntry* sEntries = NULL;
+static u32 sEntryCount = 0;
+static u32 sLastUpdate = 0;
+static struct DjuiCacheStats sFrameStats = { 0 };
+static struct DjuiCacheStats sLastStats = { 0 };
+
+#ifdef USE_SYSTEM_MALLOC
+static struct DjuiCacheEntry* sRecording = NULL;
+static struct AllocOnlyPool* sSavedPool = NULL;
+static Gfx* sSavedHead = NULL;
+static Gfx* sSavedEnd = NULL;
+#endif
+
+  //////////
+ // hash //
+//////////
+
+void djui_cache_hash_u64(u64* hash, u64 value) {
+    u64 h = (*hash ^ value) * 0x9E3779B97F4A7C15ULL;
+    *hash = h ^ (h >> 29);
+}
+
+void djui_cache_hash_f32(u64* hash, f32 value) {
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    djui_cache_hash_u64(hash, bits);
+}
+
+void djui_cache_hash_string(u64* hash, const char* str) {
+    // FNV-1a, folded in with the length so "" and NULL differ
+    u64 h = 0xcbf29ce484222325ULL;
+    u64 len = 0;
+    if (str != NULL) {
+        for (const char* c = str; *c != '\0'; c++) {
+            h = (h ^ (u8)*c) * 0x100000001b3ULL;
+            len++;
+        }
+    }
+    djui_cache_hash_u64(hash, h);
+    djui_cache_hash_u64(hash, (str != NULL) ? len : ~0ULL);
+}
+
+u64 djui_cache_screen_signature(void) {
+    u32 windowWidth, windowHeight;
+    gfx_get_dimensions(&windowWidth, &windowHeight);
+    u64 hash = 0;
+    djui_cache_hash_u64(&hash, ((u64)windowWidth << 32) | windowHeight);
+    djui_cache_hash_f32(&hash, djui_gfx_get_scale());
+    djui_cache_hash_u64(&hash, configDjuiBatchText);
+    return hash;
+}
+
+  /////////////
+ // entries //
+/////////////
+
+struct DjuiCacheEntry* djui_cache_entry_create(size_t size, void* owner, void (*on_evict)(struct DjuiCacheEntry*)) {
+    struct DjuiCacheEntry* entry = calloc(1, size);
+    if (entry == NULL) { return NULL; }
+    entry->owner = owner;
+    entry->on_evict = on_evict;
+    entry->lastFrame = gGlobalTimer - 1;
+    entry->next = sEntries;
+    sEntries = entry;
+    sEntryCount++;
+    return entry;
+}
+
+void djui_cache_entry_release(struct DjuiCacheEntry* entry) {
+    if (entry == NULL) { return; }
+    entry->released = true;
+    entry->owner = NULL;
+}
+
+static void djui_cache_entry_free(struct DjuiCacheEntry* entry) {
+#ifdef USE_SYSTEM_MALLOC
+    if (entry->pool != NULL) {
+        alloc_only_pool_destroy(entry->pool);
+    }
+#endif
+    free(entry);
+}
+
+void djui_cache_update(void) {
+    if (sLastUpdate == gGlobalTimer) { return; }
+    sLastUpdate = gGlobalTimer;
+
+    sLastStats = sFrameStats;
+    sLastStats.entries = sEntryCount;
+    memset(&sFrameStats, 0, sizeof(sFrameStats));
+
+    struct DjuiCacheEntry** link = &sEntries;
+    while (*link != NULL) {
+        struct DjuiCacheEntry* entry = *link;
+        bool drawnThisFrame = (entry->lastFrame == gGlobalTimer);
+        bool stale = (gGlobalTimer - entry->lastFrame) > DJUI_CACHE_EVICT_FRAMES;
+        if (drawnThisFrame || (!entry->released && !stale)) {
+            link = &entry->next;
+            continue;
+        }
+        *link = entry->next;
+        sEntryCount--;
+        if (!entry->released && entry->on_evict != NULL) {
+            entry->on_evict(entry);
+        }
+        djui_cache_entry_free(entry);
+    }
+}
+
+void djui_cache_get_stats(struct DjuiCacheStats* out) {
+    *out = sLastStats;
+}
+
+  ///////////////
+ // recording //
+///////////////
+
+bool djui_cache_is_recording(void) {
+#ifdef USE_SYSTEM_MALLOC
+    return sRecording != NULL;
+#else
+    return false;
+#endif
+}
+
+enum DjuiCacheResult djui_cache_begin(struct DjuiCacheEntry* entry, u64 signature) {
+#ifdef USE_SYSTEM_MALLOC
+    // nested recordings would point at lists their parent outlives, and an
+    // entry drawn twice in a frame can't be rewritten under the first draw
+    if (!configDjuiCache || entry == NULL || sRecording != NULL || entry->lastFrame == gGlobalTimer) {
+        sFrameStats.live++;
+        return DJUI_CACHE_LIVE;
+    }
+    entry->lastFrame = gGlobalTimer;
+
+    if (entry->displayList != NULL && entry->signature == signature) {
+        gSPDisplayList(gDisplayListHead++, entry->displayList);
+        sFrameStats.replayed++;
+        return DJUI_CACHE_REPLAYED;
+    }
+
+    // still changing: wait for it to settle before paying for a recording
+    bool settled = (entry->lastSignature == signature);
+    entry->lastSignature = signature;
+    if (!settled) {
+        entry->churn++;
+        sFrameStats.live++;
+        return DJUI_CACHE_LIVE;
+    }
+    entry->churn = 0;
+
+    if (entry->pool == NULL) {
+        entry->pool = alloc_only_pool_create();
+    } else {
+        alloc_only_pool_clear(entry->pool);
+    }
+    Gfx* start = alloc_only_pool_alloc(entry->pool, DJUI_CACHE_FIRST_CHUNK * sizeof(Gfx));
+
+    // everything drawn from here on, matrices and vertices included, lands
+    // in the entry's pool
+    sSavedPool = gGfxAllocOnlyPool;
+    sSavedHead = gDisplayListHeadInChunk;
+    sSavedEnd = gDisplayListEndInChunk;
+    gGfxAllocOnlyPool = entry->pool;
+    gDisplayListHeadInChunk = start;
+    gDisplayListEndInChunk = start + DJUI_CACHE_FIRST_CHUNK;
+
+    entry->displayList = start;
+    entry->signature = 0;
+    entry->pendingSignature = signature;
+    sRecording = entry;
+    sFrameStats.recorded++;
+    return DJUI_CACHE_RECORDING;
+#else
+    (void)entry;
+    (void)signature;
+    sFrameStats.live++;
+    return DJUI_CACHE_LIVE;
+#endif
+}
+
+void djui_cache_end(struct DjuiCacheEntry* entry, bool keep) {
+#ifdef USE_SYSTEM_MALLOC
+    if (entry == NULL || sRecording != entry) { return; }
+    gSPEndDisplayList(gDisplayListHead++);
+
+    gGfxAllocOnlyPool = sSavedPool;
+    gDisplayListHeadInChunk = sSavedHead;
+    gDisplayListEndInChunk = sSavedEnd;
+    sRecording = NULL;
+
+    gSPDisplayList(gDisplayListHead++, entry->displayList);
+    if (keep) {
+        entry->signature = entry->pendingSignature;
+    } else {
+        // draws this frame, never replays
+        entry->signature = 0;
+        entry->lastSignature = 0;
+        entry->displayList = NULL;
+    }
+#else
+    (void)entry;
+    (void)keep;
+#endif
+}
+
+  //////////
+ // djui //
+//////////
+
+static void djui_cache_hash_screen_value(u64* hash, struct DjuiScreenValue* value) {
+    djui_cache_hash_u64(hash, value->type);
+    djui_cache_hash_f32(hash, value->value);
+}
+
+static void djui_cache_hash_color(u64* hash, struct DjuiColor* color) {
+    djui_cache_hash_u64(hash, ((u32)color->r << 24) | ((u32)color->g << 16) | ((u32)color->b << 8) | color->a);
+}
+
+static void djui_cache_hash_rect(u64* hash, struct DjuiBaseRect* rect) {
+    djui_cache_hash_f32(hash, rect->x);
+    djui_cache_hash_f32(hash, rect->y);
+    djui_cache_hash_f32(hash, rect->width);
+    djui_cache_hash_f32(hash, rect->height);
+}
+
+static void djui_cache_hash_fields(u64* hash, struct DjuiBase* base) {
+    djui_cache_hash_u64(hash, (u64)(uintptr_t)base->render);
+    djui_cache_hash_u64(hash, (u64)(uintptr_t)base->on_child_render);
+    djui_cache_hash_screen_value(hash, &base->x);
+    djui_cache_hash_screen_value(hash, &base->y);
+    djui_cache_hash_screen_value(hash, &base->width);
+    djui_cache_hash_screen_value(hash, &base->height);
+    djui_cache_hash_color(hash, &base->color);
+    djui_cache_hash_screen_value(hash, &base->borderWidth);
+    djui_cache_hash_color(hash, &base->borderColor);
+    djui_cache_hash_screen_value(hash, &base->padding.top);
+    djui_cache_hash_screen_value(hash, &base->padding.right);
+    djui_cache_hash_screen_value(hash, &base->padding.bottom);
+    djui_cache_hash_screen_value(hash, &base->padding.left);
+    djui_cache_hash_u64(hash, ((u64)base->hAlign << 8) | base->vAlign);
+    djui_cache_hash_u64(hash, ((u64)base->gradient << 1) | base->abandonAfterChildRenderFail);
+    if (base->cache_hash != NULL) {
+        base->cache_hash(base, hash);
+    }
+}
+
+// A subtree can be cached when every node in it draws only from its own
+// fields: no on_render_pre, and a cache_hash for any render or
+// on_child_render callback to cover the element's extra state.
+static bool djui_cache_prepare_node(struct DjuiBase* base) {
+    u64 hash = 0;
+    djui_cache_hash_u64(&hash, base->visible);
+    if (!base->visible) {
+        // its parent can record it not being drawn, but its own subtree
+        // wasn't looked at
+        base->cacheHash = hash;
+        base->cacheable = false;
+        return true;
+    }
+
+    bool cacheable = (base->on_render_pre == NULL)
+                  && (base->render == NULL || base->cache_hash != NULL)
+                  && (base->on_child_render == NULL || base->cache_hash != NULL);
+    djui_cache_hash_fields(&hash, base);
+
+    for (struct DjuiBaseChild* child = base->child; child != NULL; child = child->next) {
+        cacheable = djui_cache_prepare_node(child->base) && cacheable;
+        djui_cache_hash_u64(&hash, child->base->cacheHash);
+    }
+
+    base->cacheHash = hash;
+    base->cacheable = cacheable;
+    return cacheable;
+}
+
+void djui_cache_prepare(struct DjuiBase* root) {
+    if (root == NULL || !configDjuiCache) { return; }
+    djui_cache_prepare_node(root);
+}
+
+static void djui_cache_on_base_evict(struct DjuiCacheEntry* entry) {
+    struct DjuiBase* base = entry->owner;
+    if (base != NULL) { base->cache = NULL; }
+}
+
+enum DjuiCacheResult djui_cache_begin_base(struct DjuiBase* base) {
+    if (!configDjuiCache || !base->cacheable || djui_cache_is_recording()) {
+        return DJUI_CACHE_LIVE;
+    }
+
+    // a parent that is about to record covers its children; only one that
+    // keeps changing leaves them to cache on their own
+    struct DjuiBase* parent = base->parent;
+    if (parent != NULL && parent->cacheable && parent->cache != NULL
+        && parent->cache->lastFrame == gGlobalTimer && parent->cache->churn < 2) {
+        return DJUI_CACHE_LIVE;
+    }
+
+    if (base->cache == NULL) {
+        base->cache = djui_cache_entry_create(sizeof(struct DjuiCacheEntry), base, djui_cache_on_base_evict);
+    }
+
+    // a parent's render may have moved or resized the node since
+    // djui_cache_prepare (three panels size their children), and where the
+    // parent left off decides where the subtree lands
+    u64 signature = djui_cache_screen_signature();
+    djui_cache_hash_u64(&signature, base->cacheHash);
+    djui_cache_hash_fields(&signature, base);
+    if (parent != NULL) {
+        djui_cache_hash_rect(&signature, &parent->comp);
+        djui_cache_hash_rect(&signature, &parent->clip);
+    }
+    return djui_cache_begin(base->cache, signature);
+}
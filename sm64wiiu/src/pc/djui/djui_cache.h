@@ -0,0 +1,64 @@
+#pragma once
+#include "djui.h"
+
+// Retained display lists. A DJUI subtree or a Lua HUD block is recorded into
+// a pool of its own (Gfx, matrices and vertices alike) and replayed with one
+// gSPDisplayList for as long as the signature of everything it was built
+// from stays the same. A changed signature draws live that frame and records
+// again once it holds still for a frame, so animations don't re-record every
+// frame. Nothing is recorded inside another recording, and an entry is only
+// drawn once per frame, so a list is never rewritten while the frame being
+// built still points at it.
+
+enum DjuiCacheResult {
+    DJUI_CACHE_LIVE,      // draw as usual
+    DJUI_CACHE_REPLAYED,  // the recording went out, skip drawing
+    DJUI_CACHE_RECORDING, // draw as usual, then djui_cache_end()
+};
+
+struct DjuiCacheEntry {
+    struct DjuiCacheEntry* next;
+    struct AllocOnlyPool* pool;
+    Gfx* displayList;   // NULL until something is recorded
+    u64 signature;      // of the recording
+    u64 lastSignature;  // seen the last time the entry was used
+    u64 pendingSignature;
+    u32 lastFrame;
+    u32 churn;          // uses in a row that saw a new signature
+    bool released;
+    void* owner;
+    void (*on_evict)(struct DjuiCacheEntry*);
+};
+
+struct DjuiCacheStats {
+    u32 entries;
+    u32 replayed;
+    u32 recorded;
+    u32 live;
+};
+
+void djui_cache_hash_u64(u64* hash, u64 value);
+void djui_cache_hash_f32(u64* hash, f32 value);
+void djui_cache_hash_string(u64* hash, const char* str);
+
+// `size` is at least sizeof(struct DjuiCacheEntry), for users that embed it
+struct DjuiCacheEntry* djui_cache_entry_create(size_t size, void* owner, void (*on_evict)(struct DjuiCacheEntry*));
+// frees the entry once the frame that last drew it is done with it
+void djui_cache_entry_release(struct DjuiCacheEntry* entry);
+
+enum DjuiCacheResult djui_cache_begin(struct DjuiCacheEntry* entry, u64 signature);
+// `keep` false drops the recording after this frame, e.g. when a Lua error
+// cut it short
+void djui_cache_end(struct DjuiCacheEntry* entry, bool keep);
+bool djui_cache_is_recording(void);
+
+// what every recording depends on: window size, DJUI scale and text batching
+u64 djui_cache_screen_signature(void);
+
+// hashes the inputs of every subtree under `root`; call before rendering it
+void djui_cache_prepare(struct DjuiBase* root);
+enum DjuiCacheResult djui_cache_begin_base(struct DjuiBase* base);
+
+// frees released entries and ones unused for a while, once per frame
+void djui_cache_update(void);
+void djui_cache_get_stats(struct DjuiCacheStats* out);
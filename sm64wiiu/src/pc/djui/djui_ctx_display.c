@@ -5,26 +5,6 @@
 #include "pc/pc_main.h"
 #include "pc/debug_context.h"
 
-#ifdef DEVELOPMENT
-
-static char* sDebugContextNames[] = {
-    "NONE",
-    "TOTAL",
-    "NET",
-    "INTERP",
-    "GAME",
-    "SMLUA",
-    "AUDIO",
-    "RENDER",
-    "LEVEL",
-    "HOOK",
-    "LIGHTING",
-    "OTHER",
-    "MAX",
-};
-
-#endif
-
 struct DjuiCtxEntry {
     struct DjuiText *name;
     struct DjuiText *timing;
@@ -66,8 +46,7 @@ void djui_ctx_display_update(void) {
     for (s32 i = CTX_TOTAL; i < CTX_MAX; i++) {
         struct DjuiCtxEntry *entry = &sCtxDisplay->entries[i];
 
-        const char *name = sDebugContextNames[i];
-        djui_text_set_text(entry->name, name);
+        djui_text_set_text(entry->name, debug_context_get_name(i));
 
         // The timing is in microseconds.
         s32 counterMs = (s32)(debug_context_get_time(i) * 1000000.0);
@@ -13,6 +13,7 @@
 #include "game/print.h"
 #include "game/segment2.h"
 #include "game/sound_init.h"
+#include "djui_cache.h"
 #include "djui_cursor.h"
 #include "djui_ctx_display.h"
 #include "djui_fps_display.h"
@@ -360,7 +361,9 @@ void djui_donor_render(void) {
     djui_reset_hud_params();
     djui_panel_update();
     djui_lua_profiler_render();
+    djui_cache_update();
     if (gDjuiRoot != NULL) {
+        djui_cache_prepare(&gDjuiRoot->base);
         djui_base_render(&gDjuiRoot->base);
     }
     djui_fps_display_render();
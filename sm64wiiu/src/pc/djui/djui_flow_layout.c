@@ -1,4 +1,5 @@
 #include "djui.h"
+#include "djui_cache.h"
 
   ////////////////
  // properties //
@@ -41,6 +42,13 @@ static void djui_flow_layout_on_child_render(struct DjuiBase* base, struct DjuiB
     }
 }
 
+static void djui_flow_layout_cache_hash(struct DjuiBase* base, u64* hash) {
+    struct DjuiFlowLayout* layout = (struct DjuiFlowLayout*)base;
+    djui_cache_hash_u64(hash, layout->flowDirection);
+    djui_cache_hash_u64(hash, layout->margin.type);
+    djui_cache_hash_f32(hash, layout->margin.value);
+}
+
 static void djui_flow_layout_destroy(struct DjuiBase* base) {
     struct DjuiFlowLayout* layout = (struct DjuiFlowLayout*)base;
     free(layout);
@@ -57,5 +65,6 @@ struct DjuiFlowLayout* djui_flow_layout_create(struct DjuiBase* parent) {
     djui_flow_layout_set_margin(layout, 8);
 
     layout->base.on_child_render = djui_flow_layout_on_child_render;
+    layout->base.cache_hash = djui_flow_layout_cache_hash;
     return layout;
 }
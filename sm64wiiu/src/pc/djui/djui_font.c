@@ -7,9 +7,9 @@
  // font 0 (built-in normal font) //
 ///////////////////////////////////
 
-static void djui_font_normal_render_char(char* c) {
+static bool djui_font_normal_glyph(char* c, struct DjuiGfxGlyph* glyph) {
     // replace undisplayable characters
-    if (*c == ' ') { return; }
+    if (*c == ' ') { return false; }
 
     u32 index = djui_unicode_get_sprite_index(c);
 
@@ -18,12 +18,20 @@ static void djui_font_normal_render_char(char* c) {
         u32 tx = index % 64;
         u32 ty = index / 64;
         extern ALIGNED8 const Texture texture_font_jp[];
-        djui_gfx_render_texture_tile(texture_font_jp, 512, 1024, G_IM_FMT_RGBA, G_IM_SIZ_32b, tx * 8, ty * 16, 8, 16, false, true);
+        *glyph = (struct DjuiGfxGlyph) { texture_font_jp, 512, 1024, G_IM_SIZ_32b, tx * 8, ty * 16, 8, 16 };
     } else {
         u32 tx = index % 32;
         u32 ty = index / 32;
         extern ALIGNED8 const Texture texture_font_normal[];
-        djui_gfx_render_texture_tile(texture_font_normal, 256, 128, G_IM_FMT_RGBA, G_IM_SIZ_32b, tx * 8, ty * 16, 8, 16, false, true);
+        *glyph = (struct DjuiGfxGlyph) { texture_font_normal, 256, 128, G_IM_SIZ_32b, tx * 8, ty * 16, 8, 16 };
+    }
+    return true;
+}
+
+static void djui_font_normal_render_char(char* c) {
+    struct DjuiGfxGlyph glyph;
+    if (djui_font_normal_glyph(c, &glyph)) {
+        djui_gfx_render_glyph(&glyph);
     }
 }
 
@@ -42,6 +50,7 @@ static const struct DjuiFont sDjuiFontNormal = {
     .defaultFontScale     = 32.0f,
     .textBeginDisplayList = NULL,
     .render_char          = djui_font_normal_render_char,
+    .glyph                = djui_font_normal_glyph,
     .char_width           = djui_font_normal_char_width,
 };
 
@@ -49,9 +58,9 @@ static const struct DjuiFont sDjuiFontNormal = {
  // font 1 (custom title font) //
 ////////////////////////////////
 
-static void djui_font_title_render_char(char* c) {
+static bool djui_font_title_glyph(char* c, struct DjuiGfxGlyph* glyph) {
     // replace undisplayable characters
-    if (*c == ' ') { return; }
+    if (*c == ' ') { return false; }
 
     u32 index = djui_unicode_get_sprite_index(c);
     if ((u8)*c < '!' || (u8)*c > '~' + 1) {
@@ -64,7 +73,15 @@ static void djui_font_title_render_char(char* c) {
     u32 ty = index / 16;
 
     extern ALIGNED8 const Texture texture_font_title[];
-    djui_gfx_render_texture_tile(texture_font_title, 1024, 512, G_IM_FMT_RGBA, G_IM_SIZ_32b, tx * 64, ty * 64, 64, 64, false, true);
+    *glyph = (struct DjuiGfxGlyph) { texture_font_title, 1024, 512, G_IM_SIZ_32b, tx * 64, ty * 64, 64, 64 };
+    return true;
+}
+
+static void djui_font_title_render_char(char* c) {
+    struct DjuiGfxGlyph glyph;
+    if (djui_font_title_glyph(c, &glyph)) {
+        djui_gfx_render_glyph(&glyph);
+    }
 }
 
 static f32 djui_font_title_char_width(char* text) {
@@ -84,6 +101,7 @@ static const struct DjuiFont sDjuiFontTitle = {
     .defaultFontScale     = 64.0f,
     .textBeginDisplayList = NULL,
     .render_char          = djui_font_title_render_char,
+    .glyph                = djui_font_title_glyph,
     .char_width           = djui_font_title_char_width,
 };
 
@@ -150,6 +168,7 @@ static const struct DjuiFont sDjuiFontHud = {
     .defaultFontScale     = 16.0f,
     .textBeginDisplayList = NULL,
     .render_char          = djui_font_hud_render_char,
+    .glyph                = NULL,
     .char_width           = djui_font_hud_char_width,
 };
 
@@ -157,9 +176,9 @@ static const struct DjuiFont sDjuiFontHud = {
  // font 3 (DJ's aliased font) //
 ////////////////////////////////
 
-static void djui_font_aliased_render_char(char* c) {
+static bool djui_font_aliased_glyph(char* c, struct DjuiGfxGlyph* glyph) {
     // replace undisplayable characters
-    if (*c == ' ') { return; }
+    if (*c == ' ') { return false; }
 
     u32 index = djui_unicode_get_sprite_index(c);
 
@@ -168,12 +187,20 @@ static void djui_font_aliased_render_char(char* c) {
         u32 tx = index % 64;
         u32 ty = index / 64;
         extern ALIGNED8 const Texture texture_font_jp_aliased[];
-        djui_gfx_render_texture_tile(texture_font_jp_aliased, 1024, 2048, G_IM_FMT_RGBA, G_IM_SIZ_32b, tx * 16, ty * 32, 16, 32, false, true);
+        *glyph = (struct DjuiGfxGlyph) { texture_font_jp_aliased, 1024, 2048, G_IM_SIZ_32b, tx * 16, ty * 32, 16, 32 };
     } else {
         u32 tx = index % 32;
         u32 ty = index / 32;
         extern ALIGNED8 const Texture texture_font_aliased[];
-        djui_gfx_render_texture_tile(texture_font_aliased, 512, 256, G_IM_FMT_RGBA, G_IM_SIZ_32b, tx * 16, ty * 32, 16, 32, false, true);
+        *glyph = (struct DjuiGfxGlyph) { texture_font_aliased, 512, 256, G_IM_SIZ_32b, tx * 16, ty * 32, 16, 32 };
+    }
+    return true;
+}
+
+static void djui_font_aliased_render_char(char* c) {
+    struct DjuiGfxGlyph glyph;
+    if (djui_font_aliased_glyph(c, &glyph)) {
+        djui_gfx_render_glyph(&glyph);
     }
 }
 
@@ -192,6 +219,7 @@ static const struct DjuiFont sDjuiFontAliased = {
     .defaultFontScale     = 32.0f,
     .textBeginDisplayList = NULL,
     .render_char          = djui_font_aliased_render_char,
+    .glyph                = djui_font_aliased_glyph,
     .char_width           = djui_font_aliased_char_width,
 };
 
@@ -199,9 +227,9 @@ static const struct DjuiFont sDjuiFontAliased = {
  // font 4/5 (custom hud font/recolor) //
 ////////////////////////////////////////
 
-static void djui_font_custom_hud_render_char(char* c) {
+static bool djui_font_custom_hud_glyph(char* c, struct DjuiGfxGlyph* glyph) {
     // replace undisplayable characters
-    if (*c == ' ') { return; }
+    if (*c == ' ') { return false; }
 
     u32 index = djui_unicode_get_sprite_index(c);
 
@@ -209,12 +237,20 @@ static void djui_font_custom_hud_render_char(char* c) {
     u32 ty = index / 16;
 
     extern ALIGNED8 const Texture texture_font_hud[];
-    djui_gfx_render_texture_tile(texture_font_hud, 512, 512, G_IM_FMT_RGBA, G_IM_SIZ_32b, tx * 32, ty * 32, 32, 32, false, true);
+    *glyph = (struct DjuiGfxGlyph) { texture_font_hud, 512, 512, G_IM_SIZ_32b, tx * 32, ty * 32, 32, 32 };
+    return true;
 }
 
-static void djui_font_custom_hud_recolor_render_char(char* c) {
+static void djui_font_custom_hud_render_char(char* c) {
+    struct DjuiGfxGlyph glyph;
+    if (djui_font_custom_hud_glyph(c, &glyph)) {
+        djui_gfx_render_glyph(&glyph);
+    }
+}
+
+static bool djui_font_custom_hud_recolor_glyph(char* c, struct DjuiGfxGlyph* glyph) {
     // replace undisplayable characters
-    if (*c == ' ') { return; }
+    if (*c == ' ') { return false; }
 
     u32 index = djui_unicode_get_sprite_index(c);
 
@@ -222,7 +258,15 @@ static void djui_font_custom_hud_recolor_render_char(char* c) {
     u32 ty = index / 16;
 
     extern ALIGNED8 const Texture texture_font_hud_recolor[];
-    djui_gfx_render_texture_tile(texture_font_hud_recolor, 512, 512, G_IM_FMT_RGBA, G_IM_SIZ_32b, tx * 32, ty * 32, 32, 32, false, true);
+    *glyph = (struct DjuiGfxGlyph) { texture_font_hud_recolor, 512, 512, G_IM_SIZ_32b, tx * 32, ty * 32, 32, 32 };
+    return true;
+}
+
+static void djui_font_custom_hud_recolor_render_char(char* c) {
+    struct DjuiGfxGlyph glyph;
+    if (djui_font_custom_hud_recolor_glyph(c, &glyph)) {
+        djui_gfx_render_glyph(&glyph);
+    }
 }
 
 static f32 djui_font_custom_hud_char_width(char* text) {
@@ -242,6 +286,7 @@ static const struct DjuiFont sDjuiFontCustomHud = {
     .defaultFontScale     = 32.0f,
     .textBeginDisplayList = NULL,
     .render_char          = djui_font_custom_hud_render_char,
+    .glyph                = djui_font_custom_hud_glyph,
     .char_width           = djui_font_custom_hud_char_width,
 };
 
@@ -254,6 +299,7 @@ static const struct DjuiFont sDjuiFontCustomHudRecolor = {
     .defaultFontScale     = 32.0f,
     .textBeginDisplayList = NULL,
     .render_char          = djui_font_custom_hud_recolor_render_char,
+    .glyph                = djui_font_custom_hud_recolor_glyph,
     .char_width           = djui_font_custom_hud_char_width,
 };
 
@@ -261,9 +307,9 @@ static const struct DjuiFont sDjuiFontCustomHudRecolor = {
  // font 6 (special font) //
 ///////////////////////////
 
-static void djui_font_special_render_char(char* c) {
+static bool djui_font_special_glyph(char* c, struct DjuiGfxGlyph* glyph) {
     // replace undisplayable characters
-    if (*c == ' ') { return; }
+    if (*c == ' ') { return false; }
 
     u32 index = djui_unicode_get_sprite_index(c);
     if (index & 0x010000) {
@@ -271,14 +317,21 @@ static void djui_font_special_render_char(char* c) {
         u32 tx = index % 64;
         u32 ty = index / 64;
         extern ALIGNED8 const Texture texture_font_jp[];
-        djui_gfx_render_texture_tile(texture_font_jp, 512, 1024, G_IM_FMT_RGBA, G_IM_SIZ_32b, tx * 8, ty * 16, 8, 16, false, true);
+        *glyph = (struct DjuiGfxGlyph) { texture_font_jp, 512, 1024, G_IM_SIZ_32b, tx * 8, ty * 16, 8, 16 };
     } else {
         u32 tx = index % 32;
         u32 ty = index / 32;
         extern ALIGNED8 const Texture texture_font_special[];
-        djui_gfx_render_texture_tile(texture_font_special, 256, 128, G_IM_FMT_RGBA, G_IM_SIZ_32b, tx * 8, ty * 16, 8, 16, false, true);
+        *glyph = (struct DjuiGfxGlyph) { texture_font_special, 256, 128, G_IM_SIZ_32b, tx * 8, ty * 16, 8, 16 };
     }
+    return true;
+}
 
+static void djui_font_special_render_char(char* c) {
+    struct DjuiGfxGlyph glyph;
+    if (djui_font_special_glyph(c, &glyph)) {
+        djui_gfx_render_glyph(&glyph);
+    }
 }
 
 static f32 djui_font_special_char_width(char* c) {
@@ -296,6 +349,7 @@ static const struct DjuiFont sDjuiFontSpecial = {
     .defaultFontScale     = 32.0f,
     .textBeginDisplayList = NULL,
     .render_char          = djui_font_special_render_char,
+    .glyph                = djui_font_special_glyph,
     .char_width           = djui_font_special_char_width,
 };
 
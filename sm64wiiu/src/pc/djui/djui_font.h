@@ -1,6 +1,8 @@
 #pragma once
 #include "djui.h"
 
+struct DjuiGfxGlyph;
+
 struct DjuiFont {
     f32 charWidth;
     f32 charHeight;
@@ -10,6 +12,8 @@ struct DjuiFont {
     f32 defaultFontScale;
     const Gfx* textBeginDisplayList;
     void (*render_char)(char*);
+    // atlas tile for a char, false for blanks; NULL when glyphs are not in an atlas
+    bool (*glyph)(char*, struct DjuiGfxGlyph*);
     f32 (*char_width)(char*);
 };
 
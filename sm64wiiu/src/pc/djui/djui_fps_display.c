@@ -1,20 +1,28 @@
 #include "djui.h"
+#include "djui_fps_display.h"
 #include "pc/pc_main.h"
 #include <stdio.h>
 
 struct DjuiFpsDisplay {
     struct DjuiText *text;
+    struct DjuiText *frameTimes;
     struct DjuiBase base;
 };
 
 struct DjuiFpsDisplay *sFpsDisplay = NULL;
 
-void djui_fps_display_update(u32 fps) {
+void djui_fps_display_update(u32 fps, const struct FramePacerStats* stats) {
     if (configShowFPS && sFpsDisplay != NULL) {
         char fpsText[30] = "";
         fps = fps > 99999 ? 99999 : fps; // Prevent overflowing the FPS display (cap at 99999)
         snprintf(fpsText, 30, "\\#dcdcdc\\FPS: \\#ffffff\\%d", fps);
         djui_text_set_text(sFpsDisplay->text, fpsText);
+
+        // frame time percentiles over the same second, in ms
+        char frameTimesText[96] = "";
+        snprintf(frameTimesText, 96, "\\#a0a0a0\\p50 \\#ffffff\\%.1f \\#a0a0a0\\p95 \\#ffffff\\%.1f \\#a0a0a0\\p99 \\#ffffff\\%.1f",
+                 stats->p50, stats->p95, stats->p99);
+        djui_text_set_text(sFpsDisplay->frameTimes, frameTimesText);
     }
 }
 
@@ -33,7 +41,7 @@ void djui_fps_display_create(void) {
     struct DjuiFpsDisplay *fpsDisplay = calloc(1, sizeof(struct DjuiFpsDisplay));
     struct DjuiBase* base = &fpsDisplay->base;
     djui_base_init(NULL, base, NULL, djui_fps_display_on_destroy);
-    djui_base_set_size(base, 165, 50);
+    djui_base_set_size(base, 300, 80);
     djui_base_set_color(base, 0, 0, 0, 200);
     djui_base_set_border_color(base, 0, 0, 0, 160);
     djui_base_set_border_width(base, 4);
@@ -50,6 +58,18 @@ void djui_fps_display_create(void) {
         fpsDisplay->text = text;
     }
 
+    {
+        // frame time text
+        struct DjuiText *text = djui_text_create(base, "");
+        djui_text_set_font_scale(text, text->fontScale * 0.75f);
+        djui_text_set_alignment(text, DJUI_HALIGN_CENTER, DJUI_VALIGN_TOP);
+        djui_base_set_size_type(&text->base, DJUI_SVT_RELATIVE, DJUI_SVT_ABSOLUTE);
+        djui_base_set_size(&text->base, 1.0f, text->fontScale * 2);
+        djui_base_set_location(&text->base, 0, fpsDisplay->text->fontScale * 0.85f);
+
+        fpsDisplay->frameTimes = text;
+    }
+
     sFpsDisplay = fpsDisplay;
 }
 
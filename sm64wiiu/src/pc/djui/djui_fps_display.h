@@ -1,7 +1,8 @@
 #pragma once
 #include "djui.h"
+#include "pc/frame_pacer.h"
 
-void djui_fps_display_update(u32 fps);
+void djui_fps_display_update(u32 fps, const struct FramePacerStats* stats);
 void djui_fps_display_render(void);
 void djui_fps_display_create(void);
 void djui_fps_display_destroy(void);
@@ -1,3 +1,4 @@
+#include <string.h>
 #include <ultra64.h>
 #include "sm64.h"
 #include "djui.h"
@@ -234,6 +235,140 @@ void djui_gfx_render_texture_tile(const Texture* texture, u32 w, u32 h, u8 fmt,
     gSPSetGeometryMode(gDisplayListHead++, G_LIGHTING | G_CULL_BACK);
 }
 
+void djui_gfx_render_glyph(const struct DjuiGfxGlyph* glyph) {
+    djui_gfx_render_texture_tile(glyph->texture, glyph->texW, glyph->texH, G_IM_FMT_RGBA, glyph->siz,
+                                 glyph->tileX, glyph->tileY, glyph->tileW, glyph->tileH, false, true);
+}
+
+/////////////////////////////////////////////
+
+// gfx_pc loads at most 64 vertices at a time
+#define TEXT_RUN_GLYPHS_PER_LOAD 16
+
+static Vtx sTextRunVtx[DJUI_GFX_TEXT_RUN_GLYPHS * 4];
+static u32 sTextRunCount = 0;
+static const Texture* sTextRunTexture = NULL;
+static u32 sTextRunTexW = 0;
+static u32 sTextRunTexH = 0;
+static u8 sTextRunSiz = 0;
+static bool sTextRunFilter = false;
+static bool sTextRunStateSet = false;
+
+void djui_gfx_text_run_begin(bool filter) {
+    sTextRunCount = 0;
+    sTextRunTexture = NULL;
+    sTextRunFilter = filter;
+    sTextRunStateSet = false;
+}
+
+void djui_gfx_text_run_flush(void) {
+    if (sTextRunCount == 0) { return; }
+    u32 count = sTextRunCount;
+    sTextRunCount = 0;
+
+    if (!gDisplayListHead) {
+        LOG_ERROR("Retrieved a null displaylist head");
+        return;
+    }
+
+    Vtx *vtx = alloc_display_list(sizeof(Vtx) * 4 * count);
+    if (!vtx) {
+        LOG_ERROR("Failed to allocate vertices");
+        return;
+    }
+    memcpy(vtx, sTextRunVtx, sizeof(Vtx) * 4 * count);
+
+    // the same state render_texture_tile sets for every glyph, once per run
+    if (!sTextRunStateSet) {
+        gSPClearGeometryMode(gDisplayListHead++, G_LIGHTING | G_CULL_BOTH);
+        gDPSetCombineMode(gDisplayListHead++, G_CC_FADEA, G_CC_FADEA);
+        gDPSetRenderMode(gDisplayListHead++, G_RM_XLU_SURF, G_RM_XLU_SURF2);
+        gDPSetTextureFilter(gDisplayListHead++, sTextRunFilter ? G_TF_BILERP : G_TF_POINT);
+        gSPTexture(gDisplayListHead++, 0xFFFF, 0xFFFF, 0, G_TX_RENDERTILE, G_ON);
+        sTextRunStateSet = true;
+    }
+
+    // every glyph in the batch shares this atlas
+    if (sTextRunSiz == G_IM_SIZ_32b) {
+        gDPSetTextureOverrideDjui(gDisplayListHead++, sTextRunTexture, djui_gfx_power_of_two(sTextRunTexW), djui_gfx_power_of_two(sTextRunTexH), G_IM_FMT_RGBA, G_IM_SIZ_32b);
+    } else {
+        gDPSetTextureOverrideDjui(gDisplayListHead++, sTextRunTexture, djui_gfx_power_of_two(sTextRunTexW), djui_gfx_power_of_two(sTextRunTexH), G_IM_FMT_RGBA, G_IM_SIZ_16b);
+    }
+    gDPLoadTextureBlockWithoutTexture(gDisplayListHead++, NULL, G_IM_FMT_RGBA, G_IM_SIZ_16b, 64, 64, 0, G_TX_CLAMP, G_TX_CLAMP, 0, 0, 0, 0);
+    *(gDisplayListHead++) = (Gfx) gsSPExecuteDjui(G_TEXOVERRIDE_DJUI);
+
+    for (u32 first = 0; first < count; first += TEXT_RUN_GLYPHS_PER_LOAD) {
+        u32 glyphs = count - first;
+        if (glyphs > TEXT_RUN_GLYPHS_PER_LOAD) { glyphs = TEXT_RUN_GLYPHS_PER_LOAD; }
+        gSPVertexNonGlobal(gDisplayListHead++, vtx + first * 4, glyphs * 4, 0);
+        for (u32 i = 0; i < glyphs; i++) {
+            u32 v = i * 4;
+            gSP2TrianglesDjui(gDisplayListHead++, v, v + 1, v + 2, 0x0, v, v + 2, v + 3, 0x0);
+        }
+    }
+}
+
+void djui_gfx_text_run_add(const struct DjuiGfxGlyph* glyph, f32 x, f32 y, const f32* clip) {
+    if (!glyph->texture) {
+        LOG_ERROR("Attempted to render null texture");
+        return;
+    }
+
+    if (glyph->texture != sTextRunTexture || glyph->texW != sTextRunTexW || glyph->texH != sTextRunTexH || glyph->siz != sTextRunSiz) {
+        djui_gfx_text_run_flush();
+        sTextRunTexture = glyph->texture;
+        sTextRunTexW = glyph->texW;
+        sTextRunTexH = glyph->texH;
+        sTextRunSiz = glyph->siz;
+    } else if (sTextRunCount >= DJUI_GFX_TEXT_RUN_GLYPHS) {
+        djui_gfx_text_run_flush();
+    }
+
+    // same quad and UVs as render_texture_tile with font set, moved to x, y
+    f32 w = (f32)glyph->texW;
+    f32 h = (f32)glyph->texH;
+    f32 aspect = glyph->tileH ? ((f32)glyph->tileW / (f32)glyph->tileH) : 1;
+    f32 offsetX = -1024.0f / w + 1;
+    f32 offsetY = -1024.0f / h + 1;
+    f32 x1 = x;
+    f32 x2 = x + aspect;
+    f32 y1 = y;
+    f32 y2 = y - 1;
+    f32 u1 = ( glyph->tileX                 * 2048.0f) / w + offsetX;
+    f32 u2 = ((glyph->tileX + glyph->tileW) * 2048.0f) / w + offsetX;
+    f32 v1 = ( glyph->tileY                 * 2048.0f) / h + offsetY;
+    f32 v2 = ((glyph->tileY + glyph->tileH) * 2048.0f) / h + offsetY;
+
+    // what G_TEXCLIP_DJUI does to the loaded vertices, done here instead
+    if (clip != NULL) {
+        f32 du = u2 - u1;
+        f32 dv = v2 - v1;
+        x1 += aspect * clip[0];
+        x2 -= aspect * clip[2];
+        y1 -= clip[1];
+        y2 += clip[3];
+        u1 += du * clip[0];
+        u2 -= du * clip[2];
+        v1 += dv * clip[1];
+        v2 -= dv * clip[3];
+    }
+
+    Vtx* vtx = &sTextRunVtx[sTextRunCount++ * 4];
+    vtx[0] = (Vtx) {{{ x1, y2, 0 }, 0, { u1, v2 }, { 0xff, 0xff, 0xff, 0xff }}};
+    vtx[1] = (Vtx) {{{ x2, y2, 0 }, 0, { u2, v2 }, { 0xff, 0xff, 0xff, 0xff }}};
+    vtx[2] = (Vtx) {{{ x2, y1, 0 }, 0, { u2, v1 }, { 0xff, 0xff, 0xff, 0xff }}};
+    vtx[3] = (Vtx) {{{ x1, y1, 0 }, 0, { u1, v1 }, { 0xff, 0xff, 0xff, 0xff }}};
+}
+
+void djui_gfx_text_run_end(void) {
+    djui_gfx_text_run_flush();
+    if (!sTextRunStateSet) { return; }
+    sTextRunStateSet = false;
+    gSPTexture(gDisplayListHead++, 0xFFFF, 0xFFFF, 0, G_TX_RENDERTILE, G_OFF);
+    gDPSetCombineMode(gDisplayListHead++, G_CC_SHADE, G_CC_SHADE);
+    gSPSetGeometryMode(gDisplayListHead++, G_LIGHTING | G_CULL_BACK);
+}
+
 /////////////////////////////////////////////
 
 void djui_gfx_position_translate(f32* x, f32* y) {
@@ -258,7 +393,9 @@ void djui_gfx_size_translate(f32* size) {
     *size = *size * ((f32)SCREEN_HEIGHT / (f32)windowHeight) * djui_gfx_get_scale();
 }
 
-bool djui_gfx_add_clipping_specific(struct DjuiBase* base, f32 dX, f32 dY, f32 dW, f32 dH) {
+// Returns true when the rect is clipped out entirely; otherwise fills `out`
+// with the fractions of it to cut off the left, top, right and bottom.
+bool djui_gfx_get_clipping_specific(struct DjuiBase* base, f32 dX, f32 dY, f32 dW, f32 dH, f32 out[4]) {
     struct DjuiBaseRect* clip = &base->clip;
 
     f32 clipX2 = clip->x + clip->width;
@@ -285,12 +422,25 @@ bool djui_gfx_add_clipping_specific(struct DjuiBase* base, f32 dX, f32 dY, f32 d
     dClipX2 = clamp(dClipX2, 0.0f, 1.0f);
     dClipY2 = clamp(dClipY2, 0.0f, 1.0f);
 
-    if ((dClipX1 != 0) || (dClipY1 != 0) || (dClipX2 != 0) || (dClipY2 != 0)) {
+    out[0] = dClipX1;
+    out[1] = dClipY1;
+    out[2] = dClipX2;
+    out[3] = dClipY2;
+    return false;
+}
+
+bool djui_gfx_add_clipping_specific(struct DjuiBase* base, f32 dX, f32 dY, f32 dW, f32 dH) {
+    f32 clip[4];
+    if (djui_gfx_get_clipping_specific(base, dX, dY, dW, dH, clip)) {
+        return true;
+    }
+
+    if ((clip[0] != 0) || (clip[1] != 0) || (clip[2] != 0) || (clip[3] != 0)) {
         gDPSetTextureClippingDjui(gDisplayListHead++,
-                                  (u8)roundf(dClipX1 * 255.0f),
-                                  (u8)roundf(dClipY1 * 255.0f),
-                                  (u8)roundf(dClipX2 * 255.0f),
-                                  (u8)roundf(dClipY2 * 255.0f));
+                                  (u8)roundf(clip[0] * 255.0f),
+                                  (u8)roundf(clip[1] * 255.0f),
+                                  (u8)roundf(clip[2] * 255.0f),
+                                  (u8)roundf(clip[3] * 255.0f));
     }
 
     return false;
@@ -18,11 +18,38 @@ f32 djui_gfx_get_scale(void);
 void djui_gfx_render_texture(const Texture* texture, u32 w, u32 h, u8 fmt, u8 siz, bool filter);
 void djui_gfx_render_texture_tile(const Texture* texture, u32 w, u32 h, u8 fmt, u8 siz, u32 tileX, u32 tileY, u32 tileW, u32 tileH, bool filter, bool font);
 
+// one font glyph: an RGBA tile of an atlas texture
+struct DjuiGfxGlyph {
+    const Texture* texture;
+    u32 texW;
+    u32 texH;
+    u8 siz;
+    u32 tileX;
+    u32 tileY;
+    u32 tileW;
+    u32 tileH;
+};
+
+void djui_gfx_render_glyph(const struct DjuiGfxGlyph* glyph);
+
+// Text runs lay glyphs out on the CPU and draw each stretch that shares an
+// atlas with one vertex buffer, setting the render state once. Glyphs are
+// placed in the current matrix space like render_glyph (one unit tall, top
+// left at x, y). `clip` is NULL or the fractions to cut off the left, top,
+// right and bottom, as djui_gfx_get_clipping_specific() returns them.
+// Flush before changing the env color in the middle of a run.
+#define DJUI_GFX_TEXT_RUN_GLYPHS 256
+void djui_gfx_text_run_begin(bool filter);
+void djui_gfx_text_run_add(const struct DjuiGfxGlyph* glyph, f32 x, f32 y, const f32* clip);
+void djui_gfx_text_run_flush(void);
+void djui_gfx_text_run_end(void);
+
 void gfx_get_dimensions(u32* width, u32* height);
 
 void djui_gfx_position_translate(f32* x, f32* y);
 void djui_gfx_scale_translate(f32* width, f32* height);
 void djui_gfx_size_translate(f32* size);
 
+bool djui_gfx_get_clipping_specific(struct DjuiBase* base, f32 dX, f32 dY, f32 dW, f32 dH, f32 clip[4]);
 bool djui_gfx_add_clipping_specific(struct DjuiBase* base, f32 dX, f32 dY, f32 dW, f32 dH);
 bool djui_gfx_add_clipping(struct DjuiBase* base);
\ No newline at end of file
@@ -14,6 +14,7 @@
 #include "config.h"
 #include "djui.h"
 #include "djui_unicode.h"
+#include "djui_cache.h"
 #include "djui_hud_utils.h"
 #include "djui_panel_pause.h"
 #include "game/camera.h"
@@ -24,6 +25,7 @@
 #include "pc/lua/smlua.h"
 
 #include "engine/math_util.h"
+#include "data/dynos_cmap.cpp.h"
 
 static enum HudUtilsResolution sResolution = RESOLUTION_DJUI;
 static enum HudUtilsFilter sFilter = FILTER_NEAREST;
@@ -179,6 +181,114 @@ void patch_djui_hud(f32 delta) {
     gDjuiHudUtilsZ = savedZ;
 }
 
+  ///////////////////
+ // cached blocks //
+///////////////////
+
+struct HudCacheBlock {
+    struct DjuiCacheEntry entry;
+    s64 key;
+    // HUD state where the recording ended, restored by a replay
+    enum HudUtilsResolution resolution;
+    enum HudUtilsFilter filter;
+    enum DjuiFontType font;
+    bool legacy;
+    struct HudUtilsRotation rotation;
+    struct DjuiColor color;
+    u8 colorAltered;
+    f32 z;
+};
+
+static void* sHudCacheBlocks = NULL;
+static struct HudCacheBlock* sHudCacheOpen = NULL;
+static u32 sHudCacheOpenDepth = 0;
+static u32 sHudCacheDepth = 0;
+
+static void djui_hud_cache_on_evict(struct DjuiCacheEntry* entry) {
+    struct HudCacheBlock* block = (struct HudCacheBlock*)entry;
+    hmap_del(sHudCacheBlocks, block->key);
+}
+
+// what a block draws from besides the mod's own version
+static u64 djui_hud_cache_signature(u64 version) {
+    u64 hash = djui_cache_screen_signature();
+    djui_cache_hash_u64(&hash, version);
+    djui_cache_hash_u64(&hash, ((u64)sResolution << 16) | ((u64)sFilter << 8) | sFont);
+    djui_cache_hash_u64(&hash, sLegacy);
+    djui_cache_hash_f32(&hash, sRotation.rotation);
+    djui_cache_hash_f32(&hash, sRotation.rotationDiff);
+    djui_cache_hash_f32(&hash, sRotation.pivotX);
+    djui_cache_hash_f32(&hash, sRotation.pivotY);
+    djui_cache_hash_u64(&hash, ((u32)sColor.r << 24) | ((u32)sColor.g << 16) | ((u32)sColor.b << 8) | sColor.a);
+    djui_cache_hash_u64(&hash, sColorAltered);
+    djui_cache_hash_f32(&hash, gDjuiHudUtilsZ);
+    return hash;
+}
+
+bool djui_hud_begin_cached(const char* name, u64 version) {
+    if (name == NULL) { return true; }
+
+    u64 key = 0;
+    djui_cache_hash_string(&key, name);
+    if (sHudCacheBlocks == NULL) {
+        sHudCacheBlocks = hmap_create(true);
+    }
+    struct HudCacheBlock* block = hmap_get(sHudCacheBlocks, (s64)key);
+    if (block == NULL) {
+        block = (struct HudCacheBlock*)djui_cache_entry_create(sizeof(struct HudCacheBlock), NULL, djui_hud_cache_on_evict);
+        if (block == NULL) { return true; }
+        block->key = (s64)key;
+        hmap_put(sHudCacheBlocks, block->key, block);
+    }
+
+    switch (djui_cache_begin(&block->entry, djui_hud_cache_signature(version))) {
+        case DJUI_CACHE_REPLAYED:
+            sResolution = block->resolution;
+            sFilter = block->filter;
+            sFont = block->font;
+            sLegacy = block->legacy;
+            sRotation = block->rotation;
+            sColor = block->color;
+            sColorAltered = block->colorAltered;
+            gDjuiHudUtilsZ = block->z;
+            return false;
+        case DJUI_CACHE_RECORDING:
+            sHudCacheOpen = block;
+            sHudCacheOpenDepth = ++sHudCacheDepth;
+            return true;
+        default:
+            sHudCacheDepth++;
+            return true;
+    }
+}
+
+void djui_hud_end_cached(void) {
+    if (sHudCacheDepth == 0) { return; }
+    if (sHudCacheOpen != NULL && sHudCacheDepth == sHudCacheOpenDepth) {
+        struct HudCacheBlock* block = sHudCacheOpen;
+        block->resolution = sResolution;
+        block->filter = sFilter;
+        block->font = sFont;
+        block->legacy = sLegacy;
+        block->rotation = sRotation;
+        block->color = sColor;
+        block->colorAltered = sColorAltered;
+        block->z = gDjuiHudUtilsZ;
+        djui_cache_end(&block->entry, true);
+        sHudCacheOpen = NULL;
+    }
+    sHudCacheDepth--;
+}
+
+void djui_hud_end_cached_blocks(void) {
+    // a block a Lua error cut short draws this once but isn't kept
+    if (sHudCacheOpen != NULL) {
+        djui_cache_end(&sHudCacheOpen->entry, false);
+        sHudCacheOpen = NULL;
+    }
+    sHudCacheDepth = 0;
+}
+
   ////////////
  // others //
 ////////////
@@ -381,6 +491,42 @@ f32 djui_hud_measure_text(const char* message) {
     return width * font->defaultFontScale;
 }
 
+static void djui_hud_print_text_line(const struct DjuiFont* font, const char* message) {
+    // atlas fonts go out as one batched draw per atlas
+    if (configDjuiBatchText && font->glyph != NULL) {
+        struct DjuiGfxGlyph glyph;
+        f32 x = 0;
+        djui_gfx_text_run_begin(false);
+        for (char* c = (char*)message; *c != '\0'; c = djui_unicode_next_char(c)) {
+            if (font->glyph(c, &glyph)) {
+                djui_gfx_text_run_add(&glyph, x, 0, NULL);
+            }
+            x += font->char_width(c);
+        }
+        djui_gfx_text_run_end();
+        return;
+    }
+
+    f32 addX = 0;
+    char* c = (char*)message;
+    while (*c != '\0') {
+        f32 charWidth = font->char_width(c);
+
+        if (*c == '\n' && *c == ' ') {
+            addX += charWidth;
+            c++;
+            continue;
+        }
+
+        // render
+        font->render_char(c);
+        create_dl_translation_matrix(DJUI_MTX_NOPUSH, charWidth + addX, 0, 0);
+        addX = 0;
+
+        c = djui_unicode_next_char(c);
+    }
+}
+
 void djui_hud_print_text(const char* message, f32 x, f32 y, f32 scale) {
     if (message == NULL) { return; }
     gDjuiHudUtilsZ += 0.01f;
@@ -407,24 +553,7 @@ void djui_hud_print_text(const char* message, f32 x, f32 y, f32 scale) {
     create_dl_scale_matrix(DJUI_MTX_NOPUSH, translatedFontSize, translatedFontSize, 1.0f);
 
     // render the line
-    f32 addX = 0;
-    char* c = (char*)message;
-    while (*c != '\0') {
-        f32 charWidth = font->char_width(c);
-
-        if (*c == '\n' && *c == ' ') {
-            addX += charWidth;
-            c++;
-            continue;
-        }
-
-        // render
-        font->render_char(c);
-        create_dl_translation_matrix(DJUI_MTX_NOPUSH, charWidth + addX, 0, 0);
-        addX = 0;
-
-        c = djui_unicode_next_char(c);
-    }
+    djui_hud_print_text_line(font, message);
 
     // pop
     gSPPopMatrix(gDisplayListHead++, G_MTX_MODELVIEW);
@@ -432,6 +561,12 @@ void djui_hud_print_text(const char* message, f32 x, f32 y, f32 scale) {
 
 void djui_hud_print_text_interpolated(const char* message, f32 prevX, f32 prevY, f32 prevScale, f32 x, f32 y, f32 scale) {
     if (message == NULL) { return; }
+
+    // patch_djui_hud can't reach into a recording, so it holds the end position
+    if (djui_cache_is_recording()) {
+        djui_hud_print_text(message, x, y, scale);
+        return;
+    }
     f32 savedZ = gDjuiHudUtilsZ;
     gDjuiHudUtilsZ += 0.01f;
 
@@ -462,24 +597,7 @@ void djui_hud_print_text_interpolated(const char* message, f32 prevX, f32 prevY,
     create_dl_scale_matrix(DJUI_MTX_NOPUSH, translatedFontSize, translatedFontSize, 1.0f);
 
     // render the line
-    f32 addX = 0;
-    char* c = (char*)message;
-    while (*c != '\0') {
-        f32 charWidth = font->char_width(c);
-
-        if (*c == '\n' && *c == ' ') {
-            addX += charWidth;
-            c++;
-            continue;
-        }
-
-        // render
-        font->render_char(c);
-        create_dl_translation_matrix(DJUI_MTX_NOPUSH, charWidth + addX, 0, 0);
-        addX = 0;
-
-        c = djui_unicode_next_char(c);
-    }
+    djui_hud_print_text_line(font, message);
 
     // pop
     gSPPopMatrix(gDisplayListHead++, G_MTX_MODELVIEW);
@@ -593,6 +711,11 @@ void djui_hud_render_texture_tile(struct TextureInfo* texInfo, f32 x, f32 y, f32
 }
 
 void djui_hud_render_texture_interpolated(struct TextureInfo* texInfo, f32 prevX, f32 prevY, f32 prevScaleW, f32 prevScaleH, f32 x, f32 y, f32 scaleW, f32 scaleH) {
+    if (djui_cache_is_recording()) {
+        djui_hud_render_texture(texInfo, x, y, scaleW, scaleH);
+        return;
+    }
+
     Gfx* savedHeadPos = gDisplayListHead;
     f32 savedZ = gDjuiHudUtilsZ;
 
@@ -619,6 +742,11 @@ void djui_hud_render_texture_interpolated(struct TextureInfo* texInfo, f32 prevX
 }
 
 void djui_hud_render_texture_tile_interpolated(struct TextureInfo* texInfo, f32 prevX, f32 prevY, f32 prevScaleW, f32 prevScaleH, f32 x, f32 y, f32 scaleW, f32 scaleH, u32 tileX, u32 tileY, u32 tileW, u32 tileH) {
+    if (djui_cache_is_recording()) {
+        djui_hud_render_texture_tile(texInfo, x, y, scaleW, scaleH, tileX, tileY, tileW, tileH);
+        return;
+    }
+
     Gfx* savedHeadPos = gDisplayListHead;
     f32 savedZ = gDjuiHudUtilsZ;
 
@@ -687,6 +815,11 @@ void djui_hud_render_rect(f32 x, f32 y, f32 width, f32 height) {
 }
 
 void djui_hud_render_rect_interpolated(f32 prevX, f32 prevY, f32 prevWidth, f32 prevHeight, f32 x, f32 y, f32 width, f32 height) {
+    if (djui_cache_is_recording()) {
+        djui_hud_render_rect(x, y, width, height);
+        return;
+    }
+
     Gfx* savedHeadPos = gDisplayListHead;
     f32 savedZ = gDjuiHudUtilsZ;
 
@@ -140,6 +140,12 @@ void djui_hud_render_rect_interpolated(f32 prevX, f32 prevY, f32 prevWidth, f32
 /* |description|Renders an DJUI HUD line onto the screen|descriptionEnd| */
 void djui_hud_render_line(f32 p1X, f32 p1Y, f32 p2X, f32 p2Y, f32 size);
 
+/* |description|Starts a block of HUD drawing that is recorded once and replayed while `version` and the HUD state it starts from stay the same. Returns true when the block has to be drawn, in which case it must end with `djui_hud_end_cached`. Names are shared between mods, so prefix them|descriptionEnd| */
+bool djui_hud_begin_cached(const char* name, u64 version);
+/* |description|Ends a block started by `djui_hud_begin_cached` that returned true|descriptionEnd| */
+void djui_hud_end_cached(void);
+void djui_hud_end_cached_blocks(void);
+
 /* |description|Gets the current camera FOV|descriptionEnd| */
 f32 get_current_fov();
 /* |description|Gets the camera FOV coefficient|descriptionEnd| */
@@ -1,4 +1,5 @@
 #include "djui.h"
+#include "djui_cache.h"
 #include "game/segment2.h"
 #include "pc/network/network.h"
 
@@ -33,6 +34,13 @@ static bool djui_image_render(struct DjuiBase* base) {
     return true;
 }
 
+static void djui_image_cache_hash(struct DjuiBase* base, u64* hash) {
+    struct DjuiImage* image = (struct DjuiImage*)base;
+    const struct TextureInfo *info = &image->textureInfo;
+    djui_cache_hash_u64(hash, (u64)(uintptr_t)info->texture);
+    djui_cache_hash_u64(hash, ((u64)info->width << 32) | ((u64)info->height << 16) | ((u64)info->format << 8) | info->size);
+}
+
 static void djui_image_destroy(struct DjuiBase* base) {
     struct DjuiImage* image = (struct DjuiImage*)base;
     free(image);
@@ -43,6 +51,7 @@ struct DjuiImage* djui_image_create(struct DjuiBase* parent, const Texture* text
     struct DjuiBase* base   = &image->base;
 
     djui_base_init(parent, base, djui_image_render, djui_image_destroy);
+    base->cache_hash = djui_image_cache_hash;
 
     image->textureInfo.texture = texture;
     image->textureInfo.width = width;
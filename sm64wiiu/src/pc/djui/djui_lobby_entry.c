@@ -53,6 +53,7 @@ struct DjuiLobbyEntry* djui_lobby_entry_create(struct DjuiBase* parent, char* ho
     lobbyEntry->description = strdup(description);
 
     djui_base_init(parent, base, djui_rect_render, djui_lobby_entry_destroy);
+    base->cache_hash = djui_rect_cache_hash;
     djui_base_set_size_type(&lobbyEntry->base, DJUI_SVT_RELATIVE, DJUI_SVT_ABSOLUTE);
     djui_base_set_size(&lobbyEntry->base, 1.0f, 32);
     djui_base_set_color(&lobbyEntry->base, 255, 255, 255, 128);
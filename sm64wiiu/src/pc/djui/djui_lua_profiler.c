@@ -2,27 +2,22 @@
 #include <string.h>
 
 #include <stdio.h>
-#if defined(HAVE_SDL2) || defined(TARGET_WII_U)
-#include <SDL2/SDL.h>
-#else
-#ifdef HAVE_SDL
-#include <SDL/SDL.h>
-#endif
-#endif
 
 #include "djui.h"
 #include "pc/pc_main.h"
 #include "pc/mods/mod.h"
 #include "pc/mods/mods.h"
+#include "pc/lua/smlua_alloc.h"
+#include "pc/lua/smlua_profiler.h"
 
 #define MAX_PROFILED_MODS 16
 #define REFRESH_RATE 30
 
 struct DjuiPrfCounter {
-    f64 start;
-    f64 end;
-    f64 sum;
+    f64 prev;
     f64 display;
+    f64 gcPrev;
+    f64 gcDisplay;
 };
 
 struct DjuiPrfEntry {
@@ -39,39 +34,6 @@ struct DjuiPrfDisplay {
 static struct DjuiPrfDisplay *sPrfDisplay = NULL;
 static u8 sPrfDisplayCount = 0;
 
-void lua_profiler_start_counter(UNUSED struct Mod *mod) {
-    if (!configLuaProfiler || sPrfDisplay == NULL) { return; }
-
-#ifndef WAPI_DUMMY
-    for (s32 i = 0; i != MIN(MAX_PROFILED_MODS, gActiveMods.entryCount); ++i) {
-        if (gActiveMods.entries[i] == mod) {
-            f64 freq = SDL_GetPerformanceFrequency();
-            f64 curr = SDL_GetPerformanceCounter();
-            sPrfDisplay->entries[i].counter.start = curr / freq;
-            return;
-        }
-    }
-#endif
-}
-
-void lua_profiler_stop_counter(UNUSED struct Mod *mod) {
-    if (!configLuaProfiler || sPrfDisplay == NULL) { return; }
-
-#ifndef WAPI_DUMMY
-    for (s32 i = 0; i != MIN(MAX_PROFILED_MODS, gActiveMods.entryCount); ++i) {
-        if (gActiveMods.entries[i] == mod) {
-            f64 freq = SDL_GetPerformanceFrequency();
-            f64 curr = SDL_GetPerformanceCounter();
-
-            struct DjuiPrfCounter *counter = &sPrfDisplay->entries[i].counter;
-            counter->end = curr / freq;
-            counter->sum += counter->end - counter->start;
-            return;
-        }
-    }
-#endif
-}
-
 void djui_lua_profiler_initialize_entry(struct DjuiBase *base, struct DjuiPrfEntry *entry, f64 offset) {
     struct DjuiText *name = djui_text_create(base, "");
     djui_text_set_alignment(name, DJUI_HALIGN_LEFT, DJUI_VALIGN_TOP);
@@ -116,8 +78,17 @@ void djui_lua_profiler_update(void) {
         struct DjuiPrfCounter *counter = &entry->counter;
 
         if (gGlobalTimer % REFRESH_RATE == 0) {
-            counter->display = counter->sum / (f64) REFRESH_RATE;
-            counter->sum = 0;
+            // Hook time is cumulative in the Lua profiler; show the per-frame average.
+            f64 total = smlua_profiler_get_owner_time(i);
+            counter->display = (total - counter->prev) / (f64) REFRESH_RATE;
+            counter->prev = total;
+
+            // GC time is cumulative in the allocator; show the per-frame average.
+            const struct SmluaAllocOwnerStats *alloc = smlua_alloc_get_owner_stats(i);
+            if (alloc != NULL) {
+                counter->gcDisplay = (alloc->gcTime - counter->gcPrev) / (f64) REFRESH_RATE;
+                counter->gcPrev = alloc->gcTime;
+            }
         }
 
         char name[256];
@@ -132,10 +103,13 @@ void djui_lua_profiler_update(void) {
         }
         djui_text_set_text(entry->name, name);
 
-        // The timing is in microseconds.
+        // The timing is in microseconds, live memory in kilobytes.
         s32 counterMs = (s32)(counter->display * 1000000.0);
-        char timing[32];
-        snprintf(timing, 32, "%05d", counterMs);
+        s32 gcUs = (s32)(counter->gcDisplay * 1000000.0);
+        const struct SmluaAllocOwnerStats *alloc = smlua_alloc_get_owner_stats(i);
+        u32 liveKb = (alloc != NULL) ? (u32)(alloc->liveBytes / 1024) : 0;
+        char timing[48];
+        snprintf(timing, 48, "%05d %5uK GC %04d", counterMs, liveKb, gcUs);
         djui_text_set_text(entry->timing, timing);
     }
 }
@@ -155,7 +129,7 @@ void djui_lua_profiler_create(void) {
     struct DjuiPrfDisplay *prfDisplay = calloc(1, sizeof(struct DjuiPrfDisplay));
     struct DjuiBase *base = &prfDisplay->base;
     djui_base_init(NULL, base, NULL, djui_lua_profiler_on_destroy);
-    djui_base_set_size(base, 290.0f, MAX_PROFILED_MODS * 26.0f);
+    djui_base_set_size(base, 480.0f, MAX_PROFILED_MODS * 26.0f);
     djui_base_set_color(base, 0, 0, 0, 240);
     djui_base_set_border_color(base, 0, 0, 0, 200);
     djui_base_set_border_width(base, 4);
@@ -204,14 +204,9 @@ static void* threaded_mod_refresh(UNUSED void* unused) {
 
 static void djui_panel_menu_refresh(UNUSED struct DjuiBase* base) {
     djui_base_destroy_children(&sModLayout->base);
-    if (init_thread_handle(&gModRefreshThread, threaded_mod_refresh, NULL, NULL, 0) == 0) {
-        djui_text_set_text(sRefreshButton->text, DLANG(LOBBIES, REFRESHING));
-        djui_base_set_enabled(&sRefreshButton->base, false);
-        djui_base_set_enabled(&sBackButton->base, false);
-        gDjuiPanelDisableBack = true;
-    } else {
-        threaded_mod_refresh(NULL);
-    }
+    // the refresh rebuilds DJUI nodes, which isn't safe off the game thread
+    // now that thread.c runs real threads, so keep it inline
+    threaded_mod_refresh(NULL);
 }
 
 void djui_panel_host_mods_create(struct DjuiBase* caller) {
@@ -27,6 +27,10 @@ bool djui_rect_render(struct DjuiBase* base) {
     return true;
 }
 
+// a rect draws from DjuiBase alone
+void djui_rect_cache_hash(UNUSED struct DjuiBase* base, UNUSED u64* hash) {
+}
+
 static void djui_rect_destroy(struct DjuiBase* base) {
     struct DjuiRect* rect = (struct DjuiRect*)base;
     free(rect);
@@ -37,6 +41,7 @@ struct DjuiRect* djui_rect_create(struct DjuiBase* parent) {
     struct DjuiBase* base = &rect->base;
 
     djui_base_init(parent, base, djui_rect_render, djui_rect_destroy);
+    base->cache_hash = djui_rect_cache_hash;
 
     return rect;
 }
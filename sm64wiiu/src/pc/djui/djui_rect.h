@@ -6,5 +6,6 @@ struct DjuiRect {
 };
 
 bool djui_rect_render(struct DjuiBase* base);
+void djui_rect_cache_hash(struct DjuiBase* base, u64* hash);
 struct DjuiRect* djui_rect_create(struct DjuiBase* parent);
 struct DjuiRect* djui_rect_container_create(struct DjuiBase* parent, f32 height);
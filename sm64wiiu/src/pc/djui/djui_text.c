@@ -1,5 +1,6 @@
 #include <string.h>
 #include "djui.h"
+#include "djui_cache.h"
 #include "djui_unicode.h"
 #include "djui_hud_utils.h"
 #include "game/segment2.h"
@@ -58,6 +59,7 @@ static f32 sTextRenderX = 0;
 static f32 sTextRenderY = 0;
 static f32 sTextRenderLastX = 0;
 static f32 sTextRenderLastY = 0;
+static bool sTextBatch = false;
 
 static void djui_text_translate(f32 x, f32 y) {
     sTextRenderX += x;
@@ -272,6 +274,70 @@ static char* djui_text_render_line_parse_escape(char* c1, char* c2) {
     return c;
 }
 
+static char* djui_text_skip_escape(char* c1, char* c2) {
+    char* c = c1 + 1;
+    while (c < c2 && *c != '\\') {
+        c = djui_unicode_next_char(c);
+    }
+    return djui_unicode_next_char(c);
+}
+
+static void djui_text_batch_char(struct DjuiText* text, char* c, f32 x, f32 y) {
+    struct DjuiGfxGlyph glyph;
+    if (!text->font->glyph(c, &glyph)) { return; }
+
+    // same clip rect as djui_text_render_single_char, applied on the CPU
+    struct DjuiBaseRect* comp = &text->base.comp;
+    const f32 clipPadding = 1.0f;
+    f32 dX = comp->x + x * text->fontScale;
+    f32 dY = comp->y + y * text->fontScale;
+    f32 dW = text->font->charWidth  * text->fontScale;
+    f32 dH = text->font->charHeight * text->fontScale;
+    f32 clip[4];
+    if (djui_gfx_get_clipping_specific(&text->base,
+                                       dX - clipPadding,
+                                       dY - clipPadding,
+                                       dW + clipPadding * 2.0f,
+                                       dH + clipPadding * 2.0f,
+                                       clip)) {
+        return;
+    }
+
+    djui_gfx_text_run_add(&glyph, x, -y, clip);
+}
+
+// Adds a line's glyphs to the text run. The shadow pass skips color escapes;
+// the main pass flushes the run before each one.
+static void djui_text_batch_line(struct DjuiText* text, char* c1, char* c2, bool ellipses, bool shadow) {
+    f32 offset = shadow ? 1.0f / text->fontScale : 0;
+    f32 x = 0;
+    for (char* c = c1; c < c2;) {
+        if (*c == '\\') {
+            if (shadow) {
+                c = djui_text_skip_escape(c, c2);
+            } else {
+                djui_gfx_text_run_flush();
+                c = djui_text_render_line_parse_escape(c, c2);
+            }
+            continue;
+        }
+
+        if (*c != '\n' && *c != ' ') {
+            djui_text_batch_char(text, c, sTextRenderX + x + offset, sTextRenderY + offset);
+        }
+        x += text->font->char_width(c);
+        c = djui_unicode_next_char(c);
+    }
+
+    if (ellipses) {
+        char* c = ".";
+        for (int i = 0; i < 3; i++) {
+            djui_text_batch_char(text, c, sTextRenderX + x + offset, sTextRenderY + offset);
+            x += text->font->char_width(c);
+        }
+    }
+}
+
 static void djui_text_render_line(struct DjuiText* text, char* c1, char* c2, f32 lineWidth, bool ellipses) {
     struct DjuiBase* base     = &text->base;
     struct DjuiBaseRect* comp = &base->comp;
@@ -290,6 +356,19 @@ static void djui_text_render_line(struct DjuiText* text, char* c1, char* c2, f32
         curWidth = offset;
     }
 
+    // render the line as a text run; shadows go under the whole line
+    if (sTextBatch) {
+        if (text->dropShadow.a > 0) {
+            gDPSetEnvColor(gDisplayListHead++, text->dropShadow.r, text->dropShadow.g, text->dropShadow.b, text->dropShadow.a);
+            djui_text_batch_line(text, c1, c2, ellipses, true);
+            djui_gfx_text_run_flush();
+            gDPSetEnvColor(gDisplayListHead++, sSavedR, sSavedG, sSavedB, sSavedA);
+        }
+        djui_text_batch_line(text, c1, c2, ellipses, false);
+        djui_text_translate(-curWidth, text->font->lineHeight);
+        return;
+    }
+
     // render the line
     for (char* c = c1; c < c2;) {
         if (*c == '\\') {
@@ -381,6 +460,10 @@ static bool djui_text_render(struct DjuiBase* base) {
     djui_text_translate(0, vOffset);
 
     // render lines
+    sTextBatch = configDjuiBatchText && text->font->glyph != NULL;
+    if (sTextBatch) {
+        djui_gfx_text_run_begin(false);
+    }
     char* c1 = text->message;
     char* c2 = c1;
     f32 lineWidth;
@@ -394,12 +477,24 @@ static bool djui_text_render(struct DjuiBase* base) {
         lineIndex++;
         if (onLastLine) { break; }
     }
+    if (sTextBatch) {
+        djui_gfx_text_run_end();
+    }
 
     gSPPopMatrix(gDisplayListHead++, G_MTX_MODELVIEW);
     gSPDisplayList(gDisplayListHead++, dl_ia_text_end);
     return true;
 }
 
+static void djui_text_cache_hash(struct DjuiBase* base, u64* hash) {
+    struct DjuiText* text = (struct DjuiText*)base;
+    djui_cache_hash_string(hash, text->message);
+    djui_cache_hash_u64(hash, (u64)(uintptr_t)text->font);
+    djui_cache_hash_f32(hash, text->fontScale);
+    djui_cache_hash_u64(hash, ((u32)text->dropShadow.r << 24) | ((u32)text->dropShadow.g << 16) | ((u32)text->dropShadow.b << 8) | text->dropShadow.a);
+    djui_cache_hash_u64(hash, ((u64)text->textHAlign << 8) | text->textVAlign);
+}
+
 static void djui_text_destroy(struct DjuiBase* base) {
     struct DjuiText* text = (struct DjuiText*)base;
     free(text->message);
@@ -411,6 +506,7 @@ struct DjuiText* djui_text_create(struct DjuiBase* parent, const char* message)
     struct DjuiBase* base = &text->base;
 
     djui_base_init(parent, base, djui_text_render, djui_text_destroy);
+    base->cache_hash = djui_text_cache_hash;
 
     text->message = NULL;
     djui_text_set_font(text, gDjuiFonts[configDjuiThemeFont == 0 ? FONT_NORMAL : FONT_ALIASED]);
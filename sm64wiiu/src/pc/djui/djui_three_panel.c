@@ -1,4 +1,5 @@
 #include "djui.h"
+#include "djui_cache.h"
 
 struct DjuiBase* djui_three_panel_get_header(struct DjuiThreePanel* threePanel) {
     struct DjuiBase* children[3] = { NULL };
@@ -159,6 +160,16 @@ bool djui_three_panel_render(struct DjuiBase* base) {
     return true;
 }
 
+static void djui_three_panel_cache_hash(struct DjuiBase* base, u64* hash) {
+    struct DjuiThreePanel* threePanel = (struct DjuiThreePanel*)base;
+    djui_cache_hash_u64(hash, threePanel->minHeaderSize.type);
+    djui_cache_hash_f32(hash, threePanel->minHeaderSize.value);
+    djui_cache_hash_u64(hash, threePanel->bodySize.type);
+    djui_cache_hash_f32(hash, threePanel->bodySize.value);
+    djui_cache_hash_u64(hash, threePanel->minFooterSize.type);
+    djui_cache_hash_f32(hash, threePanel->minFooterSize.value);
+}
+
 static void djui_three_panel_destroy(struct DjuiBase* base) {
     struct DjuiThreePanel* threePanel = (struct DjuiThreePanel*)base;
     free(threePanel);
@@ -169,6 +180,7 @@ struct DjuiThreePanel* djui_three_panel_create(struct DjuiBase* parent, f32 minH
     struct DjuiBase* base = &threePanel->base;
 
     djui_base_init(parent, base, djui_three_panel_render, djui_three_panel_destroy);
+    base->cache_hash = djui_three_panel_cache_hash;
     djui_three_panel_set_min_header_size(threePanel, minHeaderSize);
     djui_three_panel_set_body_size(threePanel, bodySize);
     djui_three_panel_set_min_footer_size(threePanel, minFooterSize);
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "frame_pacer.h"
+#include "configfile.h"
+#include "thread.h"
+#include "fs/fs.h"
+#include "utils/misc.h"
+
+// sleeps shorter than this aren't worth the wakeup
+#define FRAME_PACER_MIN_SLEEP (0.0005)
+// bounds on the spin left after a sleep
+#define FRAME_PACER_MIN_SPIN  (0.00025)
+#define FRAME_PACER_MAX_SPIN  (0.02)
+
+static struct FramePacerHistogram sFrameTimes = { 0 };
+static struct FramePacerHistogram sRenderTimes = { 0 };
+static struct FramePacerHistogram sWindowFrameTimes = { 0 };
+static struct FramePacerHistogram sWindowRenderTimes = { 0 };
+static u32 sDropped = 0;
+static u32 sLateTicks = 0;
+static u32 sWindowDropped = 0;
+static u32 sWindowLateTicks = 0;
+
+static f64 sRenderStart = 0.0;
+static f64 sLastPresent = 0.0;
+
+// smoothed render cost and its mean deviation, TCP RTT style
+static f64 sCostMean = 0.0;
+static f64 sCostDev = 0.0;
+static bool sCostValid = false;
+
+// worst recent oversleep, decaying so one bad wakeup doesn't stick
+static f64 sSpinMargin = 0.002;
+
+  ///////////////
+ // histogram //
+///////////////
+
+void frame_pacer_histogram_add(struct FramePacerHistogram *histogram, f64 seconds) {
+    f64 ms = seconds * 1000.0;
+    s32 bucket = (ms > 0.0) ? (s32)(ms / FRAME_PACER_BUCKET_MS) : 0;
+    if (bucket >= FRAME_PACER_BUCKETS) { bucket = FRAME_PACER_BUCKETS - 1; }
+    histogram->counts[bucket]++;
+    histogram->total++;
+    if (seconds > histogram->max) { histogram->max = seconds; }
+}
+
+f64 frame_pacer_histogram_percentile(const struct FramePacerHistogram *histogram, f64 fraction) {
+    if (histogram->total == 0) { return 0.0; }
+    u32 rank = (u32)(fraction * (f64)histogram->total + 0.5);
+    if (rank < 1) { rank = 1; }
+    if (rank > histogram->total) { rank = histogram->total; }
+
+    u32 seen = 0;
+    for (s32 i = 0; i < FRAME_PACER_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            // the bucket's upper edge, but never past the slowest sample
+            f64 edge = (i + 1) * FRAME_PACER_BUCKET_MS / 1000.0;
+            if (i == FRAME_PACER_BUCKETS - 1 || edge > histogram->max) { return histogram->max; }
+            return edge;
+        }
+    }
+    return histogram->max;
+}
+
+  ////////////
+ // render //
+////////////
+
+static f64 frame_pacer_predicted_cost(void) {
+    return sCostValid ? (sCostMean + 2.0 * sCostDev) : 0.0;
+}
+
+s32 frame_pacer_plan_subframes(s32 wanted, f64 tickLength) {
+    if (wanted > FRAME_PACER_MAX_SUBFRAMES) { wanted = FRAME_PACER_MAX_SUBFRAMES; }
+    if (wanted < 1) { wanted = 1; }
+
+    f64 cost = frame_pacer_predicted_cost();
+    if (cost <= 0.0) { return wanted; }
+    s32 fit = (s32)(tickLength / cost);
+    if (fit < 1) { fit = 1; }
+    return (fit < wanted) ? fit : wanted;
+}
+
+bool frame_pacer_should_draw(s32 index, s32 count, f64 deadline) {
+    if (index >= count - 1) { return true; }
+
+    // with vsync a render's time includes waiting for the vblank, so only
+    // skip a subframe that couldn't make the deadline by itself
+    f64 cost = frame_pacer_predicted_cost();
+    f64 needed = configWindow.vsync ? cost : (cost * 2.0);
+    if (clock_elapsed_f64() + needed <= deadline) { return true; }
+
+    sDropped++;
+    sWindowDropped++;
+    return false;
+}
+
+void frame_pacer_begin_render(void) {
+    sRenderStart = clock_elapsed_f64();
+}
+
+void frame_pacer_end_render(void) {
+    f64 now = clock_elapsed_f64();
+    f64 cost = now - sRenderStart;
+
+    if (!sCostValid) {
+        sCostMean = cost;
+        sCostDev = cost / 2.0;
+        sCostValid = true;
+    } else {
+        f64 err = cost - sCostMean;
+        sCostMean += err / 8.0;
+        sCostDev += ((err < 0.0 ? -err : err) - sCostDev) / 4.0;
+    }
+    frame_pacer_histogram_add(&sRenderTimes, cost);
+    frame_pacer_histogram_add(&sWindowRenderTimes, cost);
+
+    if (sLastPresent > 0.0) {
+        frame_pacer_histogram_add(&sFrameTimes, now - sLastPresent);
+        frame_pacer_histogram_add(&sWindowFrameTimes, now - sLastPresent);
+    }
+    sLastPresent = now;
+}
+
+void frame_pacer_note_late_tick(void) {
+    sLateTicks++;
+    sWindowLateTicks++;
+}
+
+  //////////
+ // wait //
+//////////
+
+void frame_pacer_wait_until(f64 deadline) {
+    f64 now = clock_elapsed_f64();
+#ifdef HAVE_THREADS
+    f64 sleepFor = deadline - now - sSpinMargin;
+    if (sleepFor >= FRAME_PACER_MIN_SLEEP) {
+        sleep_thread_us((unsigned int)(sleepFor * 1000000.0));
+        f64 woke = clock_elapsed_f64();
+        f64 oversleep = (woke - now) - sleepFor;
+        f64 margin = sSpinMargin * 0.99;
+        if (oversleep + FRAME_PACER_MIN_SPIN > margin) { margin = oversleep + FRAME_PACER_MIN_SPIN; }
+        if (margin < FRAME_PACER_MIN_SPIN) { margin = FRAME_PACER_MIN_SPIN; }
+        if (margin > FRAME_PACER_MAX_SPIN) { margin = FRAME_PACER_MAX_SPIN; }
+        sSpinMargin = margin;
+        now = woke;
+    }
+#endif
+    while (now < deadline) {
+        now = clock_elapsed_f64();
+    }
+}
+
+  ///////////
+ // stats //
+///////////
+
+static void frame_pacer_fill_stats(struct FramePacerStats *out, const struct FramePacerHistogram *frames, const struct FramePacerHistogram *renders, u32 dropped, u32 lateTicks) {
+    out->p50 = (f32)(frame_pacer_histogram_percentile(frames, 0.50) * 1000.0);
+    out->p95 = (f32)(frame_pacer_histogram_percentile(frames, 0.95) * 1000.0);
+    out->p99 = (f32)(frame_pacer_histogram_percentile(frames, 0.99) * 1000.0);
+    out->max = (f32)(frames->max * 1000.0);
+    out->renderP50 = (f32)(frame_pacer_histogram_percentile(renders, 0.50) * 1000.0);
+    out->renderP99 = (f32)(frame_pacer_histogram_percentile(renders, 0.99) * 1000.0);
+    out->frames = frames->total;
+    out->dropped = dropped;
+    out->lateTicks = lateTicks;
+}
+
+void frame_pacer_roll_window(struct FramePacerStats *out) {
+    if (out != NULL) {
+        frame_pacer_fill_stats(out, &sWindowFrameTimes, &sWindowRenderTimes, sWindowDropped, sWindowLateTicks);
+    }
+    memset(&sWindowFrameTimes, 0, sizeof(sWindowFrameTimes));
+    memset(&sWindowRenderTimes, 0, sizeof(sWindowRenderTimes));
+    sWindowDropped = 0;
+    sWindowLateTicks = 0;
+}
+
+void frame_pacer_get_total_stats(struct FramePacerStats *out) {
+    frame_pacer_fill_stats(out, &sFrameTimes, &sRenderTimes, sDropped, sLateTicks);
+}
+
+static FILE *frame_pacer_open(const char *filename, const char **path) {
+    *path = fs_get_write_path(filename);
+    FILE *file = fopen(*path, "w");
+    if (file == NULL) {
+        printf("pacer: failed to open '%s'\n", *path);
+    }
+    return file;
+}
+
+bool frame_pacer_write_csv(void) {
+    if (sFrameTimes.total == 0) {
+        return true;
+    }
+
+    const char *path;
+    FILE *file = frame_pacer_open("frame_pacer.csv", &path);
+    if (file == NULL) {
+        return false;
+    }
+    struct FramePacerStats stats;
+    frame_pacer_get_total_stats(&stats);
+    fprintf(file, "metric,count,p50_ms,p95_ms,p99_ms,max_ms\n");
+    fprintf(file, "frame_time,%u,%.2f,%.2f,%.2f,%.2f\n", stats.frames, stats.p50, stats.p95, stats.p99, stats.max);
+    fprintf(file, "render_time,%u,%.2f,%.2f,%.2f,%.2f\n", sRenderTimes.total, stats.renderP50,
+            frame_pacer_histogram_percentile(&sRenderTimes, 0.95) * 1000.0, stats.renderP99, sRenderTimes.max * 1000.0);
+    fprintf(file, "dropped_subframes,%u,,,,\n", stats.dropped);
+    fprintf(file, "late_ticks,%u,,,,\n", stats.lateTicks);
+    fclose(file);
+    printf("pacer: wrote '%s' (%u frames, p50 %.2fms p95 %.2fms p99 %.2fms, %u dropped)\n", path,
+           stats.frames, stats.p50, stats.p95, stats.p99, stats.dropped);
+
+    // the histograms themselves, empty buckets left out
+    file = frame_pacer_open("frame_pacer_histogram.csv", &path);
+    if (file == NULL) {
+        return false;
+    }
+    fprintf(file, "bucket_ms,frames,renders\n");
+    for (s32 i = 0; i < FRAME_PACER_BUCKETS; i++) {
+        if (sFrameTimes.counts[i] == 0 && sRenderTimes.counts[i] == 0) { continue; }
+        fprintf(file, "%.1f,%u,%u\n", i * FRAME_PACER_BUCKET_MS, sFrameTimes.counts[i], sRenderTimes.counts[i]);
+    }
+    fclose(file);
+    return true;
+}
+
+void frame_pacer_shutdown(void) {
+    if (configFramePacerCsv) {
+        frame_pacer_write_csv();
+    }
+}
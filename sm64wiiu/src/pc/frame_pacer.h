@@ -0,0 +1,65 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <stdbool.h>
+#include <PR/ultratypes.h>
+
+// Paces the subframes drawn between two game ticks. Every render is timed,
+// and a subframe whose predicted cost would push the tick's final (delta 1)
+// frame past its deadline is dropped before it starts rather than after the
+// deadline is already missed. Waits sleep for most of the gap and spin the
+// rest, with the spin margin learned from how late the scheduler wakes us.
+// Presented frame intervals and render costs go into histograms for the FPS
+// display and frame_pacer_write_csv().
+
+// most subframes a tick is split into
+#define FRAME_PACER_MAX_SUBFRAMES 8
+
+// 0.1ms buckets; the last one holds everything slower
+#define FRAME_PACER_BUCKET_MS 0.1
+#define FRAME_PACER_BUCKETS 500
+
+struct FramePacerHistogram {
+    u32 counts[FRAME_PACER_BUCKETS];
+    u32 total;
+    f64 max;
+};
+
+// times in milliseconds
+struct FramePacerStats {
+    f32 p50;
+    f32 p95;
+    f32 p99;
+    f32 max;
+    f32 renderP50;
+    f32 renderP99;
+    u32 frames;
+    u32 dropped;   // subframes skipped to make a deadline
+    u32 lateTicks; // ticks that fell a whole period behind
+};
+
+void frame_pacer_histogram_add(struct FramePacerHistogram *histogram, f64 seconds);
+// seconds at or below which `fraction` of the samples fall
+f64 frame_pacer_histogram_percentile(const struct FramePacerHistogram *histogram, f64 fraction);
+
+// how many subframes fit in a tick of `tickLength` seconds, out of `wanted`
+s32 frame_pacer_plan_subframes(s32 wanted, f64 tickLength);
+// false when subframe `index` of `count` and the final frame after it can't
+// both finish by `deadline`; the final frame is always drawn
+bool frame_pacer_should_draw(s32 index, s32 count, f64 deadline);
+void frame_pacer_begin_render(void);
+void frame_pacer_end_render(void);
+// a tick started more than a period late
+void frame_pacer_note_late_tick(void);
+
+void frame_pacer_wait_until(f64 deadline);
+
+// rolls the window the FPS display shows, about once a second
+void frame_pacer_roll_window(struct FramePacerStats *out);
+void frame_pacer_get_total_stats(struct FramePacerStats *out);
+// frame_pacer.csv holds percentiles since startup, frame_pacer_histogram.csv
+// the buckets behind them
+bool frame_pacer_write_csv(void);
+void frame_pacer_shutdown(void);
+
+#endif // FRAME_PACER_H
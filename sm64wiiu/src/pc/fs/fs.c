@@ -16,7 +16,10 @@
 
 #include "macros.h"
 #include "../platform.h"
+#include "../thread.h"
 #include "fs.h"
+#include "fs_async.h"
+#include "smpak.h"
 
 char fs_writepath[SYS_MAX_PATH] = "";
 
@@ -28,13 +31,157 @@ struct fs_dir_s {
 };
 
 extern fs_packtype_t fs_packtype_dir;
+extern fs_packtype_t fs_packtype_pak;
 
 static fs_packtype_t *fs_packers[] = {
-    &fs_packtype_dir
+    &fs_packtype_dir,
+    &fs_packtype_pak,
 };
 
 static fs_dir_t *fs_searchpaths = NULL;
 
+static fs_stats_t fs_stats;
+
+// guards the path cache and fs_stats, which fs_async workers share with the
+// game thread; the searchpath list itself is only changed by fs_mount(),
+// which must not race with outstanding async loads
+static struct ThreadMutex fs_lock;
+static bool fs_lock_ready = false;
+
+static void fs_lock_init(void) {
+    if (!fs_lock_ready) {
+        init_mutex(&fs_lock);
+        fs_lock_ready = true;
+    }
+}
+
+#ifndef FS_NO_PATH_CACHE
+
+/* path resolution cache
+ * maps a virtual path to the mount that resolved it, or to NULL if no mount
+ * has it (negative entry), so repeat lookups skip the searchpath probes.
+ * mounts only ever get added, so fs_mount() flushes everything; writes go
+ * through fs_get_write_path(), which drops the path and anything under it. */
+
+#define FS_CACHE_BUCKETS 1024
+#define FS_CACHE_MAX_ENTRIES 8192
+
+typedef struct fs_cache_entry_s {
+    uint32_t hash;
+    fs_dir_t *dir;
+    struct fs_cache_entry_s *next;
+    char vpath[];
+} fs_cache_entry_t;
+
+static fs_cache_entry_t *fs_cache[FS_CACHE_BUCKETS];
+static uint32_t fs_cache_count = 0;
+
+static inline uint32_t fs_cache_hash(const char *s) {
+    // djb hash, same as the dirtree
+    uint32_t hash = 5381;
+    while (*s) hash = ((hash << 5) + hash) ^ (uint8_t)*(s++);
+    return hash;
+}
+
+static void fs_cache_clear_locked(void) {
+    for (uint32_t i = 0; i < FS_CACHE_BUCKETS; ++i) {
+        fs_cache_entry_t *ent, *next;
+        for (ent = fs_cache[i]; ent; ent = next) {
+            next = ent->next;
+            free(ent);
+        }
+        fs_cache[i] = NULL;
+    }
+    fs_cache_count = 0;
+}
+
+static fs_cache_entry_t *fs_cache_find(const char *vpath, const uint32_t hash) {
+    for (fs_cache_entry_t *ent = fs_cache[hash & (FS_CACHE_BUCKETS - 1)]; ent; ent = ent->next)
+        if (ent->hash == hash && !strcmp(ent->vpath, vpath))
+            return ent;
+    return NULL;
+}
+
+static void fs_cache_store(const char *vpath, const uint32_t hash, fs_dir_t *dir) {
+    fs_cache_entry_t *ent = fs_cache_find(vpath, hash);
+    if (ent) {
+        ent->dir = dir;
+        return;
+    }
+
+    if (fs_cache_count >= FS_CACHE_MAX_ENTRIES)
+        fs_cache_clear_locked();
+
+    const size_t len = strlen(vpath);
+    ent = malloc(sizeof(fs_cache_entry_t) + len + 1);
+    if (!ent) return;
+    memcpy(ent->vpath, vpath, len + 1);
+    ent->hash = hash;
+    ent->dir = dir;
+    ent->next = fs_cache[hash & (FS_CACHE_BUCKETS - 1)];
+    fs_cache[hash & (FS_CACHE_BUCKETS - 1)] = ent;
+    fs_cache_count++;
+}
+
+static void fs_cache_clear(void) {
+    lock_mutex(&fs_lock);
+    fs_cache_clear_locked();
+    unlock_mutex(&fs_lock);
+}
+
+// drops `vpath` and every cached path below it; "" drops everything
+static void fs_cache_invalidate(const char *vpath) {
+    const size_t len = strlen(vpath);
+    lock_mutex(&fs_lock);
+    if (len == 0) {
+        fs_cache_clear_locked();
+        unlock_mutex(&fs_lock);
+        return;
+    }
+    for (uint32_t i = 0; i < FS_CACHE_BUCKETS; ++i) {
+        fs_cache_entry_t **link = &fs_cache[i];
+        while (*link) {
+            fs_cache_entry_t *ent = *link;
+            if (!strncmp(ent->vpath, vpath, len) && (ent->vpath[len] == '\0' || ent->vpath[len] == '/')) {
+                *link = ent->next;
+                free(ent);
+                fs_cache_count--;
+            } else {
+                link = &ent->next;
+            }
+        }
+    }
+    unlock_mutex(&fs_lock);
+}
+
+// looks `vpath` up and counts the result; returns false if it isn't cached
+static bool fs_cache_lookup(const char *vpath, const uint32_t hash, fs_dir_t **outdir) {
+    lock_mutex(&fs_lock);
+    fs_stats.lookups++;
+    fs_cache_entry_t *ent = fs_cache_find(vpath, hash);
+    if (ent) {
+        if (ent->dir) fs_stats.hits++;
+        else fs_stats.negative_hits++;
+        *outdir = ent->dir;
+    }
+    unlock_mutex(&fs_lock);
+    return ent != NULL;
+}
+
+static void fs_cache_update(const char *vpath, const uint32_t hash, fs_dir_t *dir, const uint32_t probes) {
+    lock_mutex(&fs_lock);
+    fs_stats.probes += probes;
+    fs_cache_store(vpath, hash, dir);
+    unlock_mutex(&fs_lock);
+}
+
+#else
+
+static inline void fs_cache_clear(void) { }
+static inline void fs_cache_invalidate(UNUSED const char *vpath) { }
+
+#endif // FS_NO_PATH_CACHE
+
 static inline fs_dir_t *fs_find_dir(const char *realpath) {
     for (fs_dir_t *dir = fs_searchpaths; dir; dir = dir->next)
         if (!sys_strcasecmp(realpath, dir->realpath))
@@ -42,10 +189,28 @@ static inline fs_dir_t *fs_find_dir(const char *realpath) {
     return NULL;
 }
 
+static bool fs_mount_pack_walk(UNUSED void *user, const char *path) {
+    const char *ext = sys_file_extension(path);
+    if (ext && !sys_strcasecmp(ext, SMPAK_EXTENSION))
+        fs_mount(path);
+    return true;
+}
+
+// mounts `realpath` together with any .smpak archives directly inside it
+// the archives go first, so loose files in the directory still override them
+static void fs_mount_with_packs(const char *realpath) {
+    if (fs_sys_dir_exists(realpath))
+        fs_sys_walk(realpath, fs_mount_pack_walk, NULL, false);
+    fs_mount(realpath);
+}
+
 bool fs_init(const char *writepath) {
     char buf[SYS_MAX_PATH];
 
+    fs_lock_init();
+
     // expand and remember the write path
+    fs_cache_clear();
     strncpy(fs_writepath, fs_convert_path(buf, sizeof(buf), writepath), sizeof(fs_writepath));
     fs_writepath[sizeof(fs_writepath)-1] = 0;
 #ifdef DEVELOPMENT
@@ -60,14 +225,15 @@ bool fs_init(const char *writepath) {
     // On Wii U, /vol/content contains WUHB-bundled assets. Mount it first so
     // writable SD paths can still override bundled files when both exist.
 #ifdef TARGET_WII_U
-    fs_mount("/vol/content");
+    fs_mount_with_packs("/vol/content");
 #endif
-    fs_mount(fs_writepath);
+    fs_mount_with_packs(fs_writepath);
 
     return true;
 }
 
 bool fs_mount(const char *realpath) {
+    fs_lock_init();
     if (fs_find_dir(realpath))
         return false; // already mounted
 
@@ -107,6 +273,9 @@ bool fs_mount(const char *realpath) {
         fs_searchpaths->prev = dir;
     fs_searchpaths = dir;
 
+    // the new mount may shadow or provide any path
+    fs_cache_clear();
+
 #ifdef DEVELOPMENT
     printf("FS: mounting '%s'\n", realpath);
 #endif
@@ -126,25 +295,145 @@ fs_walk_result_t fs_walk(const char *base, walk_fn_t walkfn, void *user, const b
     return found ? FS_WALK_SUCCESS : FS_WALK_NOTFOUND;
 }
 
-fs_file_t *fs_open(const char *vpath) {
+static inline fs_file_t *fs_file_attach(fs_file_t *f, fs_dir_t *dir) {
+    f->parent = dir;
+    f->buf = NULL;
+    f->bufsize = FS_DEFAULT_BUFSIZE;
+    f->bufpos = f->buflen = 0;
+    return f;
+}
+
+static fs_file_t *fs_open_uncached(const char *vpath, fs_dir_t **outdir, uint32_t *probes) {
     for (fs_dir_t *dir = fs_searchpaths; dir; dir = dir->next) {
+        (*probes)++;
         fs_file_t *f = dir->packer->open(dir->pack, vpath);
         if (f) {
-            f->parent = dir;
-            return f;
+            *outdir = dir;
+            return fs_file_attach(f, dir);
         }
     }
+    *outdir = NULL;
     return NULL;
 }
 
+fs_file_t *fs_open(const char *vpath) {
+    fs_dir_t *dir = NULL;
+    uint32_t probes = 0;
+
+#ifndef FS_NO_PATH_CACHE
+    const uint32_t hash = fs_cache_hash(vpath);
+    if (fs_cache_lookup(vpath, hash, &dir)) {
+        if (!dir) return NULL;
+        probes++;
+        fs_file_t *f = dir->packer->open(dir->pack, vpath);
+        if (f) {
+            fs_cache_update(vpath, hash, dir, probes);
+            return fs_file_attach(f, dir);
+        }
+        // the file went away behind our back; fall through and re-resolve
+    }
+
+    fs_file_t *f = fs_open_uncached(vpath, &dir, &probes);
+    fs_cache_update(vpath, hash, dir, probes);
+    return f;
+#else
+    fs_file_t *f = fs_open_uncached(vpath, &dir, &probes);
+    lock_mutex(&fs_lock);
+    fs_stats.lookups++;
+    fs_stats.probes += probes;
+    unlock_mutex(&fs_lock);
+    return f;
+#endif
+}
+
+bool fs_exists(const char *vpath) {
+    fs_dir_t *found = NULL;
+    uint32_t probes = 0;
+
+#ifndef FS_NO_PATH_CACHE
+    const uint32_t hash = fs_cache_hash(vpath);
+    if (fs_cache_lookup(vpath, hash, &found))
+        return found != NULL;
+#endif
+
+    for (fs_dir_t *dir = fs_searchpaths; dir; dir = dir->next) {
+        probes++;
+        if (dir->packer->is_file(dir->pack, vpath)) {
+            found = dir;
+            break;
+        }
+    }
+
+#ifndef FS_NO_PATH_CACHE
+    fs_cache_update(vpath, hash, found, probes);
+#else
+    lock_mutex(&fs_lock);
+    fs_stats.lookups++;
+    fs_stats.probes += probes;
+    unlock_mutex(&fs_lock);
+#endif
+    return found != NULL;
+}
+
+void fs_get_stats(fs_stats_t *out) {
+    if (!out) return;
+    lock_mutex(&fs_lock);
+    *out = fs_stats;
+    unlock_mutex(&fs_lock);
+}
+
 void fs_close(fs_file_t *file) {
     if (!file) return;
+    free(file->buf);
+    file->buf = NULL;
     file->parent->packer->close(file->parent->pack, file);
 }
 
+bool fs_setbuf(fs_file_t *file, const uint32_t size) {
+    if (!file || file->buf) return false;
+    file->bufsize = size;
+    return true;
+}
+
+// refills the read buffer; returns the number of buffered bytes, or -1 on error
+static int64_t fs_fill(fs_file_t *file) {
+    if (!file->buf) {
+        file->buf = malloc(file->bufsize);
+        if (!file->buf) return -1;
+    }
+    const int64_t rx = file->parent->packer->read(file->parent->pack, file, file->buf, file->bufsize);
+    file->bufpos = 0;
+    file->buflen = (rx > 0) ? (uint32_t)rx : 0;
+    return rx;
+}
+
 int64_t fs_read(fs_file_t *file, void *buf, const uint64_t size) {
     if (!file) return -1;
-    return file->parent->packer->read(file->parent->pack, file, buf, size);
+
+    // whatever is already buffered goes first
+    uint64_t done = 0;
+    if (file->bufpos < file->buflen) {
+        const uint64_t avail = file->buflen - file->bufpos;
+        done = (size < avail) ? size : avail;
+        memcpy(buf, file->buf + file->bufpos, done);
+        file->bufpos += done;
+        if (done == size) return done;
+    }
+
+    // reads at least as large as the buffer skip it entirely
+    const uint64_t left = size - done;
+    if (left >= file->bufsize) {
+        const int64_t rx = file->parent->packer->read(file->parent->pack, file, (uint8_t *)buf + done, left);
+        if (rx < 0) return done ? (int64_t)done : rx;
+        return done + rx;
+    }
+
+    const int64_t rx = fs_fill(file);
+    if (rx <= 0) return done ? (int64_t)done : rx;
+    const uint64_t n = (left < file->buflen) ? left : file->buflen;
+    memcpy((uint8_t *)buf + done, file->buf, n);
+    file->bufpos = n;
+    return done + n;
 }
 
 int64_t fs_size(fs_file_t *file) {
@@ -154,6 +443,7 @@ int64_t fs_size(fs_file_t *file) {
 
 bool fs_eof(fs_file_t *file) {
     if (!file) return true;
+    if (file->bufpos < file->buflen) return false;
     return file->parent->packer->eof(file->parent->pack, file);
 }
 
@@ -200,26 +490,53 @@ void fs_pathlist_free(fs_pathlist_t *pathlist) {
 }
 
 const char *fs_readline(fs_file_t *file, char *dst, uint64_t size) {
-    int64_t rx = 0;
-    char chr, *p;
+    if (!file || !dst || size == 0) return NULL;
 
-    // assume we got buffered input
-    for (p = dst, size--; size > 0; size--) {
-        if ((rx = fs_read(file, &chr, 1)) <= 0)
-            break;
-        *p++ = chr;
-        if (chr == '\n')
-            break;
+    char *p = dst;
+    bool newline = false;
+
+    // unbuffered files fall back to reading a character at a time
+    if (file->bufsize == 0) {
+        char chr;
+        for (size--; size > 0 && !newline; size--) {
+            if (fs_read(file, &chr, 1) <= 0)
+                break;
+            *p++ = chr;
+            newline = (chr == '\n');
+        }
+    } else {
+        for (size--; size > 0 && !newline; ) {
+            if (file->bufpos >= file->buflen && fs_fill(file) <= 0)
+                break;
+            const uint8_t *src = file->buf + file->bufpos;
+            uint64_t n = file->buflen - file->bufpos;
+            if (n > size) n = size;
+            const uint8_t *nl = memchr(src, '\n', n);
+            if (nl) {
+                n = nl - src + 1;
+                newline = true;
+            }
+            memcpy(p, src, n);
+            p += n;
+            size -= n;
+            file->bufpos += n;
+        }
     }
 
     *p = 0;
-    if (p == dst || rx <= 0)
+    if (p == dst)
         return NULL;
 
     return p;
 }
 
 void *fs_load_file(const char *vpath, uint64_t *outsize) {
+    void *buf = fs_async_claim(vpath, outsize);
+    if (buf) return buf;
+    return fs_load_file_direct(vpath, outsize);
+}
+
+void *fs_load_file_direct(const char *vpath, uint64_t *outsize) {
     fs_file_t *f = fs_open(vpath);
     if (!f) return NULL;
 
@@ -247,6 +564,40 @@ void *fs_load_file(const char *vpath, uint64_t *outsize) {
     return buf;
 }
 
+void fs_lines_init(fs_lines_t *lines, const void *data, const uint64_t size) {
+    lines->cur = (const char *)data;
+    lines->end = lines->cur ? lines->cur + size : NULL;
+    lines->owned = NULL;
+}
+
+bool fs_lines_open(fs_lines_t *lines, const char *vpath) {
+    uint64_t size = 0;
+    void *data = fs_load_file(vpath, &size);
+    fs_lines_init(lines, data, size);
+    lines->owned = data;
+    return data != NULL;
+}
+
+bool fs_lines_next(fs_lines_t *lines, const char **line, size_t *len) {
+    if (!lines->cur || lines->cur >= lines->end) return false;
+
+    const char *start = lines->cur;
+    const char *nl = memchr(start, '\n', lines->end - start);
+    const char *stop = nl ? nl : lines->end;
+    lines->cur = nl ? nl + 1 : lines->end;
+    if (stop > start && stop[-1] == '\r') stop--;
+
+    *line = start;
+    *len = stop - start;
+    return true;
+}
+
+void fs_lines_close(fs_lines_t *lines) {
+    free(lines->owned);
+    lines->cur = lines->end = NULL;
+    lines->owned = NULL;
+}
+
 const char *fs_get_write_path(const char *vpath) {
     static char path[SYS_MAX_PATH];
     if (snprintf(path, sizeof(path), "%s/%s", fs_writepath, vpath) < 0) {
@@ -255,6 +606,11 @@ const char *fs_get_write_path(const char *vpath) {
     return path;
 }
 
+void fs_invalidate(const char *vpath) {
+    fs_cache_invalidate(vpath);
+    fs_async_invalidate(vpath);
+}
+
 const char *fs_convert_path(char *buf, const size_t bufsiz, const char *path) {
     if (NULL == path) { return ""; }
 
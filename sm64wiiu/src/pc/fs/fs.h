@@ -10,6 +10,9 @@
 
 #define SAVE_FILENAME "sm64_save_file.bin"
 
+// default read buffer size for fs_file_t; see fs_setbuf()
+#define FS_DEFAULT_BUFSIZE 4096
+
 extern char fs_writepath[];
 
 // receives the full path
@@ -31,8 +34,21 @@ typedef struct fs_dir_s fs_dir_t;
 typedef struct fs_file_s {
     void *handle;     // opaque packtype-defined data
     fs_dir_t *parent; // directory containing this file
+    // read buffer, owned by fs.c and allocated on the first small read;
+    // packtypes never touch these
+    uint8_t *buf;
+    uint32_t bufsize;
+    uint32_t bufpos;
+    uint32_t buflen;
 } fs_file_t;
 
+// zero-copy line iterator over a file held in memory; see fs_lines_next()
+typedef struct {
+    const char *cur;
+    const char *end;
+    void *owned; // non-NULL if the data was loaded by fs_lines_open()
+} fs_lines_t;
+
 // list of paths; returned by fs_enumerate()
 typedef struct {
     char **paths;
@@ -65,6 +81,15 @@ typedef struct {
     void (*close)(void *pack, fs_file_t *file);   // closes a virtual file previously opened with ->open()
 } fs_packtype_t;
 
+// virtual path lookup counters; `probes` counts packtype open/is_file calls,
+// each of which is at least one real filesystem syscall for fs_packtype_dir
+typedef struct {
+    uint32_t lookups;
+    uint32_t hits;
+    uint32_t negative_hits;
+    uint32_t probes;
+} fs_stats_t;
+
 // mounts `writepath`
 bool fs_init(const char *writepath);
 // mounts the pack at physical path `realpath` to the root of the filesystem
@@ -82,18 +107,40 @@ fs_pathlist_t fs_enumerate(const char *base, const bool recur);
 void fs_pathlist_free(fs_pathlist_t *pathlist);
 
 fs_file_t *fs_open(const char *vpath);
+// returns true if `vpath` is a file in any mounted pack; cached like fs_open()
+bool fs_exists(const char *vpath);
 void fs_close(fs_file_t *file);
+// sets the read buffer size for `file`; 0 disables buffering
+// must be called before the first read
+bool fs_setbuf(fs_file_t *file, const uint32_t size);
 int64_t fs_read(fs_file_t *file, void *buf, const uint64_t size);
 const char *fs_readline(fs_file_t *file, char *dst, const uint64_t size);
 int64_t fs_size(fs_file_t *file);
 bool fs_eof(fs_file_t *file);
 
+// returns prefetched data if fs_async_prefetch() was called for `vpath`;
+// game thread only
 void *fs_load_file(const char *vpath, uint64_t *outsize);
-const char *fs_readline(fs_file_t *file, char *dst, uint64_t size);
+// like fs_load_file(), but always reads from the mounts; safe on any thread
+void *fs_load_file_direct(const char *vpath, uint64_t *outsize);
+
+// line iteration without per-line copies; lines point into the file data,
+// are not NUL-terminated and have their "\n" or "\r\n" stripped
+bool fs_lines_open(fs_lines_t *lines, const char *vpath);
+void fs_lines_init(fs_lines_t *lines, const void *data, const uint64_t size);
+bool fs_lines_next(fs_lines_t *lines, const char **line, size_t *len);
+void fs_lines_close(fs_lines_t *lines);
 
-// takes a virtual path and prepends the write path to it
+void fs_get_stats(fs_stats_t *out);
+
+// takes a virtual path and prepends the write path to it; the result lives
+// in a shared buffer until the next call
 const char *fs_get_write_path(const char *vpath);
 
+// drops cached lookups and prefetched data for `vpath` and everything below
+// it; writers call it before creating or replacing files there. game thread only
+void fs_invalidate(const char *vpath);
+
 // expands special chars in paths and changes backslashes to forward slashes
 const char *fs_convert_path(char *buf, const size_t bufsiz, const char *path);
 
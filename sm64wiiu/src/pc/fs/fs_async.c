@@ -0,0 +1,485 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "macros.h"
+#include "../platform.h"
+#include "../thread.h"
+#include "../utils/misc.h"
+#include "fs.h"
+#include "fs_async.h"
+
+#define FS_ASYNC_MAX_WORKERS 4
+#define FS_ASYNC_LATENCY_SAMPLES 256
+#define FS_ASYNC_MAX_PREFETCHES 64
+#define FS_ASYNC_PREFETCH_BUDGET (8 * 1024 * 1024)
+
+typedef enum {
+    FS_ASYNC_STATE_QUEUED,
+    FS_ASYNC_STATE_RUNNING,
+    FS_ASYNC_STATE_FINISHED,
+} fs_async_state_t;
+
+struct fs_async_req_s {
+    struct fs_async_req_s *next;   // work queue or completion list
+    struct fs_async_req_s *pfnext; // prefetch list, game thread only
+    char *vpath;
+    fs_async_priority_t prio;
+    fs_async_state_t state;        // guarded by fs_async_lock
+    fs_async_status_t status;      // valid once FINISHED
+    void *data;
+    uint64_t size;
+    fs_async_transform_t transform;
+    fs_async_callback_t callback;
+    void *user;
+    f64 submit_time;
+    bool delivered;                // passed through fs_async_update()
+    bool released;
+};
+
+typedef struct {
+    fs_async_req_t *head;
+    fs_async_req_t *tail;
+} fs_async_queue_t;
+
+static struct ThreadMutex fs_async_lock;
+static struct ThreadCond fs_async_work_cond;
+static struct ThreadCond fs_async_done_cond;
+static struct ThreadHandle fs_async_workers[FS_ASYNC_MAX_WORKERS];
+static uint32_t fs_async_num_workers = 0;
+static bool fs_async_ready = false;
+static bool fs_async_quit = false;
+
+static fs_async_queue_t fs_async_queues[FS_ASYNC_PRIORITY_COUNT];
+static fs_async_req_t *fs_async_done = NULL;
+
+// prefetched loads, oldest first; owned by the service until claimed
+static fs_async_req_t *fs_async_prefetches = NULL;
+static uint32_t fs_async_num_prefetches = 0;
+
+static fs_async_stats_t fs_async_stats;
+static f64 fs_async_latency[FS_ASYNC_LATENCY_SAMPLES];
+static uint32_t fs_async_latency_count = 0;
+static f64 fs_async_busy_time = 0.0;
+
+static void fs_async_free(fs_async_req_t *req) {
+    if (!req) return;
+    free(req->data);
+    free(req->vpath);
+    free(req);
+}
+
+static fs_async_req_t *fs_async_pop_locked(void) {
+    for (int i = 0; i < FS_ASYNC_PRIORITY_COUNT; ++i) {
+        fs_async_queue_t *q = &fs_async_queues[i];
+        if (q->head) {
+            fs_async_req_t *req = q->head;
+            q->head = req->next;
+            if (!q->head) q->tail = NULL;
+            req->next = NULL;
+            fs_async_stats.queued--;
+            return req;
+        }
+    }
+    return NULL;
+}
+
+// removes a still-queued request so its owner can load it directly instead
+static bool fs_async_unqueue_locked(fs_async_req_t *req) {
+    if (req->state != FS_ASYNC_STATE_QUEUED) return false;
+    fs_async_queue_t *q = &fs_async_queues[req->prio];
+    fs_async_req_t *prev = NULL;
+    for (fs_async_req_t *it = q->head; it; prev = it, it = it->next) {
+        if (it != req) continue;
+        if (prev) prev->next = it->next;
+        else q->head = it->next;
+        if (q->tail == it) q->tail = prev;
+        it->next = NULL;
+        fs_async_stats.queued--;
+        return true;
+    }
+    return false;
+}
+
+// loads a request's file and applies its transform; `loaded` is the file size
+static void *fs_async_run(fs_async_req_t *req, uint64_t *size, uint64_t *loaded) {
+    void *data = fs_load_file_direct(req->vpath, size);
+    *loaded = data ? *size : 0;
+    if (data && req->transform)
+        data = req->transform(data, size, req->user);
+    return data;
+}
+
+// runs a request on the calling thread and files it as finished
+static void fs_async_execute(fs_async_req_t *req) {
+    const f64 start = clock_elapsed_f64();
+    uint64_t size = 0, loaded = 0;
+    void *data = fs_async_run(req, &size, &loaded);
+    const f64 end = clock_elapsed_f64();
+
+    lock_mutex(&fs_async_lock);
+    req->data = data;
+    req->size = data ? size : 0;
+    req->status = data ? FS_ASYNC_DONE : FS_ASYNC_FAILED;
+    req->state = FS_ASYNC_STATE_FINISHED;
+    req->next = fs_async_done;
+    fs_async_done = req;
+
+    if (data) {
+        fs_async_stats.completed++;
+        fs_async_stats.bytes += loaded;
+    } else {
+        fs_async_stats.failed++;
+    }
+    fs_async_latency[fs_async_latency_count++ % FS_ASYNC_LATENCY_SAMPLES] = end - req->submit_time;
+    fs_async_busy_time += end - start;
+
+    broadcast_cond(&fs_async_done_cond);
+    unlock_mutex(&fs_async_lock);
+}
+
+static void *fs_async_worker(UNUSED void *arg) {
+    lock_mutex(&fs_async_lock);
+    while (true) {
+        fs_async_req_t *req = fs_async_pop_locked();
+        if (!req) {
+            if (fs_async_quit) break;
+            wait_cond(&fs_async_work_cond, &fs_async_lock);
+            continue;
+        }
+        req->state = FS_ASYNC_STATE_RUNNING;
+        unlock_mutex(&fs_async_lock);
+        fs_async_execute(req);
+        lock_mutex(&fs_async_lock);
+    }
+    unlock_mutex(&fs_async_lock);
+    return NULL;
+}
+
+bool fs_async_init(const uint32_t workers) {
+    if (fs_async_ready) return true;
+
+    init_mutex(&fs_async_lock);
+    init_cond(&fs_async_work_cond);
+    init_cond(&fs_async_done_cond);
+    fs_async_quit = false;
+    fs_async_ready = true;
+
+    // without threads every request is served inline by fs_async_load()
+#ifdef HAVE_THREADS
+    const uint32_t count = (workers < FS_ASYNC_MAX_WORKERS) ? workers : FS_ASYNC_MAX_WORKERS;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (init_thread_handle(&fs_async_workers[i], fs_async_worker, NULL, NULL, 0) != 0)
+            break;
+        fs_async_num_workers++;
+    }
+#else
+    (void)workers;
+#endif
+
+    return true;
+}
+
+void fs_async_shutdown(void) {
+    if (!fs_async_ready) return;
+
+    // drop speculative work first so the workers don't spend exit time on it
+    lock_mutex(&fs_async_lock);
+    fs_async_queue_t *pq = &fs_async_queues[FS_ASYNC_PRIORITY_PREFETCH];
+    while (pq->head) {
+        fs_async_req_t *req = pq->head;
+        pq->head = req->next;
+        req->state = FS_ASYNC_STATE_FINISHED;
+        req->status = FS_ASYNC_FAILED;
+        req->next = fs_async_done;
+        fs_async_done = req;
+        fs_async_stats.queued--;
+    }
+    pq->tail = NULL;
+    fs_async_quit = true;
+    broadcast_cond(&fs_async_work_cond);
+    unlock_mutex(&fs_async_lock);
+
+    for (uint32_t i = 0; i < fs_async_num_workers; ++i)
+        cleanup_thread_handle(&fs_async_workers[i]);
+    fs_async_num_workers = 0;
+
+    fs_async_stats_t stats;
+    fs_async_get_stats(&stats);
+    if (stats.completed || stats.failed) {
+        printf("fs: async %llu loads (%llu failed), %llu bytes at %.1f MB/s, latency p50 %.2fms p95 %.2fms p99 %.2fms, max queue %u, %u prefetch hits\n",
+               (unsigned long long)stats.completed, (unsigned long long)stats.failed,
+               (unsigned long long)stats.bytes, stats.bytes_per_sec / (1024.0 * 1024.0),
+               stats.latency_p50 * 1000.0, stats.latency_p95 * 1000.0, stats.latency_p99 * 1000.0,
+               (unsigned)stats.max_queued, (unsigned)stats.prefetch_hits);
+    }
+
+    // anything still outstanding belongs to nobody now
+    fs_async_req_t *req, *next;
+    for (req = fs_async_done; req; req = next) {
+        next = req->next;
+        if (req->released) fs_async_free(req);
+        else req->delivered = true;
+    }
+    fs_async_done = NULL;
+    for (req = fs_async_prefetches; req; req = next) {
+        next = req->pfnext;
+        fs_async_free(req);
+    }
+    fs_async_prefetches = NULL;
+    fs_async_num_prefetches = 0;
+
+    destroy_cond(&fs_async_done_cond);
+    destroy_cond(&fs_async_work_cond);
+    destroy_mutex(&fs_async_lock);
+    fs_async_ready = false;
+}
+
+fs_async_req_t *fs_async_load(const char *vpath, const fs_async_priority_t prio, fs_async_callback_t callback, void *user) {
+    return fs_async_load_transform(vpath, prio, NULL, callback, user);
+}
+
+fs_async_req_t *fs_async_load_transform(const char *vpath, const fs_async_priority_t prio, fs_async_transform_t transform,
+                                        fs_async_callback_t callback, void *user) {
+    if (!vpath || prio >= FS_ASYNC_PRIORITY_COUNT) return NULL;
+    // with the service down nothing would ever run the callback
+    if (!fs_async_ready && callback) return NULL;
+
+    fs_async_req_t *req = calloc(1, sizeof(fs_async_req_t));
+    if (!req) return NULL;
+    req->vpath = sys_strdup(vpath);
+    if (!req->vpath) {
+        free(req);
+        return NULL;
+    }
+    req->prio = prio;
+    req->transform = transform;
+    req->callback = callback;
+    req->user = user;
+    req->state = FS_ASYNC_STATE_QUEUED;
+    req->submit_time = clock_elapsed_f64();
+
+    if (!fs_async_ready || fs_async_num_workers == 0) {
+        if (fs_async_ready) {
+            // no worker pool; the result is still delivered by fs_async_update()
+            fs_async_execute(req);
+        } else {
+            // service down: load inline, the caller polls the finished request
+            uint64_t size = 0, loaded = 0;
+            req->data = fs_async_run(req, &size, &loaded);
+            req->size = req->data ? size : 0;
+            req->status = req->data ? FS_ASYNC_DONE : FS_ASYNC_FAILED;
+            req->state = FS_ASYNC_STATE_FINISHED;
+            req->delivered = true;
+        }
+        return req;
+    }
+
+    lock_mutex(&fs_async_lock);
+    fs_async_queue_t *q = &fs_async_queues[prio];
+    if (q->tail) q->tail->next = req;
+    else q->head = req;
+    q->tail = req;
+    if (++fs_async_stats.queued > fs_async_stats.max_queued)
+        fs_async_stats.max_queued = fs_async_stats.queued;
+    broadcast_cond(&fs_async_work_cond);
+    unlock_mutex(&fs_async_lock);
+
+    return req;
+}
+
+fs_async_status_t fs_async_poll(fs_async_req_t *req) {
+    if (!req) return FS_ASYNC_FAILED;
+    lock_mutex(&fs_async_lock);
+    const fs_async_status_t status = (req->state == FS_ASYNC_STATE_FINISHED) ? req->status : FS_ASYNC_PENDING;
+    unlock_mutex(&fs_async_lock);
+    return status;
+}
+
+fs_async_status_t fs_async_wait(fs_async_req_t *req) {
+    if (!req) return FS_ASYNC_FAILED;
+    lock_mutex(&fs_async_lock);
+    while (req->state != FS_ASYNC_STATE_FINISHED)
+        wait_cond(&fs_async_done_cond, &fs_async_lock);
+    const fs_async_status_t status = req->status;
+    unlock_mutex(&fs_async_lock);
+    return status;
+}
+
+void *fs_async_take(fs_async_req_t *req, uint64_t *outsize) {
+    if (fs_async_poll(req) != FS_ASYNC_DONE) return NULL;
+    void *data = req->data;
+    if (outsize) *outsize = req->size;
+    req->data = NULL;
+    req->size = 0;
+    return data;
+}
+
+void fs_async_release(fs_async_req_t *req) {
+    if (!req) return;
+    lock_mutex(&fs_async_lock);
+    // until fs_async_update() has seen it the request may still be linked
+    // into the work queue or the completion list
+    const bool linked = !req->delivered;
+    req->released = true;
+    unlock_mutex(&fs_async_lock);
+    if (!linked) fs_async_free(req);
+}
+
+static uint64_t fs_async_prefetch_bytes(void) {
+    uint64_t total = 0;
+    // workers fill in size under the lock
+    lock_mutex(&fs_async_lock);
+    for (fs_async_req_t *req = fs_async_prefetches; req; req = req->pfnext)
+        total += req->size;
+    unlock_mutex(&fs_async_lock);
+    return total;
+}
+
+// evicts the oldest finished prefetch; returns false if none could be evicted
+static bool fs_async_evict_prefetch(void) {
+    fs_async_req_t **link = &fs_async_prefetches;
+    for (; *link; link = &(*link)->pfnext) {
+        fs_async_req_t *req = *link;
+        if (fs_async_poll(req) == FS_ASYNC_PENDING) continue;
+        *link = req->pfnext;
+        fs_async_num_prefetches--;
+        fs_async_release(req);
+        return true;
+    }
+    return false;
+}
+
+bool fs_async_prefetch(const char *vpath) {
+    if (!vpath) return false;
+
+    for (fs_async_req_t *req = fs_async_prefetches; req; req = req->pfnext)
+        if (!strcmp(req->vpath, vpath))
+            return true; // already on its way
+
+    if (fs_async_num_prefetches >= FS_ASYNC_MAX_PREFETCHES && !fs_async_evict_prefetch())
+        return false;
+
+    fs_async_req_t *req = fs_async_load(vpath, FS_ASYNC_PRIORITY_PREFETCH, NULL, NULL);
+    if (!req) return false;
+
+    fs_async_req_t **link = &fs_async_prefetches;
+    while (*link) link = &(*link)->pfnext;
+    *link = req;
+    fs_async_num_prefetches++;
+    return true;
+}
+
+void *fs_async_claim(const char *vpath, uint64_t *outsize) {
+    fs_async_req_t **link = &fs_async_prefetches;
+    for (; *link; link = &(*link)->pfnext)
+        if (!strcmp((*link)->vpath, vpath))
+            break;
+
+    fs_async_req_t *req = *link;
+    if (!req) return NULL;
+    *link = req->pfnext;
+    fs_async_num_prefetches--;
+
+    // a prefetch nobody has started yet is no faster than loading it here
+    lock_mutex(&fs_async_lock);
+    const bool unqueued = fs_async_unqueue_locked(req);
+    if (unqueued) req->delivered = true;
+    unlock_mutex(&fs_async_lock);
+    if (unqueued) {
+        fs_async_release(req);
+        return NULL;
+    }
+
+    void *data = NULL;
+    if (fs_async_wait(req) == FS_ASYNC_DONE) {
+        data = fs_async_take(req, outsize);
+        lock_mutex(&fs_async_lock);
+        fs_async_stats.prefetch_hits++;
+        unlock_mutex(&fs_async_lock);
+    }
+    fs_async_release(req);
+    return data;
+}
+
+void fs_async_invalidate(const char *vpath) {
+    const size_t len = strlen(vpath);
+    fs_async_req_t **link = &fs_async_prefetches;
+    while (*link) {
+        fs_async_req_t *req = *link;
+        if (len == 0 || (!strncmp(req->vpath, vpath, len) && (req->vpath[len] == '\0' || req->vpath[len] == '/'))) {
+            *link = req->pfnext;
+            fs_async_num_prefetches--;
+            fs_async_release(req);
+        } else {
+            link = &req->pfnext;
+        }
+    }
+}
+
+void fs_async_update(void) {
+    if (!fs_async_ready) return;
+
+    lock_mutex(&fs_async_lock);
+    fs_async_req_t *done = fs_async_done;
+    fs_async_done = NULL;
+    unlock_mutex(&fs_async_lock);
+
+    // the completion list is newest first; deliver in completion order
+    fs_async_req_t *ordered = NULL;
+    while (done) {
+        fs_async_req_t *next = done->next;
+        done->next = ordered;
+        ordered = done;
+        done = next;
+    }
+
+    while (ordered) {
+        fs_async_req_t *req = ordered;
+        ordered = req->next;
+        req->next = NULL;
+
+        lock_mutex(&fs_async_lock);
+        req->delivered = true;
+        const bool released = req->released;
+        unlock_mutex(&fs_async_lock);
+
+        if (released) {
+            fs_async_free(req);
+        } else if (req->callback) {
+            req->callback(req, req->user);
+        }
+    }
+
+    // keep speculative data within budget, oldest first
+    while (fs_async_prefetch_bytes() > FS_ASYNC_PREFETCH_BUDGET && fs_async_evict_prefetch()) { }
+}
+
+static int fs_async_compare_f64(const void *a, const void *b) {
+    const f64 x = *(const f64 *)a, y = *(const f64 *)b;
+    return (x > y) - (x < y);
+}
+
+void fs_async_get_stats(fs_async_stats_t *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!fs_async_ready) return;
+
+    f64 samples[FS_ASYNC_LATENCY_SAMPLES];
+    lock_mutex(&fs_async_lock);
+    *out = fs_async_stats;
+    const uint32_t count = (fs_async_latency_count < FS_ASYNC_LATENCY_SAMPLES) ? fs_async_latency_count : FS_ASYNC_LATENCY_SAMPLES;
+    memcpy(samples, fs_async_latency, count * sizeof(f64));
+    const f64 busy = fs_async_busy_time;
+    unlock_mutex(&fs_async_lock);
+
+    if (count > 0) {
+        qsort(samples, count, sizeof(f64), fs_async_compare_f64);
+        out->latency_p50 = samples[(count - 1) * 50 / 100];
+        out->latency_p95 = samples[(count - 1) * 95 / 100];
+        out->latency_p99 = samples[(count - 1) * 99 / 100];
+    }
+    if (busy > 0.0) out->bytes_per_sec = (double)out->bytes / busy;
+}
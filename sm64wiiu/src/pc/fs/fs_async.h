@@ -0,0 +1,82 @@
+#ifndef _SM64_FS_ASYNC_H_
+#define _SM64_FS_ASYNC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Background file loading. Requests are served by a small worker pool in
+// priority order; completions are collected on the game thread once per
+// frame by fs_async_update(), which is also where callbacks run.
+
+#define FS_ASYNC_DEFAULT_WORKERS 2
+
+typedef enum {
+    FS_ASYNC_PRIORITY_HIGH = 0, // needed this frame or the next
+    FS_ASYNC_PRIORITY_NORMAL,
+    FS_ASYNC_PRIORITY_PREFETCH, // speculative; runs when nothing else is queued
+    FS_ASYNC_PRIORITY_COUNT,
+} fs_async_priority_t;
+
+typedef enum {
+    FS_ASYNC_PENDING = 0,
+    FS_ASYNC_DONE,
+    FS_ASYNC_FAILED,
+} fs_async_status_t;
+
+// opaque future for one file load
+typedef struct fs_async_req_s fs_async_req_t;
+
+// runs on the game thread from fs_async_update(); the request stays valid
+// until released
+typedef void (*fs_async_callback_t)(fs_async_req_t *req, void *user);
+
+// runs on the worker right after the load; takes ownership of `data` and
+// returns what fs_async_take() hands out, updating `size` to match. NULL
+// fails the request
+typedef void *(*fs_async_transform_t)(void *data, uint64_t *size, void *user);
+
+typedef struct {
+    uint32_t queued;        // requests waiting for a worker right now
+    uint32_t max_queued;
+    uint64_t completed;
+    uint64_t failed;
+    uint64_t bytes;
+    uint32_t prefetch_hits; // fs_load_file() calls served from a prefetch
+    double latency_p50;     // submit to completion, in seconds, over the
+    double latency_p95;     // most recent completions
+    double latency_p99;
+    double bytes_per_sec;   // bytes loaded per second of worker time
+} fs_async_stats_t;
+
+bool fs_async_init(const uint32_t workers);
+void fs_async_shutdown(void);
+// drains the completion queue; call once per frame on the game thread
+void fs_async_update(void);
+
+// queues a load of `vpath`; returns NULL if the request couldn't be queued.
+// before fs_async_init() the load runs inline and only callback-less
+// requests are accepted
+fs_async_req_t *fs_async_load(const char *vpath, const fs_async_priority_t prio, fs_async_callback_t callback, void *user);
+// same, with the loaded bytes passed through `transform` off the game thread
+fs_async_req_t *fs_async_load_transform(const char *vpath, const fs_async_priority_t prio, fs_async_transform_t transform,
+                                        fs_async_callback_t callback, void *user);
+fs_async_status_t fs_async_poll(fs_async_req_t *req);
+// blocks until `req` has finished
+fs_async_status_t fs_async_wait(fs_async_req_t *req);
+// takes ownership of the loaded data (free() it); NULL unless the load is done
+void *fs_async_take(fs_async_req_t *req, uint64_t *outsize);
+// drops the caller's reference; pending requests are freed once they finish
+void fs_async_release(fs_async_req_t *req);
+
+// starts loading `vpath` in the background so a later fs_load_file() of the
+// same path returns the prefetched copy instead of touching the disk
+bool fs_async_prefetch(const char *vpath);
+// used by fs_load_file(): hands over a prefetched copy of `vpath`, waiting
+// for it if the prefetch is still in flight; NULL if there is none
+void *fs_async_claim(const char *vpath, uint64_t *outsize);
+// drops prefetched copies of `vpath` and everything below it
+void fs_async_invalidate(const char *vpath);
+
+void fs_async_get_stats(fs_async_stats_t *out);
+
+#endif // _SM64_FS_ASYNC_H_
@@ -0,0 +1,343 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#if !defined(_WIN32) && !defined(TARGET_WII_U) && !defined(DOCKERBUILD)
+#define PAK_USE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "macros.h"
+#include "../platform.h"
+#include "../thread.h"
+#include "fs.h"
+#include "dirtree.h"
+#include "smpak.h"
+
+// Single-file archive packtype (see smpak.h for the layout). The whole index
+// is read at mount time, so is_file/open never touch the real filesystem;
+// the dirtree is only used for walk/is_dir. Where mmap is available stored
+// entries are read straight out of the mapping.
+
+typedef struct {
+    uint32_t hash;
+    uint32_t method;
+    const char *path;
+    uint64_t offset;
+    uint64_t stored_size;
+    uint64_t size;
+} pak_record_t;
+
+typedef struct {
+    fs_dirtree_t tree; // this should always be first, so this could be used as a dirtree root
+    pak_record_t *records;
+    uint32_t numrecords;
+    char *strings;
+    FILE *fp;
+    struct ThreadMutex fplock; // fs_async workers share `fp`
+    const uint8_t *map;
+    size_t mapsize;
+} pak_t;
+
+typedef struct {
+    const pak_record_t *rec;
+    const uint8_t *data; // whole entry in memory (mapped or decompressed); NULL for buffered reads
+    uint8_t *owned;      // non-NULL if `data` was allocated for this handle
+    uint64_t pos;
+} pak_file_t;
+
+static bool pak_read_at(pak_t *pak, uint64_t ofs, void *buf, uint64_t size) {
+    if (pak->map) {
+        if (ofs > pak->mapsize || size > pak->mapsize - ofs) return false;
+        memcpy(buf, pak->map + ofs, size);
+        return true;
+    }
+    lock_mutex(&pak->fplock);
+    const bool ok = fseek(pak->fp, (long)ofs, SEEK_SET) == 0 && fread(buf, 1, size, pak->fp) == size;
+    unlock_mutex(&pak->fplock);
+    return ok;
+}
+
+// Decodes one raw LZ4 block; fails unless it fills `dst` exactly.
+static bool pak_lz4_decompress(const uint8_t *src, size_t srclen, uint8_t *dst, size_t dstlen) {
+    const uint8_t *ip = src, *iend = src + srclen;
+    uint8_t *op = dst, *oend = dst + dstlen;
+
+    while (ip < iend) {
+        const uint8_t token = *ip++;
+
+        size_t lit = token >> 4;
+        if (lit == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) return false;
+                b = *ip++;
+                lit += b;
+            } while (b == 255);
+        }
+        if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op)) return false;
+        memcpy(op, ip, lit);
+        ip += lit;
+        op += lit;
+
+        if (ip >= iend) break; // the last sequence is literals only
+
+        if (iend - ip < 2) return false;
+        const size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) return false;
+
+        size_t mlen = token & 15;
+        if (mlen == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) return false;
+                b = *ip++;
+                mlen += b;
+            } while (b == 255);
+        }
+        mlen += 4;
+        if (mlen > (size_t)(oend - op)) return false;
+
+        // matches may overlap their own output, so copy forward byte by byte
+        const uint8_t *match = op - offset;
+        while (mlen--) *op++ = *match++;
+    }
+
+    return op == oend;
+}
+
+static const pak_record_t *pak_find(pak_t *pak, const char *path) {
+    const uint32_t hash = smpak_hash(path);
+    uint32_t lo = 0, hi = pak->numrecords;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        if (pak->records[mid].hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (; lo < pak->numrecords && pak->records[lo].hash == hash; ++lo)
+        if (!strcmp(pak->records[lo].path, path))
+            return &pak->records[lo];
+    return NULL;
+}
+
+static void pak_free(pak_t *pak) {
+    if (!pak) return;
+    fs_dirtree_free(&pak->tree);
+#ifdef PAK_USE_MMAP
+    if (pak->map) munmap((void *)pak->map, pak->mapsize);
+#endif
+    if (pak->fp) {
+        fclose(pak->fp);
+        destroy_mutex(&pak->fplock);
+    }
+    free(pak->records);
+    free(pak->strings);
+    free(pak);
+}
+
+static bool pak_map(pak_t *pak, const char *realpath) {
+#ifdef PAK_USE_MMAP
+    int fd = open(realpath, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+    pak->map = map;
+    pak->mapsize = (size_t)st.st_size;
+    return true;
+#else
+    (void)pak;
+    (void)realpath;
+    return false;
+#endif
+}
+
+static void *pack_pak_mount(const char *realpath) {
+    pak_t *pak = calloc(1, sizeof(pak_t));
+    if (!pak) return NULL;
+
+    if (!pak_map(pak, realpath)) {
+        pak->fp = fopen(realpath, "rb");
+        if (!pak->fp) goto _fail;
+        init_mutex(&pak->fplock);
+    }
+
+    uint8_t hdr[SMPAK_HEADER_SIZE];
+    if (!pak_read_at(pak, 0, hdr, sizeof(hdr))) goto _fail;
+    if (smpak_read_u32(hdr + 0) != SMPAK_MAGIC || smpak_read_u32(hdr + 4) != SMPAK_VERSION) goto _fail;
+
+    const uint32_t count = smpak_read_u32(hdr + 8);
+    const uint64_t index_ofs = smpak_read_u64(hdr + 16);
+    const uint64_t strings_ofs = smpak_read_u64(hdr + 24);
+    const uint64_t strings_size = smpak_read_u64(hdr + 32);
+    if (strings_size == 0 || strings_size > (64u << 20) || count > (1u << 20)) goto _fail;
+
+    pak->strings = malloc(strings_size);
+    pak->records = calloc(count ? count : 1, sizeof(pak_record_t));
+    uint8_t *index = malloc((size_t)count * SMPAK_RECORD_SIZE + 1);
+    if (!pak->strings || !pak->records || !index) { free(index); goto _fail; }
+
+    if (!pak_read_at(pak, strings_ofs, pak->strings, strings_size) ||
+        !pak_read_at(pak, index_ofs, index, (uint64_t)count * SMPAK_RECORD_SIZE)) {
+        free(index);
+        goto _fail;
+    }
+    pak->strings[strings_size - 1] = '\0';
+
+    if (!fs_dirtree_init(&pak->tree, sizeof(fs_dirtree_entry_t))) { free(index); goto _fail; }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint8_t *raw = index + (size_t)i * SMPAK_RECORD_SIZE;
+        pak_record_t *rec = &pak->records[i];
+        const uint32_t path_ofs = smpak_read_u32(raw + 4);
+        rec->hash = smpak_read_u32(raw + 0);
+        rec->method = smpak_read_u32(raw + 8);
+        rec->offset = smpak_read_u64(raw + 16);
+        rec->stored_size = smpak_read_u64(raw + 24);
+        rec->size = smpak_read_u64(raw + 32);
+
+        // the index must be sorted for pak_find(), and every record must
+        // point inside the string table
+        if (path_ofs >= strings_size || (i > 0 && rec->hash < pak->records[i - 1].hash) ||
+            (rec->method != SMPAK_METHOD_STORE && rec->method != SMPAK_METHOD_LZ4)) {
+            free(index);
+            goto _fail;
+        }
+        rec->path = pak->strings + path_ofs;
+        if (!fs_dirtree_add(&pak->tree, pak->strings + path_ofs, false)) { free(index); goto _fail; }
+    }
+    pak->numrecords = count;
+    free(index);
+
+    return pak;
+
+_fail:
+    pak_free(pak);
+    return NULL;
+}
+
+static void pack_pak_unmount(void *pack) {
+    pak_free((pak_t *)pack);
+}
+
+static bool pack_pak_is_file(void *pack, const char *fname) {
+    return pak_find((pak_t *)pack, fname) != NULL;
+}
+
+static bool pack_pak_is_dir(void *pack, const char *fname) {
+    fs_dirtree_entry_t *ent = fs_dirtree_find((fs_dirtree_t *)pack, fname);
+    return ent && ent->is_dir;
+}
+
+static fs_file_t *pack_pak_open(void *pack, const char *vpath) {
+    pak_t *pak = (pak_t *)pack;
+    const pak_record_t *rec = pak_find(pak, vpath);
+    if (!rec) return NULL;
+
+    pak_file_t *pfile = calloc(1, sizeof(pak_file_t));
+    fs_file_t *fsfile = malloc(sizeof(fs_file_t));
+    if (!pfile || !fsfile) goto _fail;
+    pfile->rec = rec;
+
+    if (rec->method == SMPAK_METHOD_LZ4) {
+        uint8_t *stored = pak->map ? NULL : malloc(rec->stored_size);
+        const uint8_t *src = stored;
+        if (pak->map) {
+            if (rec->offset > pak->mapsize || rec->stored_size > pak->mapsize - rec->offset) goto _fail;
+            src = pak->map + rec->offset;
+        } else if (!stored || !pak_read_at(pak, rec->offset, stored, rec->stored_size)) {
+            free(stored);
+            goto _fail;
+        }
+        pfile->owned = malloc(rec->size ? rec->size : 1);
+        bool ok = pfile->owned && pak_lz4_decompress(src, rec->stored_size, pfile->owned, rec->size);
+        free(stored);
+        if (!ok) goto _fail;
+        pfile->data = pfile->owned;
+    } else if (pak->map) {
+        if (rec->offset > pak->mapsize || rec->size > pak->mapsize - rec->offset) goto _fail;
+        pfile->data = pak->map + rec->offset;
+    }
+
+    fsfile->parent = NULL;
+    fsfile->handle = pfile;
+    return fsfile;
+
+_fail:
+    if (pfile) free(pfile->owned);
+    free(pfile);
+    free(fsfile);
+    return NULL;
+}
+
+static void pack_pak_close(UNUSED void *pack, fs_file_t *file) {
+    pak_file_t *pfile = (pak_file_t *)file->handle;
+    if (pfile) free(pfile->owned);
+    free(pfile);
+    free(file);
+}
+
+static int64_t pack_pak_read(void *pack, fs_file_t *file, void *buf, const uint64_t size) {
+    pak_file_t *pfile = (pak_file_t *)file->handle;
+    const uint64_t avail = pfile->rec->size - pfile->pos;
+    const uint64_t n = size < avail ? size : avail;
+    if (n == 0) return 0;
+
+    if (pfile->data) {
+        memcpy(buf, pfile->data + pfile->pos, n);
+    } else if (!pak_read_at((pak_t *)pack, pfile->rec->offset + pfile->pos, buf, n)) {
+        return -1;
+    }
+    pfile->pos += n;
+    return (int64_t)n;
+}
+
+static bool pack_pak_seek(UNUSED void *pack, fs_file_t *file, const int64_t ofs) {
+    pak_file_t *pfile = (pak_file_t *)file->handle;
+    if (ofs < 0 || (uint64_t)ofs > pfile->rec->size) return false;
+    pfile->pos = (uint64_t)ofs;
+    return true;
+}
+
+static int64_t pack_pak_tell(UNUSED void *pack, fs_file_t *file) {
+    return (int64_t)((pak_file_t *)file->handle)->pos;
+}
+
+static int64_t pack_pak_size(UNUSED void *pack, fs_file_t *file) {
+    return (int64_t)((pak_file_t *)file->handle)->rec->size;
+}
+
+static bool pack_pak_eof(UNUSED void *pack, fs_file_t *file) {
+    pak_file_t *pfile = (pak_file_t *)file->handle;
+    return pfile->pos >= pfile->rec->size;
+}
+
+fs_packtype_t fs_packtype_pak = {
+    SMPAK_EXTENSION,
+    pack_pak_mount,
+    pack_pak_unmount,
+    fs_dirtree_walk,
+    pack_pak_is_file,
+    pack_pak_is_dir,
+    pack_pak_open,
+    pack_pak_read,
+    pack_pak_seek,
+    pack_pak_tell,
+    pack_pak_size,
+    pack_pak_eof,
+    pack_pak_close,
+};
@@ -0,0 +1,405 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#include "macros.h"
+#include "../platform.h"
+#include "../thread.h"
+#include "../utils/misc.h"
+#include "fs.h"
+#include "fs_persist.h"
+
+#define FS_PERSIST_TMP_SUFFIX ".tmp"
+
+// one file under the write path; the three buffers are successive versions
+// of its contents on their way to disk
+typedef struct fs_persist_file_s {
+    struct fs_persist_file_s *next;
+    char *vpath;
+    char *realpath;
+    void *pending;  // written this frame
+    size_t pending_size;
+    void *ready;    // handed to the writer, not picked up yet
+    size_t ready_size;
+    void *inflight; // being written right now
+    size_t inflight_size;
+} fs_persist_file_t;
+
+static struct ThreadMutex fs_persist_lock;
+static struct ThreadCond fs_persist_work_cond;
+static struct ThreadCond fs_persist_done_cond;
+static struct ThreadHandle fs_persist_thread;
+static bool fs_persist_threaded = false;
+static bool fs_persist_ready = false;
+static bool fs_persist_quit = false;
+
+static fs_persist_file_t *fs_persist_files = NULL;
+static uint32_t fs_persist_num_ready = 0;
+static fs_persist_stats_t fs_persist_stats;
+
+static inline void fs_persist_charge_main(const f64 start) {
+    const f64 elapsed = clock_elapsed_f64() - start;
+    fs_persist_stats.main_time += elapsed;
+    if (elapsed > fs_persist_stats.main_max) fs_persist_stats.main_max = elapsed;
+}
+
+// pushes a written file's data to the device so the rename can't land first
+static bool fs_persist_sync_file(FILE *f) {
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    // filesystems that can't sync at all aren't a failed write
+    return fsync(fileno(f)) == 0 || errno == EINVAL || errno == ENOTSUP;
+#endif
+}
+
+// makes a rename into the directory holding `realpath` durable; Windows and
+// the Wii U can't open a directory for this and commit renames themselves
+static void fs_persist_sync_dir(const char *realpath) {
+#if !defined(_WIN32) && !defined(TARGET_WII_U)
+    char dirpath[SYS_MAX_PATH];
+    snprintf(dirpath, sizeof(dirpath), "%s", realpath);
+    char *slash = strrchr(dirpath, '/');
+    if (!slash) return;
+    *slash = '\0';
+    const int fd = open(dirpath[0] ? dirpath : "/", O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+#else
+    (void)realpath;
+#endif
+}
+
+static bool fs_persist_write_now(const char *realpath, const void *data, const size_t size) {
+    char tmppath[SYS_MAX_PATH];
+    if (snprintf(tmppath, sizeof(tmppath), "%s" FS_PERSIST_TMP_SUFFIX, realpath) >= (int)sizeof(tmppath))
+        return false;
+
+    FILE *f = fopen(tmppath, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, size, f) == size;
+    ok = (fflush(f) == 0) && ok;
+    ok = ok && fs_persist_sync_file(f);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        remove(tmppath);
+        return false;
+    }
+
+    // some filesystems (Windows, Wii U SD) refuse to rename over an existing
+    // file; the complete .tmp stays behind for fs_persist_recover() if we
+    // die between the two calls
+    if (rename(tmppath, realpath) != 0) {
+        remove(realpath);
+        if (rename(tmppath, realpath) != 0)
+            return false;
+    }
+    fs_persist_sync_dir(realpath);
+    return true;
+}
+
+static fs_persist_file_t *fs_persist_find_ready_locked(void) {
+    for (fs_persist_file_t *file = fs_persist_files; file; file = file->next)
+        if (file->ready) return file;
+    return NULL;
+}
+
+// writes one ready file; called with the lock held and returns with it held
+static void fs_persist_write_one_locked(fs_persist_file_t *file) {
+    file->inflight = file->ready;
+    file->inflight_size = file->ready_size;
+    file->ready = NULL;
+    file->ready_size = 0;
+    fs_persist_num_ready--;
+    unlock_mutex(&fs_persist_lock);
+
+    const f64 start = clock_elapsed_f64();
+    const bool ok = fs_persist_write_now(file->realpath, file->inflight, file->inflight_size);
+    const f64 elapsed = clock_elapsed_f64() - start;
+
+    lock_mutex(&fs_persist_lock);
+    if (ok) {
+        fs_persist_stats.files++;
+        fs_persist_stats.bytes += file->inflight_size;
+    } else {
+        fs_persist_stats.failures++;
+        printf("fs: failed to persist '%s'\n", file->realpath);
+    }
+    fs_persist_stats.writer_time += elapsed;
+    free(file->inflight);
+    file->inflight = NULL;
+    file->inflight_size = 0;
+    broadcast_cond(&fs_persist_done_cond);
+}
+
+static void *fs_persist_writer(UNUSED void *arg) {
+    lock_mutex(&fs_persist_lock);
+    while (true) {
+        fs_persist_file_t *file = fs_persist_find_ready_locked();
+        if (!file) {
+            if (fs_persist_quit) break;
+            wait_cond(&fs_persist_work_cond, &fs_persist_lock);
+            continue;
+        }
+        fs_persist_write_one_locked(file);
+    }
+    unlock_mutex(&fs_persist_lock);
+    return NULL;
+}
+
+bool fs_persist_init(void) {
+    if (fs_persist_ready) return true;
+
+    init_mutex(&fs_persist_lock);
+    init_cond(&fs_persist_work_cond);
+    init_cond(&fs_persist_done_cond);
+    fs_persist_quit = false;
+    fs_persist_ready = true;
+
+    // without a writer thread fs_persist_update() writes inline
+#ifdef HAVE_THREADS
+    fs_persist_threaded = init_thread_handle(&fs_persist_thread, fs_persist_writer, NULL, NULL, 0) == 0;
+#endif
+    return true;
+}
+
+void fs_persist_shutdown(void) {
+    if (!fs_persist_ready) return;
+
+    fs_persist_flush();
+
+    lock_mutex(&fs_persist_lock);
+    fs_persist_quit = true;
+    broadcast_cond(&fs_persist_work_cond);
+    unlock_mutex(&fs_persist_lock);
+    if (fs_persist_threaded) {
+        cleanup_thread_handle(&fs_persist_thread);
+        fs_persist_threaded = false;
+    }
+
+    if (fs_persist_stats.requests) {
+        printf("fs: persisted %u writes as %u files (%u coalesced, %u failed), %llu bytes; main thread %.2fms (max %.3fms), writer %.2fms\n",
+               (unsigned)fs_persist_stats.requests, (unsigned)fs_persist_stats.files,
+               (unsigned)fs_persist_stats.coalesced, (unsigned)fs_persist_stats.failures,
+               (unsigned long long)fs_persist_stats.bytes, fs_persist_stats.main_time * 1000.0,
+               fs_persist_stats.main_max * 1000.0, fs_persist_stats.writer_time * 1000.0);
+    }
+
+    fs_persist_file_t *file, *next;
+    for (file = fs_persist_files; file; file = next) {
+        next = file->next;
+        free(file->vpath);
+        free(file->realpath);
+        free(file);
+    }
+    fs_persist_files = NULL;
+
+    destroy_cond(&fs_persist_done_cond);
+    destroy_cond(&fs_persist_work_cond);
+    destroy_mutex(&fs_persist_lock);
+    fs_persist_ready = false;
+}
+
+static fs_persist_file_t *fs_persist_get_file(const char *vpath, const bool create) {
+    for (fs_persist_file_t *file = fs_persist_files; file; file = file->next)
+        if (!strcmp(file->vpath, vpath)) return file;
+    if (!create) return NULL;
+
+    const char *realpath = fs_get_write_path(vpath);
+    if (!realpath) return NULL;
+
+    fs_persist_file_t *file = calloc(1, sizeof(fs_persist_file_t));
+    if (!file) return NULL;
+    file->vpath = sys_strdup(vpath);
+    file->realpath = sys_strdup(realpath);
+    if (!file->vpath || !file->realpath) {
+        free(file->vpath);
+        free(file->realpath);
+        free(file);
+        return NULL;
+    }
+    file->next = fs_persist_files;
+    fs_persist_files = file;
+    return file;
+}
+
+bool fs_persist_write(const char *vpath, const void *data, const size_t size) {
+    if (!vpath || (!data && size)) return false;
+
+    // not initialized: behave like a plain synchronous save
+    if (!fs_persist_ready) {
+        const char *realpath = fs_get_write_path(vpath);
+        fs_invalidate(vpath);
+        return realpath && fs_persist_write_now(realpath, data, size);
+    }
+
+    const f64 start = clock_elapsed_f64();
+    void *copy = malloc(size ? size : 1);
+    if (!copy) return false;
+    if (size) memcpy(copy, data, size);
+
+    lock_mutex(&fs_persist_lock);
+    fs_persist_file_t *file = fs_persist_get_file(vpath, true);
+    if (!file) {
+        unlock_mutex(&fs_persist_lock);
+        free(copy);
+        return false;
+    }
+    if (file->pending) {
+        free(file->pending);
+        fs_persist_stats.coalesced++;
+    }
+    file->pending = copy;
+    file->pending_size = size;
+    fs_persist_stats.requests++;
+    // the content is about to change; drop cached lookups for it
+    fs_invalidate(vpath);
+    fs_persist_charge_main(start);
+    unlock_mutex(&fs_persist_lock);
+    return true;
+}
+
+void fs_persist_update(void) {
+    if (!fs_persist_ready) return;
+
+    const f64 start = clock_elapsed_f64();
+    lock_mutex(&fs_persist_lock);
+    bool any = false;
+    for (fs_persist_file_t *file = fs_persist_files; file; file = file->next) {
+        if (!file->pending) continue;
+        if (file->ready) {
+            // the writer is behind; only the newest version matters
+            free(file->ready);
+            fs_persist_stats.coalesced++;
+        } else {
+            fs_persist_num_ready++;
+        }
+        file->ready = file->pending;
+        file->ready_size = file->pending_size;
+        file->pending = NULL;
+        file->pending_size = 0;
+        any = true;
+    }
+
+    if (any) {
+        if (fs_persist_threaded) {
+            broadcast_cond(&fs_persist_work_cond);
+        } else {
+            fs_persist_file_t *file;
+            while ((file = fs_persist_find_ready_locked()) != NULL)
+                fs_persist_write_one_locked(file);
+        }
+    }
+    fs_persist_charge_main(start);
+    unlock_mutex(&fs_persist_lock);
+}
+
+void fs_persist_flush(void) {
+    if (!fs_persist_ready) return;
+
+    fs_persist_update();
+
+    lock_mutex(&fs_persist_lock);
+    while (true) {
+        bool busy = fs_persist_num_ready > 0;
+        for (fs_persist_file_t *file = fs_persist_files; file && !busy; file = file->next)
+            busy = file->inflight != NULL;
+        if (!busy) break;
+        wait_cond(&fs_persist_done_cond, &fs_persist_lock);
+    }
+    unlock_mutex(&fs_persist_lock);
+}
+
+bool fs_persist_recover(const char *vpath) {
+    char realpath[SYS_MAX_PATH];
+    char tmppath[SYS_MAX_PATH];
+    const char *path = fs_get_write_path(vpath);
+    if (!path) return false;
+    snprintf(realpath, sizeof(realpath), "%s", path);
+    if (snprintf(tmppath, sizeof(tmppath), "%s" FS_PERSIST_TMP_SUFFIX, realpath) >= (int)sizeof(tmppath))
+        return false;
+
+    // a .tmp next to a live file is a write that never got renamed; the live
+    // file is still intact, so only an orphaned .tmp is promoted
+    if (fs_sys_file_exists(realpath) || !fs_sys_file_exists(tmppath))
+        return false;
+    if (fs_persist_ready) {
+        lock_mutex(&fs_persist_lock);
+        fs_persist_file_t *file = fs_persist_get_file(vpath, false);
+        const bool busy = file && (file->ready || file->inflight);
+        unlock_mutex(&fs_persist_lock);
+        if (busy) return false;
+    }
+
+    printf("fs: recovering '%s' from an interrupted save\n", realpath);
+    fs_invalidate(vpath);
+    return rename(tmppath, realpath) == 0;
+}
+
+void *fs_persist_read(const char *vpath, uint64_t *outsize) {
+    if (!vpath) return NULL;
+
+    if (fs_persist_ready) {
+        lock_mutex(&fs_persist_lock);
+        fs_persist_file_t *file = fs_persist_get_file(vpath, false);
+        const void *src = NULL;
+        size_t size = 0;
+        if (file) {
+            if (file->pending) { src = file->pending; size = file->pending_size; }
+            else if (file->ready) { src = file->ready; size = file->ready_size; }
+            else if (file->inflight) { src = file->inflight; size = file->inflight_size; }
+        }
+        void *copy = NULL;
+        if (src) {
+            copy = malloc(size ? size : 1);
+            if (copy) {
+                memcpy(copy, src, size);
+                if (outsize) *outsize = size;
+            }
+        }
+        unlock_mutex(&fs_persist_lock);
+        if (src) return copy;
+    }
+
+    fs_persist_recover(vpath);
+
+    const char *realpath = fs_get_write_path(vpath);
+    if (!realpath) return NULL;
+    FILE *f = fopen(realpath, "rb");
+    if (!f) return NULL;
+
+    void *buf = NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) >= 0 && fseek(f, 0, SEEK_SET) == 0) {
+        buf = malloc(size ? size : 1);
+        if (buf && fread(buf, 1, size, f) != (size_t)size) {
+            free(buf);
+            buf = NULL;
+        }
+    }
+    fclose(f);
+
+    if (buf && outsize) *outsize = (uint64_t)size;
+    return buf;
+}
+
+void fs_persist_get_stats(fs_persist_stats_t *out) {
+    if (!out) return;
+    if (!fs_persist_ready) {
+        *out = fs_persist_stats;
+        return;
+    }
+    lock_mutex(&fs_persist_lock);
+    *out = fs_persist_stats;
+    unlock_mutex(&fs_persist_lock);
+}
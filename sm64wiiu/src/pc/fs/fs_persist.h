@@ -0,0 +1,44 @@
+#ifndef _SM64_FS_PERSIST_H_
+#define _SM64_FS_PERSIST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Write-behind persistence for files under the write path (config, save
+// file, mod storage). Writes replace any pending contents of the same file,
+// are handed to a writer thread once per frame by fs_persist_update(), and
+// land on disk as "<file>.tmp" followed by a rename over the real file.
+// All paths are relative to the write path; game thread only.
+
+typedef struct {
+    uint32_t requests;   // fs_persist_write() calls
+    uint32_t coalesced;  // requests replaced by a newer one before hitting disk
+    uint32_t files;      // files actually written
+    uint32_t failures;
+    uint64_t bytes;
+    double main_time;    // seconds spent in fs_persist_write/update on the game thread
+    double main_max;     // longest single call
+    double writer_time;  // seconds the writer spent on disk I/O
+} fs_persist_stats_t;
+
+bool fs_persist_init(void);
+// flushes everything and stops the writer
+void fs_persist_shutdown(void);
+
+// queues `size` bytes of `data` (copied) as the new contents of `vpath`
+bool fs_persist_write(const char *vpath, const void *data, const size_t size);
+// returns the newest contents of `vpath`, pending or on disk (free() it)
+void *fs_persist_read(const char *vpath, uint64_t *outsize);
+// if a previous flush was interrupted between writing "<vpath>.tmp" and the
+// rename, finishes it; returns true if a file was recovered
+bool fs_persist_recover(const char *vpath);
+
+// hands this frame's writes to the writer; call once per frame
+void fs_persist_update(void);
+// blocks until every queued write is on disk
+void fs_persist_flush(void);
+
+void fs_persist_get_stats(fs_persist_stats_t *out);
+
+#endif // _SM64_FS_PERSIST_H_
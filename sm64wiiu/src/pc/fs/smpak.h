@@ -0,0 +1,51 @@
+#ifndef _SM64_SMPAK_H_
+#define _SM64_SMPAK_H_
+
+#include <stdint.h>
+
+// On-disk layout of .smpak archives, shared by fs_packtype_pak and tools/smpak.
+// All integers are little-endian regardless of host.
+//
+//   header   SMPAK_HEADER_SIZE bytes at offset 0
+//   data     entry payloads, each aligned to SMPAK_DATA_ALIGN
+//   index    entry_count records of SMPAK_RECORD_SIZE bytes, sorted by
+//            (hash, path) so lookups are a binary search on the hash
+//   strings  NUL-terminated paths referenced by the index records
+//
+// Paths are virtual ("mods/foo/main.lua"), use '/' and never start with '/'.
+
+#define SMPAK_MAGIC       0x4B504D53u // "SMPK"
+#define SMPAK_VERSION     1
+#define SMPAK_EXTENSION   "smpak"
+#define SMPAK_DATA_ALIGN  16
+
+#define SMPAK_METHOD_STORE 0
+#define SMPAK_METHOD_LZ4   1 // raw LZ4 block, no frame header
+
+// header: magic u32, version u32, entry_count u32, flags u32,
+//         index_offset u64, strings_offset u64, strings_size u64
+#define SMPAK_HEADER_SIZE 40
+
+// record: hash u32, path_offset u32 (into strings), method u32, reserved u32,
+//         data_offset u64, stored_size u64, size u64
+#define SMPAK_RECORD_SIZE 40
+
+// FNV-1a over the virtual path bytes.
+static inline uint32_t smpak_hash(const char *path) {
+    uint32_t hash = 2166136261u;
+    while (*path) {
+        hash ^= (uint8_t)*path++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static inline uint32_t smpak_read_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t smpak_read_u64(const uint8_t *p) {
+    return (uint64_t)smpak_read_u32(p) | ((uint64_t)smpak_read_u32(p + 4) << 32);
+}
+
+#endif // _SM64_SMPAK_H_
@@ -6,9 +6,18 @@
 #include "gfx_rendering_api.h"
 #include "gfx_window_manager_api.h"
 
+// what gfx_pc handed the renderer since startup
+struct GfxDummyCounts {
+    uint64_t drawCalls;
+    uint64_t triangles;
+    uint64_t textureUploads;
+};
+
 extern struct GfxRenderingAPI gfx_dummy_renderer_api;
 extern struct GfxWindowManagerAPI gfx_dummy_wm_api;
 
+void gfx_dummy_get_counts(struct GfxDummyCounts *out);
+
 #endif
 
 #endif
@@ -19,6 +19,7 @@
 #include "gfx_rendering_api.h"
 #include "gfx_screen_config.h"
 #include "../pc_diag.h"
+#include "../debug_context.h"
 #include "../configfile.h"
 #include "../lua/smlua.h"
 #ifdef TARGET_WII_U
@@ -216,12 +217,6 @@ static bool dropped_frame;
 static bool sGfxDlAbortFrame = false;
 static uint32_t sGfxDlCommandCount = 0;
 static uint32_t sGfxDlAbortLogCount = 0;
-static bool sLoggedFrame1GfxRunEnter = false;
-static bool sLoggedFrame1GfxRunAfterStart = false;
-static bool sLoggedFrame1GfxRunAfterDl = false;
-static bool sLoggedFrame1GfxRunAfterFlush = false;
-static bool sLoggedFrame1GfxRunAfterEnd = false;
-static bool sLoggedFrame1GfxRunAfterSwapBegin = false;
 static uint32_t sGfxDlProgressLogCount = 0;
 static uint32_t sCombinerCreateBeginLogCount = 0;
 static uint32_t sGfxDlCommandExitLogCount = 0;
@@ -2867,35 +2862,25 @@ void gfx_start_frame(void) {
 }
 
 void gfx_run(Gfx *commands) {
-    pc_diag_mark_stage("gfx_run:enter");
+    pc_diag_mark_stage(PC_DIAG_GFX_RUN_ENTER);
+    CTX_BEGIN(CTX_RENDER);
     gfx_sp_reset();
 
     //puts("New frame");
-#ifdef TARGET_WII_U
-    if (!sLoggedFrame1GfxRunEnter) {
-        sLoggedFrame1GfxRunEnter = true;
-        WHBLogPrint("gfx: frame1 gfx_run enter");
-    }
-#endif
 
-    pc_diag_mark_stage("gfx_run:pre_start_frame");
+    pc_diag_mark_stage(PC_DIAG_GFX_RUN_PRE_START_FRAME);
     if (!gfx_wapi->start_frame()) {
-        pc_diag_mark_stage("gfx_run:start_frame_false");
+        pc_diag_mark_stage(PC_DIAG_GFX_RUN_START_FRAME_FALSE);
         dropped_frame = true;
+        CTX_END(CTX_RENDER);
         return;
     }
-    pc_diag_mark_stage("gfx_run:post_start_frame");
+    pc_diag_mark_stage(PC_DIAG_GFX_RUN_POST_START_FRAME);
     dropped_frame = false;
-#ifdef TARGET_WII_U
-    if (!sLoggedFrame1GfxRunAfterStart) {
-        sLoggedFrame1GfxRunAfterStart = true;
-        WHBLogPrint("gfx: frame1 gfx_run post start_frame");
-    }
-#endif
 
     //double t0 = gfx_wapi->get_time();
     gfx_rapi->start_frame();
-    pc_diag_mark_stage("gfx_run:post_rapi_start_frame");
+    pc_diag_mark_stage(PC_DIAG_GFX_RUN_POST_RAPI_START_FRAME);
     sGfxDlAbortFrame = false;
     sGfxDlCommandCount = 0;
     sInterpMatrixCmdIndex = 0;
@@ -2905,39 +2890,15 @@ void gfx_run(Gfx *commands) {
         memset(sInterpPrevMatrixClaimed, 0, sizeof(sInterpPrevMatrixClaimed));
     }
     gfx_run_dl(commands, 0);
-    pc_diag_mark_stage("gfx_run:post_run_dl");
-#ifdef TARGET_WII_U
-    if (!sLoggedFrame1GfxRunAfterDl) {
-        sLoggedFrame1GfxRunAfterDl = true;
-        WHBLogPrint("gfx: frame1 gfx_run post run_dl");
-    }
-#endif
+    pc_diag_mark(PC_DIAG_GFX_RUN_POST_RUN_DL, sGfxDlCommandCount);
     gfx_flush();
-    pc_diag_mark_stage("gfx_run:post_flush");
-#ifdef TARGET_WII_U
-    if (!sLoggedFrame1GfxRunAfterFlush) {
-        sLoggedFrame1GfxRunAfterFlush = true;
-        WHBLogPrint("gfx: frame1 gfx_run post flush");
-    }
-#endif
+    pc_diag_mark_stage(PC_DIAG_GFX_RUN_POST_FLUSH);
     //double t1 = gfx_wapi->get_time();
     //printf("Process %f %f\n", t1, t1 - t0);
     gfx_rapi->end_frame();
-    pc_diag_mark_stage("gfx_run:post_end_frame");
-#ifdef TARGET_WII_U
-    if (!sLoggedFrame1GfxRunAfterEnd) {
-        sLoggedFrame1GfxRunAfterEnd = true;
-        WHBLogPrint("gfx: frame1 gfx_run post end_frame");
-    }
-#endif
+    pc_diag_mark_stage(PC_DIAG_GFX_RUN_POST_END_FRAME);
     gfx_wapi->swap_buffers_begin();
-    pc_diag_mark_stage("gfx_run:post_swap_buffers_begin");
-#ifdef TARGET_WII_U
-    if (!sLoggedFrame1GfxRunAfterSwapBegin) {
-        sLoggedFrame1GfxRunAfterSwapBegin = true;
-        WHBLogPrint("gfx: frame1 gfx_run post swap_buffers_begin");
-    }
-#endif
+    pc_diag_mark_stage(PC_DIAG_GFX_RUN_POST_SWAP_BUFFERS_BEGIN);
 
     bool advance_interp_history = (!gfx_matrix_interpolation_active()) || (gRenderingDelta >= 0.999f);
     if (advance_interp_history) {
@@ -2955,14 +2916,15 @@ void gfx_run(Gfx *commands) {
         }
         sInterpPrevCameraValid = sInterpCurrCameraValid;
     }
+    CTX_END(CTX_RENDER);
 }
 
 void gfx_end_frame(void) {
-    pc_diag_mark_stage("gfx_end_frame:enter");
+    pc_diag_mark_stage(PC_DIAG_GFX_END_FRAME_ENTER);
     if (!dropped_frame) {
         gfx_rapi->finish_render();
-        pc_diag_mark_stage("gfx_end_frame:post_finish_render");
+        pc_diag_mark_stage(PC_DIAG_GFX_END_FRAME_POST_FINISH_RENDER);
         gfx_wapi->swap_buffers_end();
-        pc_diag_mark_stage("gfx_end_frame:post_swap_buffers_end");
+        pc_diag_mark_stage(PC_DIAG_GFX_END_FRAME_POST_SWAP_BUFFERS_END);
     }
 }
@@ -43,9 +43,18 @@
 #include "include/level_table.h"
 #include "include/seq_ids.h"
 #include "include/sounds.h"
+#include "pc/audio/mod_sample.h"
+#include "pc/audio/mod_seq.h"
+#include "pc/audio/mod_stream.h"
+#include "pc/configfile.h"
+#include "pc/debug_context.h"
+#include "pc/fs/fs_async.h"
+#include "pc/fs/fs_persist.h"
 #include "smlua.h"
+#include "smlua_alloc.h"
 #include "smlua_cobject.h"
 #include "smlua_hooks.h"
+#include "smlua_profiler.h"
 
 // `djui_hud_utils.h` only forward-declares `struct DjuiColor`, but the Lua HUD
 // bindings need to read the RGBA fields. Mirror the struct layout here to avoid
@@ -177,17 +186,6 @@ static s32 sLuaHudSavedFlags = HUD_DISPLAY_DEFAULT;
 static s8 sLuaHudFlash = 0;
 static s32 sLuaActSelectHudMask = 0;
 
-struct SmluaSequenceOverride {
-    bool active;
-    bool has_original;
-    u8 *original_data;
-    s32 original_len;
-    u8 *patched_data;
-    s32 patched_len;
-};
-
-static struct SmluaSequenceOverride sLuaSequenceOverrides[0x100];
-
 static bool smlua_path_has_suffix(const char *path, const char *suffix);
 static void smlua_run_file(const char *path);
 static void smlua_hud_draw_text(const char *message, s32 x, s32 y);
@@ -197,6 +195,7 @@ static void smlua_update_budget_hook(lua_State *L, lua_Debug *ar);
 static void smlua_bind_wiiu_mod_runtime_compat(lua_State *L);
 static void smlua_extract_mod_relative_path(const char *script_path, char *out, size_t out_size);
 static void smlua_format_mod_display_name(const char *relative_path, char *out, size_t out_size);
+static bool smlua_read_vec3_like(lua_State *L, int index, f32 out[3]);
 
 #define SMLUA_SCRIPT_LOAD_INSTRUCTION_BUDGET 10000000
 #define SMLUA_UPDATE_INSTRUCTION_BUDGET 5000000
@@ -258,6 +257,8 @@ struct SmluaModAudio {
     f32 frequency;
     s32 loop_start;
     s32 loop_end;
+    s32 stream; // mod_stream id once first played, else -1
+    s32 sample; // mod_sample id for sample handles, else -1
 };
 
 struct SmluaGraphRootRef {
@@ -265,10 +266,14 @@ struct SmluaGraphRootRef {
 };
 
 #define SMLUA_MAX_MOD_AUDIO 512
+#define SMLUA_AUDIO_MAX_DISTANCE 22000.0f // AUDIO_MAX_DISTANCE in audio/external.c
 static struct SmluaModAudio sLuaAudioPool[SMLUA_MAX_MOD_AUDIO];
 static s32 sLuaAudioPoolCount = 0;
 static u32 sLuaUpdateCounter = 0;
 
+#define SMLUA_MAX_ASYNC_LOADS 64
+static fs_async_req_t *sLuaAsyncLoads[SMLUA_MAX_ASYNC_LOADS];
+
 #define SMLUA_MOD_OVERLAY_MAX_LINES 4
 #define SMLUA_MOD_OVERLAY_LINE_MAX 48
 #define SMLUA_MOD_OVERLAY_SHOW_FRAMES 900
@@ -586,26 +591,9 @@ static void smlua_reset_lighting_state(void) {
     sLuaHudSavedFlags = HUD_DISPLAY_DEFAULT;
 }
 
-// Resets script-defined sequence alias mappings used by audio replacement shims.
+// Resets script-defined sequence alias mappings and mod sequences and banks.
 static void smlua_reset_sequence_aliases(void) {
-    for (u32 i = 0; i < ARRAY_COUNT(sLuaSequenceOverrides); i++) {
-        struct SmluaSequenceOverride *override = &sLuaSequenceOverrides[i];
-        if (override->active && override->has_original && gSeqFileHeader != NULL &&
-            i < (u32)gSeqFileHeader->seqCount) {
-            gSeqFileHeader->seqArray[i].offset = override->original_data;
-            gSeqFileHeader->seqArray[i].len = override->original_len;
-        }
-        if (override->patched_data != NULL) {
-            free(override->patched_data);
-            override->patched_data = NULL;
-        }
-        override->active = false;
-        override->has_original = false;
-        override->original_data = NULL;
-        override->original_len = 0;
-        override->patched_len = 0;
-    }
-
+    mod_seq_reset();
     memset(sLuaSequenceAlias, 0, sizeof(sLuaSequenceAlias));
     memset(sLuaSequenceAliasValid, 0, sizeof(sLuaSequenceAliasValid));
 }
@@ -1147,6 +1135,8 @@ static struct SmluaModAudio *smlua_alloc_mod_audio(const char *filepath, bool is
     audio->is_stream = is_stream;
     audio->volume = 1.0f;
     audio->frequency = 1.0f;
+    audio->stream = -1;
+    audio->sample = -1;
     if (filepath != NULL) {
         snprintf(audio->filepath, sizeof(audio->filepath), "%s", filepath);
     }
@@ -1261,10 +1251,12 @@ static int smlua_modaudio_newindex(lua_State *L) {
     }
     if (strcmp(key, "volume") == 0) {
         audio->volume = (f32)luaL_checknumber(L, 3);
+        mod_stream_set_volume(audio->stream, audio->volume);
         return 0;
     }
     if (strcmp(key, "frequency") == 0) {
         audio->frequency = (f32)luaL_checknumber(L, 3);
+        mod_stream_set_frequency(audio->stream, audio->frequency);
         return 0;
     }
     return 0;
@@ -1439,20 +1431,11 @@ static void smlua_sanitize_filename_component(char *dst, size_t dst_size, const
 static const char *smlua_get_mod_storage_file_path(const char *script_path) {
     static char out_path[SYS_MAX_PATH];
     char safe_name[SYS_MAX_PATH];
-    char relative_path[SYS_MAX_PATH];
-    const char *full_path;
 
     smlua_sanitize_filename_component(safe_name, sizeof(safe_name), script_path);
-    if (snprintf(relative_path, sizeof(relative_path), "sav/%s.sav", safe_name) < 0) {
-        return NULL;
-    }
-
-    full_path = fs_get_write_path(relative_path);
-    if (full_path == NULL) {
+    if (snprintf(out_path, sizeof(out_path), "sav/%s.sav", safe_name) < 0) {
         return NULL;
     }
-
-    snprintf(out_path, sizeof(out_path), "%s", full_path);
     return out_path;
 }
 
@@ -1529,7 +1512,7 @@ static bool smlua_build_script_asset_hint(char *out_path, size_t out_size,
     return true;
 }
 
-// Loads a full file into heap memory for sequence override patching.
+// Loads a full file into heap memory for mod sequences and banks.
 static bool smlua_load_binary_file(const char *path, u8 **out_data, s32 *out_len) {
     fs_file_t *file;
     int64_t length;
@@ -1568,34 +1551,6 @@ static bool smlua_load_binary_file(const char *path, u8 **out_data, s32 *out_len
     return true;
 }
 
-// Applies a runtime sequence-data override for a target vanilla sequence slot.
-static bool smlua_apply_sequence_override(u8 target_seq, u8 *data, s32 len) {
-    struct SmluaSequenceOverride *override;
-
-    if (data == NULL || len <= 0 || gSeqFileHeader == NULL || target_seq >= gSeqFileHeader->seqCount) {
-        return false;
-    }
-
-    override = &sLuaSequenceOverrides[target_seq];
-    if (!override->has_original) {
-        override->original_data = gSeqFileHeader->seqArray[target_seq].offset;
-        override->original_len = gSeqFileHeader->seqArray[target_seq].len;
-        override->has_original = true;
-    }
-
-    if (override->patched_data != NULL) {
-        free(override->patched_data);
-        override->patched_data = NULL;
-    }
-
-    override->patched_data = data;
-    override->patched_len = len;
-    override->active = true;
-    gSeqFileHeader->seqArray[target_seq].offset = data;
-    gSeqFileHeader->seqArray[target_seq].len = len;
-    return true;
-}
-
 // Clamps and rounds a Lua numeric color channel into an 8-bit render value.
 static u8 smlua_to_color_channel(lua_State *L, int index) {
     int value = (int)(luaL_checknumber(L, index) + 0.5f);
@@ -1649,7 +1604,11 @@ static bool smlua_ensure_mod_storage_dir(void) {
     if (fs_sys_dir_exists(dir)) {
         return true;
     }
-    return fs_sys_mkdir(dir);
+    if (!fs_sys_mkdir(dir)) {
+        return false;
+    }
+    fs_invalidate("sav");
+    return true;
 }
 
 // Finds an entry by key in an in-memory storage set.
@@ -1664,90 +1623,87 @@ static ssize_t smlua_mod_storage_find_entry(const struct SmluaModStorageEntry *e
 }
 
 // Reads key/value pairs from a mod storage file into an in-memory table.
+// Unflushed saves are visible here, so a load right after a save sees it.
 static bool smlua_mod_storage_read_entries(const char *filename, struct SmluaModStorageEntry *entries,
                                            size_t *count) {
-    FILE *file;
-    char line[SMLUA_MOD_STORAGE_LINE_SIZE];
+    fs_lines_t lines;
+    const char *line;
+    size_t line_len;
+    uint64_t size = 0;
+    void *data;
 
     *count = 0;
     if (filename == NULL) {
         return false;
     }
 
-    file = fopen(filename, "r");
-    if (file == NULL) {
+    data = fs_persist_read(filename, &size);
+    if (data == NULL) {
         return true;
     }
 
-    while (fgets(line, sizeof(line), file) != NULL) {
-        char *separator;
-        char *newline;
-        const char *key;
-        const char *value;
+    fs_lines_init(&lines, data, size);
+    while (fs_lines_next(&lines, &line, &line_len)) {
+        const char *separator = memchr(line, '=', line_len);
         size_t key_len;
         size_t value_len;
+        char key[SMLUA_MOD_STORAGE_MAX_KEY + 1];
         ssize_t existing;
 
-        newline = strpbrk(line, "\r\n");
-        if (newline != NULL) {
-            *newline = '\0';
-        }
-
-        separator = strchr(line, '=');
         if (separator == NULL) {
             continue;
         }
-        *separator = '\0';
-
-        key = line;
-        value = separator + 1;
-        key_len = strlen(key);
-        value_len = strlen(value);
+        key_len = (size_t)(separator - line);
+        value_len = line_len - key_len - 1;
         if (key_len == 0 || key_len > SMLUA_MOD_STORAGE_MAX_KEY || value_len > SMLUA_MOD_STORAGE_MAX_VALUE) {
             continue;
         }
+        memcpy(key, line, key_len);
+        key[key_len] = '\0';
 
         existing = smlua_mod_storage_find_entry(entries, *count, key);
-        if (existing >= 0) {
-            snprintf(entries[existing].value, sizeof(entries[existing].value), "%s", value);
-            continue;
-        }
-        if (*count >= SMLUA_MOD_STORAGE_MAX_KEYS) {
-            continue;
+        if (existing < 0) {
+            if (*count >= SMLUA_MOD_STORAGE_MAX_KEYS) {
+                continue;
+            }
+            existing = (ssize_t)(*count)++;
+            memcpy(entries[existing].key, key, key_len + 1);
         }
-
-        snprintf(entries[*count].key, sizeof(entries[*count].key), "%s", key);
-        snprintf(entries[*count].value, sizeof(entries[*count].value), "%s", value);
-        (*count)++;
+        memcpy(entries[existing].value, separator + 1, value_len);
+        entries[existing].value[value_len] = '\0';
     }
 
-    fclose(file);
+    free(data);
     return true;
 }
 
-// Persists an in-memory storage set back to a mod storage file.
+// Queues an in-memory storage set to be written back to its mod storage
+// file. Every save in a frame lands in a single write.
 static bool smlua_mod_storage_write_entries(const char *filename, const struct SmluaModStorageEntry *entries,
                                             size_t count) {
-    FILE *file;
+    size_t size = 0;
+    size_t offset = 0;
+    char *buffer;
+    bool success;
 
     if (filename == NULL) {
         return false;
     }
 
-    file = fopen(filename, "wb");
-    if (file == NULL) {
+    for (size_t i = 0; i < count; i++) {
+        size += strlen(entries[i].key) + strlen(entries[i].value) + 2;
+    }
+    buffer = malloc(size + 1);
+    if (buffer == NULL) {
         return false;
     }
-
     for (size_t i = 0; i < count; i++) {
-        if (fprintf(file, "%s=%s\n", entries[i].key, entries[i].value) < 0) {
-            fclose(file);
-            return false;
-        }
+        offset += (size_t)sprintf(buffer + offset, "%s=%s\n", entries[i].key, entries[i].value);
     }
 
-    fclose(file);
-    return true;
+    success = fs_persist_write(filename, buffer, offset);
+    free(buffer);
+    return success;
 }
 
 // Co-op DX compat wrapper for mod_storage_load(key) using per-script save files.
@@ -1780,7 +1736,7 @@ static int smlua_func_mod_storage_load(lua_State *L) {
     return 1;
 }
 
-// Co-op DX compat wrapper for mod_storage_save(key, value) with immediate flush.
+// Co-op DX compat wrapper for mod_storage_save(key, value); written behind by fs_persist.
 static int smlua_func_mod_storage_save(lua_State *L) {
     const char *key = luaL_checkstring(L, 1);
     const char *value = luaL_checkstring(L, 2);
@@ -1935,6 +1891,81 @@ static int smlua_func_mod_storage_save_bool(lua_State *L) {
     return smlua_func_mod_storage_save(L);
 }
 
+// Resolves a Lua-supplied file name the same way mod asset loaders do.
+static void smlua_resolve_async_path(lua_State *L, const char *filename, char *path, size_t path_size) {
+    if (!smlua_resolve_mod_asset_path(path, path_size, smlua_get_caller_script_path(L), filename, NULL, NULL)) {
+        snprintf(path, path_size, "%s", filename);
+    }
+}
+
+// fs_load_async(path, [urgent]) -> handle, or nil if too many loads are outstanding.
+static int smlua_func_fs_load_async(lua_State *L) {
+    const char *filename = luaL_checkstring(L, 1);
+    fs_async_priority_t prio = lua_toboolean(L, 2) ? FS_ASYNC_PRIORITY_HIGH : FS_ASYNC_PRIORITY_NORMAL;
+    char path[SYS_MAX_PATH];
+
+    for (int i = 0; i < SMLUA_MAX_ASYNC_LOADS; i++) {
+        if (sLuaAsyncLoads[i] != NULL) {
+            continue;
+        }
+        smlua_resolve_async_path(L, filename, path, sizeof(path));
+        sLuaAsyncLoads[i] = fs_async_load(path, prio, NULL, NULL);
+        if (sLuaAsyncLoads[i] == NULL) {
+            break;
+        }
+        lua_pushinteger(L, i + 1);
+        return 1;
+    }
+
+    lua_pushnil(L);
+    return 1;
+}
+
+// fs_async_poll(handle) -> nil while pending, the file contents once loaded,
+// or false if the load failed. The handle is freed once a result is returned.
+static int smlua_func_fs_async_poll(lua_State *L) {
+    lua_Integer handle = luaL_checkinteger(L, 1);
+    if (handle < 1 || handle > SMLUA_MAX_ASYNC_LOADS || sLuaAsyncLoads[handle - 1] == NULL) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    fs_async_req_t *req = sLuaAsyncLoads[handle - 1];
+    fs_async_status_t status = fs_async_poll(req);
+    if (status == FS_ASYNC_PENDING) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    uint64_t size = 0;
+    void *data = fs_async_take(req, &size);
+    if (status == FS_ASYNC_DONE && data != NULL) {
+        lua_pushlstring(L, (const char *)data, (size_t)size);
+    } else {
+        lua_pushboolean(L, 0);
+    }
+    free(data);
+    fs_async_release(req);
+    sLuaAsyncLoads[handle - 1] = NULL;
+    return 1;
+}
+
+// fs_prefetch(path) -> true if the file is being loaded ahead of use.
+static int smlua_func_fs_prefetch(lua_State *L) {
+    const char *filename = luaL_checkstring(L, 1);
+    char path[SYS_MAX_PATH];
+    smlua_resolve_async_path(L, filename, path, sizeof(path));
+    lua_pushboolean(L, fs_async_prefetch(path));
+    return 1;
+}
+
+static void smlua_release_async_loads(void) {
+    for (int i = 0; i < SMLUA_MAX_ASYNC_LOADS; i++) {
+        fs_async_release(sLuaAsyncLoads[i]);
+        sLuaAsyncLoads[i] = NULL;
+    }
+}
+
 // Returns a HUD value field by Co-op DX enum index for Lua script compatibility.
 static int smlua_func_hud_get_value(lua_State *L) {
     s32 type = (s32)luaL_checkinteger(L, 1);
@@ -2048,6 +2079,63 @@ static int smlua_func_djui_hud_render_texture(lua_State *L) {
     return 0;
 }
 
+// Folds a cached HUD block's version (number, string, boolean or nil) into 64 bits.
+static u64 smlua_hud_cache_version(lua_State *L, int index) {
+    switch (lua_type(L, index)) {
+        case LUA_TNUMBER: {
+            lua_Number number = lua_tonumber(L, index);
+            u64 bits = 0;
+            memcpy(&bits, &number, sizeof(number) < sizeof(bits) ? sizeof(number) : sizeof(bits));
+            return bits;
+        }
+        case LUA_TSTRING: {
+            size_t len = 0;
+            const char *str = lua_tolstring(L, index, &len);
+            u64 hash = 0xcbf29ce484222325ULL;
+            for (size_t i = 0; i < len; i++) {
+                hash = (hash ^ (u8)str[i]) * 0x100000001b3ULL;
+            }
+            return hash ^ len;
+        }
+        case LUA_TBOOLEAN:
+            return lua_toboolean(L, index) ? 1 : 2;
+        case LUA_TNONE:
+        case LUA_TNIL:
+            return 0;
+        default:
+            luaL_argerror(L, index, "number, string, boolean or nil expected");
+            return 0;
+    }
+}
+
+// Starts a cached HUD block; returns true when the script has to draw it.
+static int smlua_func_djui_hud_begin_cached(lua_State *L) {
+    const char *name = luaL_checkstring(L, 1);
+    u64 version = smlua_hud_cache_version(L, 2);
+    bool draw = djui_hud_begin_cached(name, version);
+    if (!draw) {
+        // a replay leaves the HUD state where the recording ended
+        struct DjuiColor *color = djui_hud_get_color();
+        sHudColor.r = color->r;
+        sHudColor.g = color->g;
+        sHudColor.b = color->b;
+        sHudColor.a = color->a;
+        sHudResolution = djui_hud_get_resolution();
+        if (djui_hud_get_font() != (sHudFont < 0 ? 0 : sHudFont)) {
+            sHudFont = djui_hud_get_font();
+        }
+    }
+    lua_pushboolean(L, draw);
+    return 1;
+}
+
+// Ends a cached HUD block that djui_hud_begin_cached asked to draw.
+static int smlua_func_djui_hud_end_cached(lua_State *L) {
+    (void)L;
+    djui_hud_end_cached();
+    return 0;
+}
+
 // Sets the logical DJUI HUD resolution.
 static int smlua_func_djui_hud_set_resolution(lua_State *L) {
     sHudResolution = (int)luaL_checkinteger(L, 1);
@@ -3144,8 +3232,8 @@ static int smlua_func_set_background_music(lua_State *L) {
     u16 seq_args = (u16)luaL_checkinteger(L, 2);
     s16 fade_timer = (s16)luaL_checkinteger(L, 3);
 
-    // Co-op DX replacement tracks can use remapped sequence IDs; route them to
-    // fallback vanilla IDs on this runtime until full sequence override support lands.
+    // Co-op DX replacement tracks can use remapped sequence IDs; registered
+    // ones alias to themselves, others route to a vanilla fallback.
     u8 seq_id = (u8)(seq_args & 0xFF);
     if (sLuaSequenceAliasValid[seq_id]) {
         seq_args = (u16)((seq_args & 0xFF00) | sLuaSequenceAlias[seq_id]);
@@ -3157,38 +3245,43 @@ static int smlua_func_set_background_music(lua_State *L) {
     return 0;
 }
 
-// Records sequence-id aliasing so scripts can safely reference replacement IDs.
+// Loads `sound/<name><suffix>` (or `<name><suffix>`) next to the calling script.
+static bool smlua_load_mod_sound_file(const char *script_path, const char *name, const char *suffix,
+                                      u8 **out_data, s32 *out_len) {
+    char relative_name[SYS_MAX_PATH];
+    char candidate_path[SYS_MAX_PATH];
+    const char *ext = smlua_path_has_suffix(name, suffix) ? "" : suffix;
+
+    snprintf(relative_name, sizeof(relative_name), "sound/%s%s", name, ext);
+    if (smlua_build_script_relative_path(candidate_path, sizeof(candidate_path), script_path, relative_name) &&
+        smlua_load_binary_file(candidate_path, out_data, out_len)) {
+        return true;
+    }
+
+    // Fallback for mods that pass a path-like token instead of bare names.
+    snprintf(relative_name, sizeof(relative_name), "%s%s", name, ext);
+    return smlua_build_script_relative_path(candidate_path, sizeof(candidate_path), script_path, relative_name) &&
+           smlua_load_binary_file(candidate_path, out_data, out_len);
+}
+
+// Registers a mod sequence under its own id; ids past SEQ_COUNT keep the
+// vanilla sequence they stand in for (SEQ_COUNT + base) as their fallback.
 static int smlua_func_smlua_audio_utils_replace_sequence(lua_State *L) {
     s32 sequence_id = (s32)luaL_checkinteger(L, 1);
     s32 bank_id = (s32)luaL_optinteger(L, 2, 0);
     s32 default_volume = (s32)luaL_optinteger(L, 3, 0);
     const char *m64_name = luaL_optstring(L, 4, NULL);
     const char *script_path = smlua_get_caller_script_path(L);
-    char relative_name[SYS_MAX_PATH];
-    char candidate_path[SYS_MAX_PATH];
     u8 *sequence_data = NULL;
     s32 sequence_len = 0;
 
-    (void)bank_id;
-    (void)default_volume;
-
     if (sequence_id < 0 || sequence_id > 0xFF) {
         return 0;
     }
 
-    // The shipped day-night scripts register replacement IDs as SEQ_COUNT + base.
-    // We map those IDs back to base sequence slots for compatibility.
-    s32 fallback_id = sequence_id;
-    if (fallback_id >= SEQ_COUNT) {
-        fallback_id -= SEQ_COUNT;
-    }
-    if (fallback_id < 0 || fallback_id >= SEQ_COUNT) {
-        fallback_id = fallback_id % SEQ_COUNT;
-    }
-    if (fallback_id < 0) {
-        fallback_id += SEQ_COUNT;
-    }
+    s32 fallback_id = sequence_id % SEQ_COUNT;
 
+    // Until the sequence is registered, set_background_music() plays the fallback.
     sLuaSequenceAlias[(u8)sequence_id] = (u8)fallback_id;
     sLuaSequenceAliasValid[(u8)sequence_id] = true;
 
@@ -3200,6 +3293,8 @@ static int smlua_func_smlua_audio_utils_replace_sequence(lua_State *L) {
     (void)default_volume;
     (void)m64_name;
     (void)script_path;
+    (void)sequence_data;
+    (void)sequence_len;
     return 0;
 #endif
 
@@ -3207,37 +3302,51 @@ static int smlua_func_smlua_audio_utils_replace_sequence(lua_State *L) {
         return 0;
     }
 
-    if (smlua_path_has_suffix(m64_name, ".m64")) {
-        snprintf(relative_name, sizeof(relative_name), "sound/%s", m64_name);
-    } else {
-        snprintf(relative_name, sizeof(relative_name), "sound/%s.m64", m64_name);
+    if (!smlua_load_mod_sound_file(script_path, m64_name, ".m64", &sequence_data, &sequence_len)) {
+        smlua_logf("lua: sequence override file not found for '%s'", m64_name);
+        return 0;
     }
-    if (smlua_build_script_relative_path(candidate_path, sizeof(candidate_path), script_path, relative_name) &&
-        smlua_load_binary_file(candidate_path, &sequence_data, &sequence_len)) {
-        if (smlua_apply_sequence_override((u8)fallback_id, sequence_data, sequence_len)) {
-            return 0;
-        }
+    if (!mod_seq_set_sequence(sequence_id, sequence_data, sequence_len, bank_id, fallback_id, default_volume)) {
+        smlua_logf("lua: could not register sequence '%s' as %d", m64_name, (int)sequence_id);
         free(sequence_data);
-        sequence_data = NULL;
+        return 0;
     }
 
-    // Fallback for mods that pass a path-like token instead of bare sequence names.
-    if (smlua_path_has_suffix(m64_name, ".m64")) {
-        snprintf(relative_name, sizeof(relative_name), "%s", m64_name);
-    } else {
-        snprintf(relative_name, sizeof(relative_name), "%s.m64", m64_name);
+    sLuaSequenceAlias[(u8)sequence_id] = (u8)sequence_id;
+    return 0;
+}
+
+// Registers a mod instrument bank (a ctl .bin playing samples from vanilla
+// bank `sample_bank`); returns its bank id for replace_sequence, or nil.
+static int smlua_func_smlua_audio_utils_load_bank(lua_State *L) {
+    const char *bin_name = luaL_checkstring(L, 1);
+    s32 sample_bank = (s32)luaL_checkinteger(L, 2);
+    const char *script_path = smlua_get_caller_script_path(L);
+    char key[SYS_MAX_PATH];
+    u8 *bank_data = NULL;
+    s32 bank_len = 0;
+
+    if (script_path == NULL || bin_name[0] == '\0') {
+        lua_pushnil(L);
+        return 1;
     }
-    if (smlua_build_script_relative_path(candidate_path, sizeof(candidate_path), script_path, relative_name) &&
-        smlua_load_binary_file(candidate_path, &sequence_data, &sequence_len)) {
-        if (smlua_apply_sequence_override((u8)fallback_id, sequence_data, sequence_len)) {
-            return 0;
-        }
-        free(sequence_data);
-        sequence_data = NULL;
+    if (!smlua_load_mod_sound_file(script_path, bin_name, ".bin", &bank_data, &bank_len)) {
+        smlua_logf("lua: bank file not found for '%s'", bin_name);
+        lua_pushnil(L);
+        return 1;
     }
 
-    smlua_logf("lua: sequence override file not found for '%s'", m64_name);
-    return 0;
+    // the same script and name reuse the bank parsed last time
+    snprintf(key, sizeof(key), "%s:%s", script_path, bin_name);
+    s32 bank_id = mod_seq_load_bank(key, bank_data, bank_len, sample_bank);
+    if (bank_id < 0) {
+        smlua_logf("lua: could not register bank '%s'", bin_name);
+        free(bank_data);
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushinteger(L, bank_id);
+    return 1;
 }
 
 // Mod-menu update helper stub for checkbox rows.
@@ -3473,19 +3582,39 @@ static int smlua_func_audio_stream_load(lua_State *L) {
     return 1;
 }
 
-// Stream playback compatibility shim (metadata only on Wii U minimal runtime).
+// Forwards a stream's loop points; negative values mean "not set".
+static void smlua_mod_audio_sync_loop_points(struct SmluaModAudio *audio) {
+    u64 start = audio->loop_start > 0 ? (u64)audio->loop_start : 0;
+    u64 end = audio->loop_end > 0 ? (u64)audio->loop_end : 0;
+    mod_stream_set_loop_points(audio->stream, start, end);
+}
+
+// Plays a stream from where it stopped, or from the start with `restart`.
+// The decoder is opened on first play so loaded-but-unused tracks cost nothing.
 static int smlua_func_audio_stream_play(lua_State *L) {
     struct SmluaModAudio *audio = smlua_check_mod_audio(L, 1);
-    if (audio != NULL) {
-        audio->looping = lua_toboolean(L, 2) != 0;
-        audio->volume = (f32)luaL_optnumber(L, 3, audio->volume);
+    if (audio == NULL || !audio->is_stream) {
+        return 0;
+    }
+    bool restart = lua_toboolean(L, 2) != 0;
+    audio->volume = (f32)luaL_optnumber(L, 3, audio->volume);
+    if (audio->stream < 0) {
+        audio->stream = mod_stream_open(audio->filepath);
+        mod_stream_set_looping(audio->stream, audio->looping);
+        smlua_mod_audio_sync_loop_points(audio);
+        mod_stream_set_frequency(audio->stream, audio->frequency);
     }
+    mod_stream_set_volume(audio->stream, audio->volume);
+    mod_stream_play(audio->stream, restart);
     return 0;
 }
 
-// Stops a stream handle.
+// Stops a stream handle and rewinds it.
 static int smlua_func_audio_stream_stop(lua_State *L) {
-    (void)smlua_check_mod_audio(L, 1);
+    struct SmluaModAudio *audio = smlua_check_mod_audio(L, 1);
+    if (audio != NULL) {
+        mod_stream_stop(audio->stream);
+    }
     return 0;
 }
 
@@ -3494,35 +3623,39 @@ static int smlua_func_audio_stream_set_looping(lua_State *L) {
     struct SmluaModAudio *audio = smlua_check_mod_audio(L, 1);
     if (audio != NULL) {
         audio->looping = lua_toboolean(L, 2) != 0;
+        mod_stream_set_looping(audio->stream, audio->looping);
     }
     return 0;
 }
 
-// Stores stream loop points for compatibility with Co-op DX APIs.
+// Sets stream loop points in frames at the file's sample rate.
 static int smlua_func_audio_stream_set_loop_points(lua_State *L) {
     struct SmluaModAudio *audio = smlua_check_mod_audio(L, 1);
     if (audio != NULL) {
         // Co-op DX accepts numeric loop points (including float expressions).
         audio->loop_start = (s32)luaL_optnumber(L, 2, 0.0);
         audio->loop_end = (s32)luaL_optnumber(L, 3, 0.0);
+        smlua_mod_audio_sync_loop_points(audio);
     }
     return 0;
 }
 
-// Stores stream volume gain.
+// Sets stream volume gain.
 static int smlua_func_audio_stream_set_volume(lua_State *L) {
     struct SmluaModAudio *audio = smlua_check_mod_audio(L, 1);
     if (audio != NULL) {
         audio->volume = (f32)luaL_checknumber(L, 2);
+        mod_stream_set_volume(audio->stream, audio->volume);
     }
     return 0;
 }
 
-// Stores stream playback frequency multiplier.
+// Sets stream playback frequency multiplier (speed and pitch).
 static int smlua_func_audio_stream_set_frequency(lua_State *L) {
     struct SmluaModAudio *audio = smlua_check_mod_audio(L, 1);
     if (audio != NULL) {
         audio->frequency = (f32)luaL_checknumber(L, 2);
+        mod_stream_set_frequency(audio->stream, audio->frequency);
     }
     return 0;
 }
@@ -3534,8 +3667,8 @@ static int smlua_func_audio_sample_load(lua_State *L) {
     char path[SYS_MAX_PATH] = { 0 };
     struct SmluaModAudio *audio;
 
-    // Audio sample APIs are currently metadata-only shims on Wii U, so avoid
-    // expensive startup-time fs probing for every declared sound file.
+    // Avoid startup-time fs probing for every declared sound file; the
+    // sample cache loads the hinted path in the background.
     if (!smlua_build_script_asset_hint(path, sizeof(path), script_path, "sound", filename)) {
         if (!smlua_build_script_asset_hint(path, sizeof(path), script_path, NULL, filename)) {
             snprintf(path, sizeof(path), "%s", filename);
@@ -3547,23 +3680,56 @@ static int smlua_func_audio_sample_load(lua_State *L) {
         lua_pushnil(L);
         return 1;
     }
+    audio->sample = mod_sample_load(path);
 
     smlua_push_mod_audio(L, audio);
     return 1;
 }
 
-// Sample playback shim for compatibility with Lua voice tables.
+// Pans and attenuates a sound at `pos` relative to the camera: full volume
+// at the camera, silent at SMLUA_AUDIO_MAX_DISTANCE.
+static void smlua_mod_audio_position(const f32 pos[3], f32 *volume, f32 *pan) {
+    f32 dx = pos[0] - gLakituState.curPos[0];
+    f32 dy = pos[1] - gLakituState.curPos[1];
+    f32 dz = pos[2] - gLakituState.curPos[2];
+    f32 fx = gLakituState.curFocus[0] - gLakituState.curPos[0];
+    f32 fz = gLakituState.curFocus[2] - gLakituState.curPos[2];
+    f32 flat = sqrtf(dx * dx + dz * dz);
+    f32 facing = sqrtf(fx * fx + fz * fz);
+    f32 dist = sqrtf(flat * flat + dy * dy);
+
+    *pan = 0.0f;
+    if (flat > 1.0f && facing > 1.0f) {
+        // camera right is the facing direction turned a quarter clockwise
+        *pan = (dx * -fz + dz * fx) / (flat * facing) * 0.75f;
+    }
+    *volume *= dist < SMLUA_AUDIO_MAX_DISTANCE ? 1.0f - dist / SMLUA_AUDIO_MAX_DISTANCE : 0.0f;
+}
+
+// Plays a one-shot sample, optionally positioned in the world.
 static int smlua_func_audio_sample_play(lua_State *L) {
     struct SmluaModAudio *audio = smlua_check_mod_audio(L, 1);
-    if (audio != NULL) {
-        audio->volume = (f32)luaL_optnumber(L, 3, audio->volume);
+    f32 pos[3];
+    f32 pan = 0.0f;
+
+    if (audio == NULL) {
+        return 0;
     }
+    audio->volume = (f32)luaL_optnumber(L, 3, audio->volume);
+    f32 volume = audio->volume;
+    if (smlua_read_vec3_like(L, 2, pos)) {
+        smlua_mod_audio_position(pos, &volume, &pan);
+    }
+    mod_sample_play(audio->sample, volume, pan, audio->frequency);
     return 0;
 }
 
-// Sample stop shim for compatibility with Lua voice tables.
+// Stops every voice playing a sample.
 static int smlua_func_audio_sample_stop(lua_State *L) {
-    (void)smlua_check_mod_audio(L, 1);
+    struct SmluaModAudio *audio = smlua_check_mod_audio(L, 1);
+    if (audio != NULL) {
+        mod_sample_stop(audio->sample);
+    }
     return 0;
 }
 
@@ -5389,6 +5555,9 @@ static void smlua_bind_minimal_functions(lua_State *L) {
     smlua_set_global_function(L, "mod_storage_load", smlua_func_mod_storage_load);
     smlua_set_global_function(L, "mod_storage_save", smlua_func_mod_storage_save);
     smlua_set_global_function(L, "mod_storage_remove", smlua_func_mod_storage_remove);
+    smlua_set_global_function(L, "fs_load_async", smlua_func_fs_load_async);
+    smlua_set_global_function(L, "fs_async_poll", smlua_func_fs_async_poll);
+    smlua_set_global_function(L, "fs_prefetch", smlua_func_fs_prefetch);
     smlua_set_global_function(L, "mod_storage_load_number", smlua_func_mod_storage_load_number);
     smlua_set_global_function(L, "mod_storage_load_bool", smlua_func_mod_storage_load_bool);
     smlua_set_global_function(L, "mod_storage_load_bool_2", smlua_func_mod_storage_load_bool_2);
@@ -5427,6 +5596,8 @@ static void smlua_bind_minimal_functions(lua_State *L) {
     smlua_set_global_function(L, "djui_hud_set_resolution", smlua_func_djui_hud_set_resolution);
     smlua_set_global_function(L, "djui_hud_set_font", smlua_func_djui_hud_set_font);
     smlua_set_global_function(L, "djui_hud_get_font", smlua_func_djui_hud_get_font);
+    smlua_set_global_function(L, "djui_hud_begin_cached", smlua_func_djui_hud_begin_cached);
+    smlua_set_global_function(L, "djui_hud_end_cached", smlua_func_djui_hud_end_cached);
     smlua_set_global_function(L, "djui_hud_set_scissor", smlua_func_djui_hud_set_scissor);
     smlua_set_global_function(L, "djui_hud_reset_scissor", smlua_func_djui_hud_reset_scissor);
     smlua_set_global_function(L, "djui_hud_get_fov_coeff", smlua_func_djui_hud_get_fov_coeff);
@@ -5516,6 +5687,7 @@ static void smlua_bind_minimal_functions(lua_State *L) {
     smlua_set_global_function(L, "play_secondary_music", smlua_func_play_secondary_music);
     smlua_set_global_function(L, "stop_secondary_music", smlua_func_stop_secondary_music);
     smlua_set_global_function(L, "smlua_audio_utils_replace_sequence", smlua_func_smlua_audio_utils_replace_sequence);
+    smlua_set_global_function(L, "smlua_audio_utils_load_bank", smlua_func_smlua_audio_utils_load_bank);
     smlua_set_global_function(L, "smlua_anim_util_register_animation", smlua_func_smlua_anim_util_register_animation);
     smlua_set_global_function(L, "smlua_anim_util_set_animation", smlua_func_smlua_anim_util_set_animation);
     smlua_set_global_function(L, "smlua_text_utils_dialog_get", smlua_func_smlua_text_utils_dialog_get);
@@ -6647,6 +6819,13 @@ static void smlua_log_runtime_hook_snapshot(lua_State *L, const char *phase) {
 }
 #endif
 
+// Replaces the panic handler luaL_newstate() would have installed.
+static int smlua_panic(lua_State *L) {
+    const char *error = lua_tostring(L, -1);
+    smlua_logf("lua: fatal panic: %s", error != NULL ? error : "<unknown>");
+    return 0;
+}
+
 // Creates the Lua VM and loads active built-in scripts from the mod set.
 void smlua_init(void) {
     smlua_logf("lua: init begin");
@@ -6656,15 +6835,18 @@ void smlua_init(void) {
     smlua_reset_custom_animations();
     smlua_reset_model_overrides();
     smlua_reset_dialog_overrides();
+    mod_stream_close_all();
+    mod_sample_stop_all();
     sLuaAudioPoolCount = 0;
     memset(sLuaAudioPool, 0, sizeof(sLuaAudioPool));
     memset(sLuaCustomActionNextIndex, 0, sizeof(sLuaCustomActionNextIndex));
 
-    sLuaState = luaL_newstate();
+    sLuaState = lua_newstate(smlua_alloc, NULL);
     if (sLuaState == NULL) {
         smlua_logf("lua: failed to allocate Lua state");
         return;
     }
+    lua_atpanic(sLuaState, smlua_panic);
 
     luaL_openlibs(sLuaState);
     smlua_bind_require_system(sLuaState);
@@ -6700,6 +6882,13 @@ void smlua_init(void) {
 
     size_t script_count = mods_get_active_script_count();
     smlua_logf("lua: loading %u root scripts", (unsigned)script_count);
+    // Read every root script in the background while earlier ones compile.
+    for (size_t i = 0; i < script_count; i++) {
+        const char *root_script = mods_get_active_script_path(i);
+        if (root_script != NULL) {
+            fs_async_prefetch(root_script);
+        }
+    }
     for (size_t i = 0; i < script_count; i++) {
         const char *root_script = mods_get_active_script_path(i);
 #ifdef TARGET_WII_U
@@ -6708,7 +6897,9 @@ void smlua_init(void) {
         WHBLogPrintf("lua: root[%u] '%s'", (unsigned)i,
                      root_script != NULL ? root_script : "<null>");
 #endif
+        int prev_owner = smlua_alloc_set_owner((int)i);
         smlua_run_script_with_companions(root_script);
+        smlua_alloc_set_owner(prev_owner);
     }
 
 #ifdef TARGET_WII_U
@@ -6719,6 +6910,7 @@ void smlua_init(void) {
     smlua_log_runtime_hook_snapshot(sLuaState, "post_mods_loaded");
 #endif
     smlua_refresh_mod_overlay_lines();
+    smlua_alloc_begin_stepped_gc(sLuaState);
 
     smlua_logf("lua: initialized (%u scripts)", (unsigned)script_count);
 }
@@ -6733,6 +6925,7 @@ void smlua_update(void) {
         smlua_logf("lua: first update tick");
     }
     sLuaUpdateCounter++;
+    CTX_BEGIN(CTX_SMLUA);
 
     smlua_cobject_update_globals(sLuaState);
     smlua_ensure_singleplayer_tables(sLuaState);
@@ -6741,14 +6934,15 @@ void smlua_update(void) {
 
     lua_getglobal(sLuaState, "on_update");
     if (lua_isfunction(sLuaState, -1)) {
-        lua_sethook(sLuaState, smlua_update_budget_hook, LUA_MASKCOUNT,
-                    SMLUA_UPDATE_INSTRUCTION_BUDGET);
+        smlua_profiler_begin(SMLUA_ALLOC_OWNER_CORE, "on_update");
+        smlua_profiler_sethook(sLuaState, smlua_update_budget_hook, SMLUA_UPDATE_INSTRUCTION_BUDGET);
         if (lua_pcall(sLuaState, 0, 0, 0) != LUA_OK) {
             const char *error = lua_tostring(sLuaState, -1);
             smlua_logf("lua: on_update failed: %s", error != NULL ? error : "<unknown>");
             lua_pop(sLuaState, 1);
         }
         lua_sethook(sLuaState, NULL, 0, 0);
+        smlua_profiler_end();
     } else {
         lua_pop(sLuaState, 1);
     }
@@ -6756,21 +6950,56 @@ void smlua_update(void) {
     smlua_call_behavior_hooks();
     smlua_update_custom_dnc_objects(sLuaState);
     smlua_poll_sync_table_change_hooks();
+    smlua_alloc_gc_frame_step(sLuaState);
+    CTX_END(CTX_SMLUA);
+}
+
+// Invalidates Lua-side identity caches for an object slot that is being freed.
+void smlua_on_object_unload(struct Object *obj) {
+    if (sLuaState == NULL) {
+        return;
+    }
+    smlua_cobject_invalidate_object(sLuaState, obj);
 }
 
 // Destroys the Lua VM and releases all script-managed resources.
 void smlua_shutdown(void) {
     if (sLuaState != NULL) {
+        struct SmluaCObjectCacheStats cache_stats;
+        smlua_cobject_get_cache_stats(&cache_stats);
+        if (cache_stats.frames > 0) {
+            smlua_logf("lua: cobject cache %llu hits / %llu allocs over %u frames (last frame %u hits, %u allocs, %u bytes)",
+                       (unsigned long long)cache_stats.totalHits,
+                       (unsigned long long)cache_stats.totalAllocations, (unsigned)cache_stats.frames,
+                       (unsigned)cache_stats.lastFrameHits, (unsigned)cache_stats.lastFrameAllocations,
+                       (unsigned)cache_stats.lastFrameAllocatedBytes);
+        }
         smlua_call_event_hooks(HOOK_ON_EXIT);
+        smlua_release_async_loads();
         smlua_clear_hooks(sLuaState);
         lua_close(sLuaState);
         sLuaState = NULL;
+
+        struct SmluaAllocStats alloc_stats;
+        smlua_alloc_get_stats(&alloc_stats);
+        smlua_logf("lua: allocator peak %u bytes, %u slab bytes, %llu small / %llu large allocs, %u gc cycles",
+                   (unsigned)alloc_stats.peakBytes, (unsigned)alloc_stats.slabBytes,
+                   (unsigned long long)alloc_stats.smallAllocs,
+                   (unsigned long long)alloc_stats.largeAllocs, (unsigned)alloc_stats.gcCycles);
+        smlua_alloc_reset();
+
+        if (configLuaProfiler) {
+            smlua_profiler_write_folded();
+        }
+        smlua_profiler_reset();
     }
     smlua_reset_lighting_state();
     smlua_reset_sequence_aliases();
     smlua_reset_custom_animations();
     smlua_reset_model_overrides();
     smlua_reset_dialog_overrides();
+    mod_stream_close_all();
+    mod_sample_stop_all();
     sLuaAudioPoolCount = 0;
     sLuaUpdateCounter = 0;
     memset(sLuaAudioPool, 0, sizeof(sLuaAudioPool));
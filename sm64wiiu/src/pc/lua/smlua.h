@@ -9,6 +9,7 @@ extern "C" {
 #endif
 
 struct lua_State;
+struct Object;
 
 struct SmluaLightingState {
     float lighting_dir[3];
@@ -29,6 +30,7 @@ void smlua_init(void);
 void smlua_update(void);
 void smlua_shutdown(void);
 struct lua_State *smlua_get_state(void);
+void smlua_on_object_unload(struct Object *obj);
 void smlua_render_mod_overlay(void);
 void smlua_get_lighting_state(struct SmluaLightingState *out_state);
 int16_t smlua_get_override_far(int16_t default_far);
@@ -0,0 +1,329 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <lua.h>
+
+#include "pc/configfile.h"
+#include "pc/utils/misc.h"
+#include "smlua_alloc.h"
+
+// Lua VM allocator. Small objects (the bulk of tables, strings, closures and
+// cobject userdata) are served from size-class slabs; anything larger falls
+// through to the system allocator, which is dlmalloc on Windows builds.
+//
+// Every block carries an 8-byte header recording its owner so frees are
+// charged back to the mod that allocated them, whichever mod is running at
+// the time of the free. The header size also keeps user pointers 8-aligned,
+// which Lua needs for lua_Number on PowerPC.
+
+#define SMLUA_ALLOC_SLAB_SIZE (16 * 1024)
+#define SMLUA_ALLOC_SMALL_MAX 256
+#define SMLUA_ALLOC_LARGE_CLASS 0xFF
+
+// Mirrors Lua's default 200% pause: a new cycle starts once the heap doubles.
+#define SMLUA_GC_PAUSE_FACTOR 2
+// Live bytes must grow this far past the last completed cycle before the
+// frame step ignores its time budget and finishes the cycle.
+#define SMLUA_GC_EMERGENCY_FACTOR 4
+#define SMLUA_GC_EMERGENCY_MIN_BYTES (1024 * 1024)
+
+struct SmluaAllocHeader {
+    uint32_t size;
+    uint16_t owner;
+    uint8_t sizeClass;
+    uint8_t pad;
+};
+
+struct SmluaAllocFreeBlock {
+    struct SmluaAllocFreeBlock *next;
+};
+
+struct SmluaAllocSlab {
+    struct SmluaAllocSlab *next;
+    uint64_t align;
+};
+
+static const uint16_t sSizeClasses[] = { 16, 24, 32, 48, 64, 80, 96, 128, 160, 192, 256 };
+#define SMLUA_ALLOC_CLASS_COUNT (sizeof(sSizeClasses) / sizeof(sSizeClasses[0]))
+
+static uint8_t sClassForUnits[(SMLUA_ALLOC_SMALL_MAX / 8) + 1];
+static bool sClassTableBuilt = false;
+static struct SmluaAllocFreeBlock *sFreeLists[SMLUA_ALLOC_CLASS_COUNT];
+static struct SmluaAllocSlab *sSlabs = NULL;
+
+static struct SmluaAllocOwnerStats sOwnerStats[SMLUA_ALLOC_OWNER_COUNT];
+static struct SmluaAllocStats sStats;
+static int sCurrentOwner = SMLUA_ALLOC_OWNER_CORE;
+static size_t sLiveAfterLastCycle = 0;
+static bool sSteppedGc = false;
+static bool sGcCycleActive = false;
+
+// Maps 8-byte size units onto the smallest class that fits.
+static void smlua_alloc_build_class_table(void) {
+    uint32_t cls = 0;
+    for (uint32_t units = 0; units < sizeof(sClassForUnits); units++) {
+        while (sSizeClasses[cls] < units * 8) {
+            cls++;
+        }
+        sClassForUnits[units] = (uint8_t)cls;
+    }
+    sClassTableBuilt = true;
+}
+
+static uint8_t smlua_alloc_class_for_size(size_t size) {
+    if (size > SMLUA_ALLOC_SMALL_MAX) {
+        return SMLUA_ALLOC_LARGE_CLASS;
+    }
+    if (!sClassTableBuilt) {
+        smlua_alloc_build_class_table();
+    }
+    return sClassForUnits[(size + 7) / 8];
+}
+
+// Carves a fresh slab into blocks for one size class.
+static bool smlua_alloc_refill(uint8_t cls) {
+    size_t stride = sizeof(struct SmluaAllocHeader) + sSizeClasses[cls];
+    struct SmluaAllocSlab *slab = malloc(SMLUA_ALLOC_SLAB_SIZE);
+    if (slab == NULL) {
+        return false;
+    }
+
+    slab->next = sSlabs;
+    sSlabs = slab;
+    sStats.slabBytes += SMLUA_ALLOC_SLAB_SIZE;
+
+    uint8_t *cursor = (uint8_t *)(slab + 1);
+    uint8_t *end = (uint8_t *)slab + SMLUA_ALLOC_SLAB_SIZE;
+    while (cursor + stride <= end) {
+        struct SmluaAllocFreeBlock *block = (struct SmluaAllocFreeBlock *)cursor;
+        block->next = sFreeLists[cls];
+        sFreeLists[cls] = block;
+        cursor += stride;
+    }
+    return true;
+}
+
+static void smlua_alloc_account(uint16_t owner, size_t size, bool allocating) {
+    struct SmluaAllocOwnerStats *stats = &sOwnerStats[owner];
+    if (allocating) {
+        stats->liveBytes += size;
+        stats->frameBytes += size;
+        if (stats->liveBytes > stats->peakBytes) {
+            stats->peakBytes = stats->liveBytes;
+        }
+        sStats.liveBytes += size;
+        if (sStats.liveBytes > sStats.peakBytes) {
+            sStats.peakBytes = sStats.liveBytes;
+        }
+    } else {
+        stats->liveBytes -= size;
+        sStats.liveBytes -= size;
+    }
+}
+
+static void *smlua_alloc_block(size_t size) {
+    uint8_t cls = smlua_alloc_class_for_size(size);
+    struct SmluaAllocHeader *header = NULL;
+
+    if (cls == SMLUA_ALLOC_LARGE_CLASS) {
+        header = malloc(sizeof(struct SmluaAllocHeader) + size);
+        if (header == NULL) {
+            return NULL;
+        }
+        sStats.largeAllocs++;
+    } else {
+        if (sFreeLists[cls] == NULL && !smlua_alloc_refill(cls)) {
+            return NULL;
+        }
+        header = (struct SmluaAllocHeader *)sFreeLists[cls];
+        sFreeLists[cls] = sFreeLists[cls]->next;
+        sStats.smallAllocs++;
+    }
+
+    header->size = (uint32_t)size;
+    header->owner = (uint16_t)sCurrentOwner;
+    header->sizeClass = cls;
+    header->pad = 0;
+    smlua_alloc_account(header->owner, size, true);
+    return header + 1;
+}
+
+static void smlua_alloc_free_block(void *ptr) {
+    struct SmluaAllocHeader *header = (struct SmluaAllocHeader *)ptr - 1;
+    smlua_alloc_account(header->owner, header->size, false);
+
+    if (header->sizeClass == SMLUA_ALLOC_LARGE_CLASS) {
+        free(header);
+        return;
+    }
+
+    struct SmluaAllocFreeBlock *block = (struct SmluaAllocFreeBlock *)header;
+    block->next = sFreeLists[header->sizeClass];
+    sFreeLists[header->sizeClass] = block;
+}
+
+// Keeps the block where it is and charges its owner for the new size. The
+// block's class is left alone, so a large block kept for a small size still
+// goes back to the system allocator when it's freed.
+static void *smlua_alloc_resize_in_place(struct SmluaAllocHeader *header, size_t nsize) {
+    smlua_alloc_account(header->owner, header->size, false);
+    header->size = (uint32_t)nsize;
+    smlua_alloc_account(header->owner, nsize, true);
+    return header + 1;
+}
+
+// lua_Alloc entry point. See the Lua 5.3 manual for the contract.
+void *smlua_alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+    (void)ud;
+    (void)osize;
+
+    if (nsize == 0) {
+        if (ptr != NULL) {
+            smlua_alloc_free_block(ptr);
+        }
+        return NULL;
+    }
+
+    if (ptr == NULL) {
+        return smlua_alloc_block(nsize);
+    }
+
+    struct SmluaAllocHeader *header = (struct SmluaAllocHeader *)ptr - 1;
+    uint8_t cls = smlua_alloc_class_for_size(nsize);
+
+    // Same slab class: the block already fits, only the accounting changes.
+    if (cls != SMLUA_ALLOC_LARGE_CLASS && cls == header->sizeClass) {
+        return smlua_alloc_resize_in_place(header, nsize);
+    }
+
+    // Large to large: let the system allocator grow in place when it can.
+    if (cls == SMLUA_ALLOC_LARGE_CLASS && header->sizeClass == SMLUA_ALLOC_LARGE_CLASS) {
+        uint16_t owner = header->owner;
+        size_t old_size = header->size;
+        struct SmluaAllocHeader *grown = realloc(header, sizeof(struct SmluaAllocHeader) + nsize);
+        if (grown == NULL) {
+            // Lua requires that shrinking never fails
+            return (nsize <= old_size) ? smlua_alloc_resize_in_place(header, nsize) : NULL;
+        }
+        smlua_alloc_account(owner, old_size, false);
+        grown->size = (uint32_t)nsize;
+        smlua_alloc_account(owner, nsize, true);
+        return grown + 1;
+    }
+
+    // Crossing classes: move the block, keeping its original owner.
+    int previous_owner = sCurrentOwner;
+    sCurrentOwner = header->owner;
+    void *moved = smlua_alloc_block(nsize);
+    sCurrentOwner = previous_owner;
+    if (moved == NULL) {
+        // a shrink into a slab class whose refill failed keeps the old block
+        return (nsize <= header->size) ? smlua_alloc_resize_in_place(header, nsize) : NULL;
+    }
+    memcpy(moved, ptr, header->size < nsize ? header->size : nsize);
+    smlua_alloc_free_block(ptr);
+    return moved;
+}
+
+// Releases slab memory after the Lua state has been closed.
+void smlua_alloc_reset(void) {
+    while (sSlabs != NULL) {
+        struct SmluaAllocSlab *next = sSlabs->next;
+        free(sSlabs);
+        sSlabs = next;
+    }
+    memset(sFreeLists, 0, sizeof(sFreeLists));
+    memset(sOwnerStats, 0, sizeof(sOwnerStats));
+    memset(&sStats, 0, sizeof(sStats));
+    sCurrentOwner = SMLUA_ALLOC_OWNER_CORE;
+    sLiveAfterLastCycle = 0;
+    sSteppedGc = false;
+    sGcCycleActive = false;
+}
+
+// Sets the mod charged for subsequent allocations and returns the previous owner.
+int smlua_alloc_set_owner(int owner) {
+    int previous = sCurrentOwner;
+    if (owner < 0 || owner >= SMLUA_ALLOC_OWNER_COUNT) {
+        owner = SMLUA_ALLOC_OWNER_CORE;
+    }
+    sCurrentOwner = owner;
+    return previous;
+}
+
+int smlua_alloc_get_owner(void) {
+    return sCurrentOwner;
+}
+
+// Hands collection over to smlua_alloc_gc_frame_step() once scripts are loaded.
+void smlua_alloc_begin_stepped_gc(struct lua_State *L) {
+    if (L == NULL || configLuaGcBudgetUs == 0) {
+        sSteppedGc = false;
+        return;
+    }
+    lua_gc(L, LUA_GCSTOP, 0);
+    sLiveAfterLastCycle = sStats.liveBytes;
+    sSteppedGc = true;
+    sGcCycleActive = false;
+}
+
+// Runs incremental GC steps until the frame's time budget is spent, then
+// splits the measured time across owners by how much each allocated.
+void smlua_alloc_gc_frame_step(struct lua_State *L) {
+    if (L == NULL || !sSteppedGc) {
+        return;
+    }
+
+    f64 start = clock_elapsed_f64();
+    f64 budget = (f64)configLuaGcBudgetUs / 1000000.0;
+    int step_kb = (configLuaGcStepKb > 0) ? (int)configLuaGcStepKb : 1;
+    size_t emergency = sLiveAfterLastCycle * SMLUA_GC_EMERGENCY_FACTOR;
+    bool force = sStats.liveBytes > emergency && sStats.liveBytes > SMLUA_GC_EMERGENCY_MIN_BYTES;
+
+    if (!sGcCycleActive && sStats.liveBytes >= sLiveAfterLastCycle * SMLUA_GC_PAUSE_FACTOR) {
+        sGcCycleActive = true;
+    }
+
+    while (sGcCycleActive || force) {
+        if (lua_gc(L, LUA_GCSTEP, step_kb)) {
+            sLiveAfterLastCycle = sStats.liveBytes;
+            sStats.gcCycles++;
+            sGcCycleActive = false;
+            break;
+        }
+        if (!force && (clock_elapsed_f64() - start) >= budget) {
+            break;
+        }
+    }
+
+    f64 elapsed = clock_elapsed_f64() - start;
+    size_t frame_total = 0;
+    sStats.lastGcStepTime = elapsed;
+
+    for (int i = 0; i < SMLUA_ALLOC_OWNER_COUNT; i++) {
+        frame_total += sOwnerStats[i].frameBytes;
+    }
+    for (int i = 0; i < SMLUA_ALLOC_OWNER_COUNT; i++) {
+        struct SmluaAllocOwnerStats *stats = &sOwnerStats[i];
+        if (frame_total > 0 && stats->frameBytes > 0) {
+            stats->gcTime += elapsed * ((f64)stats->frameBytes / (f64)frame_total);
+        }
+        stats->frameBytes = 0;
+    }
+    if (frame_total == 0) {
+        sOwnerStats[SMLUA_ALLOC_OWNER_CORE].gcTime += elapsed;
+    }
+}
+
+const struct SmluaAllocOwnerStats *smlua_alloc_get_owner_stats(int owner) {
+    if (owner < 0 || owner >= SMLUA_ALLOC_OWNER_COUNT) {
+        return NULL;
+    }
+    return &sOwnerStats[owner];
+}
+
+void smlua_alloc_get_stats(struct SmluaAllocStats *out_stats) {
+    if (out_stats != NULL) {
+        *out_stats = sStats;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef SM64_PC_SMLUA_ALLOC_H
+#define SM64_PC_SMLUA_ALLOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pc/mods/mods.h"
+
+struct lua_State;
+
+// Owner slot used for allocations made outside any mod script (bootstrap,
+// engine-side bindings, global on_update).
+#define SMLUA_ALLOC_OWNER_CORE MODS_MAX_ACTIVE_SCRIPTS
+#define SMLUA_ALLOC_OWNER_COUNT (MODS_MAX_ACTIVE_SCRIPTS + 1)
+
+struct SmluaAllocOwnerStats {
+    size_t liveBytes;
+    size_t peakBytes;
+    size_t frameBytes;      // bytes allocated since the last GC frame step
+    double gcTime;          // cumulative GC step time attributed to this owner, in seconds
+};
+
+struct SmluaAllocStats {
+    size_t liveBytes;
+    size_t peakBytes;
+    size_t slabBytes;       // bytes reserved by small-object slabs
+    uint64_t smallAllocs;
+    uint64_t largeAllocs;
+    double lastGcStepTime;  // seconds spent in the last frame's GC step
+    uint32_t gcCycles;
+};
+
+void *smlua_alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+void smlua_alloc_reset(void);
+
+int smlua_alloc_set_owner(int owner);
+int smlua_alloc_get_owner(void);
+
+void smlua_alloc_begin_stepped_gc(struct lua_State *L);
+void smlua_alloc_gc_frame_step(struct lua_State *L);
+
+const struct SmluaAllocOwnerStats *smlua_alloc_get_owner_stats(int owner);
+void smlua_alloc_get_stats(struct SmluaAllocStats *out_stats);
+
+#endif
@@ -18,6 +18,23 @@ static const char *SMLUA_OBJECT_ANIMINFO_METATABLE = "SM64.ObjectAnimInfoRef";
 static const char *SMLUA_OBJECT_SHAREDCHILD_METATABLE = "SM64.ObjectSharedChildRef";
 static const char *SMLUA_CUSTOM_OBJECT_FIELD_REGISTRY = "SM64.CustomObjectFields";
 
+// Registry key for the per-kind userdata identity cache (address is the key).
+static const char sCObjectCacheKey = 0;
+
+// Cache partitions. Object proxies share their Object's address, so the proxy
+// kind is part of the cache key alongside the pointer.
+enum SmluaCObjectCacheKind {
+    SMLUA_CACHE_MARIO_STATE = SMLUA_COBJECT_MARIO_STATE,
+    SMLUA_CACHE_OBJECT = SMLUA_COBJECT_OBJECT,
+    SMLUA_CACHE_OBJECT_HEADER,
+    SMLUA_CACHE_OBJECT_GFX,
+    SMLUA_CACHE_OBJECT_ANIMINFO,
+    SMLUA_CACHE_OBJECT_SHAREDCHILD,
+    SMLUA_CACHE_KIND_COUNT,
+};
+
+static struct SmluaCObjectCacheStats sCObjectCacheStats;
+
 typedef struct SmluaVec3fRef {
     f32 *pointer;
 } SmluaVec3fRef;
@@ -317,16 +334,63 @@ static void smlua_set_shared_child_hook_process(struct Object *object, s32 value
     }
 }
 
+// Pushes the weak-valued cache partition for one kind, creating it on first use.
+static void smlua_cobject_cache_push_partition(lua_State *L, int kind) {
+    if (lua_rawgetp(L, LUA_REGISTRYINDEX, &sCObjectCacheKey) != LUA_TTABLE) {
+        lua_pop(L, 1);
+        lua_createtable(L, SMLUA_CACHE_KIND_COUNT, 0);
+        lua_pushvalue(L, -1);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &sCObjectCacheKey);
+    }
+    if (lua_rawgeti(L, -1, kind) != LUA_TTABLE) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_createtable(L, 0, 1);
+        lua_pushliteral(L, "v");
+        lua_setfield(L, -2, "__mode");
+        lua_setmetatable(L, -2);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, -3, kind);
+    }
+    lua_remove(L, -2);
+}
+
+// Pushes the cached userdata for (kind, pointer) and returns true, or pushes nothing on a miss.
+static bool smlua_cobject_cache_get(lua_State *L, int kind, const void *pointer) {
+    smlua_cobject_cache_push_partition(L, kind);                // [partition]
+    if (lua_rawgetp(L, -1, pointer) == LUA_TUSERDATA) {         // [partition][ud]
+        lua_remove(L, -2);                                      // [ud]
+        sCObjectCacheStats.frameHits++;
+        return true;
+    }
+    lua_pop(L, 2);                                              // []
+    return false;
+}
+
+// Records the userdata on top of the stack as the identity for (kind, pointer).
+static void smlua_cobject_cache_put(lua_State *L, int kind, const void *pointer, size_t size) {
+    smlua_cobject_cache_push_partition(L, kind);                // [ud][partition]
+    lua_pushvalue(L, -2);                                       // [ud][partition][ud]
+    lua_rawsetp(L, -2, pointer);                                // [ud][partition]
+    lua_pop(L, 1);                                              // [ud]
+    sCObjectCacheStats.frameAllocations++;
+    sCObjectCacheStats.frameAllocatedBytes += (u32)size;
+}
+
 // Pushes an Object header proxy userdata.
 static void smlua_push_object_header(lua_State *L, struct Object *object) {
     if (object == NULL) {
         lua_pushnil(L);
         return;
     }
+    if (smlua_cobject_cache_get(L, SMLUA_CACHE_OBJECT_HEADER, object)) {
+        return;
+    }
     SmluaObjectHeaderRef *ref = lua_newuserdata(L, sizeof(SmluaObjectHeaderRef));
     ref->object = object;
     luaL_getmetatable(L, SMLUA_OBJECT_HEADER_METATABLE);
     lua_setmetatable(L, -2);
+    smlua_cobject_cache_put(L, SMLUA_CACHE_OBJECT_HEADER, object, sizeof(SmluaObjectHeaderRef));
 }
 
 // Pushes an Object gfx proxy userdata.
@@ -335,10 +399,14 @@ static void smlua_push_object_gfx(lua_State *L, struct Object *object) {
         lua_pushnil(L);
         return;
     }
+    if (smlua_cobject_cache_get(L, SMLUA_CACHE_OBJECT_GFX, object)) {
+        return;
+    }
     SmluaObjectGfxRef *ref = lua_newuserdata(L, sizeof(SmluaObjectGfxRef));
     ref->object = object;
     luaL_getmetatable(L, SMLUA_OBJECT_GFX_METATABLE);
     lua_setmetatable(L, -2);
+    smlua_cobject_cache_put(L, SMLUA_CACHE_OBJECT_GFX, object, sizeof(SmluaObjectGfxRef));
 }
 
 // Pushes an Object animInfo proxy userdata.
@@ -347,10 +415,14 @@ static void smlua_push_object_animinfo(lua_State *L, struct Object *object) {
         lua_pushnil(L);
         return;
     }
+    if (smlua_cobject_cache_get(L, SMLUA_CACHE_OBJECT_ANIMINFO, object)) {
+        return;
+    }
     SmluaObjectAnimInfoRef *ref = lua_newuserdata(L, sizeof(SmluaObjectAnimInfoRef));
     ref->object = object;
     luaL_getmetatable(L, SMLUA_OBJECT_ANIMINFO_METATABLE);
     lua_setmetatable(L, -2);
+    smlua_cobject_cache_put(L, SMLUA_CACHE_OBJECT_ANIMINFO, object, sizeof(SmluaObjectAnimInfoRef));
 }
 
 // Pushes an Object sharedChild proxy userdata.
@@ -359,10 +431,14 @@ static void smlua_push_object_shared_child(lua_State *L, struct Object *object)
         lua_pushnil(L);
         return;
     }
+    if (smlua_cobject_cache_get(L, SMLUA_CACHE_OBJECT_SHAREDCHILD, object)) {
+        return;
+    }
     SmluaObjectSharedChildRef *ref = lua_newuserdata(L, sizeof(SmluaObjectSharedChildRef));
     ref->object = object;
     luaL_getmetatable(L, SMLUA_OBJECT_SHAREDCHILD_METATABLE);
     lua_setmetatable(L, -2);
+    smlua_cobject_cache_put(L, SMLUA_CACHE_OBJECT_SHAREDCHILD, object, sizeof(SmluaObjectSharedChildRef));
 }
 
 // Lua metamethod for object header proxy reads.
@@ -1301,12 +1377,17 @@ static void smlua_push_cobject(lua_State *L, uint16_t type, const void *pointer)
         return;
     }
 
+    if (smlua_cobject_cache_get(L, type, pointer)) {
+        return;
+    }
+
     SmluaCObject *cobj = lua_newuserdata(L, sizeof(SmluaCObject));
     cobj->pointer = pointer;
     cobj->type = type;
 
     luaL_getmetatable(L, SMLUA_COBJECT_METATABLE);
     lua_setmetatable(L, -2);
+    smlua_cobject_cache_put(L, type, pointer, sizeof(SmluaCObject));
 }
 
 // Initializes metatables for cobjects and vector reference proxies.
@@ -1403,6 +1484,7 @@ void smlua_cobject_init_globals(lua_State *L) {
     }
 
     memset(sSharedChildHookProcess, 0, sizeof(sSharedChildHookProcess));
+    memset(&sCObjectCacheStats, 0, sizeof(sCObjectCacheStats));
 
     lua_newtable(L);
     lua_pushinteger(L, 0);
@@ -1425,6 +1507,18 @@ void smlua_cobject_update_globals(lua_State *L) {
     if (L == NULL) {
         return;
     }
+
+    // Called once per frame: roll the previous frame's counters into the totals.
+    sCObjectCacheStats.lastFrameHits = sCObjectCacheStats.frameHits;
+    sCObjectCacheStats.lastFrameAllocations = sCObjectCacheStats.frameAllocations;
+    sCObjectCacheStats.lastFrameAllocatedBytes = sCObjectCacheStats.frameAllocatedBytes;
+    sCObjectCacheStats.totalHits += sCObjectCacheStats.frameHits;
+    sCObjectCacheStats.totalAllocations += sCObjectCacheStats.frameAllocations;
+    sCObjectCacheStats.frames++;
+    sCObjectCacheStats.frameHits = 0;
+    sCObjectCacheStats.frameAllocations = 0;
+    sCObjectCacheStats.frameAllocatedBytes = 0;
+
     smlua_push_object(L, gMarioObject);
     lua_setglobal(L, "gMarioObject");
     smlua_push_object(L, gCurrentObject);
@@ -1440,3 +1534,32 @@ void smlua_push_mario_state(lua_State *L, const void *mario_state) {
 void smlua_push_object(lua_State *L, const void *object) {
     smlua_push_cobject(L, SMLUA_COBJECT_OBJECT, object);
 }
+
+// Drops every cached wrapper for an object that is being unloaded so a new
+// object reusing the same slot never inherits the stale userdata identity.
+void smlua_cobject_invalidate_object(lua_State *L, const void *object) {
+    if (L == NULL || object == NULL) {
+        return;
+    }
+
+    if (lua_rawgetp(L, LUA_REGISTRYINDEX, &sCObjectCacheKey) != LUA_TTABLE) {
+        lua_pop(L, 1);
+        return;
+    }
+
+    for (int kind = SMLUA_CACHE_OBJECT; kind < SMLUA_CACHE_KIND_COUNT; kind++) {
+        if (lua_rawgeti(L, -1, kind) == LUA_TTABLE) {
+            lua_pushnil(L);
+            lua_rawsetp(L, -2, object);
+        }
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+}
+
+// Copies the userdata identity cache counters for diagnostics.
+void smlua_cobject_get_cache_stats(struct SmluaCObjectCacheStats *out_stats) {
+    if (out_stats != NULL) {
+        *out_stats = sCObjectCacheStats;
+    }
+}
@@ -15,10 +15,26 @@ typedef struct SmluaCObject {
     uint16_t type;
 } SmluaCObject;
 
+// Userdata identity cache counters. "Allocations" are cache misses that had to
+// create a new full userdata; every hit is one allocation the GC never sees.
+struct SmluaCObjectCacheStats {
+    uint32_t frameHits;
+    uint32_t frameAllocations;
+    uint32_t frameAllocatedBytes;
+    uint32_t lastFrameHits;
+    uint32_t lastFrameAllocations;
+    uint32_t lastFrameAllocatedBytes;
+    uint64_t totalHits;
+    uint64_t totalAllocations;
+    uint32_t frames;
+};
+
 void smlua_bind_cobject(lua_State *L);
 void smlua_cobject_init_globals(lua_State *L);
 void smlua_cobject_update_globals(lua_State *L);
 void smlua_push_mario_state(lua_State *L, const void *mario_state);
 void smlua_push_object(lua_State *L, const void *object);
+void smlua_cobject_invalidate_object(lua_State *L, const void *object);
+void smlua_cobject_get_cache_stats(struct SmluaCObjectCacheStats *out_stats);
 
 #endif
@@ -10,8 +10,10 @@
 #include "game/object_list_processor.h"
 
 #include "smlua.h"
+#include "smlua_alloc.h"
 #include "smlua_hooks.h"
 #include "smlua_cobject.h"
+#include "smlua_profiler.h"
 #include <lauxlib.h>
 #ifdef TARGET_WII_U
 #include <whb/log.h>
@@ -25,9 +27,73 @@
 
 struct LuaHookedEvent {
     int references[MAX_HOOKED_REFERENCES];
+    int owners[MAX_HOOKED_REFERENCES];
     int count;
 };
 
+static const char *sHookEventNames[HOOK_MAX] = {
+    [HOOK_UPDATE] = "HOOK_UPDATE",
+    [HOOK_MARIO_UPDATE] = "HOOK_MARIO_UPDATE",
+    [HOOK_BEFORE_MARIO_UPDATE] = "HOOK_BEFORE_MARIO_UPDATE",
+    [HOOK_ON_SET_MARIO_ACTION] = "HOOK_ON_SET_MARIO_ACTION",
+    [HOOK_BEFORE_PHYS_STEP] = "HOOK_BEFORE_PHYS_STEP",
+    [HOOK_ALLOW_PVP_ATTACK] = "HOOK_ALLOW_PVP_ATTACK",
+    [HOOK_ON_PVP_ATTACK] = "HOOK_ON_PVP_ATTACK",
+    [HOOK_ON_PLAYER_CONNECTED] = "HOOK_ON_PLAYER_CONNECTED",
+    [HOOK_ON_PLAYER_DISCONNECTED] = "HOOK_ON_PLAYER_DISCONNECTED",
+    [HOOK_ON_HUD_RENDER] = "HOOK_ON_HUD_RENDER",
+    [HOOK_ALLOW_INTERACT] = "HOOK_ALLOW_INTERACT",
+    [HOOK_ON_INTERACT] = "HOOK_ON_INTERACT",
+    [HOOK_ON_LEVEL_INIT] = "HOOK_ON_LEVEL_INIT",
+    [HOOK_ON_WARP] = "HOOK_ON_WARP",
+    [HOOK_ON_SYNC_VALID] = "HOOK_ON_SYNC_VALID",
+    [HOOK_ON_OBJECT_UNLOAD] = "HOOK_ON_OBJECT_UNLOAD",
+    [HOOK_ON_SYNC_OBJECT_UNLOAD] = "HOOK_ON_SYNC_OBJECT_UNLOAD",
+    [HOOK_ON_PAUSE_EXIT] = "HOOK_ON_PAUSE_EXIT",
+    [HOOK_GET_STAR_COLLECTION_DIALOG] = "HOOK_GET_STAR_COLLECTION_DIALOG",
+    [HOOK_ON_SET_CAMERA_MODE] = "HOOK_ON_SET_CAMERA_MODE",
+    [HOOK_ON_OBJECT_RENDER] = "HOOK_ON_OBJECT_RENDER",
+    [HOOK_ON_DEATH] = "HOOK_ON_DEATH",
+    [HOOK_ON_PACKET_RECEIVE] = "HOOK_ON_PACKET_RECEIVE",
+    [HOOK_USE_ACT_SELECT] = "HOOK_USE_ACT_SELECT",
+    [HOOK_ON_CHANGE_CAMERA_ANGLE] = "HOOK_ON_CHANGE_CAMERA_ANGLE",
+    [HOOK_ON_SCREEN_TRANSITION] = "HOOK_ON_SCREEN_TRANSITION",
+    [HOOK_ALLOW_HAZARD_SURFACE] = "HOOK_ALLOW_HAZARD_SURFACE",
+    [HOOK_ON_CHAT_MESSAGE] = "HOOK_ON_CHAT_MESSAGE",
+    [HOOK_OBJECT_SET_MODEL] = "HOOK_OBJECT_SET_MODEL",
+    [HOOK_CHARACTER_SOUND] = "HOOK_CHARACTER_SOUND",
+    [HOOK_BEFORE_SET_MARIO_ACTION] = "HOOK_BEFORE_SET_MARIO_ACTION",
+    [HOOK_JOINED_GAME] = "HOOK_JOINED_GAME",
+    [HOOK_ON_OBJECT_ANIM_UPDATE] = "HOOK_ON_OBJECT_ANIM_UPDATE",
+    [HOOK_ON_DIALOG] = "HOOK_ON_DIALOG",
+    [HOOK_ON_EXIT] = "HOOK_ON_EXIT",
+    [HOOK_DIALOG_SOUND] = "HOOK_DIALOG_SOUND",
+    [HOOK_ON_HUD_RENDER_BEHIND] = "HOOK_ON_HUD_RENDER_BEHIND",
+    [HOOK_ON_COLLIDE_LEVEL_BOUNDS] = "HOOK_ON_COLLIDE_LEVEL_BOUNDS",
+    [HOOK_MIRROR_MARIO_RENDER] = "HOOK_MIRROR_MARIO_RENDER",
+    [HOOK_MARIO_OVERRIDE_PHYS_STEP_DEFACTO_SPEED] = "HOOK_MARIO_OVERRIDE_PHYS_STEP_DEFACTO_SPEED",
+    [HOOK_ON_OBJECT_LOAD] = "HOOK_ON_OBJECT_LOAD",
+    [HOOK_ON_PLAY_SOUND] = "HOOK_ON_PLAY_SOUND",
+    [HOOK_ON_SEQ_LOAD] = "HOOK_ON_SEQ_LOAD",
+    [HOOK_ON_ATTACK_OBJECT] = "HOOK_ON_ATTACK_OBJECT",
+    [HOOK_ON_LANGUAGE_CHANGED] = "HOOK_ON_LANGUAGE_CHANGED",
+    [HOOK_ON_MODS_LOADED] = "HOOK_ON_MODS_LOADED",
+    [HOOK_ON_NAMETAGS_RENDER] = "HOOK_ON_NAMETAGS_RENDER",
+    [HOOK_ON_DJUI_THEME_CHANGED] = "HOOK_ON_DJUI_THEME_CHANGED",
+    [HOOK_ON_GEO_PROCESS] = "HOOK_ON_GEO_PROCESS",
+    [HOOK_BEFORE_GEO_PROCESS] = "HOOK_BEFORE_GEO_PROCESS",
+    [HOOK_ON_GEO_PROCESS_CHILDREN] = "HOOK_ON_GEO_PROCESS_CHILDREN",
+    [HOOK_MARIO_OVERRIDE_GEOMETRY_INPUTS] = "HOOK_MARIO_OVERRIDE_GEOMETRY_INPUTS",
+    [HOOK_ON_INTERACTIONS] = "HOOK_ON_INTERACTIONS",
+    [HOOK_ALLOW_FORCE_WATER_ACTION] = "HOOK_ALLOW_FORCE_WATER_ACTION",
+    [HOOK_BEFORE_WARP] = "HOOK_BEFORE_WARP",
+    [HOOK_ON_INSTANT_WARP] = "HOOK_ON_INSTANT_WARP",
+    [HOOK_MARIO_OVERRIDE_FLOOR_CLASS] = "HOOK_MARIO_OVERRIDE_FLOOR_CLASS",
+    [HOOK_ON_ADD_SURFACE] = "HOOK_ON_ADD_SURFACE",
+    [HOOK_ON_CLEAR_AREAS] = "HOOK_ON_CLEAR_AREAS",
+    [HOOK_ON_PACKET_BYTESTRING_RECEIVE] = "HOOK_ON_PACKET_BYTESTRING_RECEIVE",
+};
+
 static lua_State *sHookState = NULL;
 static struct LuaHookedEvent sHookedEvents[HOOK_MAX];
 static int sNextModMenuHandle = 1;
@@ -45,6 +111,7 @@ struct LuaSyncTableChangeHook {
     int tagRef;
     int funcRef;
     int prevValueRef;
+    int owner;
     bool active;
 };
 
@@ -64,6 +131,7 @@ static int sSyncTableChangeHookCount = 0;
 struct LuaMarioActionHook {
     u32 action;
     int callbackRef;
+    int owner;
     bool active;
 };
 
@@ -73,6 +141,7 @@ struct LuaBehaviorHook {
     bool sync;
     int initRef;
     int loopRef;
+    int owner;
     bool active;
 };
 
@@ -124,12 +193,17 @@ static void smlua_callback_budget_hook(lua_State *L, lua_Debug *ar) {
     luaL_error(L, "callback exceeded instruction budget");
 }
 
-// Runs a Lua callback under an instruction budget guard.
-static int smlua_pcall_with_budget(lua_State *L, int nargs, int nresults) {
+// Runs a Lua callback under an instruction budget guard, charging its
+// allocations and profiler time to the mod that registered it.
+static int smlua_pcall_with_budget(lua_State *L, int nargs, int nresults, int owner, const char *site) {
     int status;
-    lua_sethook(L, smlua_callback_budget_hook, LUA_MASKCOUNT, SMLUA_CALLBACK_INSTRUCTION_BUDGET);
+    int prev_owner = smlua_alloc_set_owner(owner);
+    smlua_profiler_begin(owner, site);
+    smlua_profiler_sethook(L, smlua_callback_budget_hook, SMLUA_CALLBACK_INSTRUCTION_BUDGET);
     status = lua_pcall(L, nargs, nresults, 0);
     lua_sethook(L, NULL, 0, 0);
+    smlua_profiler_end();
+    smlua_alloc_set_owner(prev_owner);
     return status;
 }
 
@@ -165,7 +239,9 @@ static int smlua_hook_event(lua_State *L) {
         return 0;
     }
 
-    hook->references[hook->count++] = ref;
+    hook->references[hook->count] = ref;
+    hook->owners[hook->count] = smlua_alloc_get_owner();
+    hook->count++;
     return 0;
 }
 
@@ -227,6 +303,7 @@ static int smlua_hook_on_sync_table_change(lua_State *L) {
     watch->prevValueRef = luaL_ref(L, LUA_REGISTRYINDEX);
     lua_pop(L, 1);
 
+    watch->owner = smlua_alloc_get_owner();
     watch->active = true;
     sSyncTableChangeHookCount++;
 
@@ -317,6 +394,7 @@ static int smlua_hook_mario_action(lua_State *L) {
     struct LuaMarioActionHook *hook = &sMarioActionHooks[sMarioActionHookCount];
     memset(hook, 0, sizeof(*hook));
     hook->action = (u32)lua_tointeger(L, 1);
+    hook->owner = smlua_alloc_get_owner();
     lua_pushvalue(L, 2);
     hook->callbackRef = luaL_ref(L, LUA_REGISTRYINDEX);
     hook->active = hook->callbackRef != LUA_NOREF && hook->callbackRef != LUA_REFNIL;
@@ -349,6 +427,7 @@ static int smlua_hook_behavior(lua_State *L) {
     hook->behaviorId = behaviorId;
     hook->objList = (int)lua_tointeger(L, 2);
     hook->sync = lua_toboolean(L, 3) != 0;
+    hook->owner = smlua_alloc_get_owner();
     hook->initRef = LUA_NOREF;
     hook->loopRef = LUA_NOREF;
 
@@ -380,8 +459,12 @@ static int smlua_hook_behavior(lua_State *L) {
 static bool smlua_dispatch_hook_callbacks(enum LuaHookedEventType hook_type, int arg_count, int result_count,
                                           SmluaHookPushArgsFn push_args, const void *arg_ctx,
                                           SmluaHookReadResultsFn read_results, void *result_ctx) {
+    // Most events have no listeners; skip the VM lookup and diagnostics.
+    if (hook_type < 0 || hook_type >= HOOK_MAX || sHookedEvents[hook_type].count == 0) {
+        return false;
+    }
     lua_State *L = smlua_resolve_hook_state();
-    if (L == NULL || hook_type < 0 || hook_type >= HOOK_MAX) {
+    if (L == NULL) {
         return false;
     }
 
@@ -399,7 +482,7 @@ static bool smlua_dispatch_hook_callbacks(enum LuaHookedEventType hook_type, int
             push_args(L, arg_ctx);
         }
 
-        if (smlua_pcall_with_budget(L, arg_count, result_count) != LUA_OK) {
+        if (smlua_pcall_with_budget(L, arg_count, result_count, hook->owners[i], sHookEventNames[hook_type]) != LUA_OK) {
             const char *error = lua_tostring(L, -1);
             smlua_hook_logf("lua: hook %d failed: %s", hook_type, error != NULL ? error : "<unknown>");
             lua_pop(L, 1);
@@ -580,6 +663,11 @@ bool smlua_call_event_hooks_mario(enum LuaHookedEventType hook_type, const void
 // Dispatches pre-physics hooks with step metadata and supports optional result override.
 bool smlua_call_event_hooks_before_phys_step(const void *mario_state, int step_type,
                                              unsigned int step_arg, int *step_result_override) {
+    // Runs for every physics step of every player; bail before any logging
+    // or VM lookup when no mod listens.
+    if (sHookedEvents[HOOK_BEFORE_PHYS_STEP].count == 0) {
+        return false;
+    }
     lua_State *L = smlua_resolve_hook_state();
 #ifdef TARGET_WII_U
     if (step_type >= 0 && step_type < (int)(sizeof(sBeforePhysStepTypeLogged) / sizeof(sBeforePhysStepTypeLogged[0])) &&
@@ -633,7 +721,7 @@ bool smlua_call_event_hooks_before_phys_step(const void *mario_state, int step_t
         lua_pushinteger(L, step_type);
         lua_pushinteger(L, (lua_Integer)step_arg);
 
-        if (smlua_pcall_with_budget(L, 3, 1) != LUA_OK) {
+        if (smlua_pcall_with_budget(L, 3, 1, hook->owners[i], sHookEventNames[HOOK_BEFORE_PHYS_STEP]) != LUA_OK) {
             const char *error = lua_tostring(L, -1);
             smlua_hook_logf("lua: hook %d failed: %s", HOOK_BEFORE_PHYS_STEP,
                             error != NULL ? error : "<unknown>");
@@ -729,7 +817,7 @@ bool smlua_call_mario_action_hook(const void *mario_state, int *in_loop) {
         }
 
         smlua_push_mario_state(L, m);
-        if (smlua_pcall_with_budget(L, 1, 1) != LUA_OK) {
+        if (smlua_pcall_with_budget(L, 1, 1, hook->owner, "hook_mario_action") != LUA_OK) {
             const char *error = lua_tostring(L, -1);
             smlua_hook_logf("lua: mario action hook failed: %s", error != NULL ? error : "<unknown>");
             lua_pop(L, 1);
@@ -791,7 +879,7 @@ void smlua_call_behavior_hooks(void) {
                         lua_rawgeti(L, LUA_REGISTRYINDEX, hook->initRef);
                         if (lua_isfunction(L, -1)) {
                             smlua_push_object(L, obj);
-                            if (smlua_pcall_with_budget(L, 1, 0) != LUA_OK) {
+                            if (smlua_pcall_with_budget(L, 1, 0, hook->owner, "hook_behavior_init") != LUA_OK) {
                                 const char *error = lua_tostring(L, -1);
                                 smlua_hook_logf("lua: behavior init hook failed: %s",
                                                 error != NULL ? error : "<unknown>");
@@ -806,7 +894,7 @@ void smlua_call_behavior_hooks(void) {
                         lua_rawgeti(L, LUA_REGISTRYINDEX, hook->loopRef);
                         if (lua_isfunction(L, -1)) {
                             smlua_push_object(L, obj);
-                            if (smlua_pcall_with_budget(L, 1, 0) != LUA_OK) {
+                            if (smlua_pcall_with_budget(L, 1, 0, hook->owner, "hook_behavior_loop") != LUA_OK) {
                                 const char *error = lua_tostring(L, -1);
                                 smlua_hook_logf("lua: behavior loop hook failed: %s",
                                                 error != NULL ? error : "<unknown>");
@@ -858,7 +946,7 @@ void smlua_poll_sync_table_change_hooks(void) {
                 lua_pushvalue(L, previousValueIndex);
                 lua_pushvalue(L, currentValueIndex);
 
-                if (smlua_pcall_with_budget(L, 3, 0) != LUA_OK) {
+                if (smlua_pcall_with_budget(L, 3, 0, watch->owner, "hook_on_sync_table_change") != LUA_OK) {
                     const char *error = lua_tostring(L, -1);
                     smlua_hook_logf("lua: sync-table hook failed: %s", error != NULL ? error : "<unknown>");
                     lua_pop(L, 1);
@@ -964,66 +1052,9 @@ void smlua_bind_hooks(lua_State *L) {
     lua_pushcfunction(L, smlua_hook_behavior);
     lua_setglobal(L, "hook_behavior");
 
-    smlua_set_global_integer(L, "HOOK_UPDATE", HOOK_UPDATE);
-    smlua_set_global_integer(L, "HOOK_MARIO_UPDATE", HOOK_MARIO_UPDATE);
-    smlua_set_global_integer(L, "HOOK_BEFORE_MARIO_UPDATE", HOOK_BEFORE_MARIO_UPDATE);
-    smlua_set_global_integer(L, "HOOK_ON_SET_MARIO_ACTION", HOOK_ON_SET_MARIO_ACTION);
-    smlua_set_global_integer(L, "HOOK_BEFORE_PHYS_STEP", HOOK_BEFORE_PHYS_STEP);
-    smlua_set_global_integer(L, "HOOK_ALLOW_PVP_ATTACK", HOOK_ALLOW_PVP_ATTACK);
-    smlua_set_global_integer(L, "HOOK_ON_PVP_ATTACK", HOOK_ON_PVP_ATTACK);
-    smlua_set_global_integer(L, "HOOK_ON_PLAYER_CONNECTED", HOOK_ON_PLAYER_CONNECTED);
-    smlua_set_global_integer(L, "HOOK_ON_PLAYER_DISCONNECTED", HOOK_ON_PLAYER_DISCONNECTED);
-    smlua_set_global_integer(L, "HOOK_ON_HUD_RENDER", HOOK_ON_HUD_RENDER);
-    smlua_set_global_integer(L, "HOOK_ALLOW_INTERACT", HOOK_ALLOW_INTERACT);
-    smlua_set_global_integer(L, "HOOK_ON_INTERACT", HOOK_ON_INTERACT);
-    smlua_set_global_integer(L, "HOOK_ON_LEVEL_INIT", HOOK_ON_LEVEL_INIT);
-    smlua_set_global_integer(L, "HOOK_ON_WARP", HOOK_ON_WARP);
-    smlua_set_global_integer(L, "HOOK_ON_SYNC_VALID", HOOK_ON_SYNC_VALID);
-    smlua_set_global_integer(L, "HOOK_ON_OBJECT_UNLOAD", HOOK_ON_OBJECT_UNLOAD);
-    smlua_set_global_integer(L, "HOOK_ON_SYNC_OBJECT_UNLOAD", HOOK_ON_SYNC_OBJECT_UNLOAD);
-    smlua_set_global_integer(L, "HOOK_ON_PAUSE_EXIT", HOOK_ON_PAUSE_EXIT);
-    smlua_set_global_integer(L, "HOOK_GET_STAR_COLLECTION_DIALOG", HOOK_GET_STAR_COLLECTION_DIALOG);
-    smlua_set_global_integer(L, "HOOK_ON_SET_CAMERA_MODE", HOOK_ON_SET_CAMERA_MODE);
-    smlua_set_global_integer(L, "HOOK_ON_OBJECT_RENDER", HOOK_ON_OBJECT_RENDER);
-    smlua_set_global_integer(L, "HOOK_ON_DEATH", HOOK_ON_DEATH);
-    smlua_set_global_integer(L, "HOOK_ON_PACKET_RECEIVE", HOOK_ON_PACKET_RECEIVE);
-    smlua_set_global_integer(L, "HOOK_USE_ACT_SELECT", HOOK_USE_ACT_SELECT);
-    smlua_set_global_integer(L, "HOOK_ON_CHANGE_CAMERA_ANGLE", HOOK_ON_CHANGE_CAMERA_ANGLE);
-    smlua_set_global_integer(L, "HOOK_ON_SCREEN_TRANSITION", HOOK_ON_SCREEN_TRANSITION);
-    smlua_set_global_integer(L, "HOOK_ALLOW_HAZARD_SURFACE", HOOK_ALLOW_HAZARD_SURFACE);
-    smlua_set_global_integer(L, "HOOK_ON_CHAT_MESSAGE", HOOK_ON_CHAT_MESSAGE);
-    smlua_set_global_integer(L, "HOOK_OBJECT_SET_MODEL", HOOK_OBJECT_SET_MODEL);
-    smlua_set_global_integer(L, "HOOK_CHARACTER_SOUND", HOOK_CHARACTER_SOUND);
-    smlua_set_global_integer(L, "HOOK_BEFORE_SET_MARIO_ACTION", HOOK_BEFORE_SET_MARIO_ACTION);
-    smlua_set_global_integer(L, "HOOK_JOINED_GAME", HOOK_JOINED_GAME);
-    smlua_set_global_integer(L, "HOOK_ON_OBJECT_ANIM_UPDATE", HOOK_ON_OBJECT_ANIM_UPDATE);
-    smlua_set_global_integer(L, "HOOK_ON_DIALOG", HOOK_ON_DIALOG);
-    smlua_set_global_integer(L, "HOOK_ON_EXIT", HOOK_ON_EXIT);
-    smlua_set_global_integer(L, "HOOK_DIALOG_SOUND", HOOK_DIALOG_SOUND);
-    smlua_set_global_integer(L, "HOOK_ON_HUD_RENDER_BEHIND", HOOK_ON_HUD_RENDER_BEHIND);
-    smlua_set_global_integer(L, "HOOK_ON_COLLIDE_LEVEL_BOUNDS", HOOK_ON_COLLIDE_LEVEL_BOUNDS);
-    smlua_set_global_integer(L, "HOOK_MIRROR_MARIO_RENDER", HOOK_MIRROR_MARIO_RENDER);
-    smlua_set_global_integer(L, "HOOK_MARIO_OVERRIDE_PHYS_STEP_DEFACTO_SPEED", HOOK_MARIO_OVERRIDE_PHYS_STEP_DEFACTO_SPEED);
-    smlua_set_global_integer(L, "HOOK_ON_OBJECT_LOAD", HOOK_ON_OBJECT_LOAD);
-    smlua_set_global_integer(L, "HOOK_ON_PLAY_SOUND", HOOK_ON_PLAY_SOUND);
-    smlua_set_global_integer(L, "HOOK_ON_SEQ_LOAD", HOOK_ON_SEQ_LOAD);
-    smlua_set_global_integer(L, "HOOK_ON_ATTACK_OBJECT", HOOK_ON_ATTACK_OBJECT);
-    smlua_set_global_integer(L, "HOOK_ON_LANGUAGE_CHANGED", HOOK_ON_LANGUAGE_CHANGED);
-    smlua_set_global_integer(L, "HOOK_ON_MODS_LOADED", HOOK_ON_MODS_LOADED);
-    smlua_set_global_integer(L, "HOOK_ON_NAMETAGS_RENDER", HOOK_ON_NAMETAGS_RENDER);
-    smlua_set_global_integer(L, "HOOK_ON_DJUI_THEME_CHANGED", HOOK_ON_DJUI_THEME_CHANGED);
-    smlua_set_global_integer(L, "HOOK_ON_GEO_PROCESS", HOOK_ON_GEO_PROCESS);
-    smlua_set_global_integer(L, "HOOK_BEFORE_GEO_PROCESS", HOOK_BEFORE_GEO_PROCESS);
-    smlua_set_global_integer(L, "HOOK_ON_GEO_PROCESS_CHILDREN", HOOK_ON_GEO_PROCESS_CHILDREN);
-    smlua_set_global_integer(L, "HOOK_MARIO_OVERRIDE_GEOMETRY_INPUTS", HOOK_MARIO_OVERRIDE_GEOMETRY_INPUTS);
-    smlua_set_global_integer(L, "HOOK_ON_INTERACTIONS", HOOK_ON_INTERACTIONS);
-    smlua_set_global_integer(L, "HOOK_ALLOW_FORCE_WATER_ACTION", HOOK_ALLOW_FORCE_WATER_ACTION);
-    smlua_set_global_integer(L, "HOOK_BEFORE_WARP", HOOK_BEFORE_WARP);
-    smlua_set_global_integer(L, "HOOK_ON_INSTANT_WARP", HOOK_ON_INSTANT_WARP);
-    smlua_set_global_integer(L, "HOOK_MARIO_OVERRIDE_FLOOR_CLASS", HOOK_MARIO_OVERRIDE_FLOOR_CLASS);
-    smlua_set_global_integer(L, "HOOK_ON_ADD_SURFACE", HOOK_ON_ADD_SURFACE);
-    smlua_set_global_integer(L, "HOOK_ON_CLEAR_AREAS", HOOK_ON_CLEAR_AREAS);
-    smlua_set_global_integer(L, "HOOK_ON_PACKET_BYTESTRING_RECEIVE", HOOK_ON_PACKET_BYTESTRING_RECEIVE);
+    for (int i = 0; i < HOOK_MAX; i++) {
+        smlua_set_global_integer(L, sHookEventNames[i], i);
+    }
 }
 
 u32 gLuaMarioActionIndex[8] = { 0 };
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pc/configfile.h"
+#include "pc/fs/fs.h"
+#include "pc/mods/mods.h"
+#include "pc/utils/misc.h"
+#include "smlua_alloc.h"
+#include "smlua_profiler.h"
+
+// Per-hook Lua profiler. Zone timing uses clock_elapsed_f64() so it behaves
+// the same on Wii U, desktop and the headless build. Results accumulate into
+// folded stacks ("mod;site;frame count" lines) that flamegraph.pl, speedscope
+// and inferno read directly:
+//   lua_profile_time.folded    - self time per zone, in microseconds
+//   lua_profile_samples.folded - Lua stack samples from the count hook
+
+#define SMLUA_PROFILER_MAX_DEPTH 16
+#define SMLUA_PROFILER_MAX_LUA_FRAMES 24
+#define SMLUA_PROFILER_FOLDED_SLOTS 4096
+#define SMLUA_PROFILER_KEY_MAX 1024
+
+struct SmluaProfilerZone {
+    int owner;
+    const char *site;
+    f64 start;
+    f64 childTime;
+};
+
+struct SmluaFoldedEntry {
+    char *key;
+    u32 hash;
+    u64 value;
+};
+
+struct SmluaFoldedTable {
+    struct SmluaFoldedEntry slots[SMLUA_PROFILER_FOLDED_SLOTS];
+    u32 count;
+    u32 dropped;
+};
+
+static struct SmluaProfilerZone sZones[SMLUA_PROFILER_MAX_DEPTH];
+static int sZoneDepth = 0;
+static int sZoneSkipped = 0;
+static f64 sOwnerTime[SMLUA_ALLOC_OWNER_COUNT];
+
+static struct SmluaFoldedTable sTimeStacks;
+static struct SmluaFoldedTable sSampleStacks;
+
+static lua_Hook sBudgetHook = NULL;
+static int sBudgetRemaining = 0;
+
+static u32 smlua_profiler_hash(const char *str) {
+    u32 hash = 5381;
+    while (*str != '\0') {
+        hash = (hash * 33) ^ (u8)*str++;
+    }
+    return hash;
+}
+
+static void smlua_folded_add(struct SmluaFoldedTable *table, const char *key, u64 value) {
+    u32 hash = smlua_profiler_hash(key);
+    u32 mask = SMLUA_PROFILER_FOLDED_SLOTS - 1;
+    for (u32 probe = 0; probe < SMLUA_PROFILER_FOLDED_SLOTS; probe++) {
+        struct SmluaFoldedEntry *entry = &table->slots[(hash + probe) & mask];
+        if (entry->key == NULL) {
+            // Keep a quarter of the table free so probes stay short.
+            if (table->count >= (SMLUA_PROFILER_FOLDED_SLOTS * 3) / 4) {
+                break;
+            }
+            entry->key = strdup(key);
+            if (entry->key == NULL) {
+                break;
+            }
+            entry->hash = hash;
+            entry->value = value;
+            table->count++;
+            return;
+        }
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            entry->value += value;
+            return;
+        }
+    }
+    table->dropped++;
+}
+
+static void smlua_folded_clear(struct SmluaFoldedTable *table) {
+    for (u32 i = 0; i < SMLUA_PROFILER_FOLDED_SLOTS; i++) {
+        free(table->slots[i].key);
+    }
+    memset(table, 0, sizeof(*table));
+}
+
+// Appends one folded frame, replacing the separator characters the format reserves.
+static size_t smlua_folded_append(char *buffer, size_t length, const char *frame) {
+    if (length > 0 && length < SMLUA_PROFILER_KEY_MAX - 1) {
+        buffer[length++] = ';';
+    }
+    while (*frame != '\0' && length < SMLUA_PROFILER_KEY_MAX - 1) {
+        char c = *frame++;
+        buffer[length++] = (c == ';' || c == '\n') ? ':' : c;
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+static const char *smlua_profiler_owner_name(int owner) {
+    if (owner >= 0 && owner < MODS_MAX_ACTIVE_SCRIPTS) {
+        const char *path = mods_get_active_script_path((size_t)owner);
+        if (path != NULL) {
+            const char *slash = strrchr(path, '/');
+            return (slash != NULL) ? slash + 1 : path;
+        }
+    }
+    return "core";
+}
+
+// Builds "mod;site;site..." for the current zone stack.
+static size_t smlua_profiler_zone_key(char *buffer) {
+    size_t length = 0;
+    buffer[0] = '\0';
+    if (sZoneDepth <= 0) {
+        return smlua_folded_append(buffer, length, "core");
+    }
+    length = smlua_folded_append(buffer, length, smlua_profiler_owner_name(sZones[sZoneDepth - 1].owner));
+    for (int i = 0; i < sZoneDepth; i++) {
+        length = smlua_folded_append(buffer, length, sZones[i].site);
+    }
+    return length;
+}
+
+void smlua_profiler_begin(int owner, const char *site) {
+    // Skipped zones still count so the matching end() stays balanced.
+    if (!configLuaProfiler || sZoneDepth >= SMLUA_PROFILER_MAX_DEPTH) {
+        sZoneSkipped++;
+        return;
+    }
+    struct SmluaProfilerZone *zone = &sZones[sZoneDepth++];
+    zone->owner = owner;
+    zone->site = (site != NULL) ? site : "?";
+    zone->childTime = 0.0;
+    zone->start = clock_elapsed_f64();
+}
+
+void smlua_profiler_end(void) {
+    if (sZoneSkipped > 0) {
+        sZoneSkipped--;
+        return;
+    }
+    if (sZoneDepth <= 0) {
+        return;
+    }
+
+    struct SmluaProfilerZone *zone = &sZones[sZoneDepth - 1];
+    f64 total = clock_elapsed_f64() - zone->start;
+    f64 self = total - zone->childTime;
+    if (self < 0.0) {
+        self = 0.0;
+    }
+
+    int owner = (zone->owner >= 0 && zone->owner < SMLUA_ALLOC_OWNER_COUNT) ? zone->owner : SMLUA_ALLOC_OWNER_CORE;
+    sOwnerTime[owner] += self;
+
+    char key[SMLUA_PROFILER_KEY_MAX];
+    smlua_profiler_zone_key(key);
+    smlua_folded_add(&sTimeStacks, key, (u64)(self * 1000000.0 + 0.5));
+
+    sZoneDepth--;
+    if (sZoneDepth > 0) {
+        sZones[sZoneDepth - 1].childTime += total;
+    }
+}
+
+// Count hook used while sampling: records the Lua stack under the current
+// zone, then enforces the caller's instruction budget.
+static void smlua_profiler_sample_hook(lua_State *L, lua_Debug *ar) {
+    char key[SMLUA_PROFILER_KEY_MAX];
+    size_t length = smlua_profiler_zone_key(key);
+
+    lua_Debug frames[SMLUA_PROFILER_MAX_LUA_FRAMES];
+    int frame_count = 0;
+    while (frame_count < SMLUA_PROFILER_MAX_LUA_FRAMES && lua_getstack(L, frame_count, &frames[frame_count])) {
+        frame_count++;
+    }
+
+    // lua_getstack walks leaf first; folded stacks list the root first.
+    for (int i = frame_count - 1; i >= 0; i--) {
+        lua_Debug *frame = &frames[i];
+        char label[192];
+        if (!lua_getinfo(L, "Sn", frame)) {
+            continue;
+        }
+        if (frame->what != NULL && strcmp(frame->what, "C") == 0) {
+            snprintf(label, sizeof(label), "[C] %s", frame->name != NULL ? frame->name : "?");
+        } else {
+            snprintf(label, sizeof(label), "%s %s:%d", frame->name != NULL ? frame->name : "?",
+                     frame->short_src, frame->linedefined);
+        }
+        length = smlua_folded_append(key, length, label);
+    }
+    smlua_folded_add(&sSampleStacks, key, 1);
+
+    sBudgetRemaining -= (int)configLuaProfilerSampleInterval;
+    if (sBudgetRemaining <= 0 && sBudgetHook != NULL) {
+        sBudgetHook(L, ar);
+    }
+}
+
+void smlua_profiler_sethook(lua_State *L, lua_Hook budget_hook, int budget) {
+    int interval = (int)configLuaProfilerSampleInterval;
+    if (!configLuaProfiler || interval <= 0 || interval >= budget) {
+        lua_sethook(L, budget_hook, LUA_MASKCOUNT, budget);
+        return;
+    }
+    sBudgetHook = budget_hook;
+    sBudgetRemaining = budget;
+    lua_sethook(L, smlua_profiler_sample_hook, LUA_MASKCOUNT, interval);
+}
+
+// Cumulative self time charged to a mod, in seconds.
+f64 smlua_profiler_get_owner_time(int owner) {
+    if (owner < 0 || owner >= SMLUA_ALLOC_OWNER_COUNT) {
+        return 0.0;
+    }
+    return sOwnerTime[owner];
+}
+
+static bool smlua_profiler_write_table(const struct SmluaFoldedTable *table, const char *filename) {
+    if (table->count == 0) {
+        return true;
+    }
+
+    const char *path = fs_get_write_path(filename);
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        printf("lua: profiler failed to open '%s'\n", path);
+        return false;
+    }
+    for (u32 i = 0; i < SMLUA_PROFILER_FOLDED_SLOTS; i++) {
+        const struct SmluaFoldedEntry *entry = &table->slots[i];
+        if (entry->key != NULL && entry->value > 0) {
+            fprintf(file, "%s %llu\n", entry->key, (unsigned long long)entry->value);
+        }
+    }
+    fclose(file);
+
+    printf("lua: profiler wrote %u stacks to '%s' (%u dropped)\n", (unsigned)table->count, path,
+           (unsigned)table->dropped);
+    return true;
+}
+
+// Writes the collected folded stacks to the user write path.
+bool smlua_profiler_write_folded(void) {
+    bool ok = smlua_profiler_write_table(&sTimeStacks, "lua_profile_time.folded");
+    ok = smlua_profiler_write_table(&sSampleStacks, "lua_profile_samples.folded") && ok;
+    return ok;
+}
+
+void smlua_profiler_reset(void) {
+    smlua_folded_clear(&sTimeStacks);
+    smlua_folded_clear(&sSampleStacks);
+    memset(sOwnerTime, 0, sizeof(sOwnerTime));
+    sZoneDepth = 0;
+    sZoneSkipped = 0;
+    sBudgetHook = NULL;
+    sBudgetRemaining = 0;
+}
@@ -0,0 +1,25 @@
+#ifndef SM64_PC_SMLUA_PROFILER_H
+#define SM64_PC_SMLUA_PROFILER_H
+
+#include <stdbool.h>
+
+#include <lua.h>
+
+#include "types.h"
+
+// Timed Lua dispatch sites. Zones nest (a hook fired from inside another
+// mod's callback is charged to its own mod), and each zone records self time
+// so per-mod totals never double count.
+void smlua_profiler_begin(int owner, const char *site);
+void smlua_profiler_end(void);
+
+// Installs the instruction budget hook for a callback. When stack sampling is
+// enabled the sampler takes over the count hook and forwards to budget_hook
+// once the same instruction budget is used up.
+void smlua_profiler_sethook(lua_State *L, lua_Hook budget_hook, int budget);
+
+f64 smlua_profiler_get_owner_time(int owner);
+bool smlua_profiler_write_folded(void);
+void smlua_profiler_reset(void);
+
+#endif
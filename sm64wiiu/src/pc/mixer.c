@@ -5,17 +5,37 @@
 
 #include "mixer.h"
 
-#ifdef __SSE4_1__
+// MIXER_SCALAR forces the reference scalar code and MIXER_GENERIC_VECTOR
+// forces the portable vector code; tools/mixer_bench builds every variant.
+#if defined(MIXER_SCALAR)
+#define HAS_SSE41 0
+#define HAS_NEON 0
+#elif defined(__SSE4_1__) && !defined(MIXER_GENERIC_VECTOR)
 #include <immintrin.h>
 #define HAS_SSE41 1
 #define HAS_NEON 0
-#elif __ARM_NEON
+#elif __ARM_NEON && !defined(MIXER_GENERIC_VECTOR)
 #include <arm_neon.h>
 #define HAS_SSE41 0
 #define HAS_NEON 1
 #else
 #define HAS_SSE41 0
 #define HAS_NEON 0
+// GCC/Clang generic vectors, bit-exact with the scalar code. Only on by default
+// where the target has integer SIMD to lower them to; without it (Espresso)
+// they become scalar code again, so MIXER_GENERIC_VECTOR opts in after
+// measuring with tools/mixer_bench.
+#if defined(MIXER_GENERIC_VECTOR) || defined(__SSE2__) || defined(__ALTIVEC__) || defined(__wasm_simd128__)
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_convertvector)
+#define HAS_VEC 1
+#endif
+#endif
+#endif
+#endif
+
+#ifndef HAS_VEC
+#define HAS_VEC 0
 #endif
 
 #pragma GCC optimize ("unroll-loops")
@@ -67,6 +87,10 @@ static struct {
     ADPCM_STATE *adpcm_loop_state;
 
     int16_t adpcm_table[8][2][8];
+#if HAS_VEC
+    int32_t adpcm_vec_taps[8][7][8]; // built lazily from adpcm_table
+    uint8_t adpcm_vec_valid;         // one bit per table entry
+#endif
 
 #ifdef NEW_AUDIO_UCODE
     uint16_t filter_count;
@@ -79,7 +103,7 @@ static struct {
     } buf;
 } rspa;
 
-static int16_t resample_table[64][4] = {
+int16_t resample_table[64][4] = {
     {0x0c39, 0x66ad, 0x0d46, 0xffdf}, {0x0b39, 0x6696, 0x0e5f, 0xffd8},
     {0x0a44, 0x6669, 0x0f83, 0xffd0}, {0x095a, 0x6626, 0x10b4, 0xffc8},
     {0x087d, 0x65cd, 0x11f0, 0xffbf}, {0x07ab, 0x655e, 0x1338, 0xffb6},
@@ -132,6 +156,47 @@ static inline int32_t clamp32(int64_t v) {
     return (int32_t)v;
 }
 
+#if HAS_VEC
+// 128-bit vectors lower well everywhere; wider ones get split badly on SSE2
+typedef int16_t v4s16 __attribute__((vector_size(8)));
+typedef int32_t v4s32 __attribute__((vector_size(16)));
+
+static inline v4s32 vload4(const int16_t *p) {
+    v4s16 v;
+    memcpy(&v, p, sizeof(v));
+    return __builtin_convertvector(v, v4s32);
+}
+
+static inline v4s32 vload4_s32(const int32_t *p) {
+    v4s32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void vstore4(int16_t *p, v4s32 v) {
+    // clamp16 on every lane before narrowing
+    v4s32 lo = v < -0x8000;
+    v4s32 hi = v > 0x7fff;
+    v = (v & ~(lo | hi)) | (lo & -0x8000) | (hi & 0x7fff);
+    v4s16 n = __builtin_convertvector(v, v4s16);
+    memcpy(p, &n, sizeof(n));
+}
+
+// [k][j] = adpcm_table[index][1][j - k - 1] for j > k, else 0
+static inline int32_t (*adpcm_vec_taps(int index))[8] {
+    if (!(rspa.adpcm_vec_valid & (1 << index))) {
+        int j, k;
+        for (k = 0; k < 7; k++) {
+            for (j = 0; j < 8; j++) {
+                rspa.adpcm_vec_taps[index][k][j] = j > k ? rspa.adpcm_table[index][1][j - k - 1] : 0;
+            }
+        }
+        rspa.adpcm_vec_valid |= 1 << index;
+    }
+    return rspa.adpcm_vec_taps[index];
+}
+#endif
+
 void aClearBufferImpl(uint16_t addr, int nbytes) {
     nbytes = ROUND_UP_16(nbytes);
     memset(BUF_U8(addr), 0, nbytes);
@@ -157,6 +222,9 @@ void aSaveBufferImpl(int16_t *dest_addr) {
 
 void aLoadADPCMImpl(int num_entries_times_16, const int16_t *book_source_addr) {
     memcpy(rspa.adpcm_table, book_source_addr, num_entries_times_16);
+#if HAS_VEC
+    rspa.adpcm_vec_valid = 0;
+#endif
 }
 
 void aSetBufferImpl(uint8_t flags, uint16_t in, uint16_t out, uint16_t nbytes) {
@@ -418,6 +486,31 @@ void aADPCMdecImpl(uint8_t flags, ADPCM_STATE state) {
             vst1q_s16(out, result);
             out += 8;
         }
+#elif HAS_VEC
+        // taps[k] holds tbl[1] shifted right by k + 1 lanes, so the in-frame
+        // recurrence becomes seven broadcast multiply-adds
+        int32_t (*taps)[8] = adpcm_vec_taps(table_index);
+        v4s32 tbl0[2] = {vload4(tbl[0]), vload4(tbl[0] + 4)};
+        v4s32 tbl1[2] = {vload4(tbl[1]), vload4(tbl[1] + 4)};
+        for (i = 0; i < 2; i++) {
+            int16_t ins[8];
+            int j, k;
+            for (j = 0; j < 4; j++) {
+                ins[j * 2] = (((*in >> 4) << 28) >> 28) << shift;
+                ins[j * 2 + 1] = (((*in++ & 0xf) << 28) >> 28) << shift;
+            }
+            v4s32 acc_lo = tbl0[0] * out[-2] + tbl1[0] * out[-1] + (vload4(ins) << 11);
+            v4s32 acc_hi = tbl0[1] * out[-2] + tbl1[1] * out[-1] + (vload4(ins + 4) << 11);
+            for (k = 0; k < 3; k++) {
+                acc_lo += vload4_s32(taps[k]) * ins[k];
+            }
+            for (k = 0; k < 7; k++) {
+                acc_hi += vload4_s32(taps[k] + 4) * ins[k];
+            }
+            vstore4(out, acc_lo >> 11);
+            vstore4(out + 4, acc_hi >> 11);
+            out += 8;
+        }
 #else
         for (i = 0; i < 2; i++) {
             int16_t ins[8];
@@ -451,7 +544,7 @@ void aResampleImpl(uint8_t flags, uint16_t pitch, RESAMPLE_STATE state) {
     int nbytes = ROUND_UP_16(rspa.nbytes);
     uint32_t pitch_accumulator;
     int i;
-#if !HAS_SSE41 && !HAS_NEON
+#if !HAS_SSE41 && !HAS_NEON && !HAS_VEC
     int16_t *tbl;
     int32_t sample;
 #endif
@@ -564,6 +657,36 @@ void aResampleImpl(uint8_t flags, uint16_t pitch, RESAMPLE_STATE state) {
     } while (nbytes > 0);
     in += vgetq_lane_u16(vreinterpretq_u16_u32(acc_a), 1);
     pitch_accumulator = vgetq_lane_u16(vreinterpretq_u16_u32(acc_a), 0);
+#elif HAS_VEC
+    do {
+        int32_t taps[4][8];
+        int32_t coefs[4][8];
+        uint32_t step = (uint32_t)pitch << 1;
+        int h, k;
+        // gather the 4 taps for each of the 8 outputs, then filter all lanes at once
+        for (i = 0; i < 8; i++) {
+            uint32_t pos = pitch_accumulator + step * i;
+            const int16_t *src = in + (pos >> 16);
+            const int16_t *tbl = resample_table[(pos & 0xffff) >> 10];
+            for (k = 0; k < 4; k++) {
+                taps[k][i] = src[k];
+                coefs[k][i] = tbl[k];
+            }
+        }
+        for (h = 0; h < 8; h += 4) {
+            v4s32 sum = (vload4_s32(taps[0] + h) * vload4_s32(coefs[0] + h) + 0x4000) >> 15;
+            for (k = 1; k < 4; k++) {
+                sum += (vload4_s32(taps[k] + h) * vload4_s32(coefs[k] + h) + 0x4000) >> 15;
+            }
+            vstore4(out + h, sum);
+        }
+        out += 8;
+
+        pitch_accumulator += step * 8;
+        in += pitch_accumulator >> 16;
+        pitch_accumulator %= 0x10000;
+        nbytes -= 8 * sizeof(int16_t);
+    } while (nbytes > 0);
 #else
     do {
         for (i = 0; i < 8; i++) {
@@ -858,6 +981,28 @@ void aEnvMixerImpl(uint8_t flags, ENVMIX_STATE state) {
 
     do {
         for (c = 0; c < 2; c++) {
+#if HAS_VEC
+            int h;
+            for (h = 0; h < 8; h += 4) {
+                v4s32 in_vec = vload4(in + h);
+                v4s32 vol = vload4_s32(vols[c] + h);
+                v4s32 clip;
+                if ((rate[c] >> 16) > 0) {
+                    clip = (vol >> 16) > target[c];
+                } else {
+                    clip = (vol >> 16) < target[c];
+                }
+                vol = (vol & ~clip) | (clip & (target[c] << 16));
+                memcpy(vols[c] + h, &vol, sizeof(vol));
+                vstore4(dry[c] + h, (vload4(dry[c] + h) * 0x7fff + in_vec * (((vol >> 16) * vol_dry + 0x4000) >> 15) + 0x4000) >> 15);
+                if (flags & A_AUX) {
+                    vstore4(wet[c] + h, (vload4(wet[c] + h) * 0x7fff + in_vec * (((vol >> 16) * vol_wet + 0x4000) >> 15) + 0x4000) >> 15);
+                }
+            }
+            for (i = 0; i < 8; i++) {
+                vols[c][i] = clamp32((int64_t)vols[c][i] * rate[c] >> 16);
+            }
+#else
             for (i = 0; i < 8; i++) {
                 if ((rate[c] >> 16) > 0) {
                     // Increasing volume
@@ -876,6 +1021,7 @@ void aEnvMixerImpl(uint8_t flags, ENVMIX_STATE state) {
                 }
                 vols[c][i] = clamp32((int64_t)vols[c][i] * rate[c] >> 16);
             }
+#endif
 
             dry[c] += 8;
             if (flags & A_AUX) {
@@ -914,8 +1060,10 @@ void aMixImpl(int16_t gain, uint16_t in_addr, uint16_t out_addr) {
     __m128i gain_vec = _mm_set1_epi16(gain);
 #elif !HAS_NEON
     int i;
+#if !HAS_VEC
     int32_t sample;
 #endif
+#endif
 
 #if !HAS_NEON
     if (gain == -0x8000) {
@@ -935,6 +1083,12 @@ void aMixImpl(int16_t gain, uint16_t in_addr, uint16_t out_addr) {
 
             out += 16;
             in += 16;
+#elif HAS_VEC
+            for (i = 0; i < 16; i += 4) {
+                vstore4(out, vload4(out) - vload4(in));
+                out += 4;
+                in += 4;
+            }
 #else
             for (i = 0; i < 16; i++) {
                 sample = *out - *in++;
@@ -978,6 +1132,12 @@ void aMixImpl(int16_t gain, uint16_t in_addr, uint16_t out_addr) {
 
         out += 16;
         in += 16;
+#elif HAS_VEC
+        for (i = 0; i < 16; i += 4) {
+            vstore4(out, ((vload4(out) * 0x7fff + vload4(in) * gain) + 0x4000) >> 15);
+            out += 4;
+            in += 4;
+        }
 #else
         for (i = 0; i < 16; i++) {
             sample = ((*out * 0x7fff + *in++ * gain) + 0x4000) >> 15;
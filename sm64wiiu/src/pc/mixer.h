@@ -44,6 +44,10 @@ void aSetLoopImpl(ADPCM_STATE *adpcm_loop_state);
 void aADPCMdecImpl(uint8_t flags, ADPCM_STATE state);
 void aResampleImpl(uint8_t flags, uint16_t pitch, RESAMPLE_STATE state);
 
+// 4-tap interpolation filter used by aResample, also used by the float
+// synthesis path in src/audio/synthesis_float.c
+extern int16_t resample_table[64][4];
+
 #ifndef NEW_AUDIO_UCODE
 void aSetVolumeImpl(uint8_t flags, int16_t v, int16_t t, int16_t r);
 void aLoadBufferImpl(const void *source_addr);
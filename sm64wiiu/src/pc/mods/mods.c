@@ -388,12 +388,7 @@ static int mods_compare_paths(const void *a, const void *b) {
 
 // Returns true if virtual file can be opened from currently mounted search paths.
 static bool mods_script_exists_in_vfs(const char *script_path) {
-    fs_file_t *script = fs_open(script_path);
-    if (script == NULL) {
-        return false;
-    }
-    fs_close(script);
-    return true;
+    return fs_exists(script_path);
 }
 
 // Frees heap-owned discovered script paths collected during last mods_init().
@@ -543,6 +538,12 @@ void mods_init(void) {
            (unsigned)builtin_count,
            (unsigned)discovered_count,
            (unsigned)gLocalMods.script_count);
+
+    fs_stats_t stats;
+    fs_get_stats(&stats);
+    printf("mods: vfs %u lookups, %u cached (%u negative), %u mount probes\n",
+           (unsigned)stats.lookups, (unsigned)(stats.hits + stats.negative_hits),
+           (unsigned)stats.negative_hits, (unsigned)stats.probes);
 }
 
 // Clears mod references during shutdown.
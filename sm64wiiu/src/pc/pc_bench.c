@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define PC_BENCH_HAVE_MALLINFO2
+#endif
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+#include "sm64.h"
+#include "object_fields.h"
+#include "object_constants.h"
+#include "game/area.h"
+#include "game/game_init.h"
+#include "game/level_update.h"
+#include "game/object_list_processor.h"
+#include "controller/controller_recorded_tas.h"
+#include "djui/djui.h"
+#include "lua/smlua_alloc.h"
+#ifdef ENABLE_GFX_DUMMY
+#include "gfx/gfx_dummy.h"
+#endif
+
+#include "pc_bench.h"
+#include "configfile.h"
+#include "debug_context.h"
+#include "frame_pacer.h"
+#include "utils/misc.h"
+
+// mirrors level_update.c
+#define WARP_TYPE_NOT_WARPING 0
+// the level's usual spawn point
+#define PC_BENCH_WARP_NODE 0x0A
+// ticks allowed for boot and the warp before the run is called off
+#define PC_BENCH_ARRIVAL_TICKS 1800
+
+#define FNV64_OFFSET 0xcbf29ce484222325ULL
+#define FNV64_PRIME  0x100000001b3ULL
+
+void initiate_warp(s16 destLevel, s16 destArea, s16 destWarpNode, s32 arg3);
+
+struct PcBench {
+    bool active;
+    bool measuring;
+    s16 level;
+    s16 area;
+    u32 ticks;
+    const char *input;
+    const char *report;
+
+    u32 waited;
+    u32 measured;
+    f64 start;
+    f64 contextTime[CTX_MAX];
+    struct FramePacerHistogram frameTimes;
+    u64 stateHash;
+    size_t heapPeak;
+    u32 objectsPeak;
+    bool ctxProfiler; // the user's setting, put back before the config is saved
+};
+
+static struct PcBench sBench = {
+    .level = LEVEL_BOB,
+    .area = 1,
+    .report = "bench_report.json",
+};
+
+static void pc_bench_usage(const char *exe) {
+    fprintf(stderr, "usage: %s --bench <ticks> [--bench-level <num>] [--bench-area <num>]\n"
+                    "       [--bench-input <file.m64>] [--bench-report <file.json>]\n", exe);
+}
+
+bool pc_bench_parse_args(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strncmp(arg, "--bench", 7) != 0) {
+            continue;
+        }
+        if (value == NULL) {
+            pc_bench_usage(argv[0]);
+            return false;
+        }
+        if (!strcmp(arg, "--bench")) {
+            sBench.ticks = (u32)strtoul(value, NULL, 10);
+            sBench.active = (sBench.ticks > 0);
+        } else if (!strcmp(arg, "--bench-level")) {
+            sBench.level = (s16)atoi(value);
+        } else if (!strcmp(arg, "--bench-area")) {
+            sBench.area = (s16)atoi(value);
+        } else if (!strcmp(arg, "--bench-input")) {
+            sBench.input = value;
+        } else if (!strcmp(arg, "--bench-report")) {
+            sBench.report = value;
+        } else {
+            pc_bench_usage(argv[0]);
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+bool pc_bench_active(void) {
+    return sBench.active;
+}
+
+bool pc_bench_read_input(OSContPad *pad) {
+    if (!sBench.active) {
+        return false;
+    }
+    if (sBench.measuring) {
+        controller_recorded_tas.read(pad);
+    }
+    return true;
+}
+
+  //////////
+ // hash //
+//////////
+
+static u64 pc_bench_hash(u64 hash, const void *data, size_t size) {
+    const u8 *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * FNV64_PRIME;
+    }
+    return hash;
+}
+
+// Mario's state each tick, so a divergence anywhere in the run shows
+static u64 pc_bench_hash_mario(u64 hash) {
+    struct MarioState *m = &gMarioStates[0];
+    hash = pc_bench_hash(hash, &gGlobalTimer, sizeof(gGlobalTimer));
+    hash = pc_bench_hash(hash, m->pos, sizeof(m->pos));
+    hash = pc_bench_hash(hash, m->vel, sizeof(m->vel));
+    hash = pc_bench_hash(hash, m->faceAngle, sizeof(m->faceAngle));
+    hash = pc_bench_hash(hash, &m->action, sizeof(m->action));
+    hash = pc_bench_hash(hash, &m->health, sizeof(m->health));
+    hash = pc_bench_hash(hash, &m->numCoins, sizeof(m->numCoins));
+    return pc_bench_hash(hash, &m->numStars, sizeof(m->numStars));
+}
+
+// every live object too, in list order; fields only, since pointers differ
+// between builds. Walks the object lists rather than gObjectPool, which
+// USE_SYSTEM_MALLOC builds never allocate from.
+static u64 pc_bench_hash_objects(u64 hash, u32 *count) {
+    *count = 0;
+    for (s32 i = 0; i < NUM_OBJ_LISTS; i++) {
+        struct ObjectNode *list = &gObjectListArray[i];
+        if (list->next == NULL) {
+            continue; // not cleared yet during boot
+        }
+        for (struct ObjectNode *node = list->next; node != list; node = node->next) {
+            struct Object *obj = (struct Object *) node;
+            if (obj->activeFlags == ACTIVE_FLAG_DEACTIVATED) {
+                continue;
+            }
+            hash = pc_bench_hash(hash, &i, sizeof(i));
+            hash = pc_bench_hash(hash, &obj->activeFlags, sizeof(obj->activeFlags));
+            hash = pc_bench_hash(hash, &obj->oPosX, sizeof(f32) * 3);
+            hash = pc_bench_hash(hash, &obj->oAction, sizeof(obj->oAction));
+            hash = pc_bench_hash(hash, &obj->oBehParams, sizeof(obj->oBehParams));
+            (*count)++;
+        }
+    }
+    return hash;
+}
+
+  ////////////
+ // report //
+////////////
+
+static void pc_bench_write_context(FILE *file, enum DebugContext ctx, bool last) {
+    char name[32];
+    const char *src = debug_context_get_name(ctx);
+    size_t len = 0;
+    for (; src[len] != '\0' && len < sizeof(name) - 1; len++) {
+        name[len] = (char)tolower((unsigned char)src[len]);
+    }
+    name[len] = '\0';
+    fprintf(file, "    \"%s\": { \"total_ms\": %.3f, \"per_tick_us\": %.2f }%s\n", name,
+            sBench.contextTime[ctx] * 1000.0, sBench.contextTime[ctx] * 1000000.0 / sBench.measured, last ? "" : ",");
+}
+
+static bool pc_bench_write_report(f64 elapsed, u32 objects) {
+    FILE *file = fopen(sBench.report, "w");
+    if (file == NULL) {
+        fprintf(stderr, "bench: failed to open '%s'\n", sBench.report);
+        return false;
+    }
+
+    size_t rssPeak = 0;
+#ifdef __linux__
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        rssPeak = (size_t)usage.ru_maxrss * 1024;
+    }
+#endif
+    struct SmluaAllocStats lua;
+    smlua_alloc_get_stats(&lua);
+    const struct FramePacerHistogram *frames = &sBench.frameTimes;
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"level\": %d,\n  \"area\": %d,\n  \"ticks\": %u,\n", sBench.level, sBench.area, sBench.measured);
+    fprintf(file, "  \"input\": \"%s\",\n", (sBench.input != NULL) ? sBench.input : "");
+    fprintf(file, "  \"wall_seconds\": %.3f,\n  \"ticks_per_second\": %.1f,\n", elapsed, sBench.measured / elapsed);
+    fprintf(file, "  \"tick_ms\": { \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n",
+            sBench.contextTime[CTX_TOTAL] * 1000.0 / sBench.measured,
+            frame_pacer_histogram_percentile(frames, 0.50) * 1000.0,
+            frame_pacer_histogram_percentile(frames, 0.95) * 1000.0,
+            frame_pacer_histogram_percentile(frames, 0.99) * 1000.0,
+            frames->max * 1000.0);
+
+    // zones nest, so each includes the ones inside it
+    fprintf(file, "  \"subsystems\": {\n");
+    for (s32 i = CTX_TOTAL; i < CTX_MAX; i++) {
+        pc_bench_write_context(file, (enum DebugContext)i, i == CTX_MAX - 1);
+    }
+    fprintf(file, "  },\n");
+
+    fprintf(file, "  \"memory\": {\n");
+    fprintf(file, "    \"rss_peak_bytes\": %zu,\n", rssPeak);
+    fprintf(file, "    \"heap_peak_bytes\": %zu,\n", sBench.heapPeak);
+    fprintf(file, "    \"lua_peak_bytes\": %zu,\n", lua.peakBytes);
+    fprintf(file, "    \"objects_peak\": %u\n", sBench.objectsPeak);
+    fprintf(file, "  },\n");
+
+#ifdef ENABLE_GFX_DUMMY
+    struct GfxDummyCounts counts;
+    gfx_dummy_get_counts(&counts);
+    fprintf(file, "  \"gfx\": { \"draw_calls\": %llu, \"triangles\": %llu, \"texture_uploads\": %llu },\n",
+            (unsigned long long)counts.drawCalls, (unsigned long long)counts.triangles,
+            (unsigned long long)counts.textureUploads);
+#endif
+
+    fprintf(file, "  \"objects\": %u,\n", objects);
+    fprintf(file, "  \"state_hash\": \"%016llx\"\n", (unsigned long long)sBench.stateHash);
+    fprintf(file, "}\n");
+    bool ok = (ferror(file) == 0);
+    fclose(file);
+
+    printf("bench: %u ticks in %.3fs, state %016llx, report in '%s'\n", sBench.measured, elapsed,
+           (unsigned long long)sBench.stateHash, sBench.report);
+    return ok;
+}
+
+  //////////
+ // runs //
+//////////
+
+static bool pc_bench_arrived(void) {
+    return gCurrLevelNum == sBench.level && gCurrAreaIndex == sBench.area
+        && gMarioState != NULL && gMarioState->marioObj != NULL
+        && !gWarpTransition.isActive && sCurrPlayMode == 0
+        && sWarpDest.type == WARP_TYPE_NOT_WARPING && sDelayedWarpOp == WARP_OP_NONE;
+}
+
+// the same deferred level change the menu scenes use, then an area warp
+static void pc_bench_travel(void) {
+    if (gDjuiInMainMenu) {
+        djui_close_main_menu();
+    }
+    if (gWarpTransition.isActive || gChangeLevelTransition != -1
+        || sWarpDest.type != WARP_TYPE_NOT_WARPING || sDelayedWarpOp != WARP_OP_NONE) {
+        return;
+    }
+    if (gCurrLevelNum != sBench.level) {
+        gChangeLevelTransition = sBench.level;
+    } else if (gCurrAreaIndex != sBench.area) {
+        initiate_warp(sBench.level, sBench.area, PC_BENCH_WARP_NODE, 0);
+    }
+}
+
+static void pc_bench_start(void) {
+    if (sBench.input != NULL && !controller_recorded_tas_open(sBench.input)) {
+        fprintf(stderr, "bench: failed to open input '%s'\n", sBench.input);
+        exit(1);
+    }
+    // per-tick zone totals feed the report
+    sBench.ctxProfiler = configCtxProfiler;
+    configCtxProfiler = true;
+    sBench.measuring = true;
+    sBench.stateHash = FNV64_OFFSET;
+    sBench.start = clock_elapsed_f64();
+    printf("bench: reached level %d area %d after %u ticks\n", sBench.level, sBench.area, sBench.waited);
+}
+
+void pc_bench_begin_frame(void) {
+    if (!sBench.active || sBench.measuring) {
+        return;
+    }
+    if (pc_bench_arrived()) {
+        pc_bench_start();
+        return;
+    }
+    if (++sBench.waited > PC_BENCH_ARRIVAL_TICKS) {
+        fprintf(stderr, "bench: level %d area %d not reached in %u ticks\n", sBench.level, sBench.area,
+                PC_BENCH_ARRIVAL_TICKS);
+        exit(1);
+    }
+    pc_bench_travel();
+}
+
+void pc_bench_end_frame(void) {
+    if (!sBench.measuring) {
+        return;
+    }
+
+    for (s32 i = CTX_TOTAL; i < CTX_MAX; i++) {
+        sBench.contextTime[i] += debug_context_get_time((enum DebugContext)i);
+    }
+    frame_pacer_histogram_add(&sBench.frameTimes, debug_context_get_time(CTX_TOTAL));
+    u32 objects = 0;
+    sBench.stateHash = pc_bench_hash_mario(sBench.stateHash);
+    sBench.stateHash = pc_bench_hash_objects(sBench.stateHash, &objects);
+    if (objects > sBench.objectsPeak) {
+        sBench.objectsPeak = objects;
+    }
+#ifdef PC_BENCH_HAVE_MALLINFO2
+    struct mallinfo2 heap = mallinfo2();
+    if (heap.uordblks + heap.hblkhd > sBench.heapPeak) {
+        sBench.heapPeak = heap.uordblks + heap.hblkhd;
+    }
+#endif
+
+    if (++sBench.measured < sBench.ticks) {
+        return;
+    }
+    f64 elapsed = clock_elapsed_f64() - sBench.start;
+    configCtxProfiler = sBench.ctxProfiler;
+    exit(pc_bench_write_report(elapsed, objects) ? 0 : 1);
+}
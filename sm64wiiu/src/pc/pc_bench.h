@@ -0,0 +1,39 @@
+#ifndef PC_BENCH_H
+#define PC_BENCH_H
+
+#include <stdbool.h>
+#include <ultra64.h>
+
+// Deterministic benchmark runs. With --bench the game skips the menu, warps
+// to the chosen level and area, then plays a recorded .m64 through the
+// controller layer for a fixed number of ticks as fast as it can: one
+// render per tick, no pacing sleeps, audio synthesized inline. At the end
+// it writes a JSON report of per-subsystem time, memory high-water marks
+// and a hash of the game state, and exits. Build with BENCHMARK=1 for the
+// headless dummy renderer and null audio; tools/bench_compare.py checks a
+// report against a baseline.
+//
+// Not validated yet: no real run has produced two reports and confirmed
+// their state hashes match, so a hash mismatch may still be the harness's
+// fault. Don't use it as a gate until two identical runs compare clean.
+//
+//   --bench <ticks>          ticks to measure once the level is reached
+//   --bench-level <num>      LEVEL_* number (default 9, Bob-omb Battlefield)
+//   --bench-area <num>       area index (default 1)
+//   --bench-input <file>     .m64 played from the first measured tick
+//   --bench-report <file>    report path (default bench_report.json)
+
+// false on a malformed command line, after printing the usage
+bool pc_bench_parse_args(int argc, char *argv[]);
+bool pc_bench_active(void);
+
+// around each produce_one_frame(); the end of the last measured tick writes
+// the report and exits
+void pc_bench_begin_frame(void);
+void pc_bench_end_frame(void);
+
+// true when the run owns the controller: it reads the recorded input once
+// measuring, and nothing before
+bool pc_bench_read_input(OSContPad *pad);
+
+#endif // PC_BENCH_H
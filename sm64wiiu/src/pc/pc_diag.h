@@ -1,10 +1,77 @@
 #ifndef PC_DIAG_H
 #define PC_DIAG_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+// Stage markers go into a fixed ring of 16-byte binary events, cheap enough
+// to leave on in release builds. The ring is written to diag_events.bin by
+// the Wii U watchdog when the game stalls, at exit with diag_dump on, or by
+// pc_diag_dump() on request; tools/diag_decode turns it back into text.
+
+// id, name
+#define PC_DIAG_STAGES(X) \
+    X(BOOT,                              "boot") \
+    X(MAIN_AFTER_WATCHDOG_INIT,          "main:after_watchdog_init") \
+    X(FRAME,                             "frame") \
+    X(FRAME_BEGIN,                       "produce_one_frame:begin") \
+    X(FRAME_BEFORE_GAME_LOOP,            "produce_one_frame:before_game_loop") \
+    X(FRAME_AFTER_GAME_LOOP,             "produce_one_frame:after_game_loop") \
+    X(FRAME_AFTER_SMLUA_UPDATE,          "produce_one_frame:after_smlua_update") \
+    X(FRAME_AFTER_AUDIO_PLAY,            "produce_one_frame:after_audio_play") \
+    X(FRAME_AFTER_GFX_END_FRAME,         "produce_one_frame:after_gfx_end_frame") \
+    X(GFX_RUN_ENTER,                     "gfx_run:enter") \
+    X(GFX_RUN_PRE_START_FRAME,           "gfx_run:pre_start_frame") \
+    X(GFX_RUN_START_FRAME_FALSE,         "gfx_run:start_frame_false") \
+    X(GFX_RUN_POST_START_FRAME,          "gfx_run:post_start_frame") \
+    X(GFX_RUN_POST_RAPI_START_FRAME,     "gfx_run:post_rapi_start_frame") \
+    X(GFX_RUN_POST_RUN_DL,               "gfx_run:post_run_dl") \
+    X(GFX_RUN_POST_FLUSH,                "gfx_run:post_flush") \
+    X(GFX_RUN_POST_END_FRAME,            "gfx_run:post_end_frame") \
+    X(GFX_RUN_POST_SWAP_BUFFERS_BEGIN,   "gfx_run:post_swap_buffers_begin") \
+    X(GFX_END_FRAME_ENTER,               "gfx_end_frame:enter") \
+    X(GFX_END_FRAME_POST_FINISH_RENDER,  "gfx_end_frame:post_finish_render") \
+    X(GFX_END_FRAME_POST_SWAP_BUFFERS_END, "gfx_end_frame:post_swap_buffers_end") \
+    X(DUMP,                              "dump")
+
+#define PC_DIAG_STAGE_ENUM(id, name) PC_DIAG_##id,
+enum PcDiagStage {
+    PC_DIAG_STAGES(PC_DIAG_STAGE_ENUM)
+    PC_DIAG_STAGE_COUNT,
+};
+#undef PC_DIAG_STAGE_ENUM
+
+// events held; a power of two
+#define PC_DIAG_RING_EVENTS 4096
+#define PC_DIAG_TIME_BITS 48
+
+struct PcDiagEvent {
+    uint64_t time;  // clock ticks in the low PC_DIAG_TIME_BITS, stage above
+    uint32_t frame;
+    uint32_t arg;
+};
+
+// diag_events.bin: the header, then each stage name as a length byte and its
+// characters, then the events oldest first, all in the writer's byte order
+#define PC_DIAG_DUMP_MAGIC 0x53444947 // 'SDIG'
+#define PC_DIAG_DUMP_VERSION 1
+
+struct PcDiagDumpHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t stageCount;
+    uint32_t eventCount;
+    uint32_t dropped; // overwritten before the dump
+    uint64_t ticksPerSecond;
+};
+
 void pc_diag_watchdog_init(void);
-void pc_diag_mark_stage(const char *stage);
+void pc_diag_mark(enum PcDiagStage stage, uint32_t arg);
 void pc_diag_mark_frame(uint32_t frame_index);
+const char *pc_diag_stage_name(enum PcDiagStage stage);
+bool pc_diag_dump(void);
+void pc_diag_shutdown(void);
+
+#define pc_diag_mark_stage(stage) pc_diag_mark(stage, 0)
 
 #endif // PC_DIAG_H
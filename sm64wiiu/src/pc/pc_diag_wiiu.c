@@ -1,24 +1,140 @@
+#include <stdio.h>
+#include <string.h>
+
 #include "pc_diag.h"
+#include "configfile.h"
+#include "fs/fs.h"
 
 #ifdef TARGET_WII_U
-
-#include <stdbool.h>
-
 #include <coreinit/thread.h>
 #include <coreinit/time.h>
 #include <whb/log.h>
+#else
+#include <time.h>
+#endif
+
+#define PC_DIAG_STAGE_NAME(id, name) name,
+static const char *sDiagStageNames[PC_DIAG_STAGE_COUNT] = {
+    PC_DIAG_STAGES(PC_DIAG_STAGE_NAME)
+};
+#undef PC_DIAG_STAGE_NAME
+
+static struct PcDiagEvent sDiagEvents[PC_DIAG_RING_EVENTS];
+static uint32_t sDiagEventCount = 0;
+static volatile uint32_t sDiagLastFrame = 0;
+
+static inline uint64_t pc_diag_now(void) {
+#ifdef TARGET_WII_U
+    return (uint64_t)OSGetTime();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static uint64_t pc_diag_ticks_per_second(void) {
+#ifdef TARGET_WII_U
+    return (uint64_t)OSTimerClockSpeed;
+#else
+    return 1000000000ULL;
+#endif
+}
+
+void pc_diag_mark(enum PcDiagStage stage, uint32_t arg) {
+    uint32_t index = __atomic_fetch_add(&sDiagEventCount, 1, __ATOMIC_RELAXED);
+    struct PcDiagEvent *event = &sDiagEvents[index & (PC_DIAG_RING_EVENTS - 1)];
+    event->time = (pc_diag_now() & ((1ULL << PC_DIAG_TIME_BITS) - 1)) | ((uint64_t)stage << PC_DIAG_TIME_BITS);
+    event->frame = sDiagLastFrame;
+    event->arg = arg;
+}
+
+void pc_diag_mark_frame(uint32_t frame_index) {
+    sDiagLastFrame = frame_index;
+    pc_diag_mark(PC_DIAG_FRAME, frame_index);
+}
+
+const char *pc_diag_stage_name(enum PcDiagStage stage) {
+    return ((unsigned)stage < PC_DIAG_STAGE_COUNT) ? sDiagStageNames[stage] : "(unknown)";
+}
+
+// Copies the ring out first so a writer racing the dump can at worst tear
+// the newest event.
+bool pc_diag_dump(void) {
+    static struct PcDiagEvent events[PC_DIAG_RING_EVENTS];
+    uint32_t count = __atomic_load_n(&sDiagEventCount, __ATOMIC_ACQUIRE);
+    uint32_t available = (count < PC_DIAG_RING_EVENTS) ? count : PC_DIAG_RING_EVENTS;
+    for (uint32_t i = 0; i < available; i++) {
+        events[i] = sDiagEvents[(count - available + i) & (PC_DIAG_RING_EVENTS - 1)];
+    }
+
+    // the watchdog thread dumps too, so no fs_get_write_path() and its shared buffer
+    char path[SYS_MAX_PATH];
+    if (snprintf(path, sizeof(path), "%s/diag_events.bin", fs_writepath) >= (int)sizeof(path)) {
+        return false;
+    }
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("diag: failed to open '%s'\n", path);
+        return false;
+    }
+
+    struct PcDiagDumpHeader header = {
+        .magic = PC_DIAG_DUMP_MAGIC,
+        .version = PC_DIAG_DUMP_VERSION,
+        .stageCount = PC_DIAG_STAGE_COUNT,
+        .eventCount = available,
+        .dropped = count - available,
+        .ticksPerSecond = pc_diag_ticks_per_second(),
+    };
+    fwrite(&header, sizeof(header), 1, file);
+    for (uint32_t i = 0; i < PC_DIAG_STAGE_COUNT; i++) {
+        uint8_t len = (uint8_t)strlen(sDiagStageNames[i]);
+        fwrite(&len, 1, 1, file);
+        fwrite(sDiagStageNames[i], 1, len, file);
+    }
+    fwrite(events, sizeof(struct PcDiagEvent), available, file);
+    bool ok = (ferror(file) == 0);
+    fclose(file);
+
+    printf("diag: wrote %u events to '%s'\n", (unsigned)available, path);
+    pc_diag_mark(PC_DIAG_DUMP, available);
+    return ok;
+}
+
+void pc_diag_shutdown(void) {
+    if (configDiagDump) {
+        pc_diag_dump();
+    }
+}
+
+#ifdef TARGET_WII_U
+
+// a stall this long gets the ring dumped, once per stall
+#define PC_DIAG_STALL_DUMP_MS 3000
+// events echoed to the log with a stall dump
+#define PC_DIAG_STALL_LOG_EVENTS 16
 
 static OSThread sDiagWatchdogThread;
 static uint8_t sDiagWatchdogStack[0x4000] __attribute__((aligned(16)));
-static volatile uint32_t sDiagProgressCounter = 0;
-static volatile OSTime sDiagLastProgressTicks = 0;
-static volatile uint32_t sDiagLastFrame = 0;
-static volatile const char *sDiagStage = "boot";
 static bool sDiagWatchdogStarted = false;
 
+static void pc_diag_log_recent(uint32_t count) {
+    uint32_t total = __atomic_load_n(&sDiagEventCount, __ATOMIC_ACQUIRE);
+    if (count > total) { count = total; }
+    for (uint32_t i = total - count; i != total; i++) {
+        struct PcDiagEvent *event = &sDiagEvents[i & (PC_DIAG_RING_EVENTS - 1)];
+        uint32_t stage = (uint32_t)(event->time >> PC_DIAG_TIME_BITS);
+        WHBLogPrintf("diag:   frame=%u %s arg=%u", (unsigned)event->frame,
+                     pc_diag_stage_name((enum PcDiagStage)stage), (unsigned)event->arg);
+    }
+}
+
 static int pc_diag_watchdog_thread_main(int argc, const char **argv) {
-    uint32_t last_counter = sDiagProgressCounter;
+    uint32_t last_counter = __atomic_load_n(&sDiagEventCount, __ATOMIC_ACQUIRE);
+    OSTime last_progress = OSGetTime();
     uint32_t last_logged_second = 0;
+    bool dumped = false;
 
     (void)argc;
     (void)argv;
@@ -26,20 +142,17 @@ static int pc_diag_watchdog_thread_main(int argc, const char **argv) {
     while (1) {
         OSSleepTicks(OSMillisecondsToTicks(250));
 
-        uint32_t current_counter = sDiagProgressCounter;
+        uint32_t current_counter = __atomic_load_n(&sDiagEventCount, __ATOMIC_ACQUIRE);
+        OSTime now = OSGetTime();
         if (current_counter != last_counter) {
             last_counter = current_counter;
+            last_progress = now;
             last_logged_second = 0;
+            dumped = false;
             continue;
         }
 
-        OSTime now = OSGetTime();
-        OSTime last_progress = sDiagLastProgressTicks;
-        uint64_t stalled_ms = 0;
-        if (last_progress > 0 && now > last_progress) {
-            stalled_ms = (uint64_t)OSTicksToMilliseconds((uint64_t)(now - last_progress));
-        }
-
+        uint64_t stalled_ms = (uint64_t)OSTicksToMilliseconds((uint64_t)(now - last_progress));
         if (stalled_ms < 1000) {
             continue;
         }
@@ -50,11 +163,20 @@ static int pc_diag_watchdog_thread_main(int argc, const char **argv) {
         }
         last_logged_second = stalled_second;
 
+        struct PcDiagEvent *last = &sDiagEvents[(current_counter - 1) & (PC_DIAG_RING_EVENTS - 1)];
         WHBLogPrintf("diag: stall %llums stage='%s' frame=%u progress=%u",
                      (unsigned long long)stalled_ms,
-                     sDiagStage != NULL ? sDiagStage : "(null)",
+                     pc_diag_stage_name((enum PcDiagStage)(last->time >> PC_DIAG_TIME_BITS)),
                      (unsigned)sDiagLastFrame,
                      (unsigned)current_counter);
+
+        if (!dumped && stalled_ms >= PC_DIAG_STALL_DUMP_MS) {
+            dumped = true;
+            pc_diag_log_recent(PC_DIAG_STALL_LOG_EVENTS);
+            pc_diag_dump();
+            // the dump's own event isn't progress
+            last_counter = __atomic_load_n(&sDiagEventCount, __ATOMIC_ACQUIRE);
+        }
     }
 
     return 0;
@@ -65,10 +187,7 @@ void pc_diag_watchdog_init(void) {
         return;
     }
 
-    sDiagLastProgressTicks = OSGetTime();
-    sDiagProgressCounter = 1;
-    sDiagLastFrame = 0;
-    sDiagStage = "startup";
+    pc_diag_mark(PC_DIAG_BOOT, 0);
 
     if (OSCreateThread(&sDiagWatchdogThread,
                        pc_diag_watchdog_thread_main,
@@ -87,29 +206,10 @@ void pc_diag_watchdog_init(void) {
     }
 }
 
-void pc_diag_mark_stage(const char *stage) {
-    sDiagStage = (stage != NULL) ? stage : "(null)";
-    sDiagProgressCounter++;
-    sDiagLastProgressTicks = OSGetTime();
-}
-
-void pc_diag_mark_frame(uint32_t frame_index) {
-    sDiagLastFrame = frame_index;
-    sDiagProgressCounter++;
-    sDiagLastProgressTicks = OSGetTime();
-}
-
 #else
 
 void pc_diag_watchdog_init(void) {
-}
-
-void pc_diag_mark_stage(const char *stage) {
-    (void)stage;
-}
-
-void pc_diag_mark_frame(uint32_t frame_index) {
-    (void)frame_index;
+    pc_diag_mark(PC_DIAG_BOOT, 0);
 }
 
 #endif
@@ -27,8 +27,13 @@
 #include "audio/audio_alsa.h"
 #include "audio/audio_sdl.h"
 #include "audio/audio_null.h"
+#include "audio/audio_thread.h"
+#include "audio/mod_sample.h"
+#include "audio/mod_seq.h"
+#include "audio/mod_stream.h"
 
 #include "controller/controller_keyboard.h"
+#include "controller/controller_recorded_tas.h"
 #include "djui/djui.h"
 #include "djui/djui_ctx_display.h"
 #include "djui/djui_fps_display.h"
@@ -39,7 +44,12 @@
 #include "configfile.h"
 #include "platform.h"
 #include "fs/fs.h"
+#include "fs/fs_async.h"
+#include "fs/fs_persist.h"
+#include "frame_pacer.h"
 #include "pc_diag.h"
+#include "pc_bench.h"
+#include "debug_context.h"
 #include "utils/misc.h"
 
 #include "compat.h"
@@ -150,13 +160,8 @@ void exec_display_list(struct SPTask *spTask) {
 
 #define printf
 
-#ifdef VERSION_EU
-#define SAMPLES_HIGH 656
-#define SAMPLES_LOW 640
-#else
-#define SAMPLES_HIGH 544
-#define SAMPLES_LOW 528
-#endif
+#define SAMPLES_HIGH AUDIO_SAMPLES_HIGH
+#define SAMPLES_LOW AUDIO_SAMPLES_LOW
 
 #define FRAMERATE 30
 static const f64 sFrameTime = (1.0 / (f64)FRAMERATE);
@@ -197,9 +202,11 @@ static void compute_fps(f64 now, u32 frames_drawn) {
     sFpsFrameCount += frames_drawn;
     if (now >= sFpsWindowStart + 1.0) {
         f64 elapsed = now - sFpsWindowStart;
+        struct FramePacerStats stats;
+        frame_pacer_roll_window(&stats);
         if (elapsed > 0.0) {
             u32 fps = (u32)(((f64)sFpsFrameCount / elapsed) + 0.5);
-            djui_fps_display_update(fps);
+            djui_fps_display_update(fps, &stats);
         }
         sFpsWindowStart = now;
         sFpsFrameCount = 0;
@@ -208,19 +215,24 @@ static void compute_fps(f64 now, u32 frames_drawn) {
 
 static u32 produce_interpolation_frames_and_delay(void) {
     u32 refresh_rate = get_target_refresh_rate();
-    bool should_delay = (configFramerateMode != RRM_UNLIMITED);
+    // benchmark runs draw each tick once, back to back
+    bool should_delay = (configFramerateMode != RRM_UNLIMITED) && !pc_bench_active();
     f64 frame_target = sFrameTimeStart + sFrameTime;
     s32 frames_to_draw = get_num_frames_to_draw(sFrameTimeStart, refresh_rate);
     u32 drawn = 0;
 
-    if (configInterpolationMode == 0) {
+    if (configInterpolationMode == 0 || pc_bench_active()) {
         frames_to_draw = 1;
     }
-    if (frames_to_draw > 4) {
-        frames_to_draw = 4;
-    }
+    // as many as the measured render cost leaves room for
+    frames_to_draw = frame_pacer_plan_subframes(frames_to_draw, sFrameTime);
 
     for (s32 i = 0; i < frames_to_draw; i++) {
+        // running late: skip ahead to the tick's final frame instead of pushing it past the deadline
+        if (!frame_pacer_should_draw(i, frames_to_draw, frame_target)) {
+            continue;
+        }
+
         f32 delta = 1.0f;
         bool interpolation_active = (configInterpolationMode != 0 && frames_to_draw > 1);
         if (configInterpolationMode != 0 && frames_to_draw > 1) {
@@ -229,19 +241,19 @@ static u32 produce_interpolation_frames_and_delay(void) {
         gRenderingDelta = delta;
         // Match donor pacing semantics: interpolated pass stays "on" for all subframes.
         gRenderingInterpolated = interpolation_active;
+        frame_pacer_begin_render();
+        CTX_BEGIN(CTX_INTERP);
         patch_djui_hud(delta);
         gfx_start_frame();
         patch_mtx_interpolated(delta);
         exec_display_list(gGfxSPTask);
         gfx_end_frame();
+        CTX_END(CTX_INTERP);
+        frame_pacer_end_render();
         drawn++;
 
         if (should_delay) {
-            f64 ideal = sFrameTimeStart + (sFrameTime * (f64)(i + 1) / (f64)frames_to_draw);
-            f64 now = clock_elapsed_f64();
-            if (now < ideal) {
-                precise_delay_f64(ideal - now);
-            }
+            frame_pacer_wait_until(sFrameTimeStart + (sFrameTime * (f64)(i + 1) / (f64)frames_to_draw));
         }
     }
 
@@ -249,14 +261,14 @@ static u32 produce_interpolation_frames_and_delay(void) {
     gRenderingDelta = 1.0f;
 
     if (should_delay) {
-        f64 now = clock_elapsed_f64();
-        if (now < frame_target) {
-            precise_delay_f64(frame_target - now);
-        }
+        frame_pacer_wait_until(frame_target);
     }
 
     f64 now = clock_elapsed_f64();
     if (now > sFrameTimeStart + (2.0 * sFrameTime)) {
+        if (sFrameTimeStart > 0.0) {
+            frame_pacer_note_late_tick();
+        }
         sFrameTimeStart = now;
     } else {
         sFrameTimeStart += sFrameTime;
@@ -266,7 +278,10 @@ static u32 produce_interpolation_frames_and_delay(void) {
 }
 
 void produce_one_frame(void) {
-    pc_diag_mark_stage("produce_one_frame:begin");
+    pc_diag_mark_stage(PC_DIAG_FRAME_BEGIN);
+    pc_bench_begin_frame();
+    debug_context_reset();
+    CTX_BEGIN(CTX_TOTAL);
     if (configWindow.settings_changed) {
         configWindow.settings_changed = false;
         if (wm_api != NULL && wm_api->set_fullscreen != NULL) {
@@ -278,50 +293,27 @@ void produce_one_frame(void) {
     if (sFrameMarkerCount == 0) {
         WHBLogPrint("pc: first frame");
     }
-    sFrameMarkerCount++;
 #endif
+    sFrameMarkerCount++;
     pc_diag_mark_frame(sFrameMarkerCount);
 #ifdef TARGET_WII_U
     if (sFrameTimeStart <= 0.0) {
         sFrameTimeStart = clock_elapsed_f64();
     }
 #endif
-#ifdef TARGET_WII_U
-    if (sFrameMarkerCount == 1) {
-        WHBLogPrint("pc: frame1 pre game_loop_one_iteration");
-    }
-#endif
+    fs_async_update();
     patch_djui_hud_before();
     patch_mtx_before();
-    pc_diag_mark_stage("produce_one_frame:before_game_loop");
+    pc_diag_mark_stage(PC_DIAG_FRAME_BEFORE_GAME_LOOP);
+    CTX_BEGIN(CTX_GAME_LOOP);
     game_loop_one_iteration();
-    pc_diag_mark_stage("produce_one_frame:after_game_loop");
-#ifdef TARGET_WII_U
-    if (sFrameMarkerCount == 1) {
-        WHBLogPrint("pc: frame1 post game_loop_one_iteration");
-    }
-#endif
+    CTX_END(CTX_GAME_LOOP);
+    pc_diag_mark_stage(PC_DIAG_FRAME_AFTER_GAME_LOOP);
     smlua_update();
-    pc_diag_mark_stage("produce_one_frame:after_smlua_update");
-#ifdef TARGET_WII_U
-    if (sFrameMarkerCount == 1) {
-        WHBLogPrint("pc: frame1 post smlua_update");
-    }
-#endif
+    pc_diag_mark_stage(PC_DIAG_FRAME_AFTER_SMLUA_UPDATE);
 
     bool has_focus = true;
     bool should_mute = false;
-    int samples_left = audio_api->buffered();
-    u32 num_audio_samples = samples_left < audio_api->get_desired_buffered() ? SAMPLES_HIGH : SAMPLES_LOW;
-    //printf("Audio samples: %d %u\n", samples_left, num_audio_samples);
-    s16 audio_buffer[SAMPLES_HIGH * 2 * 2];
-    for (int i = 0; i < 2; i++) {
-        /*if (audio_cnt-- == 0) {
-            audio_cnt = 2;
-        }
-        u32 num_audio_samples = audio_cnt < 2 ? 528 : 544;*/
-        create_next_audio_buffer(audio_buffer + i * (num_audio_samples * 2), num_audio_samples);
-    }
     if (wm_api != NULL && wm_api->has_focus != NULL) {
         has_focus = wm_api->has_focus();
     }
@@ -329,34 +321,53 @@ void produce_one_frame(void) {
     gMasterVolume = ((f32)configMasterVolume / 127.0f) * ((f32)gLuaVolumeMaster / 127.0f);
     should_mute = (configMuteFocusLoss && !has_focus) || (gMasterVolume <= 0.0f);
 
-    if (!should_mute) {
-        set_sequence_player_volume(SEQ_PLAYER_LEVEL, ((f32)configMusicVolume / 127.0f) * ((f32)gLuaVolumeLevel / 127.0f));
-        set_sequence_player_volume(SEQ_PLAYER_SFX,   ((f32)configSfxVolume   / 127.0f) * ((f32)gLuaVolumeSfx   / 127.0f));
-        set_sequence_player_volume(SEQ_PLAYER_ENV,   ((f32)configEnvVolume   / 127.0f) * ((f32)gLuaVolumeEnv   / 127.0f));
-
-        // Apply master gain at the final mixed buffer stage.
-        for (u32 i = 0; i < (4 * num_audio_samples); i++) {
-            audio_buffer[i] = (s16)((f32)audio_buffer[i] * gMasterVolume);
+    mod_stream_set_music_volume(((f32)configMusicVolume / 127.0f) * ((f32)gLuaVolumeLevel / 127.0f));
+    mod_sample_set_sfx_volume(((f32)configSfxVolume / 127.0f) * ((f32)gLuaVolumeSfx / 127.0f));
+    if (audio_thread_running()) {
+        if (!should_mute) {
+            audio_thread_set_sequence_volume(SEQ_PLAYER_LEVEL, ((f32)configMusicVolume / 127.0f) * ((f32)gLuaVolumeLevel / 127.0f));
+            audio_thread_set_sequence_volume(SEQ_PLAYER_SFX,   ((f32)configSfxVolume   / 127.0f) * ((f32)gLuaVolumeSfx   / 127.0f));
+            audio_thread_set_sequence_volume(SEQ_PLAYER_ENV,   ((f32)configEnvVolume   / 127.0f) * ((f32)gLuaVolumeEnv   / 127.0f));
+        }
+        audio_thread_set_master_volume(gMasterVolume, should_mute);
+        // the audio thread synthesizes this tick while the next one runs
+        audio_thread_end_frame();
+    } else {
+        CTX_BEGIN(CTX_AUDIO);
+        int samples_left = audio_api->buffered();
+        u32 num_audio_samples = samples_left < audio_api->get_desired_buffered() ? SAMPLES_HIGH : SAMPLES_LOW;
+        s16 audio_buffer[SAMPLES_HIGH * 2 * 2];
+        for (int i = 0; i < 2; i++) {
+            create_next_audio_buffer(audio_buffer + i * (num_audio_samples * 2), num_audio_samples);
         }
 
-        //printf("Audio samples before submitting: %d\n", audio_api->buffered());
-        audio_api->play((u8 *)audio_buffer, 2 * num_audio_samples * 4);
-    }
-    pc_diag_mark_stage("produce_one_frame:after_audio_play");
-#ifdef TARGET_WII_U
-    if (sFrameMarkerCount == 1) {
-        WHBLogPrint("pc: frame1 post audio play");
+        if (!should_mute) {
+            set_sequence_player_volume(SEQ_PLAYER_LEVEL, ((f32)configMusicVolume / 127.0f) * ((f32)gLuaVolumeLevel / 127.0f));
+            set_sequence_player_volume(SEQ_PLAYER_SFX,   ((f32)configSfxVolume   / 127.0f) * ((f32)gLuaVolumeSfx   / 127.0f));
+            set_sequence_player_volume(SEQ_PLAYER_ENV,   ((f32)configEnvVolume   / 127.0f) * ((f32)gLuaVolumeEnv   / 127.0f));
+
+            mod_stream_mix(audio_buffer, 2 * num_audio_samples);
+            mod_sample_mix(audio_buffer, 2 * num_audio_samples);
+
+            // Apply master gain at the final mixed buffer stage.
+            for (u32 i = 0; i < (4 * num_audio_samples); i++) {
+                audio_buffer[i] = (s16)((f32)audio_buffer[i] * gMasterVolume);
+            }
+
+            audio_api->play((u8 *)audio_buffer, 2 * num_audio_samples * 4);
+        }
+        CTX_END(CTX_AUDIO);
     }
-#endif
+    pc_diag_mark_stage(PC_DIAG_FRAME_AFTER_AUDIO_PLAY);
+
+    // hand this frame's saves to the writer thread
+    fs_persist_update();
 
     u32 rendered_frames = produce_interpolation_frames_and_delay();
-    pc_diag_mark_stage("produce_one_frame:after_gfx_end_frame");
-#ifdef TARGET_WII_U
-    if (sFrameMarkerCount == 1) {
-        WHBLogPrint("pc: frame1 post gfx_end_frame");
-    }
-#endif
+    pc_diag_mark(PC_DIAG_FRAME_AFTER_GFX_END_FRAME, rendered_frames);
     compute_fps(clock_elapsed_f64(), rendered_frames);
+    CTX_END(CTX_TOTAL);
+    pc_bench_end_frame();
 }
 
 #ifdef TARGET_WEB
@@ -422,10 +433,19 @@ void main_func(void) {
     wiiu_prepare_sd_storage();
 #endif
     fs_init(sys_user_path());
+    fs_async_init(FS_ASYNC_DEFAULT_WORKERS);
+    fs_persist_init();
     configfile_load();
     gMasterVolume = (f32)configMasterVolume / 127.0f;
+    // exit handlers run in reverse, so the final flush happens after every save
+    atexit(fs_persist_shutdown);
+    atexit(fs_async_shutdown);
     atexit(save_config);
     atexit(shutdown_mod_runtime);
+    atexit(frame_pacer_shutdown);
+    atexit(debug_context_shutdown);
+    atexit(pc_diag_shutdown);
+    debug_context_set_thread_name("main");
 
 #ifdef TARGET_WEB
     emscripten_set_main_loop(em_main_loop, 0, 0);
@@ -462,9 +482,13 @@ void main_func(void) {
     wm_api->set_keyboard_callbacks(keyboard_on_key_down, keyboard_on_key_up, keyboard_on_all_keys_up, NULL, NULL);
 
     pc_diag_watchdog_init();
-    pc_diag_mark_stage("main:after_watchdog_init");
+    pc_diag_mark_stage(PC_DIAG_MAIN_AFTER_WATCHDOG_INIT);
 
 
+    // benchmark runs synthesize inline and throw the output away
+    if (pc_bench_active()) {
+        audio_api = &audio_null;
+    }
 #if HAVE_WASAPI
     if (audio_api == NULL && audio_wasapi.init()) {
         audio_api = &audio_wasapi;
@@ -491,6 +515,16 @@ void main_func(void) {
 
     audio_init();
     sound_init();
+    mod_stream_init();
+    atexit(mod_stream_shutdown);
+    mod_sample_init();
+    atexit(mod_sample_shutdown);
+    mod_seq_init();
+    atexit(mod_seq_shutdown);
+    if (!pc_bench_active() && audio_thread_init(audio_api)) {
+        // registered last so it stops before the mod runtime is torn down
+        atexit(audio_thread_shutdown);
+    }
 
     thread5_game_loop(NULL);
     // Load Lua scripts only after core game/audio systems are initialized.
@@ -537,7 +571,10 @@ int WINAPI WinMain(UNUSED HINSTANCE hInstance, UNUSED HINSTANCE hPrevInstance, U
     return 0;
 }
 #else
-int main(UNUSED int argc, UNUSED char *argv[]) {
+int main(int argc, char *argv[]) {
+    if (!pc_bench_parse_args(argc, argv) || !controller_recorded_tas_parse_args(argc, argv)) {
+        return 1;
+    }
     main_func();
     return 0;
 }
@@ -1,5 +1,204 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "macros.h"
 #include "thread.h"
 
+#if defined(TARGET_WII_U)
+
+#include <malloc.h>
+#include <stdint.h>
+#include <coreinit/time.h>
+
+#define THREAD_DEFAULT_STACK_SIZE 0x10000
+
+static int thread_entry_trampoline(int argc, const char **argv) {
+    struct ThreadHandle *handle = (struct ThreadHandle *)argv;
+    (void)argc;
+    handle->entry(handle->arg);
+    return 0;
+}
+
+int init_thread_handle(struct ThreadHandle *handle, void *(*entry)(void *), void *arg, void *sp, size_t sp_size) {
+    if (handle == NULL || entry == NULL) {
+        return -1;
+    }
+
+    memset(&handle->thread, 0, sizeof(handle->thread));
+    handle->entry = entry;
+    handle->arg = arg;
+    handle->ownedStack = NULL;
+    if (sp == NULL || sp_size == 0) {
+        sp_size = THREAD_DEFAULT_STACK_SIZE;
+        sp = handle->ownedStack = memalign(16, sp_size);
+        if (sp == NULL) {
+            return -1;
+        }
+    }
+
+    if (!OSCreateThread(&handle->thread, thread_entry_trampoline, 0, (char *)handle,
+                        (uint8_t *)sp + sp_size, sp_size, 16, OS_THREAD_ATTRIB_AFFINITY_ANY)) {
+        free(handle->ownedStack);
+        handle->ownedStack = NULL;
+        return -1;
+    }
+    handle->state = RUNNING;
+    OSResumeThread(&handle->thread);
+    return 0;
+}
+
+int join_thread(struct ThreadHandle *handle) {
+    if (handle == NULL || handle->state != RUNNING) {
+        return -1;
+    }
+    int result = 0;
+    OSJoinThread(&handle->thread, &result);
+    handle->state = STOPPED;
+    return 0;
+}
+
+void cleanup_thread_handle(struct ThreadHandle *handle) {
+    if (handle == NULL) {
+        return;
+    }
+    if (handle->state == RUNNING) {
+        join_thread(handle);
+    }
+    free(handle->ownedStack);
+    handle->ownedStack = NULL;
+    handle->state = STOPPED;
+}
+
+int init_mutex(struct ThreadMutex *mutex) {
+    OSInitMutex(&mutex->mutex);
+    return 0;
+}
+
+void destroy_mutex(UNUSED struct ThreadMutex *mutex) {
+}
+
+void lock_mutex(struct ThreadMutex *mutex) {
+    OSLockMutex(&mutex->mutex);
+}
+
+void unlock_mutex(struct ThreadMutex *mutex) {
+    OSUnlockMutex(&mutex->mutex);
+}
+
+int init_cond(struct ThreadCond *cond) {
+    OSInitCond(&cond->cond);
+    return 0;
+}
+
+void destroy_cond(UNUSED struct ThreadCond *cond) {
+}
+
+void wait_cond(struct ThreadCond *cond, struct ThreadMutex *mutex) {
+    OSWaitCond(&cond->cond, &mutex->mutex);
+}
+
+void broadcast_cond(struct ThreadCond *cond) {
+    // OSSignalCond wakes every waiter
+    OSSignalCond(&cond->cond);
+}
+
+void sleep_thread_us(unsigned int usec) {
+    OSSleepTicks(OSMicrosecondsToTicks(usec));
+}
+
+uintptr_t current_thread_id(void) {
+    return (uintptr_t)OSGetCurrentThread();
+}
+
+#elif defined(HAVE_THREADS)
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+int init_thread_handle(struct ThreadHandle *handle, void *(*entry)(void *), void *arg, void *sp, size_t sp_size) {
+    (void)sp;
+    (void)sp_size;
+    if (handle == NULL || entry == NULL) {
+        return -1;
+    }
+    if (pthread_create(&handle->thread, NULL, entry, arg) != 0) {
+        return -1;
+    }
+    handle->state = RUNNING;
+    return 0;
+}
+
+int join_thread(struct ThreadHandle *handle) {
+    if (handle == NULL || handle->state != RUNNING) {
+        return -1;
+    }
+    if (pthread_join(handle->thread, NULL) != 0) {
+        return -1;
+    }
+    handle->state = STOPPED;
+    return 0;
+}
+
+void cleanup_thread_handle(struct ThreadHandle *handle) {
+    if (handle == NULL) {
+        return;
+    }
+    if (handle->state == RUNNING) {
+        join_thread(handle);
+    }
+    handle->state = STOPPED;
+}
+
+int init_mutex(struct ThreadMutex *mutex) {
+    return pthread_mutex_init(&mutex->mutex, NULL);
+}
+
+void destroy_mutex(struct ThreadMutex *mutex) {
+    pthread_mutex_destroy(&mutex->mutex);
+}
+
+void lock_mutex(struct ThreadMutex *mutex) {
+    pthread_mutex_lock(&mutex->mutex);
+}
+
+void unlock_mutex(struct ThreadMutex *mutex) {
+    pthread_mutex_unlock(&mutex->mutex);
+}
+
+int init_cond(struct ThreadCond *cond) {
+    return pthread_cond_init(&cond->cond, NULL);
+}
+
+void destroy_cond(struct ThreadCond *cond) {
+    pthread_cond_destroy(&cond->cond);
+}
+
+void wait_cond(struct ThreadCond *cond, struct ThreadMutex *mutex) {
+    pthread_cond_wait(&cond->cond, &mutex->mutex);
+}
+
+void broadcast_cond(struct ThreadCond *cond) {
+    pthread_cond_broadcast(&cond->cond);
+}
+
+void sleep_thread_us(unsigned int usec) {
+#if defined(_WIN32) || defined(_WIN64)
+    Sleep(usec >= 1000 ? usec / 1000 : 1);
+#else
+    struct timespec ts = { usec / 1000000, (long)(usec % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+uintptr_t current_thread_id(void) {
+    return (uintptr_t)pthread_self();
+}
+
+#else
+
 int init_thread_handle(struct ThreadHandle *handle, void *(*entry)(void *), void *arg, void *sp, size_t sp_size) {
     (void)sp;
     (void)sp_size;
@@ -27,3 +226,16 @@ int join_thread(struct ThreadHandle *handle) {
     handle->state = STOPPED;
     return 0;
 }
+
+int init_mutex(UNUSED struct ThreadMutex *mutex) { return 0; }
+void destroy_mutex(UNUSED struct ThreadMutex *mutex) { }
+void lock_mutex(UNUSED struct ThreadMutex *mutex) { }
+void unlock_mutex(UNUSED struct ThreadMutex *mutex) { }
+int init_cond(UNUSED struct ThreadCond *cond) { return 0; }
+void destroy_cond(UNUSED struct ThreadCond *cond) { }
+void wait_cond(UNUSED struct ThreadCond *cond, UNUSED struct ThreadMutex *mutex) { }
+void broadcast_cond(UNUSED struct ThreadCond *cond) { }
+void sleep_thread_us(UNUSED unsigned int usec) { }
+uintptr_t current_thread_id(void) { return 1; }
+
+#endif
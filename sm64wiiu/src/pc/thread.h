@@ -2,6 +2,21 @@
 #define THREAD_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Threads run for real on Wii U (coreinit) and on pthread platforms. The web
+// build has no threads: init_thread_handle() runs the entry inline and the
+// mutex/condition calls are no-ops.
+#if defined(TARGET_WII_U)
+#include <coreinit/thread.h>
+#include <coreinit/mutex.h>
+#include <coreinit/condition.h>
+#define HAVE_THREADS 1
+#elif !defined(TARGET_WEB)
+#include <pthread.h>
+#define HAVE_THREADS 1
+#endif
 
 enum ThreadState {
     INVALID = 0,
@@ -11,10 +26,56 @@ enum ThreadState {
 
 struct ThreadHandle {
     int state;
+#if defined(TARGET_WII_U)
+    OSThread thread;
+    void *(*entry)(void *);
+    void *arg;
+    void *ownedStack;
+#elif defined(HAVE_THREADS)
+    pthread_t thread;
+#endif
 };
 
+struct ThreadMutex {
+#if defined(TARGET_WII_U)
+    OSMutex mutex;
+#elif defined(HAVE_THREADS)
+    pthread_mutex_t mutex;
+#else
+    int unused;
+#endif
+};
+
+struct ThreadCond {
+#if defined(TARGET_WII_U)
+    OSCondition cond;
+#elif defined(HAVE_THREADS)
+    pthread_cond_t cond;
+#else
+    int unused;
+#endif
+};
+
+// `sp`/`sp_size` optionally provide the thread's stack; only Wii U uses them
 int init_thread_handle(struct ThreadHandle *handle, void *(*entry)(void *), void *arg, void *sp, size_t sp_size);
 void cleanup_thread_handle(struct ThreadHandle *handle);
 int join_thread(struct ThreadHandle *handle);
 
+int init_mutex(struct ThreadMutex *mutex);
+void destroy_mutex(struct ThreadMutex *mutex);
+void lock_mutex(struct ThreadMutex *mutex);
+void unlock_mutex(struct ThreadMutex *mutex);
+
+// wait_cond() may wake spuriously; always re-check the predicate
+int init_cond(struct ThreadCond *cond);
+void destroy_cond(struct ThreadCond *cond);
+void wait_cond(struct ThreadCond *cond, struct ThreadMutex *mutex);
+void broadcast_cond(struct ThreadCond *cond);
+
+// yields the calling thread for roughly `usec` microseconds
+void sleep_thread_us(unsigned int usec);
+
+// nonzero and unique among running threads
+uintptr_t current_thread_id(void);
+
 #endif
@@ -3,6 +3,7 @@
 #include "lib/src/libultra_internal.h"
 #include "macros.h"
 #include "fs/fs.h"
+#include "fs/fs_persist.h"
 #include "controller/controller_api.h"
 #include "configfile.h"
 
@@ -156,7 +157,20 @@ s32 osEepromLongRead(UNUSED OSMesgQueue *mq, u8 address, u8 *buffer, int nbytes)
         ret = 0;
     }
 #else
-    fs_file_t *fp = fs_open("sm64_save_file.bin");
+    // prefer the write path (including saves that haven't been flushed yet),
+    // then whatever the mounted packs provide
+    uint64_t size = 0;
+    u8 *data = fs_persist_read(SAVE_FILENAME, &size);
+    if (data != NULL) {
+        if (size == 512) {
+            memcpy(buffer, data + address * 8, nbytes);
+            ret = 0;
+        }
+        free(data);
+        return ret;
+    }
+
+    fs_file_t *fp = fs_open(SAVE_FILENAME);
     if (fp == NULL) {
         return -1;
     }
@@ -191,12 +205,7 @@ s32 osEepromLongWrite(UNUSED OSMesgQueue *mq, u8 address, u8 *buffer, int nbytes
     }, content);
     s32 ret = 0;
 #else
-    FILE* fp = fopen(fs_get_write_path("sm64_save_file.bin"), "wb");
-    if (fp == NULL) {
-        return -1;
-    }
-    s32 ret = fwrite(content, 1, 512, fp) == 512 ? 0 : -1;
-    fclose(fp);
+    s32 ret = fs_persist_write(SAVE_FILENAME, content, 512) ? 0 : -1;
 #endif
     return ret;
 }
@@ -1,91 +1,198 @@
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "data/dynos_cmap.cpp.h"
 
+// Open addressing with linear probing over a power-of-two slot table. Entries
+// live in a dense array that iteration walks; each slot holds a key and its
+// entry's index + 1 (0 marks an empty slot). Deletion swaps the last entry
+// into the hole and backward-shifts the probe run, so there are no tombstones.
+// Ordered maps (useUnordered == false) iterate in key order like std::map:
+// the entries are sorted when iteration begins after a change.
+
+#define HMAP_MIN_SLOTS 64
+
 struct HMapEntry {
     int64_t key;
     void* value;
 };
 
+struct HMapSlot {
+    int64_t key;
+    uint32_t entry;
+};
+
 struct HMap {
     struct HMapEntry* entries;
     size_t len;
     size_t cap;
+    struct HMapSlot* slots;
+    size_t mask; // slot count - 1, or 0 before the first put
     size_t iter;
+    bool ordered;
+    bool sorted;
 };
 
 static struct HMap* hmap_cast(void* map) {
     return (struct HMap*)map;
 }
 
-static ptrdiff_t hmap_find(const struct HMap* map, int64_t key) {
-    size_t i = 0;
-    for (i = 0; i < map->len; i++) {
-        if (map->entries[i].key == key) {
-            return (ptrdiff_t)i;
+// splitmix64's finalizer; glyph keys are packed UTF-8 bytes, so the low bits
+// alone cluster badly
+static size_t hmap_hash(int64_t key) {
+    uint64_t x = (uint64_t)key;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return (size_t)x;
+}
+
+static struct HMapSlot* hmap_find_slot(const struct HMap* map, int64_t key) {
+    if (map->slots == NULL) {
+        return NULL;
+    }
+    size_t i = hmap_hash(key) & map->mask;
+    while (map->slots[i].entry != 0) {
+        if (map->slots[i].key == key) {
+            return &map->slots[i];
         }
+        i = (i + 1) & map->mask;
+    }
+    return NULL;
+}
+
+static void hmap_insert_slot(struct HMap* map, int64_t key, size_t entry) {
+    size_t i = hmap_hash(key) & map->mask;
+    while (map->slots[i].entry != 0) {
+        i = (i + 1) & map->mask;
+    }
+    map->slots[i].key = key;
+    map->slots[i].entry = (uint32_t)(entry + 1);
+}
+
+static void hmap_reindex(struct HMap* map) {
+    memset(map->slots, 0, (map->mask + 1) * sizeof(struct HMapSlot));
+    for (size_t i = 0; i < map->len; i++) {
+        hmap_insert_slot(map, map->entries[i].key, i);
     }
-    return -1;
+}
+
+// keeps the slot table at most half full
+static bool hmap_reserve(struct HMap* map, size_t len) {
+    if (len > map->cap) {
+        size_t newCap = (map->cap == 0) ? 32 : (map->cap * 2);
+        struct HMapEntry* newEntries = (struct HMapEntry*)realloc(map->entries, newCap * sizeof(struct HMapEntry));
+        if (newEntries == NULL) {
+            return false;
+        }
+        map->entries = newEntries;
+        map->cap = newCap;
+    }
+
+    if (map->slots != NULL && len * 2 <= map->mask + 1) {
+        return true;
+    }
+    size_t slotCount = (map->slots == NULL) ? HMAP_MIN_SLOTS : (map->mask + 1) * 2;
+    while (len * 2 > slotCount) {
+        slotCount *= 2;
+    }
+    struct HMapSlot* newSlots = (struct HMapSlot*)malloc(slotCount * sizeof(struct HMapSlot));
+    if (newSlots == NULL) {
+        return false;
+    }
+    free(map->slots);
+    map->slots = newSlots;
+    map->mask = slotCount - 1;
+    hmap_reindex(map);
+    return true;
+}
+
+static int hmap_compare_entries(const void* a, const void* b) {
+    int64_t ka = ((const struct HMapEntry*)a)->key;
+    int64_t kb = ((const struct HMapEntry*)b)->key;
+    return (ka > kb) - (ka < kb);
 }
 
 void* hmap_create(bool useUnordered) {
     struct HMap* map = (struct HMap*)calloc(1, sizeof(struct HMap));
-    (void)useUnordered;
+    if (map == NULL) {
+        return NULL;
+    }
+    map->ordered = !useUnordered;
+    map->sorted = true;
     return map;
 }
 
 void* hmap_get(void* map, int64_t key) {
     struct HMap* hmap = hmap_cast(map);
-    ptrdiff_t index = 0;
     if (hmap == NULL) {
         return NULL;
     }
-    index = hmap_find(hmap, key);
-    return (index >= 0) ? hmap->entries[index].value : NULL;
+    struct HMapSlot* slot = hmap_find_slot(hmap, key);
+    return (slot != NULL) ? hmap->entries[slot->entry - 1].value : NULL;
 }
 
 void hmap_put(void* map, int64_t key, void* value) {
     struct HMap* hmap = hmap_cast(map);
-    ptrdiff_t index = 0;
     if (hmap == NULL) {
         return;
     }
 
-    index = hmap_find(hmap, key);
-    if (index >= 0) {
-        hmap->entries[index].value = value;
+    struct HMapSlot* slot = hmap_find_slot(hmap, key);
+    if (slot != NULL) {
+        hmap->entries[slot->entry - 1].value = value;
         return;
     }
 
-    if (hmap->len == hmap->cap) {
-        size_t newCap = (hmap->cap == 0) ? 32 : (hmap->cap * 2);
-        struct HMapEntry* newEntries = (struct HMapEntry*)realloc(hmap->entries, newCap * sizeof(struct HMapEntry));
-        if (newEntries == NULL) {
-            return;
-        }
-        hmap->entries = newEntries;
-        hmap->cap = newCap;
+    if (!hmap_reserve(hmap, hmap->len + 1)) {
+        return;
     }
-
     hmap->entries[hmap->len].key = key;
     hmap->entries[hmap->len].value = value;
+    hmap_insert_slot(hmap, key, hmap->len);
     hmap->len++;
+    hmap->sorted = false;
 }
 
 void hmap_del(void* map, int64_t key) {
     struct HMap* hmap = hmap_cast(map);
-    ptrdiff_t index = 0;
     if (hmap == NULL) {
         return;
     }
-    index = hmap_find(hmap, key);
-    if (index < 0) {
+    struct HMapSlot* slot = hmap_find_slot(hmap, key);
+    if (slot == NULL) {
         return;
     }
 
-    hmap->entries[index] = hmap->entries[hmap->len - 1];
+    // move the last entry into the hole and point its slot at the new place
+    size_t entry = slot->entry - 1;
+    size_t last = hmap->len - 1;
+    if (entry != last) {
+        hmap->entries[entry] = hmap->entries[last];
+        hmap_find_slot(hmap, hmap->entries[entry].key)->entry = (uint32_t)(entry + 1);
+        hmap->sorted = false;
+    }
     hmap->len--;
+
+    // backward shift: pull later members of the probe run into the hole
+    // unless that would move them before their home slot
+    size_t hole = (size_t)(slot - hmap->slots);
+    size_t i = hole;
+    while (true) {
+        i = (i + 1) & hmap->mask;
+        if (hmap->slots[i].entry == 0) {
+            break;
+        }
+        size_t home = hmap_hash(hmap->slots[i].key) & hmap->mask;
+        if (((i - home) & hmap->mask) >= ((i - hole) & hmap->mask)) {
+            hmap->slots[hole] = hmap->slots[i];
+            hole = i;
+        }
+    }
+    hmap->slots[hole].entry = 0;
 }
 
 void hmap_clear(void* map) {
@@ -95,6 +202,10 @@ void hmap_clear(void* map) {
     }
     hmap->len = 0;
     hmap->iter = 0;
+    hmap->sorted = true;
+    if (hmap->slots != NULL) {
+        memset(hmap->slots, 0, (hmap->mask + 1) * sizeof(struct HMapSlot));
+    }
 }
 
 void hmap_destroy(void* map) {
@@ -103,6 +214,7 @@ void hmap_destroy(void* map) {
         return;
     }
     free(hmap->entries);
+    free(hmap->slots);
     free(hmap);
 }
 
@@ -119,6 +231,11 @@ void* hmap_begin(void* map) {
     if (hmap == NULL || hmap->len == 0) {
         return NULL;
     }
+    if (hmap->ordered && !hmap->sorted) {
+        qsort(hmap->entries, hmap->len, sizeof(struct HMapEntry), hmap_compare_entries);
+        hmap_reindex(hmap);
+        hmap->sorted = true;
+    }
     hmap->iter = 0;
     return hmap->entries[0].value;
 }
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+# Compares two --bench reports: fails when the runs diverged (different state
+# hash or tick count) or when a timing got slower than the allowed margin.
+#
+# The --bench mode hasn't yet been run end to end (see pc_bench.h); before
+# trusting this as a gate, check that two runs of the same build compare clean.
+#
+# usage: bench_compare.py baseline.json candidate.json [--margin 5]
+
+import argparse
+import json
+import sys
+
+
+def timings(report):
+    out = {"tick mean": report["tick_ms"]["mean"], "tick p99": report["tick_ms"]["p99"]}
+    for name, zone in report["subsystems"].items():
+        out[name] = zone["per_tick_us"] / 1000.0
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--margin", type=float, default=5.0, help="allowed slowdown in percent")
+    # sub-10us zones are mostly noise
+    parser.add_argument("--floor", type=float, default=0.01, help="ignore timings under this many ms")
+    args = parser.parse_args()
+
+    with open(args.baseline) as f:
+        base = json.load(f)
+    with open(args.candidate) as f:
+        cand = json.load(f)
+
+    ok = True
+    for key in ("level", "area", "ticks", "input", "state_hash"):
+        if base[key] != cand[key]:
+            print(f"{key}: {base[key]} -> {cand[key]}  DIVERGED")
+            ok = False
+
+    baseTimes = timings(base)
+    candTimes = timings(cand)
+    print(f"{'':16} {'base ms':>10} {'new ms':>10} {'change':>8}")
+    for name, before in baseTimes.items():
+        after = candTimes.get(name, 0.0)
+        change = ((after - before) / before * 100.0) if before > 0.0 else 0.0
+        slower = change > args.margin and max(before, after) >= args.floor
+        print(f"{name:16} {before:10.3f} {after:10.3f} {change:+7.1f}%{'  SLOWER' if slower else ''}")
+        ok = ok and not slower
+
+    for key, before in base["memory"].items():
+        print(f"{key:16} {before:>10} {cand['memory'].get(key, 0):>10}")
+
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
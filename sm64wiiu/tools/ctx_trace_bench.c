@@ -0,0 +1,150 @@
+// ctx_trace_bench: runs nested debug_context zones on the main thread and a
+// second one, enough to wrap the trace ring, exports the Chrome trace and
+// checks every thread's begins and ends pair up in order. Then times a
+// begin/end pair with the profiler off, with only the per-frame totals, and
+// with tracing.
+//
+// usage: ctx_trace_bench [-n zones]
+//   -n  zone pairs timed each way (default 2000000)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "../src/pc/debug_context.c"
+#include "../src/pc/thread.c"
+
+// what the rest of the game would provide
+bool configCtxProfiler = false;
+bool configCtxTrace = false;
+
+const char *fs_get_write_path(const char *vpath) {
+    return vpath;
+}
+
+f64 clock_elapsed_f64(void) {
+    return bench_now();
+}
+
+static volatile u32 sWork;
+
+static void work(void) {
+    sWork++;
+}
+
+static void run_frame(void) {
+    CTX_BEGIN(CTX_TOTAL);
+    CTX_BEGIN(CTX_GAME_LOOP);
+    CTX_BEGIN(CTX_LEVEL_SCRIPT);
+    for (int i = 0; i < 3; i++) {
+        CTX_EXTENT(CTX_OBJECTS, work);
+    }
+    CTX_END(CTX_LEVEL_SCRIPT);
+    CTX_END(CTX_GAME_LOOP);
+    CTX_BEGIN(CTX_RENDER);
+    // re-entered: only the outer span counts toward the total
+    CTX_EXTENT(CTX_RENDER, work);
+    CTX_END(CTX_RENDER);
+    CTX_END(CTX_TOTAL);
+}
+
+static void *audio_main(void *arg) {
+    debug_context_set_thread_name("audio");
+    for (int i = 0; i < 30000; i++) {
+        CTX_EXTENT(CTX_AUDIO, work);
+    }
+    return arg;
+}
+
+// walks the exported file: per tid, each "E" must close the innermost "B"
+static bool check_trace(const char *path, u32 *events) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) { return false; }
+    char stacks[DEBUG_CONTEXT_MAX_THREADS][DEBUG_CONTEXT_MAX_DEPTH][16];
+    u32 depth[DEBUG_CONTEXT_MAX_THREADS] = { 0 };
+    char line[256];
+    bool ok = true;
+    *events = 0;
+    while (ok && fgets(line, sizeof(line), file) != NULL) {
+        char name[16];
+        char phase;
+        double ts;
+        unsigned tid;
+        if (sscanf(line, ",{\"name\":\"%15[^\"]\",\"ph\":\"%c\",\"ts\":%lf,\"pid\":1,\"tid\":%u}", name, &phase, &ts, &tid) != 4
+            && sscanf(line, "{\"name\":\"%15[^\"]\",\"ph\":\"%c\",\"ts\":%lf,\"pid\":1,\"tid\":%u}", name, &phase, &ts, &tid) != 4) {
+            continue;
+        }
+        if (tid >= DEBUG_CONTEXT_MAX_THREADS) { ok = false; break; }
+        if (phase == 'B') {
+            if (depth[tid] == DEBUG_CONTEXT_MAX_DEPTH) { ok = false; break; }
+            strcpy(stacks[tid][depth[tid]++], name);
+        } else if (phase == 'E') {
+            ok = depth[tid] > 0 && !strcmp(stacks[tid][--depth[tid]], name);
+        }
+        (*events)++;
+    }
+    fclose(file);
+    for (u32 i = 0; i < DEBUG_CONTEXT_MAX_THREADS; i++) {
+        ok = ok && depth[i] == 0;
+    }
+    return ok;
+}
+
+static double time_zones(u32 count) {
+    double start = clock_elapsed_f64();
+    for (u32 i = 0; i < count; i++) {
+        CTX_BEGIN(CTX_HOOK);
+        CTX_END(CTX_HOOK);
+    }
+    return (clock_elapsed_f64() - start) / count;
+}
+
+int main(int argc, char **argv) {
+    u32 count = 2000000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            count = (u32)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-n zones]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    debug_context_set_thread_name("main");
+    configCtxTrace = true;
+    struct ThreadHandle audio;
+    init_thread_handle(&audio, audio_main, NULL, NULL, 0);
+    for (int frame = 0; frame < 10000; frame++) {
+        debug_context_reset();
+        // leave a zone open across the export too
+        if (frame == 9999) { CTX_BEGIN(CTX_SMLUA); }
+        run_frame();
+    }
+    join_thread(&audio);
+
+    bool ok = debug_context_get_time(CTX_TOTAL) >= debug_context_get_time(CTX_RENDER)
+           && debug_context_get_time(CTX_RENDER) > 0.0
+           && debug_context_within(CTX_SMLUA) && !debug_context_within(CTX_TOTAL);
+    u32 events = 0;
+    ok = ok && debug_context_write_trace() && check_trace("ctx_trace.json", &events) && events > DEBUG_CONTEXT_TRACE_EVENTS;
+    printf("ctx_trace_bench: %u balanced trace events across two threads: %s\n", events, ok ? "ok" : "FAILED");
+    remove("ctx_trace.json");
+    if (!ok) {
+        return 1;
+    }
+
+    configCtxTrace = false;
+    configCtxProfiler = false;
+    double offTime = time_zones(count);
+    configCtxProfiler = true;
+    double totalsTime = time_zones(count);
+    configCtxTrace = true;
+    double traceTime = time_zones(count);
+    printf("ctx_trace_bench: zone off     %6.1fns\n", offTime * 1e9);
+    printf("ctx_trace_bench: zone totals  %6.1fns\n", totalsTime * 1e9);
+    printf("ctx_trace_bench: zone traced  %6.1fns\n", traceTime * 1e9);
+    configCtxTrace = false;
+    debug_context_shutdown();
+    return 0;
+}
@@ -0,0 +1,180 @@
+// diag_decode: prints a diag_events.bin written by pc_diag_dump(), from a
+// big-endian Wii U or a little-endian PC alike, one event per line with the
+// time since the previous one. -s adds a per-stage summary with the longest
+// gap that ended at each stage, which is where a stall points.
+//
+// -b marks events through pc_diag_wiiu.c, reports the cost per event, then
+// dumps and decodes the ring and checks it comes back as written.
+//
+// usage: diag_decode [-s] diag_events.bin
+//        diag_decode -b [events]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "../src/pc/pc_diag_wiiu.c"
+
+// what the rest of the game would provide
+bool configDiagDump = false;
+
+char fs_writepath[SYS_MAX_PATH] = ".";
+
+struct DecodedLog {
+    struct PcDiagDumpHeader header;
+    char names[256][256];
+    struct PcDiagEvent *events;
+};
+
+static uint16_t swap16(uint16_t v) { return (uint16_t)((v >> 8) | (v << 8)); }
+static uint32_t swap32(uint32_t v) { return ((uint32_t)swap16((uint16_t)v) << 16) | swap16((uint16_t)(v >> 16)); }
+static uint64_t swap64(uint64_t v) { return ((uint64_t)swap32((uint32_t)v) << 32) | swap32((uint32_t)(v >> 32)); }
+
+static bool read_log(const char *path, struct DecodedLog *log) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "diag_decode: can't open '%s'\n", path);
+        return false;
+    }
+    bool ok = fread(&log->header, sizeof(log->header), 1, file) == 1;
+    bool swapped = ok && log->header.magic == swap32(PC_DIAG_DUMP_MAGIC);
+    if (swapped) {
+        log->header.version = swap16(log->header.version);
+        log->header.stageCount = swap16(log->header.stageCount);
+        log->header.eventCount = swap32(log->header.eventCount);
+        log->header.dropped = swap32(log->header.dropped);
+        log->header.ticksPerSecond = swap64(log->header.ticksPerSecond);
+    } else if (ok && log->header.magic != PC_DIAG_DUMP_MAGIC) {
+        ok = false;
+    }
+    ok = ok && log->header.version == PC_DIAG_DUMP_VERSION && log->header.stageCount <= 256 && log->header.ticksPerSecond > 0;
+
+    for (uint32_t i = 0; ok && i < log->header.stageCount; i++) {
+        uint8_t len;
+        ok = fread(&len, 1, 1, file) == 1 && fread(log->names[i], 1, len, file) == len;
+        log->names[i][ok ? len : 0] = '\0';
+    }
+
+    log->events = ok ? malloc((log->header.eventCount + 1) * sizeof(struct PcDiagEvent)) : NULL;
+    ok = ok && log->events != NULL
+      && fread(log->events, sizeof(struct PcDiagEvent), log->header.eventCount, file) == log->header.eventCount;
+    for (uint32_t i = 0; ok && swapped && i < log->header.eventCount; i++) {
+        log->events[i].time = swap64(log->events[i].time);
+        log->events[i].frame = swap32(log->events[i].frame);
+        log->events[i].arg = swap32(log->events[i].arg);
+    }
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "diag_decode: '%s' isn't a version %d diag dump\n", path, PC_DIAG_DUMP_VERSION);
+    }
+    return ok;
+}
+
+static uint32_t event_stage(const struct PcDiagEvent *event) {
+    return (uint32_t)(event->time >> PC_DIAG_TIME_BITS);
+}
+
+// ticks since `from`, across the clock field wrapping
+static uint64_t event_ticks(const struct PcDiagEvent *from, const struct PcDiagEvent *to) {
+    uint64_t mask = (1ULL << PC_DIAG_TIME_BITS) - 1;
+    return ((to->time & mask) - (from->time & mask)) & mask;
+}
+
+static void print_log(const struct DecodedLog *log, bool summary) {
+    const struct PcDiagDumpHeader *header = &log->header;
+    double toMs = 1000.0 / (double)header->ticksPerSecond;
+    printf("%u events (%u older ones overwritten), %llu ticks/s\n", header->eventCount, header->dropped,
+           (unsigned long long)header->ticksPerSecond);
+    printf("%12s %10s %8s  %-40s %s\n", "time_ms", "delta_us", "frame", "stage", "arg");
+
+    uint32_t counts[256] = { 0 };
+    double maxGap[256] = { 0 };
+    uint64_t elapsed = 0;
+    for (uint32_t i = 0; i < header->eventCount; i++) {
+        const struct PcDiagEvent *event = &log->events[i];
+        uint32_t stage = event_stage(event);
+        uint64_t delta = (i > 0) ? event_ticks(&log->events[i - 1], event) : 0;
+        elapsed += delta;
+        const char *name = (stage < header->stageCount) ? log->names[stage] : "(unknown)";
+        printf("%12.3f %10.3f %8u  %-40s %u\n", elapsed * toMs, delta * toMs * 1000.0, event->frame, name, event->arg);
+        if (stage < 256) {
+            counts[stage]++;
+            if (delta * toMs > maxGap[stage]) { maxGap[stage] = delta * toMs; }
+        }
+    }
+
+    if (!summary) { return; }
+    printf("\n%-40s %8s %12s\n", "stage", "count", "max_gap_ms");
+    for (uint32_t i = 0; i < header->stageCount; i++) {
+        if (counts[i] > 0) {
+            printf("%-40s %8u %12.3f\n", log->names[i], counts[i], maxGap[i]);
+        }
+    }
+}
+
+static int run_bench(uint32_t count) {
+    // one frame's worth of markers, the way produce_one_frame and gfx_run place them
+    double start = bench_now();
+    uint32_t frame = 0;
+    for (uint32_t i = 0; i < count; i += 16) {
+        pc_diag_mark_frame(++frame);
+        for (uint32_t stage = PC_DIAG_FRAME_BEGIN; stage < PC_DIAG_FRAME_BEGIN + 15; stage++) {
+            pc_diag_mark((enum PcDiagStage)stage, i);
+        }
+    }
+    double perEvent = (bench_now() - start) / (double)(frame * 16);
+    printf("diag_decode: %.1fns per event over %u events\n", perEvent * 1e9, frame * 16);
+
+    if (!pc_diag_dump()) {
+        return 1;
+    }
+    struct DecodedLog *log = calloc(1, sizeof(struct DecodedLog));
+    bool ok = read_log("diag_events.bin", log) && log->header.eventCount == PC_DIAG_RING_EVENTS
+           && log->header.dropped == frame * 16 - PC_DIAG_RING_EVENTS && log->header.stageCount == PC_DIAG_STAGE_COUNT;
+    for (uint32_t i = 0; ok && i < PC_DIAG_STAGE_COUNT; i++) {
+        ok = !strcmp(log->names[i], pc_diag_stage_name((enum PcDiagStage)i));
+    }
+    // the newest event is the last of the final frame, and frames climb
+    const struct PcDiagEvent *last = ok ? &log->events[log->header.eventCount - 1] : NULL;
+    ok = ok && event_stage(last) == PC_DIAG_FRAME_BEGIN + 14 && last->frame == frame;
+    for (uint32_t i = 1; ok && i < log->header.eventCount; i++) {
+        ok = log->events[i].frame >= log->events[i - 1].frame && event_stage(&log->events[i]) < PC_DIAG_STAGE_COUNT;
+    }
+    printf("diag_decode: dump round trip: %s\n", ok ? "ok" : "FAILED");
+    remove("diag_events.bin");
+    free(log->events);
+    free(log);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && !strcmp(argv[1], "-b")) {
+        return run_bench((argc >= 3) ? (uint32_t)atoi(argv[2]) : 10000000);
+    }
+
+    bool summary = false;
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-s")) {
+            summary = true;
+        } else if (path == NULL) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "usage: %s [-s] diag_events.bin\n       %s -b [events]\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    static struct DecodedLog log;
+    if (!read_log(path, &log)) {
+        return 1;
+    }
+    print_log(&log, summary);
+    free(log.events);
+    return 0;
+}
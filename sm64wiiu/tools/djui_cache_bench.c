@@ -0,0 +1,330 @@
+// djui_cache_bench: builds a DJUI menu of three panels (flow layouts of
+// bordered rects) and renders it frame after frame with djui_cache.c off and
+// on. Checks that every cached frame draws exactly what the live one does,
+// following gSPDisplayList/gSPBranchList and comparing matrices by value,
+// through a replay, a color change (drawn live, then re-recorded), a panel
+// sliding in (never recorded while it moves) and a destroyed element. Then
+// reports the main display list commands, the bytes taken from the frame's
+// pool and the CPU time per frame for each.
+//
+// usage: djui_cache_bench [-n frames]
+//   -n  frames timed each way (default 2000)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "../src/pc/djui/djui_gfx.c"
+#include "../src/pc/djui/djui_cache.c"
+#include "../src/pc/djui/djui_base.c"
+#include "../src/pc/djui/djui_rect.c"
+#include "../src/pc/djui/djui_flow_layout.c"
+#include "../src/pc/gfx/gfx_pc.h"
+
+#define PANELS 3
+#define ROWS 24
+#define MAIN_CHUNK 1000
+
+// what the rest of the game would provide
+struct GfxDimensions gfx_current_dimensions;
+u32 gGlobalTimer;
+Gfx *gDisplayListHeadInChunk;
+Gfx *gDisplayListEndInChunk;
+struct AllocOnlyPool *gGfxAllocOnlyPool;
+unsigned int configDjuiScale;
+bool configDjuiBatchText = true;
+bool configDjuiCache = true;
+bool configDjuiThemeGradients = true;
+struct DjuiBase *gDjuiHovered;
+struct DjuiBase *gDjuiCursorDownOn;
+struct DjuiBase *gInteractableFocus;
+struct DjuiBase *gInteractableBinding;
+struct DjuiBase *gInteractableMouseDown;
+
+void gfx_get_dimensions(u32 *width, u32 *height) {
+    *width = 1280;
+    *height = 720;
+}
+
+// memory.c's USE_SYSTEM_MALLOC pool, minus the block reuse
+struct AllocOnlyPoolBlock {
+    struct AllocOnlyPoolBlock *prev;
+};
+
+struct AllocOnlyPool {
+    struct AllocOnlyPoolBlock *last;
+    size_t used;
+};
+
+static struct AllocOnlyPool sMainPool;
+
+struct AllocOnlyPool *alloc_only_pool_create(void) {
+    return calloc(1, sizeof(struct AllocOnlyPool));
+}
+
+void alloc_only_pool_clear(struct AllocOnlyPool *pool) {
+    while (pool->last != NULL) {
+        struct AllocOnlyPoolBlock *prev = pool->last->prev;
+        free(pool->last);
+        pool->last = prev;
+    }
+    pool->used = 0;
+}
+
+void alloc_only_pool_destroy(struct AllocOnlyPool *pool) {
+    alloc_only_pool_clear(pool);
+    free(pool);
+}
+
+void *alloc_only_pool_alloc(struct AllocOnlyPool *pool, s32 size) {
+    struct AllocOnlyPoolBlock *block = malloc(sizeof(struct AllocOnlyPoolBlock) + 16 + size);
+    block->prev = pool->last;
+    pool->last = block;
+    pool->used += size;
+    return (u8 *) block + 16;
+}
+
+void *alloc_display_list(u32 size) {
+    return alloc_only_pool_alloc(gGfxAllocOnlyPool, size);
+}
+
+Gfx **alloc_next_dl(void) {
+    Gfx *new_chunk = alloc_only_pool_alloc(gGfxAllocOnlyPool, MAIN_CHUNK * sizeof(Gfx));
+    gSPBranchList(gDisplayListHeadInChunk++, new_chunk);
+    gDisplayListHeadInChunk = new_chunk;
+    gDisplayListEndInChunk = new_chunk + MAIN_CHUNK;
+    return &gDisplayListHeadInChunk;
+}
+
+static void create_dl_matrix(s8 pushOp, f32 x, f32 y, f32 z, bool scale) {
+    Mtx *matrix = (Mtx *) alloc_display_list(sizeof(Mtx));
+    memset(matrix, 0, sizeof(*matrix));
+    matrix->m[0][0] = scale ? x : 1.0f;
+    matrix->m[1][1] = scale ? y : 1.0f;
+    matrix->m[2][2] = scale ? z : 1.0f;
+    matrix->m[3][3] = 1.0f;
+    if (!scale) {
+        matrix->m[3][0] = x;
+        matrix->m[3][1] = y;
+        matrix->m[3][2] = z;
+    }
+    gSPMatrix(gDisplayListHead++, matrix, G_MTX_MODELVIEW | G_MTX_MUL | (pushOp == DJUI_MTX_PUSH ? G_MTX_PUSH : G_MTX_NOPUSH));
+}
+
+void create_dl_translation_matrix(s8 pushOp, f32 x, f32 y, f32 z) {
+    create_dl_matrix(pushOp, x, y, z, false);
+}
+
+void create_dl_scale_matrix(s8 pushOp, f32 x, f32 y, f32 z) {
+    create_dl_matrix(pushOp, x, y, z, true);
+}
+
+  ////////////
+ // frames //
+////////////
+
+static Gfx *sFrameStart;
+static u32 sFrameCommands;
+
+static void begin_frame(void) {
+    gGlobalTimer++;
+    gGfxAllocOnlyPool = &sMainPool;
+    alloc_only_pool_clear(&sMainPool);
+    sFrameStart = alloc_only_pool_alloc(&sMainPool, MAIN_CHUNK * sizeof(Gfx));
+    gDisplayListHeadInChunk = sFrameStart;
+    gDisplayListEndInChunk = sFrameStart + MAIN_CHUNK;
+}
+
+// djui_donor_render's part in it
+static void render_frame(struct DjuiBase *root) {
+    begin_frame();
+    djui_cache_update();
+    djui_cache_prepare(root);
+    djui_base_render(root);
+    gSPEndDisplayList(gDisplayListHead++);
+}
+
+// follows the frame's display list and hashes what gfx_pc would execute,
+// with matrices by value, and counts the main list's own commands
+static void hash_list(const Gfx *cmd, u64 *hash, bool main) {
+    while (true) {
+        u32 op = (u32) (cmd->words.w0 >> 24) & 0xFF;
+        if (main) { sFrameCommands++; }
+        if (op == (u8) G_ENDDL) {
+            return;
+        } else if (op == (u8) G_DL) {
+            const Gfx *target = (const Gfx *) cmd->words.w1;
+            if (((cmd->words.w0 >> 16) & 0xFF) == G_DL_NOPUSH) {
+                // a branch: the main list's chunks continue the main list
+                cmd = target;
+                continue;
+            }
+            hash_list(target, hash, false);
+        } else if (op == (u8) G_MTX) {
+            const Mtx *matrix = (const Mtx *) cmd->words.w1;
+            djui_cache_hash_u64(hash, cmd->words.w0);
+            for (u32 i = 0; i < 16; i++) {
+                djui_cache_hash_f32(hash, matrix->m[i / 4][i % 4]);
+            }
+        } else {
+            djui_cache_hash_u64(hash, cmd->words.w0);
+            djui_cache_hash_u64(hash, cmd->words.w1);
+        }
+        cmd++;
+    }
+}
+
+static u64 frame_hash(void) {
+    u64 hash = 0;
+    sFrameCommands = 0;
+    hash_list(sFrameStart, &hash, true);
+    return hash;
+}
+
+static u64 render_live(struct DjuiBase *root) {
+    configDjuiCache = false;
+    render_frame(root);
+    configDjuiCache = true;
+    return frame_hash();
+}
+
+static u64 render_cached(struct DjuiBase *root) {
+    render_frame(root);
+    return frame_hash();
+}
+
+  //////////
+ // menu //
+//////////
+
+struct Menu {
+    struct DjuiRect *root;
+    struct DjuiFlowLayout *panels[PANELS];
+    struct DjuiRect *rows[PANELS][ROWS];
+};
+
+static void build_menu(struct Menu *menu) {
+    // the root stays live like djui_root's, with a rect's looks
+    menu->root = djui_rect_create(NULL);
+    menu->root->base.cache_hash = NULL;
+    djui_base_set_size(&menu->root->base, 1280, 720);
+    djui_base_set_color(&menu->root->base, 0, 0, 0, 0);
+
+    for (u32 p = 0; p < PANELS; p++) {
+        struct DjuiFlowLayout *panel = djui_flow_layout_create(&menu->root->base);
+        djui_base_set_location(&panel->base, 40 + p * 300, 40);
+        djui_base_set_size(&panel->base, 280, 640);
+        djui_base_set_color(&panel->base, 0, 0, 0, 200);
+        djui_base_set_border_width(&panel->base, 4);
+        djui_base_set_border_color(&panel->base, 255, 255, 255, 255);
+        djui_base_set_padding(&panel->base, 8, 8, 8, 8);
+        djui_flow_layout_set_margin(panel, 2);
+        menu->panels[p] = panel;
+        for (u32 r = 0; r < ROWS; r++) {
+            struct DjuiRect *row = djui_rect_create(&panel->base);
+            djui_base_set_size_type(&row->base, DJUI_SVT_RELATIVE, DJUI_SVT_ABSOLUTE);
+            djui_base_set_size(&row->base, 1.0f, 22);
+            djui_base_set_color(&row->base, 40 + r * 8, 80, 160, 255);
+            djui_base_set_border_width(&row->base, 2);
+            djui_base_set_border_color(&row->base, 0, 0, 0, 255);
+            menu->rows[p][r] = row;
+        }
+    }
+}
+
+// renders a frame both ways, checks they match and that the cache replayed
+// and recorded as many subtrees as expected
+static bool check_frame(struct DjuiBase *root, const char *what, u32 replayed, u32 recorded) {
+    u64 live = render_live(root);
+    u64 cached = render_cached(root);
+
+    // the stats come in at the next frame's boundary
+    struct DjuiCacheStats stats;
+    gGlobalTimer++;
+    djui_cache_update();
+    djui_cache_get_stats(&stats);
+
+    if (live != cached || stats.replayed != replayed || stats.recorded != recorded) {
+        printf("djui_cache_bench: %s: %s, replayed %u (expected %u), recorded %u (expected %u), live %u\n", what,
+               live == cached ? "same triangles" : "MISMATCH", stats.replayed, replayed, stats.recorded, recorded, stats.live);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    u32 frames = 2000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            frames = (u32) atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-n frames]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    struct Menu menu;
+    build_menu(&menu);
+    struct DjuiBase *root = &menu.root->base;
+
+    // first sight draws live, the second records, then replays
+    bool ok = check_frame(root, "first frame", 0, 0)
+           && check_frame(root, "recording", 0, PANELS)
+           && check_frame(root, "replay", PANELS, 0);
+
+    // a hovered row changes color: its panel draws live, records, replays
+    djui_base_set_color(&menu.rows[1][5]->base, 255, 255, 0, 255);
+    ok = ok && check_frame(root, "color change", PANELS - 1, 0)
+            && check_frame(root, "color change recording", PANELS - 1, 1)
+            && check_frame(root, "color change replay", PANELS, 0);
+
+    // a panel sliding in moves every frame and is never recorded mid-way
+    for (u32 i = 0; ok && i < 16; i++) {
+        djui_base_set_location(&menu.panels[2]->base, 644 + i * 4, 40);
+        ok = check_frame(root, "sliding panel", PANELS - 1, 0);
+    }
+    ok = ok && check_frame(root, "slid panel recording", PANELS - 1, 1)
+            && check_frame(root, "slid panel replay", PANELS, 0);
+
+    // a destroyed row leaves its panel to record again
+    djui_base_destroy(&menu.rows[0][3]->base);
+    ok = ok && check_frame(root, "destroyed row", PANELS - 1, 0)
+            && check_frame(root, "destroyed row recording", PANELS - 1, 1)
+            && check_frame(root, "destroyed row replay", PANELS, 0);
+
+    printf("djui_cache_bench: cached frames against live ones: %s\n", ok ? "identical" : "FAILED");
+    if (!ok) {
+        return 1;
+    }
+
+    // steady state
+    render_live(root);
+    u32 liveCommands = sFrameCommands;
+    size_t liveBytes = sMainPool.used;
+    render_cached(root);
+    u32 cachedCommands = sFrameCommands;
+    size_t cachedBytes = sMainPool.used;
+
+    configDjuiCache = false;
+    double start = bench_now();
+    for (u32 i = 0; i < frames; i++) {
+        render_frame(root);
+    }
+    double liveTime = (bench_now() - start) / frames;
+    configDjuiCache = true;
+
+    start = bench_now();
+    for (u32 i = 0; i < frames; i++) {
+        render_frame(root);
+    }
+    double cachedTime = (bench_now() - start) / frames;
+
+    struct DjuiCacheStats stats;
+    djui_cache_get_stats(&stats);
+    printf("djui_cache_bench: %u panels of %u rows, %u cache entries\n", PANELS, ROWS, stats.entries);
+    printf("djui_cache_bench: live  : %5u commands %7zu bytes %8.2fus per frame\n", liveCommands, liveBytes, liveTime * 1e6);
+    printf("djui_cache_bench: cached: %5u commands %7zu bytes %8.2fus per frame (%.2fx faster)\n",
+           cachedCommands, cachedBytes, cachedTime * 1e6, liveTime / cachedTime);
+    return 0;
+}
@@ -0,0 +1,196 @@
+// frame_pacer_bench: checks frame_pacer.c's histogram percentiles against
+// sorted samples, then runs pc_main's subframe loop on a simulated clock with
+// a render cost that spikes now and then, once the way it was before the
+// pacer (always draw every subframe) and once through the pacer, counting
+// ticks whose final frame missed its deadline. Last, times real waits of a
+// few milliseconds with the sleep/spin wait and with a pure spin.
+//
+// usage: frame_pacer_bench [-n ticks] [-w waits]
+//   -n  simulated ticks (default 20000)
+//   -w  real waits timed each way (default 200)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench_util.h"
+#include "../src/pc/frame_pacer.c"
+
+// what the rest of the game would provide
+ConfigWindow configWindow;
+bool configFramePacerCsv = false;
+
+const char *fs_get_write_path(const char *vpath) {
+    return vpath;
+}
+
+// the simulated clock moves a microsecond per read so spins end
+static bool sSimulated = false;
+static f64 sSimNow = 0.0;
+
+f64 clock_elapsed_f64(void) {
+    if (sSimulated) {
+        sSimNow += 0.000001;
+        return sSimNow;
+    }
+    return bench_now();
+}
+
+void sleep_thread_us(unsigned int usec) {
+    if (sSimulated) {
+        // a coarse scheduler: wakes up to a millisecond late
+        sSimNow += usec / 1e6 + (rand() % 1000) / 1e6;
+        return;
+    }
+    struct timespec ts = { usec / 1000000, (long)(usec % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+static int compare_f64(const void *a, const void *b) {
+    f64 x = *(const f64 *)a;
+    f64 y = *(const f64 *)b;
+    return (x > y) - (x < y);
+}
+
+static bool check_percentiles(void) {
+    enum { SAMPLES = 10000 };
+    static f64 samples[SAMPLES];
+    struct FramePacerHistogram histogram = { 0 };
+    for (u32 i = 0; i < SAMPLES; i++) {
+        // mostly around 16.7ms with a slow tail, some past the last bucket
+        f64 ms = 15.0 + (rand() % 3000) / 1000.0;
+        if (i % 50 == 0) { ms += (rand() % 40000) / 1000.0; }
+        samples[i] = ms / 1000.0;
+        frame_pacer_histogram_add(&histogram, samples[i]);
+    }
+    qsort(samples, SAMPLES, sizeof(f64), compare_f64);
+
+    static const f64 fractions[] = { 0.5, 0.95, 0.99, 1.0 };
+    for (u32 i = 0; i < sizeof(fractions) / sizeof(fractions[0]); i++) {
+        f64 exact = samples[(u32)(fractions[i] * SAMPLES + 0.5) - 1];
+        f64 got = frame_pacer_histogram_percentile(&histogram, fractions[i]);
+        // at or above the exact value, within a bucket (or exact past the last one)
+        if (got < exact || got > exact + FRAME_PACER_BUCKET_MS / 1000.0) {
+            printf("frame_pacer_bench: p%g is %.3fms, expected %.3fms\n", fractions[i] * 100.0, got * 1000.0, exact * 1000.0);
+            return false;
+        }
+    }
+    return true;
+}
+
+#define SIM_TICK (1.0 / 30.0)
+#define SIM_SUBFRAMES 4
+
+// 5ms renders, with stretches of 11ms ones like a busy scene
+static f64 sim_render_cost(u32 tick) {
+    f64 cost = ((tick / 200) % 5 == 4) ? 0.011 : 0.005;
+    return cost + (rand() % 1000) / 1e6;
+}
+
+struct SimResult {
+    u32 misses;
+    u32 frames;
+    struct FramePacerHistogram intervals;
+};
+
+static void sim_present(struct SimResult *result, f64 *lastPresent) {
+    if (*lastPresent > 0.0) {
+        frame_pacer_histogram_add(&result->intervals, sSimNow - *lastPresent);
+    }
+    *lastPresent = sSimNow;
+    result->frames++;
+}
+
+static void run_sim(u32 ticks, bool usePacer, struct SimResult *result) {
+    memset(result, 0, sizeof(*result));
+    sSimulated = true;
+    sSimNow = 1.0;
+    sCostValid = false;
+    srand(1);
+
+    f64 tickStart = sSimNow;
+    f64 lastPresent = 0.0;
+    for (u32 tick = 0; tick < ticks; tick++) {
+        f64 target = tickStart + SIM_TICK;
+        s32 count = usePacer ? frame_pacer_plan_subframes(SIM_SUBFRAMES, SIM_TICK) : SIM_SUBFRAMES;
+        for (s32 i = 0; i < count; i++) {
+            if (usePacer && !frame_pacer_should_draw(i, count, target)) {
+                continue;
+            }
+            frame_pacer_begin_render();
+            sSimNow += sim_render_cost(tick);
+            frame_pacer_end_render();
+            sim_present(result, &lastPresent);
+            if (i == count - 1 && sSimNow > target) {
+                result->misses++;
+            }
+            frame_pacer_wait_until(tickStart + SIM_TICK * (i + 1) / count);
+        }
+        frame_pacer_wait_until(target);
+        tickStart = (sSimNow > tickStart + 2.0 * SIM_TICK) ? sSimNow : (tickStart + SIM_TICK);
+    }
+    sSimulated = false;
+}
+
+static void time_waits(u32 waits, bool spinOnly, f64 *meanLate, f64 *maxLate, f64 *cpuShare) {
+    *meanLate = 0.0;
+    *maxLate = 0.0;
+    clock_t cpuStart = clock();
+    f64 start = bench_now();
+    for (u32 i = 0; i < waits; i++) {
+        f64 deadline = bench_now() + (1 + rand() % 8) / 1000.0;
+        if (spinOnly) {
+            while (bench_now() < deadline) {}
+        } else {
+            frame_pacer_wait_until(deadline);
+        }
+        f64 late = bench_now() - deadline;
+        *meanLate += late / waits;
+        if (late > *maxLate) { *maxLate = late; }
+    }
+    *cpuShare = ((f64)(clock() - cpuStart) / CLOCKS_PER_SEC) / (bench_now() - start);
+}
+
+int main(int argc, char **argv) {
+    u32 ticks = 20000;
+    u32 waits = 200;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            ticks = (u32)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+            waits = (u32)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-n ticks] [-w waits]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    bool ok = check_percentiles();
+    printf("frame_pacer_bench: histogram percentiles against sorted samples: %s\n", ok ? "ok" : "FAILED");
+    if (!ok) {
+        return 1;
+    }
+
+    static struct SimResult before, paced;
+    run_sim(ticks, false, &before);
+    run_sim(ticks, true, &paced);
+    printf("frame_pacer_bench: %u ticks of %d subframes, renders 5ms with 11ms stretches\n", ticks, SIM_SUBFRAMES);
+    printf("frame_pacer_bench: every subframe: %6u frames, %5u missed deadlines, interval p50 %.2fms p99 %.2fms\n",
+           before.frames, before.misses, frame_pacer_histogram_percentile(&before.intervals, 0.5) * 1000.0,
+           frame_pacer_histogram_percentile(&before.intervals, 0.99) * 1000.0);
+    printf("frame_pacer_bench: paced:         %6u frames, %5u missed deadlines, interval p50 %.2fms p99 %.2fms (%u dropped)\n",
+           paced.frames, paced.misses, frame_pacer_histogram_percentile(&paced.intervals, 0.5) * 1000.0,
+           frame_pacer_histogram_percentile(&paced.intervals, 0.99) * 1000.0, sDropped);
+    if (paced.misses >= before.misses || paced.misses > ticks / 100) {
+        printf("frame_pacer_bench: the pacer didn't cut missed deadlines\n");
+        return 1;
+    }
+
+    f64 meanLate, maxLate, cpuShare;
+    time_waits(waits, true, &meanLate, &maxLate, &cpuShare);
+    printf("frame_pacer_bench: spin wait:       late by %.3fms mean, %.3fms max, %3.0f%% CPU\n", meanLate * 1000.0, maxLate * 1000.0, cpuShare * 100.0);
+    time_waits(waits, false, &meanLate, &maxLate, &cpuShare);
+    printf("frame_pacer_bench: sleep/spin wait: late by %.3fms mean, %.3fms max, %3.0f%% CPU (spin margin %.3fms)\n", meanLate * 1000.0, maxLate * 1000.0, cpuShare * 100.0, sSpinMargin * 1000.0);
+    return 0;
+}
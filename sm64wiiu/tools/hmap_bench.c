@@ -0,0 +1,260 @@
+// hmap_bench: checks pc/utils/hmap.c against the linear-scan map it replaced
+// with a randomized sequence of puts, gets, deletes, clears and iterations
+// (key order for ordered maps, the reference's order for unordered ones),
+// then times lookups of the real djui_unicode glyph set through both maps
+// and through djui_unicode_get_sprite_index on mixed Latin/Japanese text.
+//
+// usage: hmap_bench [-n iterations] [-s seed]
+//   -n  passes over the glyph keys per timing (default 2000)
+//   -s  seed for the randomized test (default 1)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "../src/pc/utils/hmap.c"
+#include "../src/pc/djui/djui_unicode.c"
+
+// the map before the hash table, as the reference
+struct RefMap {
+    struct HMapEntry* entries;
+    size_t len;
+    size_t cap;
+};
+
+static ptrdiff_t ref_find(const struct RefMap* map, int64_t key) {
+    for (size_t i = 0; i < map->len; i++) {
+        if (map->entries[i].key == key) {
+            return (ptrdiff_t)i;
+        }
+    }
+    return -1;
+}
+
+static void* ref_get(const struct RefMap* map, int64_t key) {
+    ptrdiff_t index = ref_find(map, key);
+    return (index >= 0) ? map->entries[index].value : NULL;
+}
+
+static void ref_put(struct RefMap* map, int64_t key, void* value) {
+    ptrdiff_t index = ref_find(map, key);
+    if (index >= 0) {
+        map->entries[index].value = value;
+        return;
+    }
+    if (map->len == map->cap) {
+        map->cap = (map->cap == 0) ? 32 : (map->cap * 2);
+        map->entries = (struct HMapEntry*)realloc(map->entries, map->cap * sizeof(struct HMapEntry));
+    }
+    map->entries[map->len].key = key;
+    map->entries[map->len].value = value;
+    map->len++;
+}
+
+static void ref_del(struct RefMap* map, int64_t key) {
+    ptrdiff_t index = ref_find(map, key);
+    if (index >= 0) {
+        map->entries[index] = map->entries[map->len - 1];
+        map->len--;
+    }
+}
+
+static uint64_t sRandState;
+
+static uint64_t rand_next(void) {
+    sRandState ^= sRandState << 13;
+    sRandState ^= sRandState >> 7;
+    sRandState ^= sRandState << 17;
+    return sRandState;
+}
+
+// values point into the key's own table entry, offset by a version so
+// overwrites are visible
+#define TEST_KEYS 4096
+static int64_t sTestKeys[TEST_KEYS];
+
+static void* test_value(size_t i, uint32_t version) {
+    return (char*)&sTestKeys[i] + (version & 7);
+}
+
+static bool check_iteration(void* map, struct RefMap* ref, bool ordered) {
+    if (hmap_len(map) != ref->len) {
+        return false;
+    }
+    struct HMapEntry* expected = malloc((ref->len + 1) * sizeof(struct HMapEntry));
+    memcpy(expected, ref->entries, ref->len * sizeof(struct HMapEntry));
+    if (ordered) {
+        qsort(expected, ref->len, sizeof(struct HMapEntry), hmap_compare_entries);
+    }
+    size_t count = 0;
+    bool ok = true;
+    for (void* value = hmap_begin(map); value != NULL; value = hmap_next(map)) {
+        if (count >= ref->len || value != expected[count].value) {
+            ok = false;
+            break;
+        }
+        count++;
+    }
+    free(expected);
+    return ok && count == ref->len;
+}
+
+static bool run_test(bool ordered, uint32_t ops) {
+    void* map = hmap_create(!ordered);
+    struct RefMap ref = { 0 };
+    for (uint32_t op = 0; op < ops; op++) {
+        uint64_t r = rand_next();
+        // a small key range at first so deletes and overwrites hit, then the full one
+        size_t range = (op < ops / 2) ? 256 : TEST_KEYS;
+        size_t i = (size_t)(r >> 32) % range;
+        int64_t key = sTestKeys[i];
+        switch (r % 16) {
+            case 0: case 1: case 2: case 3: case 4: case 5: {
+                void* value = test_value(i, op);
+                hmap_put(map, key, value);
+                ref_put(&ref, key, value);
+                break;
+            }
+            case 6: case 7: case 8:
+                hmap_del(map, key);
+                ref_del(&ref, key);
+                break;
+            case 9:
+                if (rand_next() % 512 == 0) {
+                    hmap_clear(map);
+                    ref.len = 0;
+                }
+                break;
+            case 10:
+                if (rand_next() % 64 == 0 && !check_iteration(map, &ref, ordered)) {
+                    printf("hmap_bench: iteration mismatch at op %u\n", op);
+                    return false;
+                }
+                break;
+            default:
+                if (hmap_get(map, key) != ref_get(&ref, key)) {
+                    printf("hmap_bench: get mismatch at op %u\n", op);
+                    return false;
+                }
+                break;
+        }
+        if (hmap_len(map) != ref.len) {
+            printf("hmap_bench: len mismatch at op %u\n", op);
+            return false;
+        }
+    }
+
+    // every key, present or not, and a final walk
+    for (size_t i = 0; i < TEST_KEYS; i++) {
+        if (hmap_get(map, sTestKeys[i]) != ref_get(&ref, sTestKeys[i])) {
+            printf("hmap_bench: final get mismatch for key %zu\n", i);
+            return false;
+        }
+    }
+    bool ok = check_iteration(map, &ref, ordered);
+    hmap_destroy(map);
+    free(ref.entries);
+    return ok;
+}
+
+// replays djui_unicode_init's puts into the reference map
+static void add_glyph_keys(struct RefMap* ref, struct SmCodeGlyph* glyphs, size_t count, int64_t* keys, size_t* keyCount) {
+    for (size_t i = 0; i < count; i++) {
+        int64_t key = (int64_t)convert_unicode_char_to_u64(glyphs[i].unicode);
+        ref_put(ref, key, &glyphs[i]);
+        keys[(*keyCount)++] = key;
+    }
+}
+
+#define ARRAY_COUNT(arr) (sizeof(arr) / sizeof(arr[0]))
+
+int main(int argc, char** argv) {
+    uint32_t iterations = 2000;
+    sRandState = 1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            iterations = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            sRandState = (uint64_t)strtoull(argv[++i], NULL, 0) | 1;
+        } else {
+            fprintf(stderr, "usage: %s [-n iterations] [-s seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // glyph-like keys (1-4 packed UTF-8 bytes) mixed with arbitrary 64-bit ones
+    for (size_t i = 0; i < TEST_KEYS; i++) {
+        uint64_t r = rand_next();
+        sTestKeys[i] = (i % 4 == 3) ? (int64_t)r : (int64_t)(r & (0xFFFFFFFFULL >> (8 * (i % 4))));
+        for (size_t j = 0; j < i; j++) {
+            if (sTestKeys[j] == sTestKeys[i]) {
+                sTestKeys[i] = (int64_t)(r | (1ULL << 40));
+                break;
+            }
+        }
+    }
+
+    bool ok = run_test(false, 400000) && run_test(true, 400000);
+    printf("hmap_bench: randomized test against the linear map: %s\n", ok ? "ok" : "FAILED");
+    if (!ok) {
+        return 1;
+    }
+
+    // the real glyph set
+    djui_unicode_init();
+    static int64_t keys[ARRAY_COUNT(sSmCodeGlyphs) + ARRAY_COUNT(sSmCodeGlyphs_JP) + ARRAY_COUNT(sSmCodeDuplicateGlyphs)];
+    size_t keyCount = 0;
+    struct RefMap ref = { 0 };
+    add_glyph_keys(&ref, sSmCodeGlyphs, ARRAY_COUNT(sSmCodeGlyphs), keys, &keyCount);
+    add_glyph_keys(&ref, sSmCodeGlyphs_JP, ARRAY_COUNT(sSmCodeGlyphs_JP), keys, &keyCount);
+    add_glyph_keys(&ref, sSmCodeDuplicateGlyphs, ARRAY_COUNT(sSmCodeDuplicateGlyphs), keys, &keyCount);
+    for (size_t i = 0; i < keyCount; i++) {
+        if (ref_get(&ref, keys[i]) != hmap_get(sCharMap, keys[i]) || hmap_get(sCharMap, keys[i]) == NULL) {
+            printf("hmap_bench: glyph %zu looks up differently\n", i);
+            return 1;
+        }
+    }
+
+    volatile uintptr_t sink = 0;
+    double start = bench_now();
+    for (uint32_t n = 0; n < iterations; n++) {
+        for (size_t i = 0; i < keyCount; i++) {
+            sink += (uintptr_t)hmap_get(sCharMap, keys[i]);
+        }
+    }
+    double hashTime = (bench_now() - start) / ((double)iterations * keyCount);
+
+    uint32_t refIterations = iterations / 50 + 1;
+    start = bench_now();
+    for (uint32_t n = 0; n < refIterations; n++) {
+        for (size_t i = 0; i < keyCount; i++) {
+            sink += (uintptr_t)ref_get(&ref, keys[i]);
+        }
+    }
+    double refTime = (bench_now() - start) / ((double)refIterations * keyCount);
+
+    // a line of chat as djui_font renders it: one sprite index per character
+    char text[4096] = "";
+    for (size_t i = 0; strlen(text) + 16 < sizeof(text); i++) {
+        struct SmCodeGlyph* glyph = (i % 3 == 0)
+            ? &sSmCodeGlyphs[i % ARRAY_COUNT(sSmCodeGlyphs)]
+            : &sSmCodeGlyphs_JP[(i * 37) % ARRAY_COUNT(sSmCodeGlyphs_JP)];
+        strcat(text, glyph->unicode);
+        strcat(text, (i % 5 == 0) ? " a" : "");
+    }
+    size_t textChars = djui_unicode_len(text);
+    start = bench_now();
+    for (uint32_t n = 0; n < iterations; n++) {
+        for (char* c = text; *c != '\0'; c = djui_unicode_next_char(c)) {
+            sink += djui_unicode_get_sprite_index(c);
+        }
+    }
+    double spriteTime = (bench_now() - start) / ((double)iterations * textChars);
+
+    printf("hmap_bench: %zu glyph keys, %zu slots\n", keyCount, ((struct HMap*)sCharMap)->mask + 1);
+    printf("hmap_bench: linear lookup %8.1fns\n", refTime * 1e9);
+    printf("hmap_bench: hash lookup   %8.1fns (%.0fx faster)\n", hashTime * 1e9, refTime / hashTime);
+    printf("hmap_bench: djui_unicode_get_sprite_index %.1fns per character (%zu characters)\n", spriteTime * 1e9, textChars);
+    return 0;
+}
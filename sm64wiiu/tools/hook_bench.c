@@ -0,0 +1,188 @@
+// hook_bench: registers 0, 1 and 20 HOOK_MARIO_UPDATE callbacks through
+// hook_event and times one dispatch of the event through smlua_hooks.c, the
+// way mario.c fires it once per player per frame. Checks every callback saw
+// the event with the same MarioState and that a failing callback doesn't
+// stop the ones after it.
+//
+// usage: hook_bench [-n events]
+//   -n  events dispatched per hook count (default 200000)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+
+#include "bench_util.h"
+#include "../src/pc/lua/smlua_hooks.c"
+#include "../src/pc/lua/smlua_cobject.c"
+
+struct MarioState gMarioStates[1];
+struct MarioState *gMarioState = &gMarioStates[0];
+struct Object *gMarioObject = NULL;
+struct Object *gCurrentObject = NULL;
+struct ObjectNode *gObjectLists = NULL;
+
+// behaviors smlua_hooks.c can map ids to; only their addresses matter
+const BehaviorScript bhvMario[1], bhvKoopa[1], bhvActSelector[1], bhvActSelectorStarType[1];
+const BehaviorScript bhvNormalCap[1], bhvMetalCap[1], bhvWingCap[1], bhvVanishCap[1];
+
+static lua_State *sState = NULL;
+static int sOwner = 0;
+
+lua_State *smlua_get_state(void) {
+    return sState;
+}
+
+int smlua_alloc_set_owner(int owner) {
+    int previous = sOwner;
+    sOwner = owner;
+    return previous;
+}
+
+int smlua_alloc_get_owner(void) {
+    return sOwner;
+}
+
+// the profiler as it runs with configLuaProfiler off
+void smlua_profiler_begin(int owner, const char *site) {
+    (void)owner;
+    (void)site;
+}
+
+void smlua_profiler_end(void) {
+}
+
+void smlua_profiler_sethook(lua_State *L, lua_Hook budget_hook, int budget) {
+    lua_sethook(L, budget_hook, LUA_MASKCOUNT, budget);
+}
+
+static const char sScript[] =
+    "calls = 0\n"
+    "seen = nil\n"
+    "function add_hooks(count)\n"
+    "  for i = 1, count do\n"
+    "    hook_event(HOOK_MARIO_UPDATE, function(m)\n"
+    "      calls = calls + 1\n"
+    "      if seen ~= nil and seen ~= m then error('callbacks saw different MarioStates') end\n"
+    "      seen = m\n"
+    "      m.forwardVel = m.forwardVel + 1\n"
+    "    end)\n"
+    "  end\n"
+    "end\n";
+
+static lua_State *open_state(void) {
+    lua_State *L = luaL_newstate();
+    luaL_openlibs(L);
+    sState = L;
+    smlua_bind_cobject(L);
+    smlua_cobject_init_globals(L);
+    smlua_bind_hooks(L);
+    if (luaL_dostring(L, sScript) != LUA_OK) {
+        printf("hook_bench: %s\n", lua_tostring(L, -1));
+        lua_close(L);
+        return NULL;
+    }
+    return L;
+}
+
+static void run_lua(lua_State *L, const char *chunk) {
+    if (luaL_dostring(L, chunk) != LUA_OK) {
+        printf("hook_bench: %s\n", lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+}
+
+static lua_Integer global_integer(lua_State *L, const char *name) {
+    lua_getglobal(L, name);
+    lua_Integer value = lua_tointeger(L, -1);
+    lua_pop(L, 1);
+    return value;
+}
+
+static bool check_dispatch(void) {
+    lua_State *L = open_state();
+    if (L == NULL) {
+        return false;
+    }
+    memset(gMarioStates, 0, sizeof(gMarioStates));
+
+    // nothing registered: no call, nothing left on the stack
+    int top = lua_gettop(L);
+    bool ok = !smlua_call_event_hooks_mario(HOOK_MARIO_UPDATE, &gMarioStates[0]) && lua_gettop(L) == top;
+
+    // a callback that throws in the middle of three
+    run_lua(L, "add_hooks(1)\n"
+               "hook_event(HOOK_MARIO_UPDATE, function(m) error('expected') end)\n"
+               "add_hooks(1)\n");
+    for (int i = 0; i < 2; i++) {
+        ok = ok && smlua_call_event_hooks_mario(HOOK_MARIO_UPDATE, &gMarioStates[0]);
+    }
+    ok = ok && lua_gettop(L) == top && global_integer(L, "calls") == 4 && gMarioStates[0].forwardVel == 4.0f
+            && smlua_get_event_hook_count(HOOK_MARIO_UPDATE) == 3;
+
+    smlua_clear_hooks(L);
+    lua_close(L);
+    return ok;
+}
+
+static bool time_dispatch(int hooks, u32 events, double *seconds) {
+    lua_State *L = open_state();
+    if (L == NULL) {
+        return false;
+    }
+    memset(gMarioStates, 0, sizeof(gMarioStates));
+    char chunk[32];
+    snprintf(chunk, sizeof(chunk), "add_hooks(%d)", hooks);
+    run_lua(L, chunk);
+
+    double start = bench_now();
+    for (u32 i = 0; i < events; i++) {
+        smlua_call_event_hooks_mario(HOOK_MARIO_UPDATE, &gMarioStates[0]);
+    }
+    *seconds = (bench_now() - start) / events;
+
+    bool ok = global_integer(L, "calls") == (lua_Integer)events * hooks
+           && gMarioStates[0].forwardVel == (f32)((double)events * hooks);
+    smlua_clear_hooks(L);
+    lua_close(L);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    u32 events = 200000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            events = (u32)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-n events]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (events == 0) {
+        events = 1;
+    }
+    // forwardVel counts the calls and has to stay exact as an f32
+    if ((double)events * 20 > (double)(1 << 24)) {
+        events = (1 << 24) / 20;
+    }
+
+    bool dispatch = check_dispatch();
+    printf("hook_bench: dispatch, same MarioState and failing callbacks: %s\n", dispatch ? "ok" : "FAILED");
+    if (!dispatch) {
+        return 1;
+    }
+
+    static const int sHookCounts[] = { 0, 1, 20 };
+    for (u32 i = 0; i < sizeof(sHookCounts) / sizeof(sHookCounts[0]); i++) {
+        double seconds = 0.0;
+        if (!time_dispatch(sHookCounts[i], events, &seconds)) {
+            printf("hook_bench: %d hooks: FAILED\n", sHookCounts[i]);
+            return 1;
+        }
+        printf("hook_bench: %2d hooks %9.1fns per event\n", sHookCounts[i], seconds * 1e9);
+    }
+    return 0;
+}
@@ -0,0 +1,270 @@
+// lua_bench: runs three per-frame mod workloads on the vendored Lua VM and
+// the smlua cobject bindings: building and drawing a HUD from tables,
+// reading and writing MarioState/Object fields through smlua_cobject.c, and
+// string.format. Checks their results, plus the NaN and float key rules the
+// VM loses under -ffast-math, then times each workload per frame.
+//
+// usage: lua_bench [-n frames]
+//   -n  frames timed per workload (default 20000)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+
+#include "bench_util.h"
+#include "../src/pc/lua/smlua_cobject.c"
+
+// HUD entries per frame, as in a typical coin/star/timer mod HUD
+#define HUD_ROWS 20
+
+struct MarioState gMarioStates[1];
+struct MarioState *gMarioState = &gMarioStates[0];
+struct Object *gMarioObject = NULL;
+struct Object *gCurrentObject = NULL;
+static struct Object sMarioObject;
+
+// the djui_hud bindings as smlua.c registers them, drawing into counters
+static u32 sHudCalls = 0;
+static f32 sHudSink = 0.0f;
+static u8 sHudColor[4];
+
+static u8 to_color_channel(lua_State *L, int index) {
+    int value = (int)(luaL_checknumber(L, index) + 0.5f);
+    if (value < 0) { value = 0; }
+    if (value > 255) { value = 255; }
+    return (u8)value;
+}
+
+static int hud_set_color(lua_State *L) {
+    for (int i = 0; i < 4; i++) {
+        sHudColor[i] = to_color_channel(L, i + 1);
+    }
+    sHudCalls++;
+    return 0;
+}
+
+static int hud_measure_text(lua_State *L) {
+    const char *message = luaL_checkstring(L, 1);
+    sHudCalls++;
+    lua_pushnumber(L, (lua_Number)strlen(message) * 8.0);
+    return 1;
+}
+
+static int hud_print_text(lua_State *L) {
+    const char *message = luaL_checkstring(L, 1);
+    f32 x = (f32)luaL_checknumber(L, 2);
+    f32 y = (f32)luaL_checknumber(L, 3);
+    f32 scale = (f32)luaL_optnumber(L, 4, 1.0f);
+    sHudSink += x + y * scale + message[0];
+    sHudCalls++;
+    return 0;
+}
+
+static int hud_render_rect(lua_State *L) {
+    f32 x = (f32)luaL_checknumber(L, 1);
+    f32 y = (f32)luaL_checknumber(L, 2);
+    f32 width = (f32)luaL_checknumber(L, 3);
+    f32 height = (f32)luaL_checknumber(L, 4);
+    sHudSink += x + y + width * height * sHudColor[3];
+    sHudCalls++;
+    return 0;
+}
+
+static const char sScript[] =
+    "local names = { 'coins', 'stars', 'lives', 'reds' }\n"
+    "function hud_frame(frame)\n"
+    "  local rows = {}\n"
+    "  for i = 1, 20 do\n"
+    "    rows[i] = { x = 16, y = 16 + i * 12, text = string.format('%s x%d', names[i % 4 + 1], frame + i),\n"
+    "                color = { r = 255, g = i * 8, b = 64, a = 200 } }\n"
+    "  end\n"
+    "  for i = 1, #rows do\n"
+    "    local r = rows[i]\n"
+    "    djui_hud_set_color(r.color.r, r.color.g, r.color.b, r.color.a)\n"
+    "    djui_hud_render_rect(r.x - 2, r.y - 2, djui_hud_measure_text(r.text) + 4, 12)\n"
+    "    djui_hud_print_text(r.text, r.x, r.y, 1)\n"
+    "  end\n"
+    "  return #rows\n"
+    "end\n"
+    "function cobject_frame()\n"
+    "  local m = gMarioStates[0]\n"
+    "  local sum = 0\n"
+    "  for i = 1, 20 do\n"
+    "    local pos = m.pos\n"
+    "    sum = sum + pos.x + pos.y + pos.z + m.forwardVel + m.health + gMarioObject.oPosX\n"
+    "    m.forwardVel = m.forwardVel + 1\n"
+    "  end\n"
+    "  return sum\n"
+    "end\n"
+    "function format_frame(frame)\n"
+    "  local parts = {}\n"
+    "  for i = 1, 20 do\n"
+    "    parts[i] = string.format('%5d %8.3f %-6s %x', frame * i, frame / (i + 1), 'star', i * 255)\n"
+    "  end\n"
+    "  return table.concat(parts, '\\n')\n"
+    "end\n"
+    "function semantics()\n"
+    "  local t = {}\n"
+    "  t[1.0] = 'one'; t[2^53] = 'big'\n"
+    "  local ok = t[1] == 'one' and t[2^53 | 0] == 'big' and math.type(next({ [3.0] = true })) == 'integer'\n"
+    "  local nan = 0/0\n"
+    "  ok = ok and nan ~= nan and not pcall(function() t[nan] = 1 end) and t[nan] == nil\n"
+    "  ok = ok and math.huge > 1e308 and (math.huge - math.huge) ~= (math.huge - math.huge)\n"
+    "  ok = ok and 3 // 0.0 == math.huge and math.tointeger(3.0) == 3 and math.tointeger(3.5) == nil\n"
+    "  ok = ok and string.format('%.3f', 1/3) == '0.333' and string.format('%f', nan):find('nan') ~= nil\n"
+    "  -- integer and float keys mixed across resizes\n"
+    "  local u = {}\n"
+    "  for i = 1, 1000 do u[i] = i; u[i + 0.5] = i end\n"
+    "  for i = 1, 1000 do u[i + 0.5] = nil end\n"
+    "  collectgarbage()\n"
+    "  for i = 1001, 2000 do u[i] = i end\n"
+    "  local n = 0\n"
+    "  for _ in pairs(u) do n = n + 1 end\n"
+    "  return ok and n == 2000 and #u == 2000\n"
+    "end\n";
+
+// calls global `name` with an optional integer argument; leaves one result
+static bool call(lua_State *L, const char *name, lua_Integer arg) {
+    lua_getglobal(L, name);
+    lua_pushinteger(L, arg);
+    if (lua_pcall(L, 1, 1, 0) != LUA_OK) {
+        printf("lua_bench: %s: %s\n", name, lua_tostring(L, -1));
+        lua_pop(L, 1);
+        return false;
+    }
+    return true;
+}
+
+static void reset_mario(void) {
+    memset(gMarioStates, 0, sizeof(gMarioStates));
+    memset(&sMarioObject, 0, sizeof(sMarioObject));
+    gMarioStates[0].pos[0] = 1.0f;
+    gMarioStates[0].pos[1] = 2.0f;
+    gMarioStates[0].pos[2] = 3.0f;
+    gMarioStates[0].health = 0x880;
+    gMarioStates[0].marioObj = &sMarioObject;
+    sMarioObject.oPosX = 5.0f;
+    gMarioObject = &sMarioObject;
+    gCurrentObject = &sMarioObject;
+}
+
+static bool check_hud(lua_State *L) {
+    u32 calls = sHudCalls;
+    bool ok = call(L, "hud_frame", 7) && lua_tointeger(L, -1) == HUD_ROWS;
+    lua_pop(L, 1);
+    return ok && sHudCalls - calls == HUD_ROWS * 4 && sHudColor[3] == 200;
+}
+
+static bool check_cobject(lua_State *L) {
+    reset_mario();
+    double want = 0.0;
+    for (int i = 0; i < 20; i++) {
+        want += 1.0 + 2.0 + 3.0 + i + 0x880 + 5.0;
+    }
+    bool ok = call(L, "cobject_frame", 0) && lua_tonumber(L, -1) == want;
+    lua_pop(L, 1);
+    return ok && gMarioStates[0].forwardVel == 20.0f;
+}
+
+static bool check_format(lua_State *L) {
+    char want[2048];
+    size_t used = 0;
+    for (int i = 1; i <= 20; i++) {
+        used += snprintf(want + used, sizeof(want) - used, "%s%5d %8.3f %-6s %x", (i > 1) ? "\n" : "",
+                         7 * i, 7.0 / (i + 1), "star", i * 255);
+    }
+    bool ok = call(L, "format_frame", 7) && !strcmp(lua_tostring(L, -1), want);
+    lua_pop(L, 1);
+    return ok;
+}
+
+static bool check_semantics(lua_State *L) {
+    bool ok = call(L, "semantics", 0) && lua_toboolean(L, -1);
+    lua_pop(L, 1);
+    return ok;
+}
+
+// `globals` refreshes the cobject globals first, as smlua does each frame
+static double time_frames(lua_State *L, const char *name, bool globals, u32 frames) {
+    double start = bench_now();
+    for (u32 i = 0; i < frames; i++) {
+        if (globals) {
+            smlua_cobject_update_globals(L);
+        }
+        if (!call(L, name, (lua_Integer)i)) {
+            return -1.0;
+        }
+        lua_pop(L, 1);
+    }
+    return (bench_now() - start) / frames;
+}
+
+int main(int argc, char **argv) {
+    u32 frames = 20000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            frames = (u32)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-n frames]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (frames == 0) {
+        frames = 1;
+    }
+
+    lua_State *L = luaL_newstate();
+    luaL_openlibs(L);
+    reset_mario();
+    smlua_bind_cobject(L);
+    smlua_cobject_init_globals(L);
+    lua_register(L, "djui_hud_set_color", hud_set_color);
+    lua_register(L, "djui_hud_measure_text", hud_measure_text);
+    lua_register(L, "djui_hud_print_text", hud_print_text);
+    lua_register(L, "djui_hud_render_rect", hud_render_rect);
+    if (luaL_dostring(L, sScript) != LUA_OK) {
+        printf("lua_bench: %s\n", lua_tostring(L, -1));
+        lua_close(L);
+        return 1;
+    }
+
+#ifdef __OPTIMIZE__
+    const char *opt = "optimized";
+#else
+    const char *opt = "-O0";
+#endif
+#if defined(LUA_USE_JUMPTABLE) && LUA_USE_JUMPTABLE
+    const char *dispatch = "jump table";
+#else
+    const char *dispatch = "switch";
+#endif
+    printf("lua_bench: VM %s, %s dispatch\n", opt, dispatch);
+
+    bool semantics = check_semantics(L);
+    bool hud = check_hud(L);
+    bool cobject = check_cobject(L);
+    bool format = check_format(L);
+    printf("lua_bench: NaN and float keys: %s\n", semantics ? "ok" : "FAILED");
+    printf("lua_bench: HUD tables: %s\n", hud ? "ok" : "FAILED");
+    printf("lua_bench: cobject access: %s\n", cobject ? "ok" : "FAILED");
+    printf("lua_bench: string.format: %s\n", format ? "ok" : "FAILED");
+    if (!semantics || !hud || !cobject || !format) {
+        lua_close(L);
+        return 1;
+    }
+
+    double hudTime = time_frames(L, "hud_frame", false, frames);
+    double cobjectTime = time_frames(L, "cobject_frame", true, frames);
+    double formatTime = time_frames(L, "format_frame", false, frames);
+    struct SmluaCObjectCacheStats stats;
+    smlua_cobject_get_cache_stats(&stats);
+    printf("lua_bench: hud %7.2fus cobject %7.2fus format %7.2fus per frame (%llu cobject cache hits, %g)\n",
+           hudTime * 1e6, cobjectTime * 1e6, formatTime * 1e6, (unsigned long long)stats.totalHits, sHudSink);
+
+    lua_close(L);
+    return 0;
+}
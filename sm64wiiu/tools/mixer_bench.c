@@ -0,0 +1,279 @@
+// mixer_bench: replays a fixed audio command list through the software RSP
+// mixer (src/pc/mixer.c) and times it. Build it once per mixer variant; the
+// "mixer-test" target in tools/Makefile checks every variant bit-for-bit
+// against the scalar reference.
+//
+// usage: mixer_bench [-n updates] [-o output.pcm] [-c golden.pcm]
+//   -n  number of audio updates to run (160 stereo frames each)
+//   -o  write the interleaved output of every update
+//   -c  compare the output against a file written with -o; exits 1 on mismatch
+//
+// The command list mirrors what synthesis.c emits for one audio update:
+// per note ADPCM decode, resample and envelope mix into the dry/wet buses,
+// then the reverb mix and the final interleave. Notes, codebooks and sample
+// data come from a fixed seed so every build replays the same stream.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "../src/pc/mixer.c"
+
+#ifdef NEW_AUDIO_UCODE
+#error "mixer_bench replays the original audio microcode only"
+#endif
+
+#define NUM_NOTES 24
+#define NOTE_LIFETIME 37 // updates before a note is restarted with A_INIT
+#define SAMPLE_DATA_SIZE 0x10000
+
+#define DMEM_TEMP 0x0
+#define DMEM_RESAMPLED 0x20
+#define DMEM_UNCOMPRESSED_NOTE 0x180
+#define DMEM_COMPRESSED_ADPCM_DATA 0x3f0
+#define DMEM_LEFT_CH 0x4c0
+#define DMEM_RIGHT_CH 0x600
+#define DMEM_WET_LEFT_CH 0x740
+#define DMEM_WET_RIGHT_CH 0x880
+#define LEN_1CH 0x140
+#define LEN_2CH 0x280
+
+typedef struct {
+    uint32_t data_offset;
+    uint16_t pitch;       // resampling ratio in 1.15 fixed point
+    uint16_t age;
+    int16_t vol[2];
+    int16_t target[2];
+    int32_t rate[2];
+    int16_t vol_dry;
+    int16_t vol_wet;
+    uint8_t book;
+    uint8_t aux;
+    ADPCM_STATE adpcm_state;
+    ADPCM_STATE loop_state;
+    RESAMPLE_STATE resample_state;
+    ENVMIX_STATE envmix_state;
+} Note;
+
+static uint32_t sSeed = 0x5eed1234;
+static Note sNotes[NUM_NOTES];
+static int16_t sBooks[4][8][2][8];
+static uint8_t sSampleData[SAMPLE_DATA_SIZE];
+
+static uint32_t next_random(void) {
+    sSeed = sSeed * 1664525u + 1013904223u;
+    return sSeed >> 8;
+}
+
+static int32_t random_range(int32_t lo, int32_t hi) {
+    return lo + (int32_t)(next_random() % (uint32_t)(hi - lo + 1));
+}
+
+// Expands a stable order-2 predictor into a VADPCM codebook entry, the way
+// tabledesign does: column 0 is the response to prev2, column 1 to prev1.
+static void make_book_entry(int16_t entry[2][8], double radius, double angle) {
+    double c1 = 2.0 * radius * cos(angle);
+    double c2 = -radius * radius;
+    for (int col = 0; col < 2; col++) {
+        double x2 = col == 0 ? 1.0 : 0.0;
+        double x1 = col == 0 ? 0.0 : 1.0;
+        for (int j = 0; j < 8; j++) {
+            double x = c1 * x1 + c2 * x2;
+            entry[col][j] = (int16_t)lround(x * 2048.0);
+            x2 = x1;
+            x1 = x;
+        }
+    }
+}
+
+static void restart_note(Note *note) {
+    note->data_offset = (uint32_t)random_range(0, SAMPLE_DATA_SIZE / 2) & ~0xf;
+    note->pitch = (uint16_t)random_range(0x4000, 0xc000);
+    note->age = 0;
+    note->vol[0] = (int16_t)random_range(0, 0x7fff);
+    note->vol[1] = (int16_t)random_range(0, 0x7fff);
+    note->target[0] = (int16_t)random_range(0, 0x7fff);
+    note->target[1] = (int16_t)random_range(0, 0x7fff);
+    note->rate[0] = random_range(0xf000, 0x11000);
+    note->rate[1] = random_range(0xf000, 0x11000);
+    note->vol_dry = (int16_t)random_range(0x4000, 0x7fff);
+    note->vol_wet = (int16_t)random_range(0, 0x4000);
+    note->book = (uint8_t)random_range(0, 3);
+    note->aux = (uint8_t)random_range(0, 1);
+    memset(note->loop_state, 0, sizeof(note->loop_state));
+}
+
+static void init_stream(void) {
+    for (int b = 0; b < 4; b++) {
+        for (int e = 0; e < 8; e++) {
+            make_book_entry(sBooks[b][e], 0.5 + 0.06 * e, 0.05 + 0.4 * b + 0.1 * e);
+        }
+    }
+    // frame headers keep the shift in the range real encoders produce
+    for (int i = 0; i < SAMPLE_DATA_SIZE; i++) {
+        sSampleData[i] = (uint8_t)next_random();
+        if (i % 9 == 0) {
+            sSampleData[i] = (uint8_t)((random_range(0, 12) << 4) | random_range(0, 7));
+        }
+    }
+    for (int i = 0; i < NUM_NOTES; i++) {
+        restart_note(&sNotes[i]);
+    }
+}
+
+static void process_note(Note *note) {
+    uint8_t init = note->age == 0 ? A_INIT : 0;
+
+    // enough decoded samples to cover the resampler's reach plus its 4 taps
+    uint32_t samples = ((uint32_t)note->pitch * (LEN_1CH / 2) >> 15) + 8;
+    uint32_t frames = (samples + 15) / 16;
+    uint32_t offset = note->data_offset % (SAMPLE_DATA_SIZE - frames * 9 - 16);
+    offset -= offset % 9;
+
+    aLoadADPCM(NULL, 8 * 16 * 2, &sBooks[note->book][0][0][0]);
+    aSetBuffer(NULL, 0, DMEM_COMPRESSED_ADPCM_DATA, 0, frames * 9);
+    aLoadBuffer(NULL, sSampleData + offset);
+    aSetLoop(NULL, &note->loop_state);
+    aSetBuffer(NULL, 0, DMEM_COMPRESSED_ADPCM_DATA, DMEM_UNCOMPRESSED_NOTE, frames * 16 * sizeof(int16_t));
+    aADPCMdec(NULL, init, note->adpcm_state);
+    note->data_offset += frames * 9;
+
+    aSetBuffer(NULL, 0, DMEM_UNCOMPRESSED_NOTE + 16 * sizeof(int16_t), DMEM_RESAMPLED, LEN_1CH);
+    aResample(NULL, init, note->pitch, note->resample_state);
+
+    aSetBuffer(NULL, 0, DMEM_RESAMPLED, DMEM_LEFT_CH, LEN_1CH);
+    aSetBuffer(NULL, A_AUX, DMEM_RIGHT_CH, DMEM_WET_LEFT_CH, DMEM_WET_RIGHT_CH);
+    aSetVolume(NULL, A_VOL | A_LEFT, note->vol[0], 0, 0);
+    aSetVolume(NULL, A_VOL | A_RIGHT, note->vol[1], 0, 0);
+    aSetVolume32(NULL, A_RATE | A_LEFT, note->target[0], note->rate[0]);
+    aSetVolume32(NULL, A_RATE | A_RIGHT, note->target[1], note->rate[1]);
+    aSetVolume(NULL, A_AUX, note->vol_dry, 0, note->vol_wet);
+    aEnvMixer(NULL, init | (note->aux ? A_AUX : 0), note->envmix_state);
+
+    if (++note->age == NOTE_LIFETIME) {
+        restart_note(note);
+    }
+}
+
+static void process_update(int16_t *out, int16_t reverb_gain) {
+    aClearBuffer(NULL, DMEM_LEFT_CH, LEN_2CH);
+    aClearBuffer(NULL, DMEM_WET_LEFT_CH, LEN_2CH);
+
+    for (int i = 0; i < NUM_NOTES; i++) {
+        process_note(&sNotes[i]);
+    }
+
+    // reverb: fold the wet bus into the dry one, then decay it
+    aSetBuffer(NULL, 0, 0, 0, LEN_2CH);
+    aMix(NULL, 0, 0x7fff, DMEM_WET_LEFT_CH, DMEM_LEFT_CH);
+    aMix(NULL, 0, (int16_t)(0x8000 + reverb_gain), DMEM_WET_LEFT_CH, DMEM_WET_LEFT_CH);
+
+    aSetBuffer(NULL, 0, 0, DMEM_TEMP, LEN_1CH);
+    aInterleave(NULL, DMEM_LEFT_CH, DMEM_RIGHT_CH);
+    aSetBuffer(NULL, 0, 0, DMEM_TEMP, LEN_2CH);
+    aSaveBuffer(NULL, out);
+}
+
+static const char *variant_name(void) {
+#if HAS_SSE41
+    return "sse4.1";
+#elif HAS_NEON
+    return "neon";
+#elif HAS_VEC
+    return "generic-vector";
+#else
+    return "scalar";
+#endif
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: mixer_bench [-n updates] [-o output.pcm] [-c golden.pcm]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    long updates = 4000;
+    const char *output = NULL;
+    const char *golden = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            updates = strtol(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            output = argv[++i];
+        } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            golden = argv[++i];
+        } else {
+            usage();
+        }
+    }
+    if (updates <= 0) {
+        usage();
+    }
+
+    size_t frame_size = LEN_2CH;
+    int16_t *pcm = malloc((size_t)updates * frame_size);
+    if (pcm == NULL) {
+        fprintf(stderr, "mixer_bench: out of memory\n");
+        return 1;
+    }
+
+    init_stream();
+    double start = bench_now();
+    for (long u = 0; u < updates; u++) {
+        // reverb gain 0 exercises the aMix -0x8000 fast path
+        process_update(pcm + u * (frame_size / sizeof(int16_t)), (u & 1) ? 0x2000 : 0);
+    }
+    double elapsed = bench_now() - start;
+
+    double audio_seconds = (double)updates * (LEN_1CH / sizeof(int16_t)) / 32000.0;
+    printf("mixer_bench: %-14s %ld updates x %d notes: %.3fms, %.2fus/update, %.0fx realtime\n",
+           variant_name(), updates, NUM_NOTES, elapsed * 1000.0,
+           elapsed * 1e6 / (double)updates, audio_seconds / elapsed);
+
+    int result = 0;
+    if (output != NULL) {
+        FILE *f = fopen(output, "wb");
+        if (f == NULL || fwrite(pcm, frame_size, (size_t)updates, f) != (size_t)updates) {
+            fprintf(stderr, "mixer_bench: could not write '%s'\n", output);
+            result = 1;
+        }
+        if (f != NULL) {
+            fclose(f);
+        }
+    }
+    if (golden != NULL) {
+        FILE *f = fopen(golden, "rb");
+        int16_t *ref = malloc((size_t)updates * frame_size);
+        if (f == NULL || ref == NULL || fread(ref, frame_size, (size_t)updates, f) != (size_t)updates) {
+            fprintf(stderr, "mixer_bench: could not read %ld updates from '%s'\n", updates, golden);
+            result = 1;
+        } else {
+            size_t count = (size_t)updates * frame_size / sizeof(int16_t);
+            size_t mismatches = 0;
+            size_t first = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (pcm[i] != ref[i] && mismatches++ == 0) {
+                    first = i;
+                }
+            }
+            if (mismatches != 0) {
+                printf("mixer_bench: %s differs from '%s' in %zu of %zu samples (first at update %zu, sample %zu: %d != %d)\n",
+                       variant_name(), golden, mismatches, count, first / (frame_size / sizeof(int16_t)),
+                       first % (frame_size / sizeof(int16_t)), pcm[first], ref[first]);
+                result = 1;
+            } else {
+                printf("mixer_bench: %s matches '%s'\n", variant_name(), golden);
+            }
+        }
+        if (f != NULL) {
+            fclose(f);
+        }
+        free(ref);
+    }
+
+    free(pcm);
+    return result;
+}
@@ -0,0 +1,356 @@
+// smpak: packs a directory tree into a single .smpak archive for the
+// game's fs_packtype_pak (format described in src/pc/fs/smpak.h).
+//
+// usage: smpak [-z] [-p prefix] <input_dir> <output.smpak>
+//   -z         LZ4-compress entries when that makes them smaller
+//   -p prefix  virtual path prefix; defaults to the input directory's name,
+//              so "smpak -z mods mods.smpak" yields "mods/<mod>/main.lua"
+//              (pass -p "" to pack the directory contents at the root)
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../src/pc/fs/smpak.h"
+
+#define MAX_PATH_LEN 4096
+
+typedef struct {
+    char *path;     // virtual path stored in the archive
+    char *realpath; // file on disk
+    uint32_t hash;
+    uint32_t method;
+    uint32_t path_offset;
+    uint64_t offset;
+    uint64_t stored_size;
+    uint64_t size;
+} Entry;
+
+static Entry *sEntries = NULL;
+static size_t sNumEntries = 0;
+static size_t sEntryCap = 0;
+
+static void *xrealloc(void *ptr, size_t size) {
+    void *ret = realloc(ptr, size);
+    if (ret == NULL && size != 0) {
+        fprintf(stderr, "smpak: out of memory\n");
+        exit(1);
+    }
+    return ret;
+}
+
+static char *xstrdup(const char *str) {
+    size_t len = strlen(str) + 1;
+    char *ret = xrealloc(NULL, len);
+    memcpy(ret, str, len);
+    return ret;
+}
+
+static void add_entry(const char *vpath, const char *realpath) {
+    if (sNumEntries == sEntryCap) {
+        sEntryCap = sEntryCap ? sEntryCap * 2 : 256;
+        sEntries = xrealloc(sEntries, sEntryCap * sizeof(Entry));
+    }
+    Entry *e = &sEntries[sNumEntries++];
+    memset(e, 0, sizeof(*e));
+    e->path = xstrdup(vpath);
+    e->realpath = xstrdup(realpath);
+    e->hash = smpak_hash(vpath);
+}
+
+static void scan_dir(const char *realdir, const char *vdir) {
+    DIR *dir = opendir(realdir);
+    if (dir == NULL) {
+        fprintf(stderr, "smpak: could not open directory '%s'\n", realdir);
+        exit(1);
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        // skip ./.. and hidden files, same as fs_sys_walk
+        if (ent->d_name[0] == '\0' || ent->d_name[0] == '.') {
+            continue;
+        }
+
+        char realpath[MAX_PATH_LEN];
+        char vpath[MAX_PATH_LEN];
+        snprintf(realpath, sizeof(realpath), "%s/%s", realdir, ent->d_name);
+        if (vdir[0] != '\0') {
+            snprintf(vpath, sizeof(vpath), "%s/%s", vdir, ent->d_name);
+        } else {
+            snprintf(vpath, sizeof(vpath), "%s", ent->d_name);
+        }
+
+        struct stat st;
+        if (stat(realpath, &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            scan_dir(realpath, vpath);
+        } else if (S_ISREG(st.st_mode)) {
+            add_entry(vpath, realpath);
+        }
+    }
+    closedir(dir);
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const Entry *ea = a;
+    const Entry *eb = b;
+    if (ea->hash != eb->hash) {
+        return ea->hash < eb->hash ? -1 : 1;
+    }
+    return strcmp(ea->path, eb->path);
+}
+
+static uint8_t *read_file(const char *path, uint64_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "smpak: could not open '%s'\n", path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = xrealloc(NULL, len > 0 ? (size_t)len : 1);
+    if (len > 0 && fread(data, 1, (size_t)len, f) != (size_t)len) {
+        fprintf(stderr, "smpak: could not read '%s'\n", path);
+        exit(1);
+    }
+    fclose(f);
+    *size = (uint64_t)len;
+    return data;
+}
+
+static uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint8_t *write_length(uint8_t *op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+// Greedy single-pass LZ4 block compressor. Output must have room for
+// lz4_bound(n) bytes. Follows the block format end rules: the last match
+// starts at least 12 bytes before the end and the last 5 bytes are literals.
+static size_t lz4_bound(size_t n) {
+    return n + n / 255 + 16;
+}
+
+static size_t lz4_compress(const uint8_t *src, size_t n, uint8_t *dst) {
+    enum { HASH_BITS = 12 };
+    int32_t table[1 << HASH_BITS];
+    uint8_t *op = dst;
+    size_t anchor = 0;
+    size_t ip = 0;
+
+    for (size_t i = 0; i < (1 << HASH_BITS); i++) {
+        table[i] = -1;
+    }
+
+    if (n >= 13) {
+        const size_t limit = n - 12;
+        const size_t match_limit = n - 5;
+        while (ip < limit) {
+            uint32_t seq = read32(src + ip);
+            uint32_t h = (seq * 2654435761u) >> (32 - HASH_BITS);
+            int32_t ref = table[h];
+            table[h] = (int32_t)ip;
+
+            if (ref < 0 || ip - (size_t)ref > 65535 || read32(src + ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            size_t mlen = 4;
+            while (ip + mlen < match_limit && src[ref + mlen] == src[ip + mlen]) {
+                mlen++;
+            }
+
+            size_t lit = ip - anchor;
+            size_t ml = mlen - 4;
+            *op++ = (uint8_t)(((lit < 15 ? lit : 15) << 4) | (ml < 15 ? ml : 15));
+            if (lit >= 15) {
+                op = write_length(op, lit - 15);
+            }
+            memcpy(op, src + anchor, lit);
+            op += lit;
+            size_t offset = ip - (size_t)ref;
+            *op++ = (uint8_t)(offset & 0xFF);
+            *op++ = (uint8_t)(offset >> 8);
+            if (ml >= 15) {
+                op = write_length(op, ml - 15);
+            }
+
+            ip += mlen;
+            anchor = ip;
+        }
+    }
+
+    size_t lit = n - anchor;
+    *op++ = (uint8_t)((lit < 15 ? lit : 15) << 4);
+    if (lit >= 15) {
+        op = write_length(op, lit - 15);
+    }
+    memcpy(op, src + anchor, lit);
+    op += lit;
+    return (size_t)(op - dst);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void put_u64(uint8_t *p, uint64_t v) {
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static void write_padding(FILE *out, uint64_t *pos) {
+    static const uint8_t zeros[SMPAK_DATA_ALIGN] = { 0 };
+    uint64_t pad = (SMPAK_DATA_ALIGN - (*pos % SMPAK_DATA_ALIGN)) % SMPAK_DATA_ALIGN;
+    fwrite(zeros, 1, (size_t)pad, out);
+    *pos += pad;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: smpak [-z] [-p prefix] <input_dir> <output.smpak>\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int compress = 0;
+    const char *prefix = NULL;
+    int argi = 1;
+
+    for (; argi < argc && argv[argi][0] == '-'; argi++) {
+        if (!strcmp(argv[argi], "-z")) {
+            compress = 1;
+        } else if (!strcmp(argv[argi], "-p") && argi + 1 < argc) {
+            prefix = argv[++argi];
+        } else {
+            usage();
+        }
+    }
+    if (argc - argi != 2) {
+        usage();
+    }
+
+    char input[MAX_PATH_LEN];
+    snprintf(input, sizeof(input), "%s", argv[argi]);
+    size_t inlen = strlen(input);
+    while (inlen > 1 && input[inlen - 1] == '/') {
+        input[--inlen] = '\0';
+    }
+    const char *output = argv[argi + 1];
+
+    if (prefix == NULL) {
+        const char *slash = strrchr(input, '/');
+        prefix = slash ? slash + 1 : input;
+        if (!strcmp(prefix, ".")) {
+            prefix = "";
+        }
+    }
+
+    scan_dir(input, prefix);
+    qsort(sEntries, sNumEntries, sizeof(Entry), compare_entries);
+
+    FILE *out = fopen(output, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "smpak: could not create '%s'\n", output);
+        return 1;
+    }
+
+    // header is rewritten once the offsets are known
+    uint8_t header[SMPAK_HEADER_SIZE] = { 0 };
+    fwrite(header, 1, sizeof(header), out);
+    uint64_t pos = sizeof(header);
+
+    uint64_t total_in = 0;
+    uint64_t total_out = 0;
+    for (size_t i = 0; i < sNumEntries; i++) {
+        Entry *e = &sEntries[i];
+        uint8_t *data = read_file(e->realpath, &e->size);
+        const uint8_t *stored = data;
+        uint8_t *packed = NULL;
+
+        e->method = SMPAK_METHOD_STORE;
+        e->stored_size = e->size;
+        if (compress && e->size > 0) {
+            packed = xrealloc(NULL, lz4_bound((size_t)e->size));
+            size_t packed_size = lz4_compress(data, (size_t)e->size, packed);
+            if (packed_size < e->size) {
+                e->method = SMPAK_METHOD_LZ4;
+                e->stored_size = packed_size;
+                stored = packed;
+            }
+        }
+
+        write_padding(out, &pos);
+        e->offset = pos;
+        fwrite(stored, 1, (size_t)e->stored_size, out);
+        pos += e->stored_size;
+        total_in += e->size;
+        total_out += e->stored_size;
+
+        free(packed);
+        free(data);
+    }
+
+    // index
+    write_padding(out, &pos);
+    uint64_t index_offset = pos;
+    uint32_t strings_size = 0;
+    for (size_t i = 0; i < sNumEntries; i++) {
+        Entry *e = &sEntries[i];
+        uint8_t rec[SMPAK_RECORD_SIZE] = { 0 };
+        e->path_offset = strings_size;
+        strings_size += (uint32_t)strlen(e->path) + 1;
+        put_u32(rec + 0, e->hash);
+        put_u32(rec + 4, e->path_offset);
+        put_u32(rec + 8, e->method);
+        put_u64(rec + 16, e->offset);
+        put_u64(rec + 24, e->stored_size);
+        put_u64(rec + 32, e->size);
+        fwrite(rec, 1, sizeof(rec), out);
+    }
+    pos += (uint64_t)sNumEntries * SMPAK_RECORD_SIZE;
+
+    // string table; always at least one byte so an empty pack still mounts
+    uint64_t strings_offset = pos;
+    for (size_t i = 0; i < sNumEntries; i++) {
+        fwrite(sEntries[i].path, 1, strlen(sEntries[i].path) + 1, out);
+    }
+    if (strings_size == 0) {
+        fputc('\0', out);
+        strings_size = 1;
+    }
+
+    put_u32(header + 0, SMPAK_MAGIC);
+    put_u32(header + 4, SMPAK_VERSION);
+    put_u32(header + 8, (uint32_t)sNumEntries);
+    put_u32(header + 12, 0);
+    put_u64(header + 16, index_offset);
+    put_u64(header + 24, strings_offset);
+    put_u64(header + 32, strings_size);
+    fseek(out, 0, SEEK_SET);
+    fwrite(header, 1, sizeof(header), out);
+    fclose(out);
+
+    printf("smpak: %u files, %llu -> %llu bytes\n", (unsigned)sNumEntries,
+           (unsigned long long)total_in, (unsigned long long)total_out);
+    return 0;
+}
@@ -0,0 +1,391 @@
+// synth_bench: renders the same note stream through both synthesis paths of
+// src/audio (the command list replayed by src/pc/mixer.c, and the native float
+// path in synthesis_float.c) at 16, 32 and 64 active notes, then reports CPU
+// time per second of audio for each and how closely the float output tracks
+// the command list output.
+//
+// usage: synth_bench [-s seconds] [-m min_snr_db]
+//   -s  seconds of audio rendered per path and note count (default 10)
+//   -m  exit 1 if either channel of any float render falls below this SNR
+//       against the command list render (default 25 dB)
+//
+// SNR is reported per channel. The float path reproduces aEnvMixer's volume
+// lanes, including the microcode's quirk of scaling the right channel's ramp
+// steps by the left start volume, so both channels track the command list
+// equally. They are still not expected to be bit-exact: the float path holds
+// a steady note at its target volume instead of carrying the lanes over, and
+// resamples notes above 2x in one step instead of halving them first, so
+// 30 dB or so is the norm.
+//
+// The notes are synthetic: VADPCM-encoded harmonic tones, looping and
+// one-shot samples, wave notes, pitches from 0.25x to 3.9x,
+// stereo-strong panning and reverb sends, with volume and pitch changes every
+// few frames so the envelope ramps run constantly.
+//
+// Both paths are then rendered again at the US preset's 16 notes and at 24
+// (the most the 0x60 sample DMA slots hold) with load.c's emulated N64 sample
+// DMA cache, and against reading samples in place (audio_sample_dma_cache
+// off). Those renders must match bit for bit; the bytes the cache copied per
+// audio frame are reported next to the time.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "../src/pc/mixer.c"
+#include "../src/audio/data.c"
+#include "../src/audio/synthesis.c"
+#include "../src/audio/synthesis_float.c"
+#include "../src/audio/load.c"
+
+#define SAMPLE_RATE 32000
+#define FRAME_SAMPLES 544 // AUDIO_SAMPLES_HIGH, as the audio thread asks for
+#define NUM_SAMPLES 8
+#define SAMPLE_FRAMES 512 // 8192 samples each
+#define REVERB_WINDOW 0x0c00
+#define MAX_NOTES 64
+#define MAX_DMA_NOTES 24 // init_sample_dma_buffers takes 4 of the 0x60 slots per note
+
+// what the rest of the audio engine would provide
+s8 gReverbDownsampleRate = 1;
+s16 gVolume = 0x7fff;
+s32 gMaxSimultaneousNotes;
+u8 gBankLoadStatus[64];
+s32 gAudioErrorFlags;
+s8 gSoundMode = SOUND_MODE_STEREO;
+s8 gAudioUpdatesPerFrame = 4;
+bool configAudioFloatSynthesis;
+bool configAudioSampleDmaCache;
+struct SoundAllocPool gNotesAndBuffersPool;
+
+void osInvalDCache(UNUSED void *vaddr, UNUSED size_t nbytes) {
+}
+
+s32 osPiStartDma(UNUSED OSIoMesg *mb, UNUSED s32 priority, UNUSED s32 direction,
+                 uintptr_t devAddr, void *vAddr, size_t nbytes, UNUSED OSMesgQueue *mq) {
+    memcpy(vAddr, (const void *) devAddr, nbytes);
+    return 0;
+}
+
+// only the sample DMA buffers come from here; they live for the whole run
+void *soundAlloc(UNUSED struct SoundAllocPool *pool, u32 size) {
+    return malloc(size);
+}
+
+void process_sequences(UNUSED s32 iterationsRemaining) {
+}
+
+static uint32_t sSeed;
+static struct AudioBankSample sSamples[NUM_SAMPLES];
+static struct AudioBankSound sSounds[NUM_SAMPLES];
+static struct AdpcmLoop sLoops[NUM_SAMPLES];
+static struct Note sNotes[MAX_NOTES];
+static struct NoteSynthesisBuffers sBuffers[MAX_NOTES];
+static s16 sReverbLeft[REVERB_WINDOW];
+static s16 sReverbRight[REVERB_WINDOW];
+static u64 sCmdBuf[0x4000];
+
+static uint32_t next_random(void) {
+    sSeed = sSeed * 1664525u + 1013904223u;
+    return sSeed >> 8;
+}
+
+static int32_t random_range(int32_t lo, int32_t hi) {
+    return lo + (int32_t)(next_random() % (uint32_t)(hi - lo + 1));
+}
+
+static f32 random_float(f32 lo, f32 hi) {
+    return lo + (hi - lo) * (f32)(next_random() & 0xffff) / 65535.0f;
+}
+
+// Same construction as tools/mixer_bench: a stable order-2 predictor
+// expanded into a VADPCM codebook entry.
+static void make_book_entry(s16 *entry, double radius, double angle) {
+    double c1 = 2.0 * radius * cos(angle);
+    double c2 = -radius * radius;
+    for (int col = 0; col < 2; col++) {
+        double x2 = col == 0 ? 1.0 : 0.0;
+        double x1 = col == 0 ? 0.0 : 1.0;
+        for (int j = 0; j < 8; j++) {
+            double x = c1 * x1 + c2 * x2;
+            entry[col * 8 + j] = (s16) lround(x * 2048.0);
+            x2 = x1;
+            x1 = x;
+        }
+    }
+}
+
+// Greedy VADPCM encoder: for each frame, the predictor and shift with the
+// lowest error. Decoding the choice back keeps the encoder state exact.
+static void encode_frame(const s16 *pcm, const s16 *book, s16 *state, u8 *out) {
+    int bestError = -1;
+    u8 best[9];
+
+    for (int p = 0; p < 8; p++) {
+        const s16 *tbl = book + p * 16;
+        for (int shift = 0; shift <= 12; shift++) {
+            u8 frame[9] = { (u8)((shift << 4) | p) };
+            s32 prev2 = state[14];
+            s32 prev1 = state[15];
+            int error = 0;
+            for (int half = 0; half < 2; half++) {
+                s32 ins[8];
+                for (int j = 0; j < 8; j++) {
+                    s32 acc = tbl[j] * prev2 + tbl[8 + j] * prev1;
+                    for (int k = 0; k < j; k++) {
+                        acc += tbl[8 + (j - k) - 1] * ins[k];
+                    }
+                    s32 nibble = (s32) lround((pcm[half * 8 + j] - acc / 2048.0) / (1 << shift));
+                    nibble = nibble < -8 ? -8 : (nibble > 7 ? 7 : nibble);
+                    ins[j] = nibble * (1 << shift);
+                    frame[1 + half * 4 + j / 2] |= (u8)((nibble & 0xf) << ((j & 1) ? 0 : 4));
+                }
+                // the real outputs, for the next half's prediction and the error
+                for (int j = 0; j < 8; j++) {
+                    s32 acc = tbl[j] * prev2 + tbl[8 + j] * prev1 + ins[j] * 2048;
+                    for (int k = 0; k < j; k++) {
+                        acc += tbl[8 + (j - k) - 1] * ins[k];
+                    }
+                    acc >>= 11;
+                    acc = acc < -0x8000 ? -0x8000 : (acc > 0x7fff ? 0x7fff : acc);
+                    error += abs(acc - pcm[half * 8 + j]);
+                    if (j == 6) {
+                        prev2 = acc;
+                    } else if (j == 7) {
+                        prev1 = acc;
+                    }
+                }
+            }
+            if (bestError < 0 || error < bestError) {
+                bestError = error;
+                memcpy(best, frame, sizeof(best));
+            }
+        }
+    }
+    memcpy(out, best, sizeof(best));
+    float_decode_adpcm_frame(out, state, book);
+}
+
+// Harmonic tones with a slow tremolo, VADPCM encoded; odd samples are
+// one-shots, even ones loop from an unaligned start.
+static void init_samples(void) {
+    sSeed = 0x5a3b1e77;
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        struct AudioBankSample *sample = &sSamples[i];
+        struct AdpcmLoop *loop = &sLoops[i];
+        struct AdpcmBook *book = malloc(sizeof(struct AdpcmBook) + 8 * 16 * sizeof(s16));
+        // the command list path loads from 16-byte aligned addresses below the data
+        u8 *data = (u8 *) malloc(SAMPLE_FRAMES * 9 + 32) + 16;
+        double f0 = random_float(80.0f, 900.0f) / SAMPLE_RATE;
+        s16 state[16] = { 0 };
+
+        book->order = 2;
+        book->npredictors = 8;
+        for (int e = 0; e < 8; e++) {
+            make_book_entry(book->book + e * 16, 0.6 + 0.05 * e, 0.02 + 0.04 * e);
+        }
+
+        loop->start = (u32) random_range(100, SAMPLE_FRAMES * 8);
+        loop->end = (u32) random_range(SAMPLE_FRAMES * 12, SAMPLE_FRAMES * 16 - 1);
+        loop->count = (i & 1) ? 0 : (u32) -1;
+
+        for (int f = 0; f < SAMPLE_FRAMES; f++) {
+            s16 pcm[16];
+            for (int j = 0; j < 16; j++) {
+                double t = f * 16 + j;
+                double x = 0.0;
+                for (int h = 1; h <= 4; h++) {
+                    x += sin(2.0 * M_PI * f0 * h * t) / h;
+                }
+                pcm[j] = (s16)(x * 9000.0 * (0.75 + 0.25 * sin(t * 0.0007)));
+            }
+            encode_frame(pcm, book->book, state, data + f * 9);
+            if (f == (int) loop->start / 16) {
+                memcpy(loop->state, state, sizeof(state));
+            }
+        }
+
+        sample->sampleAddr = data;
+        sample->loop = loop;
+        sample->book = book;
+        sSounds[i].sample = sample;
+        sSounds[i].tuning = 1.0f;
+    }
+}
+
+static void start_note(struct Note *note) {
+    struct AudioBankSound *sound = &sSounds[random_range(0, NUM_SAMPLES - 1)];
+
+    note_enable(note);
+    note->bankId = 0;
+    note->stereoHeadsetEffects = random_range(0, 3) == 0;
+    note->sound = random_range(0, 7) == 0 ? NULL : sound;
+    if (note->sound == NULL) {
+        s16 *samples = note->synthesisBuffers->samples;
+        note->sampleCount = 64;
+        for (int i = 0; i < 64; i++) {
+            samples[i] = (s16)(sinf(i * (2.0f * 3.14159265f / 64.0f)) * 12000.0f);
+        }
+    }
+    note_set_frequency(note, random_range(0, 3) == 0 ? random_float(2.0f, 3.9f) : random_float(0.25f, 1.99f));
+    note_set_vel_pan_reverb(note, random_float(0.05f, 0.3f) * 32767.0f, random_float(0.0f, 1.0f),
+                            (u8) random_range(0, 0x7f));
+}
+
+static void init_stream(int numNotes) {
+    sSeed = 0x7e57ab1e;
+    memset(sNotes, 0, sizeof(sNotes));
+    memset(sBuffers, 0, sizeof(sBuffers));
+    memset(sReverbLeft, 0, sizeof(sReverbLeft));
+    memset(sReverbRight, 0, sizeof(sReverbRight));
+
+    gNotes = sNotes;
+    gMaxSimultaneousNotes = numNotes;
+    gBankLoadStatus[0] = SOUND_LOAD_STATUS_COMPLETE;
+
+    memset(&gSynthesisReverb, 0, sizeof(gSynthesisReverb));
+    gSynthesisReverb.useReverb = 1;
+    gSynthesisReverb.reverbGain = 0x2fff;
+    gSynthesisReverb.bufSizePerChannel = REVERB_WINDOW;
+    gSynthesisReverb.ringBuffer.left = sReverbLeft;
+    gSynthesisReverb.ringBuffer.right = sReverbRight;
+
+    for (int i = 0; i < numNotes; i++) {
+        sNotes[i].synthesisBuffers = &sBuffers[i];
+        note_init_volume(&sNotes[i]);
+        start_note(&sNotes[i]);
+    }
+}
+
+// Stands in for the sequence player between audio frames. The two paths may
+// end a one-shot note an update apart, so nothing here depends on whether a
+// note is still playing; that keeps both renders on the same random stream.
+static void update_notes(int numNotes) {
+    for (int i = 0; i < numNotes; i++) {
+        struct Note *note = &sNotes[i];
+        if (random_range(0, 30) == 0) {
+            start_note(note);
+        } else if (random_range(0, 3) == 0) {
+            note_set_frequency(note, note->frequency * random_float(0.97f, 1.03f));
+            note_set_vel_pan_reverb(note, random_float(0.05f, 0.3f) * 32767.0f, random_float(0.0f, 1.0f),
+                                    note->reverbVol);
+        }
+    }
+}
+
+// Renders 'frames' audio frames and returns the CPU seconds spent in synthesis.
+static double render(int numNotes, int frames, bool useFloat, bool useDmaCache, s16 *out) {
+    double elapsed = 0.0;
+    s32 writtenCmds;
+
+    configAudioFloatSynthesis = useFloat;
+    configAudioSampleDmaCache = useDmaCache;
+    init_stream(numNotes);
+    for (int f = 0; f < frames; f++) {
+        double start;
+        update_notes(numNotes);
+        start = bench_cpu_time();
+        synthesis_execute(sCmdBuf, &writtenCmds, out + f * FRAME_SAMPLES * 2, FRAME_SAMPLES);
+        decrease_sample_dma_ttls();
+        elapsed += bench_cpu_time() - start;
+    }
+    return elapsed;
+}
+
+// Renders one path with and without the sample DMA cache; returns 1 if the
+// outputs differ.
+static int compare_sample_dma(int numNotes, int frames, bool useFloat, double audioSeconds, s16 *cached, s16 *direct) {
+    size_t count = (size_t) frames * FRAME_SAMPLES * 2;
+    u64 copied = gSampleDmaBytesCopied;
+    double cacheTime = render(numNotes, frames, useFloat, true, cached);
+    double cacheBytes = (double) (gSampleDmaBytesCopied - copied) / frames;
+
+    copied = gSampleDmaBytesCopied;
+    double directTime = render(numNotes, frames, useFloat, false, direct);
+    double directBytes = (double) (gSampleDmaBytesCopied - copied) / frames;
+    bool same = memcmp(cached, direct, count * sizeof(s16)) == 0;
+
+    printf("synth_bench: %2d notes, %-12s: dma cache %7.1f bytes/frame %6.2fms/s, in place %5.1f bytes/frame %6.2fms/s, %s\n",
+           numNotes, useFloat ? "float" : "command list", cacheBytes, cacheTime * 1000.0 / audioSeconds,
+           directBytes, directTime * 1000.0 / audioSeconds, same ? "identical" : "OUTPUT DIFFERS");
+    return same ? 0 : 1;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: synth_bench [-s seconds] [-m min_snr_db]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    static const int noteCounts[] = { 16, 32, 64 };
+    double seconds = 10.0;
+    double minSnr = 25.0;
+    int result = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            seconds = strtod(argv[++i], NULL);
+        } else if (!strcmp(argv[i], "-m") && i + 1 < argc) {
+            minSnr = strtod(argv[++i], NULL);
+        } else {
+            usage();
+        }
+    }
+    if (seconds <= 0.0) {
+        usage();
+    }
+
+    int frames = (int) ceil(seconds * SAMPLE_RATE / FRAME_SAMPLES);
+    double audioSeconds = (double) frames * FRAME_SAMPLES / SAMPLE_RATE;
+    size_t count = (size_t) frames * FRAME_SAMPLES * 2;
+    s16 *reference = malloc(count * sizeof(s16));
+    s16 *native = malloc(count * sizeof(s16));
+    if (reference == NULL || native == NULL) {
+        fprintf(stderr, "synth_bench: out of memory\n");
+        return 1;
+    }
+
+    init_samples();
+    gMaxSimultaneousNotes = MAX_DMA_NOTES;
+    init_sample_dma_buffers(MAX_DMA_NOTES);
+    for (size_t n = 0; n < sizeof(noteCounts) / sizeof(noteCounts[0]); n++) {
+        double cmdTime = render(noteCounts[n], frames, false, false, reference);
+        double floatTime = render(noteCounts[n], frames, true, false, native);
+        double signal[2] = { 0.0, 0.0 };
+        double noise[2] = { 0.0, 0.0 };
+        double snr[2];
+        int peak = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            int diff = abs(native[i] - reference[i]);
+            signal[i & 1] += (double) reference[i] * reference[i];
+            noise[i & 1] += (double) diff * diff;
+            if (diff > peak) {
+                peak = diff;
+            }
+        }
+        for (int c = 0; c < 2; c++) {
+            snr[c] = noise[c] > 0.0 ? 10.0 * log10(signal[c] / noise[c]) : INFINITY;
+        }
+
+        printf("synth_bench: %2d notes: command list %6.2fms/s, float %6.2fms/s (%.2fx), SNR L %.1fdB R %.1fdB, peak error %d\n",
+               noteCounts[n], cmdTime * 1000.0 / audioSeconds, floatTime * 1000.0 / audioSeconds,
+               cmdTime / floatTime, snr[0], snr[1], peak);
+        if (snr[0] < minSnr || snr[1] < minSnr) {
+            printf("synth_bench: float output below %.1fdB SNR at %d notes\n", minSnr, noteCounts[n]);
+            result = 1;
+        }
+    }
+
+    static const int dmaNoteCounts[] = { 16, MAX_DMA_NOTES };
+    for (size_t n = 0; n < sizeof(dmaNoteCounts) / sizeof(dmaNoteCounts[0]); n++) {
+        result |= compare_sample_dma(dmaNoteCounts[n], frames, false, audioSeconds, reference, native);
+        result |= compare_sample_dma(dmaNoteCounts[n], frames, true, audioSeconds, reference, native);
+    }
+
+    free(reference);
+    free(native);
+    return result;
+}
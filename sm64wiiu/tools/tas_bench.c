@@ -0,0 +1,186 @@
+// tas_bench: writes a two-controller .m64, plays it back through
+// controller_recorded_tas.c with seeks and a loop, checks truncated and
+// malformed movies are caught, records a run and plays the recording back.
+// Then times a per-tick read.
+//
+// usage: tas_bench [-n reads]
+//   -n  reads timed (default 20000000)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "../src/pc/controller/controller_recorded_tas.c"
+
+#define MOVIE_PATH "tas_bench.m64"
+#define MOVIE_FRAMES 100
+
+// what fs_persist would have handed to its writer thread
+static u8 *sPersisted = NULL;
+static size_t sPersistedSize = 0;
+static u32 sPersistWrites = 0;
+
+bool fs_persist_write(const char *vpath, const void *data, const size_t size) {
+    (void)vpath;
+    free(sPersisted);
+    sPersisted = malloc(size);
+    memcpy(sPersisted, data, size);
+    sPersistedSize = size;
+    sPersistWrites++;
+    return true;
+}
+
+static OSContPad expected(u32 frame, u8 port) {
+    OSContPad pad = { 0 };
+    pad.button = (u16)(frame * 0x0123 + port * 0x1000);
+    pad.stick_x = (s8)(frame + port);
+    pad.stick_y = (s8)-(s32)(frame + port * 7);
+    return pad;
+}
+
+static bool same(const OSContPad *a, const OSContPad *b) {
+    return a->button == b->button && a->stick_x == b->stick_x && a->stick_y == b->stick_y;
+}
+
+static void write_movie(u32 claimedFrames, const char *magic) {
+    u8 header[M64_HEADER_SIZE] = { 0 };
+    memcpy(header, magic, 4);
+    write_u32_le(header + M64_OFS_VERSION, M64_VERSION);
+    header[M64_OFS_CONTROLLERS] = 2;
+    write_u32_le(header + M64_OFS_SAMPLES, claimedFrames);
+    write_u32_le(header + M64_OFS_CONT_FLAGS, 0x3);
+
+    FILE *fp = fopen(MOVIE_PATH, "wb");
+    fwrite(header, 1, sizeof(header), fp);
+    for (u32 frame = 0; frame < MOVIE_FRAMES; frame++) {
+        for (u8 port = 0; port < 2; port++) {
+            OSContPad pad = expected(frame, port);
+            u8 sample[4] = { (u8)(pad.button >> 8), (u8)pad.button, (u8)pad.stick_x, (u8)pad.stick_y };
+            fwrite(sample, 1, sizeof(sample), fp);
+        }
+    }
+    fclose(fp);
+}
+
+static OSContPad read_tick(void) {
+    OSContPad pad = { 0 };
+    controller_recorded_tas.read(&pad);
+    return pad;
+}
+
+static bool check_playback(void) {
+    write_movie(MOVIE_FRAMES, "M64\x1A");
+    bool ok = controller_recorded_tas_open(MOVIE_PATH)
+           && controller_recorded_tas_frame_count() == MOVIE_FRAMES
+           && controller_recorded_tas_controller_count() == 2;
+
+    // straight through, port 0 feeding the game and port 1 alongside
+    for (u32 frame = 0; ok && frame < MOVIE_FRAMES; frame++) {
+        OSContPad other;
+        OSContPad want0 = expected(frame, 0);
+        OSContPad want1 = expected(frame, 1);
+        ok = controller_recorded_tas_peek(1, &other) && same(&other, &want1);
+        OSContPad pad = read_tick();
+        ok = ok && same(&pad, &want0);
+    }
+    // past the end without a loop nothing is pressed
+    OSContPad idle = { 0 };
+    OSContPad pad = read_tick();
+    ok = ok && same(&pad, &idle) && controller_recorded_tas_tell() == MOVIE_FRAMES;
+
+    // seek, then wrap to the loop point
+    OSContPad want = expected(42, 0);
+    ok = ok && controller_recorded_tas_seek(42);
+    pad = read_tick();
+    ok = ok && same(&pad, &want) && !controller_recorded_tas_seek(MOVIE_FRAMES + 1);
+    controller_recorded_tas_set_loop(true, 10);
+    controller_recorded_tas_seek(MOVIE_FRAMES - 1);
+    want = expected(MOVIE_FRAMES - 1, 0);
+    pad = read_tick();
+    ok = ok && same(&pad, &want);
+    want = expected(10, 0);
+    pad = read_tick();
+    ok = ok && same(&pad, &want) && controller_recorded_tas_tell() == 11;
+    return ok;
+}
+
+static bool check_validation(void) {
+    // a header claiming more than the file holds plays what is there
+    write_movie(MOVIE_FRAMES + 20, "M64\x1A");
+    bool ok = controller_recorded_tas_open(MOVIE_PATH) && controller_recorded_tas_frame_count() == MOVIE_FRAMES;
+    // one claiming less stops where it says
+    write_movie(MOVIE_FRAMES - 20, "M64\x1A");
+    ok = ok && controller_recorded_tas_open(MOVIE_PATH) && controller_recorded_tas_frame_count() == MOVIE_FRAMES - 20;
+    write_movie(MOVIE_FRAMES, "M65\x1A");
+    ok = ok && !controller_recorded_tas_open(MOVIE_PATH) && controller_recorded_tas_frame_count() == 0;
+    ok = ok && !controller_recorded_tas_open("tas_bench_missing.m64");
+    return ok;
+}
+
+static bool check_recording(void) {
+    const u32 frames = 150;
+    bool ok = controller_recorded_tas_record(MOVIE_PATH) && controller_recorded_tas_recording();
+    for (u32 frame = 0; frame < frames; frame++) {
+        OSContPad pad = expected(frame, 0);
+        controller_recorded_tas_capture(&pad);
+    }
+    // two flushes on the way, one at the end
+    ok = ok && sPersistWrites == 2;
+    controller_recorded_tas_stop_recording();
+    ok = ok && sPersistWrites == 3 && !controller_recorded_tas_recording()
+            && sPersistedSize == M64_HEADER_SIZE + frames * M64_SAMPLE_SIZE;
+    if (!ok) { return false; }
+
+    FILE *fp = fopen(MOVIE_PATH, "wb");
+    fwrite(sPersisted, 1, sPersistedSize, fp);
+    fclose(fp);
+    ok = controller_recorded_tas_open(MOVIE_PATH) && controller_recorded_tas_frame_count() == frames
+      && controller_recorded_tas_controller_count() == 1;
+    for (u32 frame = 0; ok && frame < frames; frame++) {
+        OSContPad want = expected(frame, 0);
+        OSContPad pad = read_tick();
+        ok = same(&pad, &want);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    u32 count = 20000000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            count = (u32)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-n reads]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    bool playback = check_playback();
+    bool validation = check_validation();
+    bool recording = check_recording();
+    printf("tas_bench: playback, seek and loop: %s\n", playback ? "ok" : "FAILED");
+    printf("tas_bench: header validation: %s\n", validation ? "ok" : "FAILED");
+    printf("tas_bench: record and replay: %s\n", recording ? "ok" : "FAILED");
+    if (!playback || !validation || !recording) {
+        remove(MOVIE_PATH);
+        return 1;
+    }
+
+    write_movie(MOVIE_FRAMES, "M64\x1A");
+    controller_recorded_tas_open(MOVIE_PATH);
+    controller_recorded_tas_set_loop(true, 0);
+    u32 sink = 0;
+    double start = bench_now();
+    for (u32 i = 0; i < count; i++) {
+        OSContPad pad = read_tick();
+        sink += pad.button;
+    }
+    double elapsed = bench_now() - start;
+    printf("tas_bench: read %6.1fns (%u)\n", elapsed / count * 1e9, sink & 1);
+
+    controller_recorded_tas.shutdown();
+    remove(MOVIE_PATH);
+    free(sPersisted);
+    return 0;
+}
@@ -0,0 +1,193 @@
+// text_bench: builds the display list for a 1000 glyph HUD string both ways
+// djui_hud_print_text can: one djui_gfx_render_texture_tile call and one
+// translation matrix per glyph, as before, and as a text run through
+// djui_gfx.c. Reports the Gfx commands emitted and the CPU time spent per 1000
+// glyphs for each, then walks both display lists and checks that they draw
+// the same triangles (positions after the per-glyph matrices, and UVs).
+//
+// usage: text_bench [-n iterations]
+//   -n  times each display list is built (default 2000)
+//
+// Only the display list is built and timed here; gfx_pc.c's cost of
+// interpreting it scales with the command count reported next to the time.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "../src/pc/djui/djui_gfx.c"
+
+#define GLYPHS 1000
+#define DL_COMMANDS 0x10000
+#define DL_POOL_SIZE (4 * 1024 * 1024)
+
+// what the rest of the game would provide
+Gfx *gDisplayListHead;
+unsigned int configDjuiScale;
+static Gfx sDisplayList[DL_COMMANDS];
+static u8 sPool[DL_POOL_SIZE] __attribute__((aligned(16)));
+static size_t sPoolUsed;
+
+void *alloc_display_list(u32 size) {
+    size = (size + 7) & ~7;
+    if (sPoolUsed + size > sizeof(sPool)) {
+        return NULL;
+    }
+    void *ret = sPool + sPoolUsed;
+    sPoolUsed += size;
+    return ret;
+}
+
+void gfx_get_dimensions(u32 *width, u32 *height) {
+    *width = 1280;
+    *height = 720;
+}
+
+// create_dl_translation_matrix from ingame_menu.c, with guTranslate inlined
+void create_dl_translation_matrix(s8 pushOp, f32 x, f32 y, f32 z) {
+    Mtx *matrix = (Mtx *) alloc_display_list(sizeof(Mtx));
+    if (matrix == NULL) {
+        return;
+    }
+    memset(matrix, 0, sizeof(*matrix));
+    matrix->m[0][0] = matrix->m[1][1] = matrix->m[2][2] = matrix->m[3][3] = 1.0f;
+    matrix->m[3][0] = x;
+    matrix->m[3][1] = y;
+    matrix->m[3][2] = z;
+    gSPMatrix(gDisplayListHead++, matrix, G_MTX_MODELVIEW | G_MTX_MUL | (pushOp == DJUI_MTX_PUSH ? G_MTX_PUSH : G_MTX_NOPUSH));
+}
+
+static const Texture sAtlas[256 * 128 * 4];
+
+// the normal font's ASCII layout: 8x16 tiles, 32 per row of a 256x128 atlas
+static bool bench_glyph(char c, struct DjuiGfxGlyph *glyph) {
+    if (c == ' ') {
+        return false;
+    }
+    u32 index = (u8) c - '!';
+    *glyph = (struct DjuiGfxGlyph) { sAtlas, 256, 128, G_IM_SIZ_32b, (index % 32) * 8, (index / 32) * 16, 8, 16 };
+    return true;
+}
+
+static f32 bench_char_width(char c) {
+    return c == ' ' ? 0.30f : 0.25f + ((u8) c % 7) * 0.03f;
+}
+
+static void begin_list(void) {
+    gDisplayListHead = sDisplayList;
+    sPoolUsed = 0;
+    create_dl_translation_matrix(DJUI_MTX_PUSH, 10.0f, 200.0f, 0.0f);
+}
+
+static u32 end_list(void) {
+    gSPPopMatrix(gDisplayListHead++, G_MTX_MODELVIEW);
+    return (u32) (gDisplayListHead - sDisplayList);
+}
+
+// djui_hud_print_text's loop before text runs
+static u32 build_per_glyph(const char *text) {
+    struct DjuiGfxGlyph glyph;
+    begin_list();
+    for (const char *c = text; *c != '\0'; c++) {
+        if (bench_glyph(*c, &glyph)) {
+            djui_gfx_render_glyph(&glyph);
+        }
+        create_dl_translation_matrix(DJUI_MTX_NOPUSH, bench_char_width(*c), 0, 0);
+    }
+    return end_list();
+}
+
+static u32 build_text_run(const char *text) {
+    struct DjuiGfxGlyph glyph;
+    f32 x = 0;
+    begin_list();
+    djui_gfx_text_run_begin(false);
+    for (const char *c = text; *c != '\0'; c++) {
+        if (bench_glyph(*c, &glyph)) {
+            djui_gfx_text_run_add(&glyph, x, 0, NULL);
+        }
+        x += bench_char_width(*c);
+    }
+    djui_gfx_text_run_end();
+    return end_list();
+}
+
+struct Corner {
+    f32 x, y;
+    s16 u, v;
+};
+
+// Replays the matrices, vertex loads and triangles of the display list in
+// sDisplayList, keeping only the x translation the text paths use.
+static u32 walk_triangles(u32 commands, struct Corner *out, u32 max) {
+    const Vtx *loaded = NULL;
+    f32 tx = 0;
+    u32 count = 0;
+    for (u32 i = 0; i < commands; i++) {
+        const Gfx *cmd = &sDisplayList[i];
+        u32 op = (u32) (cmd->words.w0 >> 24) & 0xFF;
+        if (op == (u8) G_MTX) {
+            tx += ((const Mtx *) cmd->words.w1)->m[3][0];
+        } else if (op == G_VTX_EXT) {
+            loaded = (const Vtx *) cmd->words.w1;
+        } else if (op == G_TRI2_EXT) {
+            u32 idx[6] = {
+                (cmd->words.w0 >> 16) & 0xFF, (cmd->words.w0 >> 8) & 0xFF, cmd->words.w0 & 0xFF,
+                (cmd->words.w1 >> 16) & 0xFF, (cmd->words.w1 >> 8) & 0xFF, cmd->words.w1 & 0xFF,
+            };
+            for (u32 j = 0; j < 6 && count < max; j++) {
+                const Vtx_t *v = &loaded[idx[j] / 2].v;
+                out[count++] = (struct Corner) { v->ob[0] + tx, v->ob[1], v->tc[0], v->tc[1] };
+            }
+        }
+    }
+    return count;
+}
+
+static double time_build(u32 (*build)(const char *), const char *text, u32 iterations) {
+    double start = bench_now();
+    for (u32 i = 0; i < iterations; i++) {
+        build(text);
+    }
+    return (bench_now() - start) / iterations;
+}
+
+int main(int argc, char **argv) {
+    u32 iterations = 2000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            iterations = (u32) atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-n iterations]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // printable ASCII with a space every few glyphs, like HUD text
+    static char text[GLYPHS + 1];
+    for (u32 i = 0; i < GLYPHS; i++) {
+        text[i] = (i % 7 == 6) ? ' ' : (char) ('!' + (i * 13) % 94);
+    }
+    text[GLYPHS] = '\0';
+
+    static struct Corner before[GLYPHS * 6], after[GLYPHS * 6];
+    u32 beforeCommands = build_per_glyph(text);
+    u32 beforeCorners = walk_triangles(beforeCommands, before, GLYPHS * 6);
+    u32 afterCommands = build_text_run(text);
+    u32 afterCorners = walk_triangles(afterCommands, after, GLYPHS * 6);
+
+    bool same = beforeCorners == afterCorners && beforeCorners > 0;
+    for (u32 i = 0; same && i < beforeCorners; i++) {
+        same = fabsf(before[i].x - after[i].x) < 1e-3f && before[i].y == after[i].y &&
+               before[i].u == after[i].u && before[i].v == after[i].v;
+    }
+
+    double beforeTime = time_build(build_per_glyph, text, iterations);
+    double afterTime = time_build(build_text_run, text, iterations);
+    printf("text_bench: per glyph: %6u commands %8.1fus per 1000 glyphs\n", beforeCommands, beforeTime * 1e6);
+    printf("text_bench: text run : %6u commands %8.1fus per 1000 glyphs (%.1fx fewer commands, %.2fx faster)\n",
+           afterCommands, afterTime * 1e6, (double) beforeCommands / afterCommands, beforeTime / afterTime);
+    printf("text_bench: %u triangle corners, %s\n", beforeCorners, same ? "identical" : "MISMATCH");
+    return same ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+// vorbis_bench: decodes Ogg Vorbis files with the mod stream decoder
+// (src/pc/audio/vorbis.c) and reports CPU time per second of audio, the heap
+// the decoder holds, and whether the decoded length matches the final granule
+// position. Random seeks are checked against the straight decode.
+//
+// usage: vorbis_bench [-o output.pcm] file.ogg...
+//   -o  write the first file's interleaved s16 output
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "../src/pc/audio/vorbis.h"
+
+#define SEEK_CHECKS 16
+#define SEEK_FRAMES 2048
+
+static uint8_t *load(const char *path, uint32_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = length > 0 ? malloc((size_t)length) : NULL;
+    if (data != NULL && fread(data, 1, (size_t)length, f) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (uint32_t)length;
+    return data;
+}
+
+static int bench_file(const char *path, const char *output) {
+    uint32_t size;
+    uint8_t *data = load(path, &size);
+    if (data == NULL) {
+        fprintf(stderr, "vorbis_bench: could not read '%s'\n", path);
+        return 1;
+    }
+    vorbis_t *v = vorbis_open(data, size);
+    if (v == NULL) {
+        fprintf(stderr, "vorbis_bench: '%s' did not open\n", path);
+        free(data);
+        return 1;
+    }
+
+    uint32_t channels = vorbis_channels(v);
+    uint64_t length = vorbis_length(v);
+    size_t capacity = (size_t)(length + 4096) * channels;
+    int16_t *pcm = malloc(capacity * sizeof(int16_t));
+    if (pcm == NULL) {
+        fprintf(stderr, "vorbis_bench: out of memory\n");
+        return 1;
+    }
+
+    uint64_t frames = 0;
+    double start = bench_now();
+    for (;;) {
+        uint32_t want = 1024;
+        if ((frames + want) * channels > capacity) {
+            want = (uint32_t)(capacity / channels - frames);
+        }
+        int32_t got = want > 0 ? vorbis_read(v, pcm + frames * channels, want) : 0;
+        if (got <= 0) {
+            break;
+        }
+        frames += (uint64_t)got;
+    }
+    double elapsed = bench_now() - start;
+    double seconds = (double)frames / vorbis_rate(v);
+
+    // seeks must land on exactly the frames the straight decode produced
+    int16_t window[SEEK_FRAMES * 8];
+    uint32_t seed = 0x5eed1234;
+    uint32_t bad_seeks = 0;
+    for (int i = 0; i < SEEK_CHECKS && frames > 0; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        uint64_t target = (uint64_t)(seed >> 8) % frames;
+        vorbis_seek(v, target);
+        int32_t got = vorbis_read(v, window, SEEK_FRAMES);
+        uint64_t expect = frames - target < SEEK_FRAMES ? frames - target : SEEK_FRAMES;
+        if ((uint64_t)got != expect || memcmp(window, pcm + target * channels, (size_t)got * channels * sizeof(int16_t)) != 0) {
+            bad_seeks++;
+        }
+    }
+
+    printf("vorbis_bench: %s: %u ch, %u Hz, %.1fs: %.1fms, %.3fms per second of audio, %zu KB decoder + %u KB file\n",
+           path, channels, vorbis_rate(v), seconds, elapsed * 1000.0, elapsed * 1000.0 / seconds,
+           vorbis_memory(v) / 1024, size / 1024);
+
+    int result = 0;
+    if (length != 0 && frames != length) {
+        printf("vorbis_bench: %s: decoded %llu frames, last granule says %llu\n",
+               path, (unsigned long long)frames, (unsigned long long)length);
+        result = 1;
+    }
+    if (bad_seeks != 0) {
+        printf("vorbis_bench: %s: %u of %d seeks did not match the straight decode\n", path, bad_seeks, SEEK_CHECKS);
+        result = 1;
+    }
+    if (output != NULL) {
+        FILE *f = fopen(output, "wb");
+        if (f == NULL || fwrite(pcm, channels * sizeof(int16_t), (size_t)frames, f) != (size_t)frames) {
+            fprintf(stderr, "vorbis_bench: could not write '%s'\n", output);
+            result = 1;
+        }
+        if (f != NULL) {
+            fclose(f);
+        }
+    }
+
+    free(pcm);
+    vorbis_close(v);
+    free(data);
+    return result;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: vorbis_bench [-o output.pcm] file.ogg...\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *output = NULL;
+    int first = 1;
+
+    if (argc > 2 && !strcmp(argv[1], "-o")) {
+        output = argv[2];
+        first = 3;
+    }
+    if (first >= argc) {
+        usage();
+    }
+
+    int result = 0;
+    for (int i = first; i < argc; i++) {
+        result |= bench_file(argv[i], i == first ? output : NULL);
+    }
+    return result;
+}